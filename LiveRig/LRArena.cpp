@@ -0,0 +1,164 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "LRArena.hpp"
+
+LRArena::LRArena() :
+	_planSize(0),
+	_alloc(NULL),
+	_region(NULL),
+	_capacity(0)
+{
+	memset(_size, 0, sizeof(_size));
+	memset(_offset, 0, sizeof(_offset));
+	memset(_conflict, 0, sizeof(_conflict));
+}
+
+LRArena::~LRArena()
+{
+	Free();
+}
+
+uint32_t LRArena::Align(uint32_t size)
+{
+	return (size + LR_ARENA_ALIGN - 1) & ~(uint32_t)(LR_ARENA_ALIGN - 1);
+}
+
+void LRArena::Reset()
+{
+	Free();
+
+	memset(_size, 0, sizeof(_size));
+	memset(_offset, 0, sizeof(_offset));
+	memset(_conflict, 0, sizeof(_conflict));
+	_planSize = 0;
+}
+
+void LRArena::SetSize(int32_t stage, uint32_t size)
+{
+	_size[stage] = size;
+}
+
+uint32_t LRArena::GetStageSize(int32_t stage) const
+{
+	return _size[stage];
+}
+
+void LRArena::SetConflict(int32_t a, int32_t b)
+{
+	_conflict[a] |= 1u << b;
+	_conflict[b] |= 1u << a;
+}
+
+bool LRArena::IsConflict(int32_t a, int32_t b) const
+{
+	return (_conflict[a] & (1u << b)) != 0;
+}
+
+uint32_t LRArena::Plan()
+{
+	bool placed[LR_ARENA_STAGE_MAX];
+	for (int32_t i = 0; i < LR_ARENA_STAGE_MAX; i++)
+		placed[i] = false;
+
+	_planSize = 0;
+
+	while (1) {
+		// Largest unplaced stage next, ties in stage order so that plans are repeatable
+		int32_t stage = -1;
+		for (int32_t i = 0; i < LR_ARENA_STAGE_MAX; i++) {
+			if (!placed[i] && _size[i] > 0 && (stage < 0 || _size[i] > _size[stage]))
+				stage = i;
+		}
+		if (stage < 0)
+			break;
+
+		const uint32_t size = Align(_size[stage]);
+
+		// Lowest offset clear of every placed conflicting stage. A collision moves the candidate
+		// past the colliding stage, which ends after the candidate started, so this terminates.
+		uint32_t offset = 0;
+		bool moved = true;
+		while (moved) {
+			moved = false;
+
+			for (int32_t i = 0; i < LR_ARENA_STAGE_MAX; i++) {
+				if (!placed[i] || !IsConflict(stage, i))
+					continue;
+
+				const uint32_t end = _offset[i] + Align(_size[i]);
+				if (offset < end && _offset[i] < offset + size) {
+					offset = end;
+					moved = true;
+				}
+			}
+		}
+
+		_offset[stage] = offset;
+		placed[stage] = true;
+
+		if (offset + size > _planSize)
+			_planSize = offset + size;
+	}
+
+	return _planSize;
+}
+
+bool LRArena::Reserve()
+{
+	if (_planSize <= _capacity)
+		return true;
+
+	Free();
+
+	_alloc = malloc(_planSize + LR_ARENA_ALIGN - 1);
+	if (_alloc == NULL)
+		return false;
+
+	_region = (uint8_t *)(((uintptr_t)_alloc + LR_ARENA_ALIGN - 1) & ~(uintptr_t)(LR_ARENA_ALIGN - 1));
+	_capacity = _planSize;
+
+	return true;
+}
+
+void LRArena::Free()
+{
+	free(_alloc);
+
+	_alloc = NULL;
+	_region = NULL;
+	_capacity = 0;
+}
+
+void *LRArena::Get(int32_t stage) const
+{
+	if (_region == NULL || _size[stage] == 0 || _offset[stage] + _size[stage] > _capacity)
+		return NULL;
+
+	return _region + _offset[stage];
+}
+
+uint32_t LRArena::GetOffset(int32_t stage) const
+{
+	return _offset[stage];
+}
+
+uint32_t LRArena::GetSize() const
+{
+	return _planSize;
+}
+
+uint32_t LRArena::GetSeparateSize() const
+{
+	uint32_t size = 0;
+	for (int32_t i = 0; i < LR_ARENA_STAGE_MAX; i++)
+		size += Align(_size[i]);
+
+	return size;
+}
+
+uint32_t LRArena::GetCapacity() const
+{
+	return _capacity;
+}
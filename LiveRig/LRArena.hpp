@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stdint.h>
+
+// One allocation for the working memory of several stages.
+//
+// Stages declare their size and which other stages can be running at the same time. Stages
+// that never overlap in time share addresses, stages that can overlap get disjoint regions.
+// Plan() places the largest stages first, each at the lowest offset that does not collide
+// with a conflicting stage already placed, so the region ends up close to the largest
+// concurrent requirement instead of the sum of all stages.
+//
+// Working memory is scratch: a stage must not expect its contents to survive until its next
+// run, and a region may move whenever the plan grows.
+//
+// Only depends on the C library so that layouts can be checked on the host.
+
+#define LR_ARENA_STAGE_MAX		16
+#define LR_ARENA_ALIGN			64
+
+class LRArena
+{
+public:
+
+	LRArena();
+
+	~LRArena();
+
+	// Forgets sizes and conflicts and frees the region
+	void Reset();
+
+	// 0 leaves the stage out of the plan
+	void SetSize(int32_t stage, uint32_t size);
+
+	uint32_t GetStageSize(int32_t stage) const;
+
+	// Stages a and b can be running at the same time
+	void SetConflict(int32_t a, int32_t b);
+
+	bool IsConflict(int32_t a, int32_t b) const;
+
+	// Places every stage with a size, returns the region size needed
+	uint32_t Plan();
+
+	// Grows the region to the planned size, the contents are not kept. False if out of memory.
+	bool Reserve();
+
+	void Free();
+
+	// Region of a planned stage, NULL without a region or size
+	void *Get(int32_t stage) const;
+
+	uint32_t GetOffset(int32_t stage) const;
+
+	// Planned size, and what separate aligned buffers for every stage would take
+	uint32_t GetSize() const;
+
+	uint32_t GetSeparateSize() const;
+
+	uint32_t GetCapacity() const;
+
+private:
+
+	uint32_t _size[LR_ARENA_STAGE_MAX];
+	uint32_t _offset[LR_ARENA_STAGE_MAX];
+	uint32_t _conflict[LR_ARENA_STAGE_MAX];	// bit per stage
+
+	uint32_t _planSize;
+
+	void *_alloc;	// as returned by malloc()
+	uint8_t *_region;	// aligned start
+	uint32_t _capacity;
+
+	static uint32_t Align(uint32_t size);
+};
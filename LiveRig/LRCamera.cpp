@@ -1,234 +1,906 @@
-#include <kernel.h>
-#include <camera.h>
-#include <scetypes.h>
-#include <libdbg.h>
-#include <gxm.h>
-#include <kernel\dmacmgr.h>
-#include <stdlib.h>
-#include <vita2d_sys.h>
-
-#include <target_transport.h>
-
-#include "LRCamera.hpp"
-#include "LRUtil.hpp"
-#include "LRGXM.hpp"
-
-namespace {
-	LRCamera *s_instance = SCE_NULL;
-}
-
-LRCamera::LRCamera() :
-	_camCtrl({0})
-{
-	SceInt32 ret;
-
-	_camCtrl.cameraStatus = CAMERA_INVALID;
-	_camCtrl.cameraDevNum = -1;
-
-	//camera open
-	_camCtrl.cameraInfo.sizeThis = sizeof(SceCameraInfo);
-	_camCtrl.cameraInfo.wPriority = SCE_CAMERA_PRIORITY_SHARE;
-	_camCtrl.cameraInfo.wFormat = SCE_CAMERA_FORMAT_YUV420_PLANE;
-	_camCtrl.cameraInfo.wResolution = SCE_CAMERA_RESOLUTION_QQVGA;
-	_camCtrl.cameraInfo.wFramerate = SCE_CAMERA_FRAMERATE_60;
-	_camCtrl.cameraInfo.wBuffer = SCE_CAMERA_BUFFER_SETBYOPEN;
-
-	_tex = vita2d_create_empty_texture_null();
-	SceSize bufSize = ROUND_UP(_cameraWidth * _cameraHeight * 3 / 2, 0x1000);
-	sceGxmAllocDeviceMemLinux(SCE_GXM_DEVICE_HEAP_ID_USER_NC, SCE_GXM_MEMORY_ATTRIB_READ, bufSize, 256, &_tex->data_mem);
-	sceGxmTextureInitLinear(&_tex->gxm_tex, _tex->data_mem->mappedBase, SCE_GXM_TEXTURE_FORMAT_YUV420P2_CSC0, _cameraWidth, _cameraHeight, 0);
-
-	_camCtrl.cameraInfo.pvIBase = _tex->data_mem->mappedBase;
-	_camCtrl.cameraInfo.pvUBase = static_cast<unsigned char*>(_camCtrl.cameraInfo.pvIBase) + _cameraWidth * _cameraHeight;
-	_camCtrl.cameraInfo.pvVBase = static_cast<unsigned char*>(_camCtrl.cameraInfo.pvUBase) + _cameraWidth * _cameraHeight / 4;
-
-	_camCtrl.cameraInfo.sizeIBase = _cameraWidth * _cameraHeight;
-	_camCtrl.cameraInfo.sizeUBase = _cameraWidth * _cameraHeight / 4;
-	_camCtrl.cameraInfo.sizeVBase = _cameraWidth * _cameraHeight / 4;
-
-	_camCtrl.cameraCpuIBufMemblock = sceKernelAllocMemBlock("LRCamera::IBufffer", SCE_KERNEL_MEMBLOCK_TYPE_USER_RW, ROUND_UP(_camCtrl.cameraInfo.sizeIBase, SCE_KERNEL_4KiB), SCE_NULL);
-	if (_camCtrl.cameraCpuIBufMemblock <= 0)
-		SCE_DBG_LOG_ERROR("[LRCamera] sceKernelAllocMemBlock() 0x%X\n", _camCtrl.cameraCpuIBufMemblock);
-
-	sceKernelGetMemBlockBase(_camCtrl.cameraCpuIBufMemblock, &_camCtrl.cameraCpuIBuffer);
-
-	_camCtrl.cameraInfo.wPitch = 0;
-	_camCtrl.cameraStatus = CAMERA_CLOSE;
-
-	ret = sceCameraOpen(SCE_CAMERA_DEVICE_FRONT, &_camCtrl.cameraInfo);
-	if (ret < 0)
-		SCE_DBG_LOG_ERROR("[LRCamera] sceCameraOpen():SCE_CAMERA_DEVICE_FRONT 0x%X\n", ret);
-
-	/*ret = sceCameraOpen(SCE_CAMERA_DEVICE_BACK, &_camCtrl.cameraInfo);
-	if (ret < 0)
-		SCE_DBG_LOG_ERROR("[LRCamera] sceCameraOpen():SCE_CAMERA_DEVICE_BACK 0x%X\n", ret);*/
-
-	_camCtrl.cameraBuffer = _tex->data_mem->mappedBase;
-	_camCtrl.cameraBufSize = bufSize;
-
-	_camCtrl.cameraStatus = CAMERA_OPEN;
-
-	s_instance = this;
-}
-
-LRCamera::~LRCamera()
-{
-	SceInt32 ret;
-
-	if (_camCtrl.cameraStatus == CAMERA_OPEN) {
-		ret = sceCameraClose(SCE_CAMERA_DEVICE_FRONT);
-		if (ret < 0)
-			SCE_DBG_LOG_ERROR("[LRCamera] sceCameraClose(SCE_CAMERA_DEVICE_FRONT) 0x%X\n", ret);
-
-		/*ret = sceCameraClose(SCE_CAMERA_DEVICE_BACK);
-		if (ret < 0)
-			SCE_DBG_LOG_ERROR("[LRCamera] sceCameraClose(SCE_CAMERA_DEVICE_BACK) 0x%X\n", ret);*/
-
-		_camCtrl.cameraStatus = CAMERA_CLOSE;
-	}
-
-	if (_camCtrl.cameraStatus == CAMERA_CLOSE) {
-		vita2d_free_texture(_tex);
-		_camCtrl.cameraBuffer = SCE_NULL;
-		_camCtrl.cameraBufSize = 0;
-		_tex = SCE_NULL;
-		sceKernelFreeMemBlock(_camCtrl.cameraCpuIBufMemblock);
-		_camCtrl.cameraCpuIBufMemblock = SCE_UID_INVALID_UID;
-		_camCtrl.cameraCpuIBuffer = SCE_NULL;
-	}
-
-	_camCtrl.cameraStatus = CAMERA_INVALID;
-}
-
-LRCamera *LRCamera::GetInstance()
-{
-	if (s_instance == SCE_NULL)
-	{
-		s_instance = new LRCamera();
-	}
-
-	return s_instance;
-}
-
-SceVoid LRCamera::ReleaseInstance()
-{
-	if (s_instance != SCE_NULL)
-	{
-		delete s_instance;
-	}
-
-	s_instance = SCE_NULL;
-}
-
-SceInt32 LRCamera::Start(SceInt32 dev)
-{
-	SceInt32 ret = 0;
-
-	if (_camCtrl.cameraStatus != CAMERA_OPEN)
-		return ret;
-
-	//camera start
-	ret = sceCameraStart(dev);
-	if (ret < 0) {
-		SCE_DBG_LOG_ERROR("[LRCamera] sceCameraStart() 0x%X\n", ret);
-		return ret;
-	}
-	_camCtrl.cameraDevNum = dev;
-	_camCtrl.cameraStatus = CAMERA_START;
-
-	_camCtrl.cameraRead.sizeThis = sizeof(SceCameraRead);
-
-	return 0;
-}
-
-SceInt32 LRCamera::Update(
-	unsigned char **buf,
-	SceInt32 *width,
-	SceInt32 *height,
-	SceUInt64 *frame,
-	SceUInt64 *timestamp,
-	SceBool iBufOnly
-)
-{
-	SceInt32 ret = 0;
-
-	if (_camCtrl.cameraStatus != CAMERA_START)
-		return ret;
-
-	LRGXM::GetInstance()->WaitRenderingDone();
-	ret = sceCameraRead(_camCtrl.cameraDevNum, &_camCtrl.cameraRead);
-
-	if ((ret < 0) && (ret != SCE_CAMERA_ERROR_ALREADY_READ)) {
-		SCE_DBG_LOG_ERROR("[LRCamera] sceCameraRead() 0x%X\n", ret);
-		return ret;
-	}
-
-	if (iBufOnly) {
-		sceClibMemcpy(_camCtrl.cameraCpuIBuffer, _camCtrl.cameraInfo.pvIBase, _camCtrl.cameraInfo.sizeIBase);
-		*buf = static_cast<unsigned char*>(_camCtrl.cameraCpuIBuffer);
-	}
-	else {
-		*buf = static_cast<unsigned char*>(_camCtrl.cameraInfo.pvIBase);
-	}
-
-	*width = _cameraWidth;
-	*height = _cameraHeight;
-
-	*frame = _camCtrl.cameraRead.qwFrame;
-	*timestamp = _camCtrl.cameraRead.qwTimestamp;
-
-	return ret;
-}
-
-SceInt32 LRCamera::Stop()
-{
-	SceInt32 ret = 0;
-
-	if (_camCtrl.cameraStatus != CAMERA_START)
-		return ret;
-
-	ret = sceCameraStop(_camCtrl.cameraDevNum);
-	if (ret < 0) {
-		SCE_DBG_LOG_ERROR("[LRCamera] sceCameraStop() 0x%X\n", ret);
-		return ret;
-	}
-	_camCtrl.cameraDevNum = -1;
-	_camCtrl.cameraStatus = CAMERA_OPEN;
-
-	return 0;
-}
-
-SceInt32 LRCamera::GetBuffer(ScePVoid *ptr, SceInt32 *size)
-{
-	if (!_camCtrl.cameraBuffer) return -1;
-
-	*ptr = _camCtrl.cameraBuffer;
-	*size = _camCtrl.cameraBufSize;
-	return 0;
-}
-
-SceInt32 LRCamera::GetIBuffer(ScePVoid *ptr, SceInt32 *size)
-{
-	if (!_camCtrl.cameraCpuIBuffer) return -1;
-
-	*ptr = _camCtrl.cameraCpuIBuffer;
-	*size = _camCtrl.cameraInfo.sizeIBase;
-	return 0;
-}
-
-SceVoid LRCamera::GetSize(SceInt32 *width, SceInt32 *height)
-{
-	*width = _cameraWidth;
-	*height = _cameraHeight;
-}
-
-SceVoid LRCamera::SetEv(SceInt32 level)
-{
-	if (_camCtrl.cameraStatus == CAMERA_START)
-		sceCameraSetEV(_camCtrl.cameraDevNum, level);
-}
-
-SceVoid LRCamera::DrawCamTex()
-{
-	vita2d_draw_texture(_tex, 0, 0);	
+#include <kernel.h>
+#include <camera.h>
+#include <scetypes.h>
+#include <libdbg.h>
+#include <gxm.h>
+#include <kernel\dmacmgr.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vita2d_sys.h>
+
+#include <target_transport.h>
+
+#include "LRCamera.hpp"
+#include "LRUtil.hpp"
+#include "LRGXM.hpp"
+#include "LRCaptureFile.hpp"
+
+namespace {
+	LRCamera *s_instance = SCE_NULL;
+}
+
+LRCamera::LRCamera() :
+	_camCtrl({0}),
+	_cameraWidth(0),
+	_cameraHeight(0),
+	_replayRealtime(SCE_TRUE),
+	_replayFinished(SCE_FALSE),
+	_replayFrameCount(0),
+	_replayBaseTime(0),
+	_replayBaseTimestamp(0),
+	_recordThread(SCE_UID_INVALID_UID),
+	_recordMemblock(SCE_UID_INVALID_UID),
+	_recordFreeSema(SCE_UID_INVALID_UID),
+	_recordFullSema(SCE_UID_INVALID_UID),
+	_recordHead(0),
+	_recordTail(0),
+	_recordDropCount(0),
+	_recordExit(SCE_FALSE),
+	_recordFailed(SCE_FALSE),
+	_captureThread(SCE_UID_INVALID_UID),
+	_captureExit(SCE_FALSE),
+	_lastQwFrame(0),
+	_lastCaptureTime(0),
+	_deliveredSeq(0)
+{
+	sceKernelCreateLwMutex(&_backendMtx, "LRCamera:BackendMtx", 0, 0, NULL);
+
+	sceClibMemset(&_captureStats, 0, sizeof(LRCaptureStats));
+
+	// Camera timestamps are on the system clock
+	_sensorTimeOffset = sceKernelGetSystemTimeWide() - sceKernelGetProcessTimeWide();
+
+	_captureEvf = sceKernelCreateEventFlag("LRCamera:CaptureEvf", SCE_KERNEL_EVF_ATTR_MULTI, LR_CAMERA_EVF_CONSUMED, NULL);
+	if (_captureEvf <= 0)
+		SCE_DBG_LOG_ERROR("[LRCamera] sceKernelCreateEventFlag() 0x%X\n", _captureEvf);
+
+	_camCtrl.cameraStatus = CAMERA_INVALID;
+	_camCtrl.cameraDevNum = -1;
+
+	_frameRing.SetTimeline(LRGXM::GetInstance());
+
+	//camera open
+	_camCtrl.cameraInfo.sizeThis = sizeof(SceCameraInfo);
+	_camCtrl.cameraInfo.wPriority = SCE_CAMERA_PRIORITY_SHARE;
+	_camCtrl.cameraInfo.wFormat = SCE_CAMERA_FORMAT_YUV420_PLANE;
+	_camCtrl.cameraInfo.wFramerate = SCE_CAMERA_FRAMERATE_60;
+	_camCtrl.cameraInfo.wBuffer = SCE_CAMERA_BUFFER_SETBYREAD;
+	_camCtrl.cameraInfo.wPitch = 0;
+
+	SetResolutionParam(SCE_CAMERA_RESOLUTION_QQVGA);
+	AllocBuffers();
+
+	_camCtrl.cameraStatus = CAMERA_CLOSE;
+
+	OpenDevice();
+
+	s_instance = this;
+}
+
+LRCamera::~LRCamera()
+{
+	if (_captureThread > 0) {
+		_captureExit = SCE_TRUE;
+		sceKernelWaitThreadEnd(_captureThread, NULL, NULL);
+		sceKernelDeleteThread(_captureThread);
+	}
+
+	StopRecordThread();
+
+	sceKernelDeleteEventFlag(_captureEvf);
+
+	CloseDevice();
+
+	if (_camCtrl.cameraStatus == CAMERA_CLOSE)
+		FreeBuffers();
+
+	_camCtrl.cameraStatus = CAMERA_INVALID;
+}
+
+SceVoid LRCamera::SetResolutionParam(SceInt32 resolution)
+{
+	switch (resolution) {
+	case SCE_CAMERA_RESOLUTION_VGA:
+		_cameraWidth = 640;
+		_cameraHeight = 480;
+		break;
+	case SCE_CAMERA_RESOLUTION_QVGA:
+		_cameraWidth = 320;
+		_cameraHeight = 240;
+		break;
+	default:
+		resolution = SCE_CAMERA_RESOLUTION_QQVGA;
+		_cameraWidth = 160;
+		_cameraHeight = 120;
+		break;
+	}
+
+	_camCtrl.cameraInfo.wResolution = resolution;
+}
+
+SceVoid LRCamera::AllocBuffers()
+{
+	// Every ring slot holds a whole YUV420 frame in cached memory that is also mapped for the GPU.
+	// The camera writes into it, libface reads the Y plane and the preview samples it, all in place.
+	SceSize slotSize = ROUND_UP(_cameraWidth * _cameraHeight * 3 / 2, SCE_KERNEL_4KiB);
+	SceSize blockSize = ROUND_UP(slotSize * _frameRingSize, SCE_KERNEL_256KiB);
+
+	_camCtrl.cameraFrameMemblock = sceKernelAllocMemBlock("LRCamera::FrameRing", SCE_KERNEL_MEMBLOCK_TYPE_USER_RW, blockSize, SCE_NULL);
+	if (_camCtrl.cameraFrameMemblock <= 0)
+		SCE_DBG_LOG_ERROR("[LRCamera] sceKernelAllocMemBlock() 0x%X\n", _camCtrl.cameraFrameMemblock);
+
+	sceKernelGetMemBlockBase(_camCtrl.cameraFrameMemblock, &_camCtrl.cameraFrameBuffer);
+
+	SceInt32 ret = sceGxmMapMemory(_camCtrl.cameraFrameBuffer, blockSize, SCE_GXM_MEMORY_ATTRIB_READ);
+	if (ret != SCE_OK)
+		SCE_DBG_LOG_ERROR("[LRCamera] sceGxmMapMemory() 0x%X\n", ret);
+
+	for (int i = 0; i < _frameRingSize; i++) {
+		unsigned char *slotBase = static_cast<unsigned char*>(_camCtrl.cameraFrameBuffer) + slotSize * i;
+
+		_frameRing.SetBuffer(i, slotBase, _cameraWidth, _cameraHeight, _cameraWidth);
+
+		// Texture memory is owned by the ring, not by vita2d
+		_tex[i] = vita2d_create_empty_texture_null();
+		_tex[i]->data_mem = SCE_NULL;
+		sceGxmTextureInitLinear(&_tex[i]->gxm_tex, slotBase, SCE_GXM_TEXTURE_FORMAT_YUV420P2_CSC0, _cameraWidth, _cameraHeight, 0);
+	}
+
+	_frameRing.Reset();
+
+	_camCtrl.cameraInfo.pvIBase = _camCtrl.cameraFrameBuffer;
+	_camCtrl.cameraInfo.pvUBase = static_cast<unsigned char*>(_camCtrl.cameraInfo.pvIBase) + _cameraWidth * _cameraHeight;
+	_camCtrl.cameraInfo.pvVBase = static_cast<unsigned char*>(_camCtrl.cameraInfo.pvUBase) + _cameraWidth * _cameraHeight / 4;
+
+	_camCtrl.cameraInfo.sizeIBase = _cameraWidth * _cameraHeight;
+	_camCtrl.cameraInfo.sizeUBase = _cameraWidth * _cameraHeight / 4;
+	_camCtrl.cameraInfo.sizeVBase = _cameraWidth * _cameraHeight / 4;
+
+	if (_lumaNorm.Init(_cameraWidth, _cameraHeight) < 0)
+		SCE_DBG_LOG_ERROR("[LRCamera] luma normalization init failed\n");
+
+	_camCtrl.cameraBufSize = slotSize;
+	_camCtrl.cameraFrameBlockSize = blockSize;
+}
+
+SceVoid LRCamera::FreeBuffers()
+{
+	for (int i = 0; i < _frameRingSize; i++) {
+		vita2d_free_texture(_tex[i]);
+		_tex[i] = SCE_NULL;
+	}
+
+	sceGxmUnmapMemory(_camCtrl.cameraFrameBuffer);
+	sceKernelFreeMemBlock(_camCtrl.cameraFrameMemblock);
+
+	_camCtrl.cameraBufSize = 0;
+	_camCtrl.cameraFrameBlockSize = 0;
+	_camCtrl.cameraFrameMemblock = SCE_UID_INVALID_UID;
+	_camCtrl.cameraFrameBuffer = SCE_NULL;
+	_lumaNorm.Term();
+}
+
+SceInt32 LRCamera::OpenDevice()
+{
+	SceInt32 ret;
+
+	if (_camCtrl.cameraStatus != CAMERA_CLOSE)
+		return 0;
+
+	ret = sceCameraOpen(SCE_CAMERA_DEVICE_FRONT, &_camCtrl.cameraInfo);
+	if (ret < 0) {
+		SCE_DBG_LOG_ERROR("[LRCamera] sceCameraOpen():SCE_CAMERA_DEVICE_FRONT 0x%X\n", ret);
+		return ret;
+	}
+
+	/*ret = sceCameraOpen(SCE_CAMERA_DEVICE_BACK, &_camCtrl.cameraInfo);
+	if (ret < 0)
+		SCE_DBG_LOG_ERROR("[LRCamera] sceCameraOpen():SCE_CAMERA_DEVICE_BACK 0x%X\n", ret);*/
+
+	_camCtrl.cameraStatus = CAMERA_OPEN;
+
+	return 0;
+}
+
+SceVoid LRCamera::CloseDevice()
+{
+	SceInt32 ret;
+
+	if (_camCtrl.cameraStatus == CAMERA_OPEN) {
+		ret = sceCameraClose(SCE_CAMERA_DEVICE_FRONT);
+		if (ret < 0)
+			SCE_DBG_LOG_ERROR("[LRCamera] sceCameraClose(SCE_CAMERA_DEVICE_FRONT) 0x%X\n", ret);
+
+		/*ret = sceCameraClose(SCE_CAMERA_DEVICE_BACK);
+		if (ret < 0)
+			SCE_DBG_LOG_ERROR("[LRCamera] sceCameraClose(SCE_CAMERA_DEVICE_BACK) 0x%X\n", ret);*/
+
+		_camCtrl.cameraStatus = CAMERA_CLOSE;
+	}
+}
+
+SceInt32 LRCamera::SetResolution(SceInt32 resolution)
+{
+	SceInt32 ret = 0;
+
+	sceKernelLockLwMutex(&_backendMtx, 1, NULL);
+
+	if (resolution == _camCtrl.cameraInfo.wResolution) {
+		sceKernelUnlockLwMutex(&_backendMtx, 1);
+		return 0;
+	}
+
+	// Recordings are tied to the resolution they were made with
+	StopRecordThread();
+	_replay.Close();
+
+	SceInt32 dev = _camCtrl.cameraDevNum;
+	SceBool wasStarted = (_camCtrl.cameraStatus == CAMERA_START);
+
+	if (wasStarted)
+		Stop();
+
+	CloseDevice();
+
+	// Rare reconfiguration, a full GPU wait before freeing the textures is fine here
+	LRGXM::GetInstance()->WaitRenderingDone();
+	FreeBuffers();
+
+	SetResolutionParam(resolution);
+	AllocBuffers();
+
+	ret = OpenDevice();
+	if (ret == 0 && wasStarted)
+		ret = Start(dev);
+
+	sceKernelUnlockLwMutex(&_backendMtx, 1);
+
+	return ret;
+}
+
+SceInt32 LRCamera::GetResolution()
+{
+	return _camCtrl.cameraInfo.wResolution;
+}
+
+LRCamera *LRCamera::GetInstance()
+{
+	if (s_instance == SCE_NULL)
+	{
+		s_instance = new LRCamera();
+	}
+
+	return s_instance;
+}
+
+SceVoid LRCamera::ReleaseInstance()
+{
+	if (s_instance != SCE_NULL)
+	{
+		delete s_instance;
+	}
+
+	s_instance = SCE_NULL;
+}
+
+SceInt32 LRCamera::Start(SceInt32 dev)
+{
+	SceInt32 ret = 0;
+
+	if (_camCtrl.cameraStatus != CAMERA_OPEN)
+		return ret;
+
+	//camera start
+	ret = sceCameraStart(dev);
+	if (ret < 0) {
+		SCE_DBG_LOG_ERROR("[LRCamera] sceCameraStart() 0x%X\n", ret);
+		return ret;
+	}
+	_camCtrl.cameraDevNum = dev;
+	_camCtrl.cameraStatus = CAMERA_START;
+
+	_lastQwFrame = 0;
+	_lastCaptureTime = 0;
+
+	_camCtrl.cameraRead.sizeThis = sizeof(SceCameraRead);
+
+	// Reads are issued from the capture thread, block there until the next frame is ready
+	_camCtrl.cameraRead.dwMode = SCE_CAMERA_READ_MODE_WAIT_NEXTFRAME_ON;
+
+	return 0;
+}
+
+SceInt32 LRCamera::StartCapture()
+{
+	if (_captureThread > 0)
+		return 0;
+
+	_captureExit = SCE_FALSE;
+
+	_captureThread = sceKernelCreateThread("LRCamera:CaptureThread", CaptureThreadStart, 60, 0x10000, 0, SCE_KERNEL_CPU_MASK_USER_2, NULL);
+	if (_captureThread < 0) {
+		SCE_DBG_LOG_ERROR("[LRCamera] sceKernelCreateThread() 0x%X\n", _captureThread);
+		return _captureThread;
+	}
+
+	return sceKernelStartThread(_captureThread, 0, NULL);
+}
+
+SceInt32 LRCamera::CaptureThreadStart(SceSize args, ScePVoid argp)
+{
+	s_instance->CaptureThread();
+
+	return 0;
+}
+
+SceVoid LRCamera::CaptureThread()
+{
+	unsigned char *buf;
+	SceInt32 width;
+	SceInt32 height;
+	SceUInt64 frame;
+	SceUInt64 timestamp;
+
+	while (!_captureExit) {
+		// Unpaced replay serves the next frame only once the previous one was picked up
+		if (_replay.IsOpen() && !_replayRealtime) {
+			SceUInt32 timeout = 100 * 1000;
+			if (sceKernelWaitEventFlag(_captureEvf, LR_CAMERA_EVF_CONSUMED, SCE_KERNEL_EVF_WAITMODE_OR | SCE_KERNEL_EVF_WAITMODE_CLEAR_PAT, SCE_NULL, &timeout) < 0)
+				continue;
+		}
+
+		SceUInt32 frameCount = _captureStats.frameCount;
+
+		Update(&buf, &width, &height, &frame, &timestamp);
+
+		// Camera stopped, replay finished or read error: nothing to wait on, back off
+		if (_captureStats.frameCount == frameCount)
+			sceKernelDelayThread(5 * 1000);
+	}
+}
+
+const LRFrame *LRCamera::WaitForFrame(SceUInt32 timeoutUs)
+{
+	SceUInt64 deadline = sceKernelGetProcessTimeWide() + timeoutUs;
+	SceBool woken = SCE_FALSE;
+
+	while (1) {
+		// A frame picked up without waiting must not cause a wakeup later
+		sceKernelClearEventFlag(_captureEvf, ~LR_CAMERA_EVF_NEW_FRAME);
+
+		const LRFrame *frame = _frameRing.AcquireLatest();
+		if (frame != SCE_NULL) {
+			if (frame->seq != _deliveredSeq && _frameRing.IsValid(frame)) {
+				SceUInt64 now = sceKernelGetProcessTimeWide();
+
+				if (_deliveredSeq != 0 && frame->seq - _deliveredSeq > 1)
+					_captureStats.droppedFrameCount += frame->seq - _deliveredSeq - 1;
+				_deliveredSeq = frame->seq;
+
+				if (woken) {
+					SceUInt32 latency = 0;
+					if (now > frame->captureTime)
+						latency = (SceUInt32)(now - frame->captureTime);
+
+					_captureStats.wakeCount++;
+					_captureStats.wakeLatencyLast = latency;
+					_captureStats.wakeLatencySum += latency;
+					if (latency > _captureStats.wakeLatencyMax)
+						_captureStats.wakeLatencyMax = latency;
+				}
+
+				sceKernelSetEventFlag(_captureEvf, LR_CAMERA_EVF_CONSUMED);
+
+				return frame;
+			}
+
+			_frameRing.Release(frame);
+		}
+
+		if (woken)
+			_captureStats.duplicateWakeCount++;
+
+		SceUInt64 now = sceKernelGetProcessTimeWide();
+		if (now >= deadline)
+			return SCE_NULL;
+
+		SceUInt32 timeout = (SceUInt32)(deadline - now);
+		if (sceKernelWaitEventFlag(_captureEvf, LR_CAMERA_EVF_NEW_FRAME, SCE_KERNEL_EVF_WAITMODE_OR | SCE_KERNEL_EVF_WAITMODE_CLEAR_PAT, SCE_NULL, &timeout) < 0)
+			return SCE_NULL;
+
+		woken = SCE_TRUE;
+	}
+}
+
+SceBool LRCamera::IsFrameValid(const LRFrame *frame)
+{
+	return _frameRing.IsValid(frame);
+}
+
+SceVoid LRCamera::UpdateFrameStats(SceUInt64 frame, SceUInt64 captureTime)
+{
+	// Frame numbers restart with the camera or a replay
+	if (_lastQwFrame != 0 && frame > _lastQwFrame + 1)
+		_captureStats.skippedFrameCount += (SceUInt32)(frame - _lastQwFrame - 1);
+
+	if (_lastCaptureTime != 0 && frame > _lastQwFrame) {
+		SceUInt32 interval = (SceUInt32)(captureTime - _lastCaptureTime);
+		SceFloat deviation = (SceFloat)interval - _captureStats.frameIntervalMean;
+
+		if (_captureStats.frameIntervalMean == 0.0f) {
+			_captureStats.frameIntervalMean = (SceFloat)interval;
+		}
+		else {
+			_captureStats.frameIntervalMean += deviation * 0.0625f;
+			_captureStats.frameJitter += (fabsf(deviation) - _captureStats.frameJitter) * 0.0625f;
+		}
+
+		_captureStats.frameIntervalLast = interval;
+		if (interval > _captureStats.frameIntervalMax)
+			_captureStats.frameIntervalMax = interval;
+	}
+
+	_lastQwFrame = frame;
+	_lastCaptureTime = captureTime;
+}
+
+SceVoid LRCamera::GetCaptureStats(LRCaptureStats *stats)
+{
+	sceClibMemcpy(stats, &_captureStats, sizeof(LRCaptureStats));
+}
+
+SceInt32 LRCamera::Update(
+	unsigned char **buf,
+	SceInt32 *width,
+	SceInt32 *height,
+	SceUInt64 *frame,
+	SceUInt64 *timestamp
+)
+{
+	SceInt32 ret = 0;
+
+	sceKernelLockLwMutex(&_backendMtx, 1, NULL);
+
+	// Serve replayed frames at the cadence they were recorded with. The wait comes before a
+	// slot is taken: the resolution, the ring and the replay may all change while unlocked.
+	SceUInt64 replayDelay = GetReplayDelay();
+	if (replayDelay > 0) {
+		sceKernelUnlockLwMutex(&_backendMtx, 1);
+		sceKernelDelayThread(replayDelay);
+		sceKernelLockLwMutex(&_backendMtx, 1, NULL);
+	}
+
+	if (_camCtrl.cameraStatus != CAMERA_START && !_replay.IsOpen()) {
+		sceKernelUnlockLwMutex(&_backendMtx, 1);
+		return ret;
+	}
+
+	// Only waits if every free slot is still sampled by a scene in flight
+	LRFrame *slot = _frameRing.BeginWrite();
+	if (slot == SCE_NULL) {
+		sceKernelUnlockLwMutex(&_backendMtx, 1);
+		SCE_DBG_LOG_ERROR("[LRCamera] no free frame ring slot\n");
+		return -1;
+	}
+
+	unsigned char *slotBase = slot->data;
+
+	// Where the Y plane is written to, a record buffer while recording
+	unsigned char *lumaBase = slotBase;
+
+	if (_replay.IsOpen()) {
+		ret = ReadReplayFrame(slotBase);
+	}
+	else {
+		if (IsRecording()) {
+			if (sceKernelPollSema(_recordFreeSema, 1) == SCE_OK)
+				lumaBase = _recordBuf[_recordHead % LR_CAMERA_RECORD_BUF_NUM];
+			else
+				_recordDropCount++;
+		}
+
+		// No dirty lines may be written back over the camera DMA
+		sceKernelDcacheWritebackInvalidateRange(slotBase, _camCtrl.cameraBufSize);
+		if (lumaBase != slotBase)
+			sceKernelDcacheWritebackInvalidateRange(lumaBase, _camCtrl.cameraInfo.sizeIBase);
+
+		_camCtrl.cameraRead.pvIBase = lumaBase;
+		_camCtrl.cameraRead.pvUBase = slotBase + _camCtrl.cameraInfo.sizeIBase;
+		_camCtrl.cameraRead.pvVBase = slotBase + _camCtrl.cameraInfo.sizeIBase + _camCtrl.cameraInfo.sizeUBase;
+		_camCtrl.cameraRead.sizeIBase = _camCtrl.cameraInfo.sizeIBase;
+		_camCtrl.cameraRead.sizeUBase = _camCtrl.cameraInfo.sizeUBase;
+		_camCtrl.cameraRead.sizeVBase = _camCtrl.cameraInfo.sizeVBase;
+
+		ret = sceCameraRead(_camCtrl.cameraDevNum, &_camCtrl.cameraRead);
+
+		// Nothing to record without a new frame
+		if (ret < 0 && lumaBase != slotBase)
+			sceKernelSignalSema(_recordFreeSema, 1);
+	}
+
+	if ((ret < 0) && (ret != SCE_CAMERA_ERROR_ALREADY_READ)) {
+		_frameRing.CancelWrite();
+		sceKernelUnlockLwMutex(&_backendMtx, 1);
+		SCE_DBG_LOG_ERROR("[LRCamera] sceCameraRead() 0x%X\n", ret);
+		return ret;
+	}
+
+	if (ret == SCE_CAMERA_ERROR_ALREADY_READ) {
+		// Nothing was written, keep serving the previous frame
+		_captureStats.alreadyReadCount++;
+		_frameRing.CancelWrite();
+
+		const LRFrame *latest = _frameRing.PeekLatest();
+		if (latest == SCE_NULL) {
+			sceKernelUnlockLwMutex(&_backendMtx, 1);
+			return ret;
+		}
+
+		*buf = latest->data;
+	}
+	else {
+		// Drop lines that were speculatively fetched while the camera was writing
+		if (!_replay.IsOpen())
+			sceKernelDcacheWritebackInvalidateRange(lumaBase, _camCtrl.cameraInfo.sizeIBase);
+
+		// The camera and the replay write straight into the slot, only a recorded frame comes
+		// from another buffer. Any copy on the way to the tracker shows up here.
+		SceUInt32 bytesCopied = _lumaNorm.Process(lumaBase, _cameraWidth, slotBase, slot->pitch);
+
+		// The camera output as is goes to the file, so that replays go through normalization again
+		if (lumaBase != slotBase) {
+			SceUInt32 index = _recordHead % LR_CAMERA_RECORD_BUF_NUM;
+			_recordFrame[index] = _camCtrl.cameraRead.qwFrame;
+			_recordTimestamp[index] = _camCtrl.cameraRead.qwTimestamp;
+			_recordHead++;
+			sceKernelSignalSema(_recordFullSema, 1);
+		}
+
+		// The preview samples the slot straight from memory
+		sceKernelDcacheWritebackRange(slotBase, _camCtrl.cameraBufSize);
+
+		SceUInt64 captureTime = sceKernelGetProcessTimeWide();
+		_frameRing.EndWrite(_camCtrl.cameraRead.qwFrame, _camCtrl.cameraRead.qwTimestamp, captureTime);
+		*buf = slotBase;
+
+		UpdateFrameStats(_camCtrl.cameraRead.qwFrame, captureTime);
+
+		_captureStats.frameCount++;
+		_captureStats.bytesCopiedLast = bytesCopied;
+		sceKernelSetEventFlag(_captureEvf, LR_CAMERA_EVF_NEW_FRAME);
+	}
+
+	*width = _cameraWidth;
+	*height = _cameraHeight;
+
+	*frame = _camCtrl.cameraRead.qwFrame;
+	*timestamp = _camCtrl.cameraRead.qwTimestamp;
+
+	sceKernelUnlockLwMutex(&_backendMtx, 1);
+
+	return ret;
+}
+
+SceUInt64 LRCamera::GetReplayDelay()
+{
+	if (!_replay.IsOpen() || _replayFinished || !_replayRealtime || _replayFrameCount == 0)
+		return 0;
+
+	// Errors and the end of the recording are left for ReadReplayFrame() to report
+	SceUInt64 frame;
+	SceUInt64 timestamp;
+	if (_replay.Peek(&frame, &timestamp) < 0)
+		return 0;
+
+	SceUInt64 now = sceKernelGetProcessTimeWide();
+	SceUInt64 due = _replayBaseTime + (timestamp - _replayBaseTimestamp);
+
+	return due > now ? due - now : 0;
+}
+
+SceInt32 LRCamera::ReadReplayFrame(unsigned char *texBase)
+{
+	SceUInt64 frame;
+	SceUInt64 timestamp;
+
+	if (_replayFinished)
+		return SCE_CAMERA_ERROR_ALREADY_READ;
+
+	// A failed read leaves the file position in the middle of a record, nothing after it can be served
+	SceInt32 ret = _replay.Read(&frame, &timestamp, texBase, _cameraWidth);
+	if (ret == LR_CAPTURE_ERROR_EOF) {
+		SCE_DBG_LOG_INFO("[LRCamera] replay finished after %u frames\n", _replayFrameCount);
+		_replayFinished = SCE_TRUE;
+		return SCE_CAMERA_ERROR_ALREADY_READ;
+	}
+	else if (ret < 0) {
+		SCE_DBG_LOG_ERROR("[LRCamera] replay read failed after %u frames: %d\n", _replayFrameCount, ret);
+		_replayFinished = SCE_TRUE;
+		return SCE_CAMERA_ERROR_ALREADY_READ;
+	}
+
+	// Only the Y plane is recorded, show the preview in grayscale
+	sceClibMemset(texBase + _camCtrl.cameraInfo.sizeIBase, 0x80, _camCtrl.cameraInfo.sizeUBase + _camCtrl.cameraInfo.sizeVBase);
+
+	// The cadence of the following frames is measured from the first one
+	if (_replayFrameCount == 0) {
+		_replayBaseTime = sceKernelGetProcessTimeWide();
+		_replayBaseTimestamp = timestamp;
+	}
+
+	_replayFrameCount++;
+
+	// Recorded timestamps lie in the session they were recorded in. Moved onto the replay clock
+	// they compare with process time like live ones, e.g. for latency and prediction.
+	_camCtrl.cameraRead.qwFrame = frame;
+	_camCtrl.cameraRead.qwTimestamp = _replayBaseTime + _sensorTimeOffset + (timestamp - _replayBaseTimestamp);
+
+	return SCE_OK;
+}
+
+SceInt32 LRCamera::StartRecording(const char *path)
+{
+	sceKernelLockLwMutex(&_backendMtx, 1, NULL);
+
+	// A recording that stopped on a write error still holds its thread and buffers
+	StopRecordThread();
+
+	SceInt32 ret = _recorder.Open(path, _cameraWidth, _cameraHeight);
+	if (ret < 0) {
+		SCE_DBG_LOG_ERROR("[LRCamera] failed to open %s for recording: %d\n", path, ret);
+	}
+	else {
+		ret = StartRecordThread();
+		if (ret < 0)
+			_recorder.Close();
+	}
+
+	sceKernelUnlockLwMutex(&_backendMtx, 1);
+
+	return ret;
+}
+
+SceVoid LRCamera::StopRecording()
+{
+	sceKernelLockLwMutex(&_backendMtx, 1, NULL);
+	StopRecordThread();
+	sceKernelUnlockLwMutex(&_backendMtx, 1);
+}
+
+SceBool LRCamera::IsRecording()
+{
+	return _recordThread > 0 && !_recordFailed;
+}
+
+SceInt32 LRCamera::StartRecordThread()
+{
+	SceSize bufSize = ROUND_UP(_cameraWidth * _cameraHeight, SCE_KERNEL_4KiB);
+
+	_recordMemblock = sceKernelAllocMemBlock("LRCamera::RecordBuf", SCE_KERNEL_MEMBLOCK_TYPE_USER_RW, bufSize * LR_CAMERA_RECORD_BUF_NUM, SCE_NULL);
+	if (_recordMemblock <= 0) {
+		SCE_DBG_LOG_ERROR("[LRCamera] sceKernelAllocMemBlock() 0x%X\n", _recordMemblock);
+		SceInt32 ret = _recordMemblock;
+		_recordMemblock = SCE_UID_INVALID_UID;
+		return ret;
+	}
+
+	ScePVoid base;
+	sceKernelGetMemBlockBase(_recordMemblock, &base);
+	for (int i = 0; i < LR_CAMERA_RECORD_BUF_NUM; i++)
+		_recordBuf[i] = static_cast<unsigned char*>(base) + bufSize * i;
+
+	_recordFreeSema = sceKernelCreateSema("LRCamera:RecordFreeSema", 0, LR_CAMERA_RECORD_BUF_NUM, LR_CAMERA_RECORD_BUF_NUM, SCE_NULL);
+	_recordFullSema = sceKernelCreateSema("LRCamera:RecordFullSema", 0, 0, LR_CAMERA_RECORD_BUF_NUM, SCE_NULL);
+	if (_recordFreeSema < 0 || _recordFullSema < 0) {
+		SCE_DBG_LOG_ERROR("[LRCamera] sceKernelCreateSema() 0x%X 0x%X\n", _recordFreeSema, _recordFullSema);
+		SceInt32 ret = _recordFreeSema < 0 ? _recordFreeSema : _recordFullSema;
+		StopRecordThread();
+		return ret;
+	}
+
+	_recordHead = 0;
+	_recordTail = 0;
+	_recordDropCount = 0;
+	_recordExit = SCE_FALSE;
+	_recordFailed = SCE_FALSE;
+
+	// Mostly blocked on the memory card, below the capture and tracking threads
+	SceUID thread = sceKernelCreateThread("LRCamera:RecordThread", RecordThreadStart, 120, 0x4000, 0, SCE_KERNEL_CPU_MASK_USER_1, NULL);
+	if (thread < 0) {
+		SCE_DBG_LOG_ERROR("[LRCamera] sceKernelCreateThread() 0x%X\n", thread);
+		StopRecordThread();
+		return thread;
+	}
+
+	SceInt32 ret = sceKernelStartThread(thread, 0, NULL);
+	if (ret < 0) {
+		SCE_DBG_LOG_ERROR("[LRCamera] sceKernelStartThread() 0x%X\n", ret);
+		sceKernelDeleteThread(thread);
+		StopRecordThread();
+		return ret;
+	}
+
+	_recordThread = thread;
+
+	return 0;
+}
+
+SceVoid LRCamera::StopRecordThread()
+{
+	// The thread writes what is queued before it exits
+	if (_recordThread > 0) {
+		_recordExit = SCE_TRUE;
+		sceKernelWaitThreadEnd(_recordThread, NULL, NULL);
+		sceKernelDeleteThread(_recordThread);
+		_recordThread = SCE_UID_INVALID_UID;
+
+		SCE_DBG_LOG_INFO("[LRCamera] recorded %u frames, %u not recorded\n", _recorder.GetFrameCount(), _recordDropCount);
+	}
+
+	if (_recordFreeSema > 0)
+		sceKernelDeleteSema(_recordFreeSema);
+	if (_recordFullSema > 0)
+		sceKernelDeleteSema(_recordFullSema);
+	_recordFreeSema = SCE_UID_INVALID_UID;
+	_recordFullSema = SCE_UID_INVALID_UID;
+
+	if (_recordMemblock > 0)
+		sceKernelFreeMemBlock(_recordMemblock);
+	_recordMemblock = SCE_UID_INVALID_UID;
+
+	_recorder.Close();
+	_recordFailed = SCE_FALSE;
+}
+
+SceInt32 LRCamera::RecordThreadStart(SceSize args, ScePVoid argp)
+{
+	s_instance->RecordThread();
+
+	return 0;
+}
+
+SceVoid LRCamera::RecordThread()
+{
+	while (1) {
+		// Once asked to exit nothing new is queued, stop when the queue is empty
+		SceUInt32 timeout = 100 * 1000;
+		SceInt32 ret = _recordExit ? sceKernelPollSema(_recordFullSema, 1) : sceKernelWaitSema(_recordFullSema, 1, &timeout);
+		if (ret < 0) {
+			if (_recordExit)
+				break;
+			continue;
+		}
+
+		SceUInt32 index = _recordTail % LR_CAMERA_RECORD_BUF_NUM;
+
+		// After a failure the queue is only drained, IsRecording() stops new frames
+		if (!_recordFailed && _recorder.Write(_recordFrame[index], _recordTimestamp[index], _recordBuf[index], _cameraWidth) < 0) {
+			SCE_DBG_LOG_ERROR("[LRCamera] capture write failed, recording stopped\n");
+			_recordFailed = SCE_TRUE;
+		}
+
+		_recordTail++;
+		sceKernelSignalSema(_recordFreeSema, 1);
+	}
+}
+
+SceInt32 LRCamera::StartReplay(const char *path, SceBool realtime)
+{
+	sceKernelLockLwMutex(&_backendMtx, 1, NULL);
+
+	SceInt32 ret = _replay.Open(path);
+	if (ret == 0 && (_replay.GetWidth() != _cameraWidth || _replay.GetHeight() != _cameraHeight)) {
+		SCE_DBG_LOG_ERROR("[LRCamera] replay resolution %dx%d does not match camera\n", _replay.GetWidth(), _replay.GetHeight());
+		_replay.Close();
+		ret = LR_CAPTURE_ERROR_FORMAT;
+	}
+
+	_replayRealtime = realtime;
+	_replayFinished = SCE_FALSE;
+	_replayFrameCount = 0;
+	_lastQwFrame = 0;
+	_lastCaptureTime = 0;
+
+	sceKernelUnlockLwMutex(&_backendMtx, 1);
+
+	if (ret < 0)
+		SCE_DBG_LOG_ERROR("[LRCamera] failed to open %s for replay: %d\n", path, ret);
+
+	return ret;
+}
+
+SceVoid LRCamera::StopReplay()
+{
+	sceKernelLockLwMutex(&_backendMtx, 1, NULL);
+	_replay.Close();
+	_replayFinished = SCE_FALSE;
+	sceKernelUnlockLwMutex(&_backendMtx, 1);
+}
+
+SceBool LRCamera::IsReplaying()
+{
+	return _replay.IsOpen();
+}
+
+SceBool LRCamera::IsReplayFinished()
+{
+	return _replayFinished;
+}
+
+SceInt32 LRCamera::Stop()
+{
+	SceInt32 ret = 0;
+
+	if (_camCtrl.cameraStatus != CAMERA_START)
+		return ret;
+
+	ret = sceCameraStop(_camCtrl.cameraDevNum);
+	if (ret < 0) {
+		SCE_DBG_LOG_ERROR("[LRCamera] sceCameraStop() 0x%X\n", ret);
+		return ret;
+	}
+	_camCtrl.cameraDevNum = -1;
+	_camCtrl.cameraStatus = CAMERA_OPEN;
+
+	return 0;
+}
+
+const LRFrame *LRCamera::AcquireLatest()
+{
+	return _frameRing.AcquireLatest();
+}
+
+SceVoid LRCamera::Retain(const LRFrame *frame)
+{
+	_frameRing.Retain(frame);
+}
+
+SceVoid LRCamera::Release(const LRFrame *frame)
+{
+	_frameRing.Release(frame);
+}
+
+SceVoid LRCamera::GetSize(SceInt32 *width, SceInt32 *height)
+{
+	*width = _cameraWidth;
+	*height = _cameraHeight;
+}
+
+SceUInt64 LRCamera::SensorToProcessTime(SceUInt64 timestamp)
+{
+	if (timestamp <= _sensorTimeOffset)
+		return 0;
+
+	return timestamp - _sensorTimeOffset;
+}
+
+SceVoid LRCamera::SetEv(SceInt32 level)
+{
+	if (_camCtrl.cameraStatus == CAMERA_START)
+		sceCameraSetEV(_camCtrl.cameraDevNum, level);
+}
+
+SceVoid LRCamera::SetLumaNormMode(SceInt32 mode)
+{
+	sceKernelLockLwMutex(&_backendMtx, 1, NULL);
+	_lumaNorm.SetMode(mode);
+	sceKernelUnlockLwMutex(&_backendMtx, 1);
+}
+
+SceInt32 LRCamera::GetLumaNormMode()
+{
+	return _lumaNorm.GetMode();
+}
+
+SceVoid LRCamera::GetLumaStats(LRLumaStats *stats)
+{
+	sceClibMemcpy(stats, _lumaNorm.GetStats(), sizeof(LRLumaStats));
+}
+
+SceVoid LRCamera::DrawCamTex()
+{
+	// Always drawn at QQVGA size regardless of the capture resolution
+	const LRFrame *frame = _frameRing.AcquireForGpu();
+	if (frame != SCE_NULL)
+		vita2d_draw_texture_scale(_tex[_frameRing.GetIndex(frame)], 0, 0, 160.0f / _cameraWidth, 120.0f / _cameraHeight);
 }
\ No newline at end of file
@@ -1,71 +1,224 @@
-#pragma once
-
-#include <kernel.h>
-#include <camera.h>
-#include <scetypes.h>
-#include <vita2d_sys.h>
-
-class LRCamera
-{
-public:
-
-	static LRCamera *GetInstance();
-
-	static SceVoid ReleaseInstance();
-
-	SceInt32 Start(SceInt32 dev);
-
-	SceInt32 Update(
-		unsigned char **buf,
-		SceInt32 *width,
-		SceInt32 *height,
-		SceUInt64 *frame,
-		SceUInt64 *timestamp,
-		SceBool iBufOnly = SCE_FALSE
-	);
-
-	SceInt32 Stop();
-
-	SceInt32 GetBuffer(ScePVoid *ptr, SceInt32 *size);
-
-	SceInt32 GetIBuffer(ScePVoid *ptr, SceInt32 *size);
-
-	SceVoid GetSize(SceInt32 *width, SceInt32 *height);
-
-	SceVoid SetEv(SceInt32 level);
-
-	SceVoid DrawCamTex();
-
-private:
-
-	typedef enum CameraStatus {
-		CAMERA_INVALID,
-		CAMERA_CLOSE,
-		CAMERA_OPEN,
-		CAMERA_START
-	} CameraStatus;
-
-	typedef struct {
-	public:
-		ScePVoid		cameraBuffer;
-		SceInt32		cameraBufSize;
-		ScePVoid		cameraCpuIBuffer;
-		SceUID			cameraCpuIBufMemblock;
-		SceCameraInfo	cameraInfo;
-		SceCameraRead	cameraRead;
-		SceInt32		cameraDevNum;
-		CameraStatus 	cameraStatus;
-	} CameraCtrl;
-
-	CameraCtrl _camCtrl;
-
-	const SceInt32 _cameraWidth = 160;
-	const SceInt32 _cameraHeight = 120;
-
-	vita2d_texture *_tex;
-
-	LRCamera();
-
-	~LRCamera();
-};
-
+#pragma once
+
+#include <kernel.h>
+#include <camera.h>
+#include <scetypes.h>
+#include <vita2d_sys.h>
+
+#include "LRFrameRing.hpp"
+#include "LRFence.hpp"
+#include "LRCaptureFile.hpp"
+#include "LRLumaNorm.hpp"
+
+#define LR_CAMERA_EVF_NEW_FRAME		0x00000001
+#define LR_CAMERA_EVF_CONSUMED		0x00000002
+
+// Y planes the camera can run ahead of the record thread, about 70 ms at 60 fps
+#define LR_CAMERA_RECORD_BUF_NUM	4
+
+// Capture thread counters, latencies are in microseconds
+typedef struct LRCaptureStats {
+	SceUInt32 frameCount;		// frames published to the frame ring
+	SceUInt32 alreadyReadCount;	// reads that did not return a new frame
+	SceUInt32 wakeCount;
+	SceUInt32 wakeLatencyLast;	// frame published -> waiter running
+	SceUInt32 wakeLatencyMax;
+	SceUInt64 wakeLatencySum;
+	SceUInt32 bytesCopiedLast;	// bytes memcpy'd to hand the last frame to the tracker
+	SceUInt32 skippedFrameCount;	// camera frame numbers that were never returned by sceCameraRead()
+	SceUInt32 droppedFrameCount;	// published frames replaced before WaitForFrame() picked them up
+	SceUInt32 duplicateWakeCount;	// WaitForFrame() wakeups that found no fresh frame
+	SceUInt32 frameIntervalLast;	// time between two published frames
+	SceUInt32 frameIntervalMax;
+	SceFloat frameIntervalMean;		// moving averages
+	SceFloat frameJitter;
+} LRCaptureStats;
+
+class LRCamera
+{
+public:
+
+	static LRCamera *GetInstance();
+
+	static SceVoid ReleaseInstance();
+
+	SceInt32 Start(SceInt32 dev);
+
+	SceInt32 Update(
+		unsigned char **buf,
+		SceInt32 *width,
+		SceInt32 *height,
+		SceUInt64 *frame,
+		SceUInt64 *timestamp
+	);
+
+	SceInt32 Stop();
+
+	// Starts the thread that blocks in sceCameraRead() and publishes every new frame to the frame ring
+	SceInt32 StartCapture();
+
+	// Blocks until a frame newer than the one returned by the previous call is published.
+	// Returns it acquired, or SCE_NULL on timeout. Only one thread may wait for frames.
+	const LRFrame *WaitForFrame(SceUInt32 timeoutUs);
+
+	// False if the frame belongs to buffers that were reallocated since it was published
+	SceBool IsFrameValid(const LRFrame *frame);
+
+	SceVoid GetCaptureStats(LRCaptureStats *stats);
+
+	const LRFrame *AcquireLatest();
+
+	// Takes another reference to an acquired frame, e.g. to hand it to another thread
+	SceVoid Retain(const LRFrame *frame);
+
+	SceVoid Release(const LRFrame *frame);
+
+	SceVoid GetSize(SceInt32 *width, SceInt32 *height);
+
+	// Converts a camera qwTimestamp to process time
+	SceUInt64 SensorToProcessTime(SceUInt64 timestamp);
+
+	// SCE_CAMERA_RESOLUTION_QQVGA, QVGA or VGA. Frames acquired from the ring
+	// must be released before switching, they are freed with the old buffers.
+	SceInt32 SetResolution(SceInt32 resolution);
+
+	SceInt32 GetResolution();
+
+	SceVoid SetEv(SceInt32 level);
+
+	// LR_LUMA_NORM_OFF, _STRETCH or _CLAHE, applied to the Y plane before it is published to the frame ring
+	SceVoid SetLumaNormMode(SceInt32 mode);
+
+	SceInt32 GetLumaNormMode();
+
+	SceVoid GetLumaStats(LRLumaStats *stats);
+
+	// Records the Y plane, frame number and timestamp of every new camera frame. The camera
+	// writes the Y plane to a record buffer, luma normalization moves it on into the ring slot
+	// and a low priority thread writes the file. Frames that find no free record buffer are
+	// not recorded.
+	SceInt32 StartRecording(const char *path);
+
+	SceVoid StopRecording();
+
+	SceBool IsRecording();
+
+	// Serves recorded frames through Update() instead of the camera,
+	// either at the recorded cadence or as fast as they are consumed.
+	// Timestamps are shifted to start at the replay start, unpaced they drift from process time.
+	SceInt32 StartReplay(const char *path, SceBool realtime);
+
+	SceVoid StopReplay();
+
+	SceBool IsReplaying();
+
+	SceBool IsReplayFinished();
+
+	SceVoid DrawCamTex();
+
+private:
+
+	typedef enum CameraStatus {
+		CAMERA_INVALID,
+		CAMERA_CLOSE,
+		CAMERA_OPEN,
+		CAMERA_START
+	} CameraStatus;
+
+	typedef struct {
+	public:
+		SceInt32		cameraBufSize;
+		SceSize			cameraFrameBlockSize;
+		ScePVoid		cameraFrameBuffer;
+		SceUID			cameraFrameMemblock;
+		SceCameraInfo	cameraInfo;
+		SceCameraRead	cameraRead;
+		SceInt32		cameraDevNum;
+		CameraStatus 	cameraStatus;
+	} CameraCtrl;
+
+	CameraCtrl _camCtrl;
+
+	SceInt32 _cameraWidth;
+	SceInt32 _cameraHeight;
+
+	// writer + latest + current frame and the previous frame of each of the 2 faces held by the tracker
+	// + request, working and result frame of the detection thread + pending EV calibration frame
+	// + scenes in flight on the GPU
+	static const SceInt32 _frameRingSize = 10;
+
+	LRFrameRing<_frameRingSize> _frameRing;
+
+	// Preview textures over the ring slots
+	vita2d_texture *_tex[_frameRingSize];
+
+	SceKernelLwMutexWork _backendMtx;
+
+	LRLumaNorm _lumaNorm;
+
+	LRCaptureWriter _recorder;
+	LRCaptureReader _replay;
+	SceBool _replayRealtime;
+	SceBool _replayFinished;
+	SceUInt32 _replayFrameCount;
+	SceUInt64 _replayBaseTime;
+	SceUInt64 _replayBaseTimestamp;
+
+	SceUID _recordThread;
+	SceUID _recordMemblock;
+	SceUID _recordFreeSema;		// record buffers the camera may write to
+	SceUID _recordFullSema;		// record buffers waiting to be written
+	unsigned char *_recordBuf[LR_CAMERA_RECORD_BUF_NUM];
+	SceUInt64 _recordFrame[LR_CAMERA_RECORD_BUF_NUM];
+	SceUInt64 _recordTimestamp[LR_CAMERA_RECORD_BUF_NUM];
+	SceUInt32 _recordHead;		// capture thread
+	SceUInt32 _recordTail;		// record thread
+	SceUInt32 _recordDropCount;
+	volatile SceBool _recordExit;
+	volatile SceBool _recordFailed;
+
+	SceUInt64 _sensorTimeOffset;
+
+	SceUID _captureThread;
+	SceUID _captureEvf;
+	volatile SceBool _captureExit;
+	LRCaptureStats _captureStats;
+	SceUInt64 _lastQwFrame;
+	SceUInt64 _lastCaptureTime;
+	SceUInt32 _deliveredSeq;
+
+	LRCamera();
+
+	~LRCamera();
+
+	SceVoid SetResolutionParam(SceInt32 resolution);
+
+	SceVoid AllocBuffers();
+
+	SceVoid FreeBuffers();
+
+	SceInt32 OpenDevice();
+
+	SceVoid CloseDevice();
+
+	// Time until the next replayed frame is due, 0 when not pacing a replay
+	SceUInt64 GetReplayDelay();
+
+	SceInt32 ReadReplayFrame(unsigned char *texBase);
+
+	static SceInt32 CaptureThreadStart(SceSize args, ScePVoid argp);
+
+	SceVoid CaptureThread();
+
+	SceVoid UpdateFrameStats(SceUInt64 frame, SceUInt64 captureTime);
+
+	// Both with _backendMtx held, no sceCameraRead() can be writing to a record buffer then
+	SceInt32 StartRecordThread();
+
+	SceVoid StopRecordThread();
+
+	static SceInt32 RecordThreadStart(SceSize args, ScePVoid argp);
+
+	SceVoid RecordThread();
+};
+
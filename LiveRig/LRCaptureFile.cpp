@@ -0,0 +1,211 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "LRCaptureFile.hpp"
+
+namespace {
+	bool WriteRecordHeader(FILE *fp, uint64_t frame, uint64_t timestamp)
+	{
+		uint64_t rec[2] = { frame, timestamp };
+		return fwrite(rec, sizeof(rec), 1, fp) == 1;
+	}
+}
+
+LRCaptureWriter::LRCaptureWriter() :
+	_fp(NULL),
+	_frameCount(0)
+{
+	memset(&_header, 0, sizeof(LRCaptureHeader));
+}
+
+LRCaptureWriter::~LRCaptureWriter()
+{
+	Close();
+}
+
+int LRCaptureWriter::Open(const char *path, int32_t width, int32_t height)
+{
+	Close();
+
+	_fp = fopen(path, "wb");
+	if (_fp == NULL)
+		return LR_CAPTURE_ERROR_IO;
+
+	// Records are written one frame at a time, let stdio batch them
+	setvbuf(_fp, NULL, _IOFBF, 256 * 1024);
+
+	_header.magic = LR_CAPTURE_MAGIC;
+	_header.version = LR_CAPTURE_VERSION;
+	_header.width = width;
+	_header.height = height;
+	_frameCount = 0;
+
+	if (fwrite(&_header, sizeof(LRCaptureHeader), 1, _fp) != 1) {
+		Close();
+		return LR_CAPTURE_ERROR_IO;
+	}
+
+	return 0;
+}
+
+int LRCaptureWriter::Write(uint64_t frame, uint64_t timestamp, const unsigned char *data, int32_t pitch)
+{
+	if (_fp == NULL)
+		return LR_CAPTURE_ERROR_IO;
+
+	if (!WriteRecordHeader(_fp, frame, timestamp))
+		return LR_CAPTURE_ERROR_IO;
+
+	if (pitch == (int32_t)_header.width) {
+		if (fwrite(data, _header.width * _header.height, 1, _fp) != 1)
+			return LR_CAPTURE_ERROR_IO;
+	}
+	else {
+		for (uint32_t y = 0; y < _header.height; y++) {
+			if (fwrite(data + y * pitch, _header.width, 1, _fp) != 1)
+				return LR_CAPTURE_ERROR_IO;
+		}
+	}
+
+	_frameCount++;
+
+	return 0;
+}
+
+void LRCaptureWriter::Close()
+{
+	if (_fp != NULL) {
+		fclose(_fp);
+		_fp = NULL;
+	}
+}
+
+bool LRCaptureWriter::IsOpen() const
+{
+	return _fp != NULL;
+}
+
+uint32_t LRCaptureWriter::GetFrameCount() const
+{
+	return _frameCount;
+}
+
+LRCaptureReader::LRCaptureReader() :
+	_fp(NULL)
+{
+	memset(&_header, 0, sizeof(LRCaptureHeader));
+}
+
+LRCaptureReader::~LRCaptureReader()
+{
+	Close();
+}
+
+int LRCaptureReader::Open(const char *path)
+{
+	Close();
+
+	_fp = fopen(path, "rb");
+	if (_fp == NULL)
+		return LR_CAPTURE_ERROR_IO;
+
+	if (fread(&_header, sizeof(LRCaptureHeader), 1, _fp) != 1) {
+		Close();
+		return LR_CAPTURE_ERROR_FORMAT;
+	}
+
+	if (_header.magic != LR_CAPTURE_MAGIC || _header.version != LR_CAPTURE_VERSION ||
+		_header.width == 0 || _header.height == 0) {
+		Close();
+		return LR_CAPTURE_ERROR_FORMAT;
+	}
+
+	return 0;
+}
+
+int LRCaptureReader::Read(uint64_t *frame, uint64_t *timestamp, unsigned char *dst, int32_t pitch)
+{
+	uint64_t rec[2];
+
+	if (_fp == NULL)
+		return LR_CAPTURE_ERROR_IO;
+
+	// A record cut short is what a recording that was killed while writing ends with
+	if (fread(rec, sizeof(rec), 1, _fp) != 1)
+		return feof(_fp) ? LR_CAPTURE_ERROR_EOF : LR_CAPTURE_ERROR_IO;
+
+	if (pitch == (int32_t)_header.width) {
+		if (fread(dst, _header.width * _header.height, 1, _fp) != 1)
+			return feof(_fp) ? LR_CAPTURE_ERROR_EOF : LR_CAPTURE_ERROR_IO;
+	}
+	else {
+		for (uint32_t y = 0; y < _header.height; y++) {
+			if (fread(dst + y * pitch, _header.width, 1, _fp) != 1)
+				return feof(_fp) ? LR_CAPTURE_ERROR_EOF : LR_CAPTURE_ERROR_IO;
+		}
+	}
+
+	*frame = rec[0];
+	*timestamp = rec[1];
+
+	return 0;
+}
+
+int LRCaptureReader::Peek(uint64_t *frame, uint64_t *timestamp)
+{
+	uint64_t rec[2];
+
+	if (_fp == NULL)
+		return LR_CAPTURE_ERROR_IO;
+
+	if (fread(rec, sizeof(rec), 1, _fp) != 1) {
+		int ret = feof(_fp) ? LR_CAPTURE_ERROR_EOF : LR_CAPTURE_ERROR_IO;
+
+		// Read() runs into the end again and reports it
+		clearerr(_fp);
+		return ret;
+	}
+
+	if (fseek(_fp, -(long)sizeof(rec), SEEK_CUR) != 0)
+		return LR_CAPTURE_ERROR_IO;
+
+	*frame = rec[0];
+	*timestamp = rec[1];
+
+	return 0;
+}
+
+int LRCaptureReader::Rewind()
+{
+	if (_fp == NULL)
+		return LR_CAPTURE_ERROR_IO;
+
+	if (fseek(_fp, sizeof(LRCaptureHeader), SEEK_SET) != 0)
+		return LR_CAPTURE_ERROR_IO;
+
+	return 0;
+}
+
+void LRCaptureReader::Close()
+{
+	if (_fp != NULL) {
+		fclose(_fp);
+		_fp = NULL;
+	}
+}
+
+bool LRCaptureReader::IsOpen() const
+{
+	return _fp != NULL;
+}
+
+int32_t LRCaptureReader::GetWidth() const
+{
+	return _header.width;
+}
+
+int32_t LRCaptureReader::GetHeight() const
+{
+	return _header.height;
+}
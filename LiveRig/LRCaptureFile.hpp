@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+
+// Camera capture file: a small header followed by one record per camera frame.
+//
+// header: "LRCF", version, width, height (little endian uint32)
+// record: qwFrame (uint64), qwTimestamp (uint64), width * height bytes of Y plane
+//
+// Only depends on stdio so that recordings can be replayed on the host.
+
+#define LR_CAPTURE_MAGIC			0x4643524C	// "LRCF"
+#define LR_CAPTURE_VERSION			1
+
+#define LR_CAPTURE_ERROR_IO			-1
+#define LR_CAPTURE_ERROR_FORMAT		-2
+#define LR_CAPTURE_ERROR_EOF		-3
+
+struct LRCaptureHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+};
+
+class LRCaptureWriter
+{
+public:
+
+	LRCaptureWriter();
+
+	~LRCaptureWriter();
+
+	int Open(const char *path, int32_t width, int32_t height);
+
+	int Write(uint64_t frame, uint64_t timestamp, const unsigned char *data, int32_t pitch);
+
+	void Close();
+
+	bool IsOpen() const;
+
+	uint32_t GetFrameCount() const;
+
+private:
+
+	FILE *_fp;
+	LRCaptureHeader _header;
+	uint32_t _frameCount;
+};
+
+class LRCaptureReader
+{
+public:
+
+	LRCaptureReader();
+
+	~LRCaptureReader();
+
+	int Open(const char *path);
+
+	// Reads the next record, the Y plane is written to dst with the given pitch.
+	// A truncated last record reads as LR_CAPTURE_ERROR_EOF, dst is then partly written.
+	int Read(uint64_t *frame, uint64_t *timestamp, unsigned char *dst, int32_t pitch);
+
+	// Frame number and timestamp of the next record without consuming it
+	int Peek(uint64_t *frame, uint64_t *timestamp);
+
+	int Rewind();
+
+	void Close();
+
+	bool IsOpen() const;
+
+	int32_t GetWidth() const;
+
+	int32_t GetHeight() const;
+
+private:
+
+	FILE *_fp;
+	LRCaptureHeader _header;
+};
@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "LRChannelTrace.hpp"
+
+LRChannelTrace::LRChannelTrace()
+{
+	Reset();
+}
+
+void LRChannelTrace::Reset()
+{
+	_head = 0;
+	_count = 0;
+}
+
+void LRChannelTrace::Add(const float *values, uint64_t time)
+{
+	if (_count != 0 && time <= GetSample(_count - 1)->time)
+		return;
+
+	LRChannelSample *sample = &_sample[(_head + _count) % LR_CHANNEL_TRACE_SIZE];
+	sample->time = time;
+	memcpy(sample->value, values, sizeof(sample->value));
+
+	if (_count < LR_CHANNEL_TRACE_SIZE)
+		_count++;
+	else
+		_head = (_head + 1) % LR_CHANNEL_TRACE_SIZE;
+}
+
+uint32_t LRChannelTrace::GetCount() const
+{
+	return _count;
+}
+
+const LRChannelSample *LRChannelTrace::GetSample(uint32_t index) const
+{
+	if (index >= _count)
+		return NULL;
+
+	return &_sample[(_head + index) % LR_CHANNEL_TRACE_SIZE];
+}
+
+void LRChannelTrace::Write(FILE *fp) const
+{
+	fprintf(fp, "# time_us, %d channels\n", LR_FILTER_CHANNEL_MAX);
+
+	for (uint32_t i = 0; i < _count; i++) {
+		const LRChannelSample *sample = GetSample(i);
+
+		fprintf(fp, "%llu", (unsigned long long)sample->time);
+		for (int32_t c = 0; c < LR_FILTER_CHANNEL_MAX; c++)
+			fprintf(fp, " %.6g", sample->value[c]);
+		fprintf(fp, "\n");
+	}
+}
+
+uint32_t LRChannelTrace::Read(FILE *fp)
+{
+	char line[512];
+
+	Reset();
+
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		if (line[0] == '#' || line[0] == '\n' || line[0] == '\r')
+			continue;
+
+		char *p = line;
+		char *end;
+		uint64_t time = strtoull(p, &end, 10);
+		if (end == p)
+			continue;
+		p = end;
+
+		// Channels missing at the end of a line read as zero
+		float values[LR_FILTER_CHANNEL_MAX];
+		for (int32_t c = 0; c < LR_FILTER_CHANNEL_MAX; c++) {
+			values[c] = strtof(p, &end);
+			if (end == p)
+				values[c] = 0.0f;
+			p = end;
+		}
+
+		Add(values, time);
+	}
+
+	return _count;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "LRFilter.hpp"
+
+// Ring of the last unfiltered tracking channels with the time they were measured at, as fed to
+// LRFilter. Written as text, one sample per line: the time in microseconds then every channel.
+//
+// Only depends on stdio so that recorded channels can be read back and filtered on the host.
+
+#define LR_CHANNEL_TRACE_SIZE	2048
+
+struct LRChannelSample
+{
+	uint64_t time;
+	float value[LR_FILTER_CHANNEL_MAX];
+};
+
+class LRChannelTrace
+{
+public:
+
+	LRChannelTrace();
+
+	void Reset();
+
+	// Samples not newer than the last one are ignored, the oldest is dropped when full
+	void Add(const float *values, uint64_t time);
+
+	uint32_t GetCount() const;
+
+	// index 0 is the oldest sample kept
+	const LRChannelSample *GetSample(uint32_t index) const;
+
+	void Write(FILE *fp) const;
+
+	// Replaces the trace with the samples in fp, returns the number read
+	uint32_t Read(FILE *fp);
+
+private:
+
+	LRChannelSample _sample[LR_CHANNEL_TRACE_SIZE];
+	uint32_t _head;
+	uint32_t _count;
+};
@@ -1,16 +1,16 @@
-#pragma once
-
-#include <CubismFramework.hpp>
-#include <ICubismAllocator.hpp>
-
-class LRCubismAllocator : public Csm::ICubismAllocator
-{
-	void* Allocate(const Csm::csmSizeType size);
-
-	void Deallocate(void* memory);
-
-	void* AllocateAligned(const Csm::csmSizeType size, const Csm::csmUint32 alignment);
-
-	void DeallocateAligned(void* alignedMemory);
-};
-
+#pragma once
+
+#include <CubismFramework.hpp>
+#include <ICubismAllocator.hpp>
+
+class LRCubismAllocator : public Csm::ICubismAllocator
+{
+	void* Allocate(const Csm::csmSizeType size);
+
+	void Deallocate(void* memory);
+
+	void* AllocateAligned(const Csm::csmSizeType size, const Csm::csmUint32 alignment);
+
+	void DeallocateAligned(void* alignedMemory);
+};
+
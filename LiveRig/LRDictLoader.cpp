@@ -0,0 +1,234 @@
+#include <kernel.h>
+#include <libdbg.h>
+#include <libface.h>
+#include <stdlib.h>
+#include <scetypes.h>
+
+#include "LRDictLoader.hpp"
+
+namespace {
+	struct DictFile
+	{
+		const char *name;
+		SceUInt32 size;
+	};
+
+	const DictFile s_dictFile[LR_DICT_NUM] = {
+		{ SCE_FACE_DETECT_ROLL_YAW_PITCH_DICT, SCE_FACE_DETECT_ROLL_YAW_PITCH_DICT_SIZE },
+		{ SCE_FACE_PARTS_ROLL_YAW_DICT, SCE_FACE_PARTS_ROLL_YAW_DICT_SIZE },
+		{ SCE_FACE_PARTS_CHECK_DICT, SCE_FACE_PARTS_CHECK_DICT_SIZE },
+		{ SCE_FACE_SHAPE_DICT_FRONTAL, SCE_FACE_SHAPE_DICT_FRONTAL_SIZE },
+		{ SCE_FACE_DETECT_ROLL_YAW_DICT, SCE_FACE_DETECT_ROLL_YAW_DICT_SIZE },
+		{ SCE_FACE_ALLPARTS_DICT, SCE_FACE_ALLPARTS_DICT_SIZE },
+		{ SCE_FACE_ALLPARTS_SHAPE_DICT, SCE_FACE_ALLPARTS_SHAPE_DICT_SIZE },
+		{ SCE_FACE_ATTRIB_DICT, SCE_FACE_ATTRIB_DICT_SIZE },
+	};
+}
+
+LRDictLoader::LRDictLoader() :
+	_dictMask(0),
+	_region(SCE_NULL),
+	_doneEvf(SCE_UID_INVALID_UID),
+	_thread(SCE_UID_INVALID_UID)
+{
+	_dir[0] = '\0';
+
+	for (int i = 0; i < LR_DICT_NUM; i++) {
+		_offset[i] = 0;
+		_result[i] = SCE_OK;
+	}
+
+	sceClibMemset(&_stats, 0, sizeof(LRDictStats));
+}
+
+LRDictLoader::~LRDictLoader()
+{
+	if (_thread > 0) {
+		sceKernelWaitThreadEnd(_thread, NULL, NULL);
+		sceKernelDeleteThread(_thread);
+	}
+
+	if (_doneEvf > 0)
+		sceKernelDeleteEventFlag(_doneEvf);
+
+	free(_region);
+}
+
+SceUInt32 LRDictLoader::GetSize(SceInt32 dict)
+{
+	return s_dictFile[dict].size;
+}
+
+SceInt32 LRDictLoader::Start(const char *dir, SceUInt32 dictMask)
+{
+	sceClibSnprintf(_dir, sizeof(_dir), "%s", dir);
+	_dictMask = dictMask;
+
+	// Every slot starts on a cache line
+	SceUInt32 totalSize = 0;
+	for (int i = 0; i < LR_DICT_NUM; i++) {
+		if (!(dictMask & (1 << i))) {
+			_result[i] = LR_DICT_ERROR_DISABLED;
+			continue;
+		}
+
+		_offset[i] = totalSize;
+		totalSize += (s_dictFile[i].size + LR_DICT_ALIGN - 1) & ~(LR_DICT_ALIGN - 1);
+		_stats.dictNum++;
+	}
+
+	_stats.totalSize = totalSize;
+	_stats.startTime = sceKernelGetProcessTimeWide();
+
+	_region = (SceUInt8 *)memalign(LR_DICT_ALIGN, totalSize);
+	if (_region == SCE_NULL) {
+		SCE_DBG_LOG_ERROR("[LRDictLoader] memalign() failed.\n");
+		return SCE_KERNEL_ERROR_NO_MEMORY;
+	}
+
+	_doneEvf = sceKernelCreateEventFlag("LRDictLoader:DoneEvf", SCE_KERNEL_EVF_ATTR_MULTI, 0, SCE_NULL);
+	if (_doneEvf < 0) {
+		SCE_DBG_LOG_ERROR("[LRDictLoader] sceKernelCreateEventFlag() 0x%X\n", _doneEvf);
+		free(_region);
+		_region = SCE_NULL;
+		return _doneEvf;
+	}
+
+	sceKernelSetEventFlag(_doneEvf, ~dictMask & ((1 << LR_DICT_NUM) - 1));
+
+	// Mostly blocked in sceIoRead(), below the tracking threads so that it never delays a frame
+	_thread = sceKernelCreateThread("LRDictLoader:IoThread", ThreadStart, 100, 0x4000, 0, SCE_KERNEL_CPU_MASK_USER_1, NULL);
+	if (_thread < 0) {
+		SCE_DBG_LOG_ERROR("[LRDictLoader] sceKernelCreateThread() 0x%X\n", _thread);
+		Fail(_thread);
+		return _thread;
+	}
+
+	LRDictLoader *self = this;
+	SceInt32 ret = sceKernelStartThread(_thread, sizeof(LRDictLoader *), &self);
+	if (ret < 0) {
+		SCE_DBG_LOG_ERROR("[LRDictLoader] sceKernelStartThread() 0x%X\n", ret);
+		sceKernelDeleteThread(_thread);
+		_thread = SCE_UID_INVALID_UID;
+		Fail(ret);
+	}
+
+	return ret;
+}
+
+SceVoid LRDictLoader::Fail(SceInt32 error)
+{
+	for (int i = 0; i < LR_DICT_NUM; i++) {
+		if (_dictMask & (1 << i))
+			_result[i] = error;
+	}
+
+	_stats.doneCount = _stats.dictNum;
+	_stats.failCount = _stats.dictNum;
+
+	sceKernelSetEventFlag(_doneEvf, (1 << LR_DICT_NUM) - 1);
+}
+
+SceInt32 LRDictLoader::ThreadStart(SceSize args, ScePVoid argp)
+{
+	LRDictLoader *self = *(LRDictLoader **)argp;
+	self->Thread();
+
+	return sceKernelExitThread(0);
+}
+
+SceVoid LRDictLoader::Thread()
+{
+	for (int i = 0; i < LR_DICT_NUM; i++) {
+		if (!(_dictMask & (1 << i)))
+			continue;
+
+		SceUInt64 begin = sceKernelGetProcessTimeWide();
+
+		_result[i] = Read(i);
+
+		SceUInt64 end = sceKernelGetProcessTimeWide();
+		_stats.readTime[i] = (SceUInt32)(end - begin);
+
+		if (_result[i] == SCE_OK) {
+			_stats.readyTime[i] = end;
+		}
+		else {
+			SCE_DBG_LOG_ERROR("[LRDictLoader] %s%s 0x%X\n", _dir, s_dictFile[i].name, _result[i]);
+			_stats.failCount++;
+		}
+		_stats.doneCount++;
+
+		// The event flag call orders the dictionary data before the bit
+		sceKernelSetEventFlag(_doneEvf, 1 << i);
+	}
+}
+
+SceInt32 LRDictLoader::Read(SceInt32 dict)
+{
+	char path[128];
+	sceClibSnprintf(path, sizeof(path), "%s%s", _dir, s_dictFile[dict].name);
+
+	SceUID fd = sceIoOpen(path, SCE_O_RDONLY, 0);
+	if (fd < 0)
+		return fd;
+
+	SceUInt8 *dst = _region + _offset[dict];
+	SceUInt32 size = s_dictFile[dict].size;
+	SceUInt32 done = 0;
+	SceInt32 ret = SCE_OK;
+
+	while (done < size) {
+		SceUInt32 chunk = size - done;
+		if (chunk > LR_DICT_READ_CHUNK)
+			chunk = LR_DICT_READ_CHUNK;
+
+		SceSSize read = sceIoRead(fd, dst + done, chunk);
+		if (read < 0) {
+			ret = read;
+			break;
+		}
+		if (read == 0) {
+			ret = LR_DICT_ERROR_TRUNCATED;
+			break;
+		}
+
+		done += read;
+		_stats.loadedSize += read;
+	}
+
+	sceIoClose(fd);
+
+	return ret;
+}
+
+SceBool LRDictLoader::IsDone(SceInt32 dict)
+{
+	if (_doneEvf < 0)
+		return SCE_TRUE;
+
+	return sceKernelPollEventFlag(_doneEvf, 1 << dict, SCE_KERNEL_EVF_WAITMODE_AND, SCE_NULL) == SCE_OK;
+}
+
+ScePVoid LRDictLoader::Get(SceInt32 dict)
+{
+	if (_region == SCE_NULL || !IsDone(dict) || _result[dict] != SCE_OK)
+		return SCE_NULL;
+
+	return _region + _offset[dict];
+}
+
+ScePVoid LRDictLoader::Wait(SceInt32 dict)
+{
+	if (_doneEvf > 0)
+		sceKernelWaitEventFlag(_doneEvf, 1 << dict, SCE_KERNEL_EVF_WAITMODE_AND, SCE_NULL, SCE_NULL);
+
+	return Get(dict);
+}
+
+SceVoid LRDictLoader::GetStats(LRDictStats *stats)
+{
+	sceClibMemcpy(stats, &_stats, sizeof(LRDictStats));
+
+	stats->progress = stats->totalSize > 0 ? (SceUInt32)((SceUInt64)stats->loadedSize * 100 / stats->totalSize) : 0;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <kernel.h>
+#include <scetypes.h>
+
+// libface dictionaries in the order they are read, the ones tracking starts with come first
+#define LR_DICT_DETECT			0
+#define LR_DICT_PARTS			1
+#define LR_DICT_PARTS_CHECK		2
+#define LR_DICT_SHAPE			3
+#define LR_DICT_DETECT_LOCAL	4
+#define LR_DICT_ALLPARTS		5
+#define LR_DICT_ALLPARTS_SHAPE	6
+#define LR_DICT_ATTRIB			7
+#define LR_DICT_NUM				8
+
+#define LR_DICT_ALIGN			64
+// Reads are split so that progress moves while a large dictionary comes in
+#define LR_DICT_READ_CHUNK		(256 * 1024)
+
+// File shorter than the dictionary size libface expects
+#define LR_DICT_ERROR_TRUNCATED	-1
+// Not in the mask passed to Start()
+#define LR_DICT_ERROR_DISABLED	-2
+
+struct LRDictStats
+{
+	SceUInt32 dictNum;		// dictionaries to load
+	SceUInt32 doneCount;	// of those resident or failed
+	SceUInt32 failCount;
+	SceUInt32 totalSize;	// bytes
+	SceUInt32 loadedSize;
+	SceUInt32 progress;		// percent of totalSize
+	SceUInt64 startTime;	// process time Start() was called
+	SceUInt64 readyTime[LR_DICT_NUM];	// process time each dictionary became resident, 0 before or on failure
+	SceUInt32 readTime[LR_DICT_NUM];	// microseconds from opening to the last byte
+};
+
+// Reads the libface dictionaries on an I/O thread into one contiguous, cache line aligned
+// region. Callers pick up each dictionary as soon as it is resident instead of waiting for all.
+class LRDictLoader
+{
+public:
+
+	LRDictLoader();
+
+	~LRDictLoader();
+
+	// Allocates the region for the dictionaries in dictMask (1 << LR_DICT_*) and starts the
+	// I/O thread, dir ends with a slash. The others are done right away, without data.
+	SceInt32 Start(const char *dir, SceUInt32 dictMask);
+
+	// Resident dictionary, SCE_NULL while it is loading or if it could not be read
+	ScePVoid Get(SceInt32 dict);
+
+	// Read or failed, either way the loader is done with it
+	SceBool IsDone(SceInt32 dict);
+
+	// Blocks until the dictionary is done, same result as Get()
+	ScePVoid Wait(SceInt32 dict);
+
+	SceVoid GetStats(LRDictStats *stats);
+
+	static SceUInt32 GetSize(SceInt32 dict);
+
+private:
+
+	char _dir[64];
+	SceUInt32 _dictMask;
+
+	SceUInt8 *_region;
+	SceUInt32 _offset[LR_DICT_NUM];
+	SceInt32 _result[LR_DICT_NUM];
+
+	// One bit per dictionary, set once it is done
+	SceUID _doneEvf;
+	SceUID _thread;
+
+	LRDictStats _stats;
+
+	static SceInt32 ThreadStart(SceSize args, ScePVoid argp);
+
+	SceVoid Thread();
+
+	// Whole file into its slot, short reads count as failure
+	SceInt32 Read(SceInt32 dict);
+
+	// Marks every dictionary done with the error, so that no caller waits forever
+	SceVoid Fail(SceInt32 error);
+};
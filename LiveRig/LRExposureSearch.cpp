@@ -0,0 +1,238 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+
+#include "LRExposureSearch.hpp"
+
+LRExposureSearch::LRExposureSearch() :
+	_levelNum(0),
+	_center(0),
+	_step(0),
+	_level(0),
+	_active(false),
+	_measureCount(0)
+{
+	for (int32_t i = 0; i < LR_EXPOSURE_LEVEL_MAX; i++)
+		_score[i] = -1.0f;
+
+	SetLevel(0);
+}
+
+void LRExposureSearch::Start(int32_t levelNum, int32_t startIndex)
+{
+	if (levelNum > LR_EXPOSURE_LEVEL_MAX)
+		levelNum = LR_EXPOSURE_LEVEL_MAX;
+	if (startIndex < 0 || startIndex >= levelNum)
+		startIndex = levelNum / 2;
+
+	for (int32_t i = 0; i < LR_EXPOSURE_LEVEL_MAX; i++)
+		_score[i] = -1.0f;
+
+	_levelNum = levelNum;
+	_center = startIndex;
+	_step = levelNum / 4;
+	if (_step < 1)
+		_step = 1;
+	_measureCount = 0;
+	_active = levelNum > 0;
+
+	// The center is measured first
+	SetLevel(startIndex);
+}
+
+void LRExposureSearch::Abort()
+{
+	_active = false;
+}
+
+bool LRExposureSearch::IsActive() const
+{
+	return _active;
+}
+
+int32_t LRExposureSearch::GetLevel() const
+{
+	return _level;
+}
+
+void LRExposureSearch::SetLevel(int32_t level)
+{
+	_level = level;
+
+	_settleFrames = 0;
+	_stableFrames = 0;
+	_prevMean = -1.0f;
+
+	_sampleCount = 0;
+	_sampleSum = 0.0f;
+}
+
+bool LRExposureSearch::AddLuma(float mean)
+{
+	if (!_active)
+		return false;
+
+	if (_settleFrames < LR_EXPOSURE_SETTLE_MAX)
+		_settleFrames++;
+
+	if (_prevMean >= 0.0f && fabsf(mean - _prevMean) < LR_EXPOSURE_SETTLE_DELTA) {
+		if (_stableFrames < LR_EXPOSURE_SETTLE_STABLE)
+			_stableFrames++;
+	}
+	else {
+		// Samples are only taken from an image that stopped changing, unless it never does,
+		// a flickering light would otherwise keep the search on this level for good
+		_stableFrames = 0;
+		if (_settleFrames < LR_EXPOSURE_SETTLE_MAX) {
+			_sampleCount = 0;
+			_sampleSum = 0.0f;
+		}
+	}
+	_prevMean = mean;
+
+	if (_settleFrames >= LR_EXPOSURE_SETTLE_MAX)
+		return true;
+
+	return _settleFrames >= LR_EXPOSURE_SETTLE_MIN && _stableFrames >= LR_EXPOSURE_SETTLE_STABLE;
+}
+
+bool LRExposureSearch::AddScore(float score)
+{
+	if (!_active)
+		return false;
+
+	if (score < 0.0f)
+		score = 0.0f;
+
+	_sampleSum += score;
+	if (++_sampleCount < LR_EXPOSURE_SAMPLE_NUM)
+		return false;
+
+	_score[_level] = _sampleSum / (float)_sampleCount;
+	_measureCount++;
+
+	if (!Advance()) {
+		_active = false;
+
+		float best;
+		int32_t level = GetBest(&best);
+		SetLevel(level >= 0 ? level : _center);
+	}
+
+	return true;
+}
+
+bool LRExposureSearch::Advance()
+{
+	while (1) {
+		if (_step > 0) {
+			const int32_t probe[2] = { _center - _step, _center + _step };
+
+			for (int32_t i = 0; i < 2; i++) {
+				if (probe[i] >= 0 && probe[i] < _levelNum && _score[probe[i]] < 0.0f) {
+					SetLevel(probe[i]);
+					return true;
+				}
+			}
+
+			// Ties keep the center, so that a flat stretch does not wander
+			int32_t best = _center;
+			for (int32_t i = 0; i < 2; i++) {
+				if (probe[i] >= 0 && probe[i] < _levelNum && _score[probe[i]] > _score[best])
+					best = probe[i];
+			}
+
+			if (best != _center) {
+				_center = best;
+				continue;
+			}
+		}
+
+		// No face at any level yet: measure the middle of the widest unmeasured stretch instead
+		// of refining around a level that saw nothing
+		if (GetBest(NULL) < 0) {
+			int32_t gapLevel = -1;
+			int32_t gapDistance = 0;
+
+			for (int32_t i = 0; i < _levelNum; i++) {
+				if (_score[i] >= 0.0f)
+					continue;
+
+				int32_t distance = _levelNum;
+				for (int32_t j = 0; j < _levelNum; j++) {
+					if (_score[j] >= 0.0f) {
+						const int32_t d = i > j ? i - j : j - i;
+						distance = d < distance ? d : distance;
+					}
+				}
+
+				if (distance > gapDistance) {
+					gapDistance = distance;
+					gapLevel = i;
+				}
+			}
+
+			if (gapLevel < 0)
+				return false;
+
+			_center = gapLevel;
+			_step = gapDistance / 2;
+			SetLevel(gapLevel);
+			return true;
+		}
+
+		if (_step == 0)
+			return false;
+
+		_step /= 2;
+	}
+}
+
+int32_t LRExposureSearch::GetBest(float *score) const
+{
+	int32_t best = -1;
+	float bestScore = 0.0f;
+
+	for (int32_t i = 0; i < _levelNum; i++) {
+		if (_score[i] > bestScore) {
+			bestScore = _score[i];
+			best = i;
+		}
+	}
+
+	// Same as the search, a tie keeps the center
+	if (best >= 0 && _score[_center] == bestScore)
+		best = _center;
+
+	if (score != NULL)
+		*score = bestScore;
+
+	return best;
+}
+
+uint32_t LRExposureSearch::GetProgress() const
+{
+	if (!_active)
+		return 100;
+
+	uint32_t remaining = 0;
+
+	for (int32_t i = -1; i <= 1; i += 2) {
+		const int32_t probe = _center + i * _step;
+		if (probe >= 0 && probe < _levelNum && _score[probe] < 0.0f)
+			remaining++;
+	}
+	if (_score[_center] < 0.0f)
+		remaining++;
+
+	for (int32_t step = _step / 2; step > 0; step /= 2)
+		remaining += 2;
+
+	const uint32_t progress = _measureCount * 100 / (_measureCount + remaining);
+	return progress < 99 ? progress : 99;
+}
+
+uint32_t LRExposureSearch::GetMeasureCount() const
+{
+	return _measureCount;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stdint.h>
+
+// Finds the camera exposure level with the best face detection score.
+//
+// Coarse to fine pattern search over the level table: the levels one step below and above
+// the current best are scored, the best of the three becomes the center, and the step is
+// halved once the center stays best. Scores are kept, so no level is measured twice. With
+// 17 levels and a single peak this takes 6 to 8 measurements from the middle of the table
+// and at most 9 from anywhere, instead of 17. Without a face at any level all are measured.
+//
+// After every level change the caller feeds the mean luma of each new frame until the image
+// has settled: a few frames in a row that differ by less than LR_EXPOSURE_SETTLE_DELTA.
+// Then LR_EXPOSURE_SAMPLE_NUM detection scores are averaged for the level.
+//
+// Only depends on the C library so that it can be run on the host against simulated scores.
+
+#define LR_EXPOSURE_LEVEL_MAX		32
+#define LR_EXPOSURE_SAMPLE_NUM		2
+
+#define LR_EXPOSURE_SETTLE_DELTA	1.5f	// luma levels between consecutive frames
+#define LR_EXPOSURE_SETTLE_STABLE	2		// frames in a row within the delta
+#define LR_EXPOSURE_SETTLE_MIN		3		// frames before the level can have taken effect
+#define LR_EXPOSURE_SETTLE_MAX		15		// frames after which a level counts as settled anyway
+
+class LRExposureSearch
+{
+public:
+
+	LRExposureSearch();
+
+	// Starts at startIndex, which is usually the level the camera already uses
+	void Start(int32_t levelNum, int32_t startIndex);
+
+	void Abort();
+
+	bool IsActive() const;
+
+	// Level the camera has to use now
+	int32_t GetLevel() const;
+
+	// Mean luma of a frame taken at GetLevel(). Returns true once the image has settled
+	// and AddScore() is expected for this frame.
+	bool AddLuma(float mean);
+
+	// Detection score of a settled frame, 0 if no face was found. Returns true if the search
+	// moved on to another level, or finished.
+	bool AddScore(float score);
+
+	// Best level and its score, -1 if no level had a face
+	int32_t GetBest(float *score) const;
+
+	// Estimate from the measurements done and the ones left at the current step size
+	uint32_t GetProgress() const;
+
+	uint32_t GetMeasureCount() const;
+
+private:
+
+	float _score[LR_EXPOSURE_LEVEL_MAX];	// negative until measured
+	int32_t _levelNum;
+	int32_t _center;
+	int32_t _step;
+	int32_t _level;
+	bool _active;
+
+	uint32_t _measureCount;
+
+	int32_t _settleFrames;
+	int32_t _stableFrames;
+	float _prevMean;
+
+	int32_t _sampleCount;
+	float _sampleSum;
+
+	void SetLevel(int32_t level);
+
+	// Next unmeasured probe around the center, shrinking the step as needed. False when done.
+	bool Advance();
+};
@@ -1,561 +1,2037 @@
-#include <kernel.h>
-#include <libdbg.h>
-#include <libsysmodule.h>
-#include <libface.h>
-#include <stdlib.h>
-#include <math.h>
-#include <display.h>
-#include <scetypes.h>
-#include <vita2d_sys.h>
-
-#include <target_transport.h>
-
-#include "LRFace.hpp"
-#include "LRCamera.hpp"
-#include "LRGXM.hpp"
-#include "LRUtil.hpp"
-
-namespace {
-	LRFace *s_instance = SCE_NULL;
-}
-
-LRFace *LRFace::GetInstance()
-{
-	if (s_instance == SCE_NULL)
-	{
-		s_instance = new LRFace();
-	}
-
-	return s_instance;
-}
-
-SceVoid LRFace::ReleaseInstance()
-{
-	if (s_instance != SCE_NULL)
-	{
-		delete s_instance;
-	}
-
-	s_instance = SCE_NULL;
-}
-
-LRFace::LRFace() :
-	_prevFrame(0),
-	_evCalibrationNum(0),
-	_waitFrameCount(0),
-	_evLevel(0),
-	_isTracking(SCE_FALSE),
-	_isShapeTrack(SCE_TRUE),
-	_lostThres(SCE_FACE_SHAPE_SCORE_LOST_THRES_DEFAULT),
-	_evScore{0.f}
-{
-	SceInt32 ret;
-
-	sceClibMemset(&_shapeData, 0, sizeof(SceFaceShapeResult));
-
-	sceKernelCreateLwMutex(&_faceMtx, "LRFace:FaceMtx", SCE_KERNEL_LW_MUTEX_ATTR_RECURSIVE, 0, NULL);
-
-	// Load face module
-	ret = sceSysmoduleLoadModule(SCE_SYSMODULE_FACE);
-	if (ret != SCE_OK)
-		SCE_DBG_LOG_ERROR("[LRFace] sceSysmoduleLoadModule(SCE_SYSMODULE_FACE) 0x%X\n", ret);
-
-	// open dictionary file...
-	// face detect
-	_detectDictPtr = (SceUInt8 *)malloc(SCE_FACE_DETECT_ROLL_YAW_PITCH_DICT_SIZE);
-	if (_detectDictPtr == NULL)
-		SCE_DBG_LOG_ERROR("[LRFace] malloc() failed.\n");
-
-	SceUID fd = sceIoOpen("app0:sce_data/libface/" SCE_FACE_DETECT_ROLL_YAW_PITCH_DICT, SCE_O_RDONLY, 0);
-	if (fd > 0) {
-		sceIoRead(fd, _detectDictPtr, SCE_FACE_DETECT_ROLL_YAW_PITCH_DICT_SIZE);
-		sceIoClose(fd);
-	}
-	else
-		SCE_DBG_LOG_ERROR("[LRFace] detect dict not found\n");
-
-	//face detect local
-	_detectLocalDictPtr = (uint8_t*)malloc(SCE_FACE_DETECT_ROLL_YAW_DICT_SIZE);
-	if (_detectLocalDictPtr == NULL)
-		SCE_DBG_LOG_ERROR("[LRFace] malloc() failed.\n");
-
-	fd = sceIoOpen("app0:sce_data/libface/" SCE_FACE_DETECT_ROLL_YAW_DICT, SCE_O_RDONLY, 0);
-	if (fd > 0) {
-		sceIoRead(fd, _detectLocalDictPtr, SCE_FACE_DETECT_ROLL_YAW_DICT_SIZE);
-		sceIoClose(fd);
-	}
-	else
-		SCE_DBG_LOG_ERROR("[LRFace] detect-local dict not found\n");
-
-	// parts detect
-	_partsDictPtr = (uint8_t*)malloc(SCE_FACE_PARTS_ROLL_YAW_DICT_SIZE);
-	if (_partsDictPtr == NULL)
-		SCE_DBG_LOG_ERROR("[LRFace] malloc() failed.\n");
-
-	fd = sceIoOpen("app0:sce_data/libface/" SCE_FACE_PARTS_ROLL_YAW_DICT, SCE_O_RDONLY, 0);
-	if (fd > 0) {
-		sceIoRead(fd, _partsDictPtr, SCE_FACE_PARTS_ROLL_YAW_DICT_SIZE);
-		sceIoClose(fd);
-	}
-	else
-		SCE_DBG_LOG_ERROR("[LRFace] parts dict not found\n");
-
-	// allparts detect
-	_allPartsDictPtr = (uint8_t*)malloc(SCE_FACE_ALLPARTS_DICT_SIZE);
-	if (_allPartsDictPtr == NULL)
-		SCE_DBG_LOG_ERROR("[LRFace] malloc() failed.\n");
-
-	fd = sceIoOpen("app0:sce_data/libface/" SCE_FACE_ALLPARTS_DICT, SCE_O_RDONLY, 0);
-	if (fd > 0) {
-		sceIoRead(fd, _allPartsDictPtr, SCE_FACE_ALLPARTS_DICT_SIZE);
-		sceIoClose(fd);
-	}
-	else
-		SCE_DBG_LOG_ERROR("[LRFace] parts dict not found\n");
-
-	// parts checker
-	_partsCheckDictPtr = (uint8_t*)malloc(SCE_FACE_PARTS_CHECK_DICT_SIZE);
-	if (_partsCheckDictPtr == NULL)
-		SCE_DBG_LOG_ERROR("[LRFace] malloc() failed.\n");
-
-	fd = sceIoOpen("app0:sce_data/libface/" SCE_FACE_PARTS_CHECK_DICT, SCE_O_RDONLY, 0);
-	if (fd > 0) {
-		sceIoRead(fd, _partsCheckDictPtr, SCE_FACE_PARTS_CHECK_DICT_SIZE);
-		sceIoClose(fd);
-	}
-	else
-		SCE_DBG_LOG_ERROR("[LRFace] parts check dict not found\n");
-
-	// attrib classify
-	_attribDictPtr = (SceFaceAttribDictPtr)malloc(SCE_FACE_ATTRIB_DICT_SIZE);
-	if (_attribDictPtr == NULL)
-		SCE_DBG_LOG_ERROR("[LRFace] malloc() failed.\n");
-
-	fd = sceIoOpen("app0:sce_data/libface/" SCE_FACE_ATTRIB_DICT, SCE_O_RDONLY, 0);
-	if (fd > 0) {
-		sceIoRead(fd, _attribDictPtr, SCE_FACE_ATTRIB_DICT_SIZE);
-		sceIoClose(fd);
-	}
-	else
-		SCE_DBG_LOG_ERROR("[LRFace] attrib dict not found\n");
-
-	//shape
-	_shapeDictPtr = (SceFaceShapeModelDictPtr)malloc(SCE_FACE_SHAPE_DICT_FRONTAL_SIZE);
-	if (_shapeDictPtr == NULL)
-		SCE_DBG_LOG_ERROR("[LRFace] malloc() failed.\n");
-
-	fd = sceIoOpen("app0:sce_data/libface/" SCE_FACE_SHAPE_DICT_FRONTAL, SCE_O_RDONLY, 0);
-	if (fd > 0) {
-		sceIoRead(fd, _shapeDictPtr, SCE_FACE_SHAPE_DICT_FRONTAL_SIZE);
-		sceIoClose(fd);
-	}
-	else
-		SCE_DBG_LOG_ERROR("[LRFace] shape dict not found\n");
-
-	//allparts shape
-	_shapeApDictPtr = (SceFaceShapeDictPtr)malloc(SCE_FACE_ALLPARTS_SHAPE_DICT_SIZE);
-	if (_shapeApDictPtr == NULL)
-		SCE_DBG_LOG_ERROR("[LRFace] malloc() failed.\n");
-
-	fd = sceIoOpen("app0:sce_data/libface/" SCE_FACE_ALLPARTS_SHAPE_DICT, SCE_O_RDONLY, 0);
-	if (fd > 0) {
-		sceIoRead(fd, _shapeApDictPtr, SCE_FACE_ALLPARTS_SHAPE_DICT_SIZE);
-		sceIoClose(fd);
-	}
-	else
-		SCE_DBG_LOG_ERROR("[LRFace] shape dict not found\n");
-
-	SceInt32 cameraWidth, cameraHeight;
-	LRCamera *cam = LRCamera::GetInstance();
-
-	cam->GetSize(&cameraWidth, &cameraHeight);
-
-	_workSize = sceFaceDetectionGetWorkingMemorySize(cameraWidth, cameraHeight, cameraWidth, _detectDictPtr);
-	_workPtr = malloc(_workSize);
-
-	_workSizeLocal = sceFaceDetectionGetWorkingMemorySize(cameraWidth, cameraHeight, cameraWidth, _detectLocalDictPtr);
-	_workPtrLocal = malloc(_workSizeLocal);
-
-	_workSizeParts = sceFacePartsGetWorkingMemorySize(cameraWidth, cameraHeight, cameraWidth, _partsDictPtr);
-	_workPtrParts = malloc(_workSizeParts);
-
-	_workSizeAllParts = sceFaceAllPartsGetWorkingMemorySize(cameraWidth, cameraHeight, cameraWidth, _allPartsDictPtr);
-	_workPtrAllParts = malloc(_workSizeAllParts);
-
-	_workAttribSize = sceFaceAttributeGetWorkingMemorySize(cameraWidth, cameraHeight, cameraWidth, _attribDictPtr);
-	_workAttribPtr = malloc(_workAttribSize);
-
-	_workSizeShape = sceFaceShapeGetWorkingMemorySize(cameraWidth, cameraHeight, cameraWidth, _shapeDictPtr, cameraWidth, cameraHeight, true);
-	_workPtrShape = malloc(_workSizeShape);
-
-	SceInt32 cameraBufSize;
-	ScePVoid buf;
-	cam->GetIBuffer(&buf, &cameraBufSize);
-
-	_iBufferPrevious = (SceUInt8 *)malloc(cameraBufSize); //for tracking
-}
-
-LRFace::~LRFace()
-{
-	
-}
-
-SceInt32 LRFace::TrackThreadStart(SceSize args, ScePVoid argp)
-{
-	s_instance->TrackThread();
-
-	return 0;
-}
-
-SceVoid LRFace::TrackThread()
-{
-	SceInt32 ret;
-	SceInt32 face_ret = -1;
-	SceInt32 parts_ret = -1;
-	SceInt32 shape_ret = -1;
-	SceInt32 attr_ret = -1;
-	unsigned char *camBuffer;
-	SceInt32 camWidth;
-	SceInt32 camHeight;
-	SceUInt64 frame;
-	SceUInt64 timestamp;
-
-	// Set resultPrecision to SCE_FACE_DETECT_RESULT_NORMAL for speed.
-	// After global search face detection, it is always done local search
-	// face detection, so that resultPrecision set to SCE_FACE_DETECT_RESULT_NORMAL.
-	SceFaceDetectionParam detectParam;
-	sceFaceDetectionGetDefaultParam(&detectParam);
-	detectParam.resultPrecision = SCE_FACE_DETECT_RESULT_PRECISE;
-	detectParam.searchType = SCE_FACE_DETECT_SEARCH_FACE_NUM_LIMIT;
-	detectParam.magBegin = 0.5f;
-	detectParam.magStep = 0.841f;
-	detectParam.magEnd = 0.0f;
-	detectParam.xScanStep = 2;
-	detectParam.yScanStep = 2;
-	detectParam.thresholdScore = 0.5f;
-
-	SceFaceDetectionResult face[2];
-	SceFaceAttribResult    attr[SCE_FACE_ATTRIB_NUM_MAX];
-
-	while (1) {
-
-		sceKernelLockLwMutex(&_faceMtx, 1, NULL);
-
-		LRCamera::GetInstance()->Update(
-			&camBuffer, &camWidth, &camHeight,
-			&frame, &timestamp, SCE_TRUE
-		);
-
-		if (_prevFrame != frame) {
-			_prevFrame = frame;
-
-			// TODO: Render camera image here
-
-			SceInt32 numFace;
-			SceInt32 numAttrib;
-			if (!_isTracking) {
-				face_ret = sceFaceDetectionEx(
-					camBuffer, camWidth, camHeight, camWidth,
-					_detectDictPtr,
-					&detectParam,
-					&face[0], 1,
-					&numFace,
-					_workPtr, _workSize
-				);
-
-				if (face_ret == SCE_OK) {
-					if (numFace > 0) {
-
-						/*face_ret = sceFaceDetectionLocal(
-							yuvBuffer, yuvWidth, yuvHeight, yuvWidth,
-							_detectLocalDictPtr,
-							0.841f, 1.3f, 1.3f, 1, 1, 0.50f,
-							&face[1], 1, &face[0], 1,
-							&numFace,
-							_workPtrLocal, _workSizeLocal
-						);*/
-
-						parts_ret = sceFacePartsEx(
-							camBuffer, camWidth, camHeight, camWidth,
-							_partsDictPtr,
-							_partsCheckDictPtr,
-							1, 1,
-							&face[0],
-							_parts, SCE_FACE_PARTS_NUM_MAX,
-							&_numParts,
-							_workPtrParts, _workSizeParts
-						);
-
-						/*parts_ret = sceFaceAllParts(
-							camBuffer, camWidth, camHeight, camWidth,
-							_allPartsDictPtr,
-							_shapeApDictPtr,
-							1, 1,
-							&face[0],
-							_allParts, SCE_FACE_ALLPARTS_NUM_MAX,
-							&_numAllParts,
-							_workPtrAllParts, _workSizeAllParts
-						);*/
-
-						/*attr_ret = sceFaceAttribute(
-							yuvBuffer, yuvWidth, yuvHeight, yuvWidth,
-							_attribDictPtr,
-							&face[0], parts, numParts,
-							attr, SCE_FACE_ATTRIB_NUM_MAX, &numAttrib,
-							_workAttribPtr, _workAttribSize
-						);*/
-
-						if (_isShapeTrack) {
-								shape_ret = sceFaceShapeFit(
-									camBuffer, camWidth, camHeight, camWidth,
-									_shapeDictPtr,
-									&_shapeData, SCE_FACE_SHAPE_SCORE_LOST_THRES_MIN,
-									&face[0], _parts, _numParts,
-									_workPtrShape, _workSizeShape
-								);
-
-								//s_score = s_shapeData.score;
-
-								if (shape_ret == SCE_OK) {
-									_isTracking = SCE_TRUE;
-								}
-						}
-					}
-				}
-			}
-			else { // _isTracking == SCE_TRUE
-				shape_ret = sceFaceShapeTrack(
-					camBuffer, _iBufferPrevious, camWidth, camHeight, camWidth,
-					_shapeDictPtr,
-					&_shapeData, _lostThres,
-					_workPtrShape, _workSizeShape
-				);
-
-				//s_score = s_shapeData.score;
-
-				if (shape_ret != SCE_OK) {
-					_isTracking = SCE_FALSE;
-				}
-			}
-
-			sceClibMemcpy(_iBufferPrevious, camBuffer, camWidth * camHeight);
-
-			// TODO: End camera rendering here
-
-			if (_isTracking) { // Full tracking
-
-				/*sceClibPrintf("face pitch: %f\n", _shapeData.facePitch);
-				sceClibPrintf("face roll: %f\n", _shapeData.faceRoll);
-				sceClibPrintf("face yaw: %f\n", _shapeData.faceYaw);
-
-				sceClibPrintf("\nface rect widht: %f\n", _shapeData.rectWidth);
-				sceClibPrintf("face rect height: %f\n", _shapeData.rectHeight);
-
-				sceClibPrintf("\nface rect centerx: %f\n", _shapeData.rectCenterX);
-				sceClibPrintf("face rect centery: %f\n", _shapeData.rectCenterY);
-
-				sceClibPrintf("\npoint num: %d\n", _shapeData.pointNum);*/
-
-				// TODO: draw wireframe here
-				//drawShape(rgbaBuffer, rgbaWidth, rgbaHeight, rgbaPitch * 4, &s_shapeData);
-			}
-			else { // No tracking: can only get face pitch, roll, yaw
-				if (parts_ret == SCE_OK) {
-					/*SceFacePose pose;
-					SceFaceRegion region;
-					ret = sceFaceEstimatePoseRegion(
-						camWidth, camHeight,
-						&face[0], _parts, _numParts,
-						&pose, &region
-					);*/
-
-					if (ret == SCE_OK) {
-
-						/*sceClibPrintf("face pitch: %f\n", pose.facePitch);
-						sceClibPrintf("face roll: %f\n", pose.faceRoll);
-						sceClibPrintf("face yaw: %f\n", pose.faceYaw);*/
-
-						// TODO: draw wireframe here
-						/*sampleFaceDrawPoseRegionResult(
-							rgbaBuffer, rgbaWidth, rgbaHeight, rgbaPitch * 4,
-							&pose, &region,
-							D_CYAN
-						);*/
-					}
-				}
-			}
-		}
-
-		sceKernelUnlockLwMutex(&_faceMtx, 1);
-		sceDisplayWaitVblankStartMulti(2);
-	}
-}
-
-SceBool LRFace::Calibrate(SceUInt32 *progress)
-{
-	unsigned char *camBuffer;
-	SceInt32 camWidth;
-	SceInt32 camHeight;
-	SceUInt64 frame;
-	SceUInt64 timestamp;
-	SceBool result = SCE_FALSE;
-
-	LRCamera *cam = LRCamera::GetInstance();
-
-	sceKernelLockLwMutex(&_faceMtx, 1, NULL);
-
-	cam->Update(
-		&camBuffer, &camWidth, &camHeight,
-		&frame, &timestamp, SCE_TRUE
-	);
-
-	if (_prevFrame != frame) {
-		_prevFrame = frame;
-
-		if (_waitFrameCount < _waitFrameNum) {
-			/*E wait until the effect of sceCameraSetEV(). */
-			_waitFrameCount++;
-		}
-		else {
-			SceFaceDetectionResult face;
-			SceInt32 numFace = 0;
-			sceFaceDetection(
-				camBuffer, camWidth, camHeight, camWidth,
-				_detectDictPtr,
-				0.5f, 0.841f, 0.0f, 2, 2, 0.80f, SCE_FACE_DETECT_RESULT_NORMAL,
-				&face, 1,
-				&numFace,
-				_workPtr, _workSize
-			);
-
-			if (numFace == 0) {
-				sceKernelUnlockLwMutex(&_faceMtx, 1);
-				if (progress) {
-					*progress = (SceUInt32)(((SceFloat)_evCalibrationNum / (SceFloat)_evLevelNum) * 100.0f);
-				}
-				return result;
-			}
-
-			_evScore[_evCalibrationNum] = face.score;
-			sceClibPrintf("EV_Level:Score = %d:%f\n", _evLevelTable[_evCalibrationNum], _evScore[_evCalibrationNum]);
-			_evCalibrationNum++;
-
-			if (_evCalibrationNum < _evLevelNum) {
-				_waitFrameCount = 0;
-				cam->SetEv(_evLevelTable[_evCalibrationNum]);
-			}
-			else { // calibration finished
-				SceInt32 maxLevelNum = -1;
-				SceFloat maxScore = 0.f;
-
-				for (int i = 0; i < _evLevelNum; i++) {
-					if (maxScore < _evScore[i]) {
-						maxScore = _evScore[i];
-						maxLevelNum = i;
-					}
-				}
-
-				if (maxLevelNum == -1) {
-					sceClibPrintf("Calibration Error\n");
-					cam->SetEv(_evLevel);
-				}
-				else {
-					sceClibPrintf("max_level:max_score = %d:%f\n", _evLevelTable[maxLevelNum], maxScore);
-					_evLevel = _evLevelTable[maxLevelNum];
-					cam->SetEv(_evLevelTable[maxLevelNum]);
-				}
-				_evCalibrationNum = 0;
-				result = SCE_TRUE;
-			}
-		}
-	}
-
-	sceKernelUnlockLwMutex(&_faceMtx, 1);
-
-	if (progress) {
-		if (result)
-			*progress = 100;
-		else
-			*progress = (SceUInt32)(((SceFloat)_evCalibrationNum / (SceFloat)_evLevelNum) * 100.0f);
-	}
-
-	return result;
-}
-
-SceBool LRFace::GetTrackingState()
-{
-	return _isTracking;
-}
-
-SceVoid LRFace::GetBasicTrackingAngles(SceFloat *x, SceFloat *y)
-{
-	SceFloat rx = _shapeData.faceYaw * 2.0f;
-	SceFloat ry = _shapeData.facePitch * -2.5f;
-
-	if (isnan(rx))
-		rx = 0.0f;
-	if (isnan(ry))
-		ry = 0.0f;
-
-	*x = rx;
-	*y = ry;
-}
-
-SceVoid LRFace::GetMouth(SceFloat *p1)
-{
-	SceFloat ret = (_shapeData.pointY[43] - _shapeData.pointY[40]) * 10.0f;
-	if (isnan(ret))
-		ret = 0.0f;
-	*p1 = ret;
-}
-
-SceVoid LRFace::GetBrows(SceFloat *l, SceFloat *r)
-{
-	SceFloat rl = (_shapeData.pointY[14] - _shapeData.pointY[22]);
-	SceFloat rr = (_shapeData.pointY[1] - _shapeData.pointY[18]);
-
-	if (isnan(rl))
-		rl = 0.0f;
-	if (isnan(rr))
-		rr = 0.0f;
-
-	*l = rl;
-	*r = rr;
-}
-
-int idx = 0;
-
-SceVoid LRFace::DrawShape()
-{
-	if (_isTracking) {
-		for (int i = 0; i < _shapeData.pointNum; i++) {
-
-			SceFloat sx = (int)(160 * _shapeData.pointX[i]);
-			SceFloat dx = (int)(160 * _shapeData.pointX[_shapeConnectTo[_shapeData.modelID][i]]);
-			SceFloat sy = (int)(120 * _shapeData.pointY[i]);
-			SceFloat dy = (int)(120 * _shapeData.pointY[_shapeConnectTo[_shapeData.modelID][i]]);
-
-			//if (i == idx)
-			vita2d_draw_line(sx, sy, dx, dy, RGBA8(255, 0, 0, 255));
-		}
-	}
-
-	char val[1];
-
-	if (sceTargetTransportTryRecv(val, sizeof(val)) == sizeof(val)) {
-		if (val[0] == ',') {
-			idx++;
-			sceClibPrintf("idx: %d\n", idx);
-		}
-		else if (val[0] == 'S') {
-			idx--;
-			sceClibPrintf("idx: %d\n", idx);
-		}
-	}
-}
-
-SceVoid LRFace::StartTracking()
-{
-	SceUID updateThread = sceKernelCreateThread("LRFace:UpdateThread", TrackThreadStart, 64, 0x100000, 0, SCE_KERNEL_CPU_MASK_USER_1, NULL);
-	sceKernelStartThread(updateThread, 0, NULL);
-}
+#include <kernel.h>
+#include <libdbg.h>
+#include <libsysmodule.h>
+#include <libface.h>
+#include <stdlib.h>
+#include <math.h>
+#include <display.h>
+#include <scetypes.h>
+#include <vita2d_sys.h>
+
+#include <target_transport.h>
+
+#include "LRFace.hpp"
+#include "LRCamera.hpp"
+#include "LRGXM.hpp"
+#include "LRUtil.hpp"
+
+namespace {
+	LRFace *s_instance = SCE_NULL;
+
+	const char *s_stageName[LR_FACE_STAGE_NUM] = {
+		"detect", "local", "parts", "shape", "allparts", "attrib"
+	};
+
+	// Dictionaries each stage reads, 1 << LR_DICT_*
+	const SceUInt32 s_stageDictMask[LR_FACE_STAGE_NUM] = {
+		1 << LR_DICT_DETECT,
+		1 << LR_DICT_DETECT_LOCAL,
+		(1 << LR_DICT_PARTS) | (1 << LR_DICT_PARTS_CHECK),
+		1 << LR_DICT_SHAPE,
+		(1 << LR_DICT_ALLPARTS) | (1 << LR_DICT_ALLPARTS_SHAPE),
+		1 << LR_DICT_ATTRIB,
+	};
+
+	const char *s_profilePath = "ux0:data/LiveRig/profile.lrpf";
+}
+
+LRFace *LRFace::GetInstance()
+{
+	if (s_instance == SCE_NULL)
+	{
+		s_instance = new LRFace();
+	}
+
+	return s_instance;
+}
+
+SceVoid LRFace::ReleaseInstance()
+{
+	if (s_instance != SCE_NULL)
+	{
+		delete s_instance;
+	}
+
+	s_instance = SCE_NULL;
+}
+
+LRFace::LRFace() :
+	_calibBegin(0),
+	_evLevel(0),
+	_evScore(0.0f),
+	_profileSnapshotTime(0),
+	_profileSavedVersion(0),
+	_profileSaveTime(0),
+	_profileSavedEv(0),
+	_profileSavedScore(0.0f),
+	_profileCheck(SCE_FALSE),
+	_profileMissCount(0),
+	_stageMask(LR_FACE_PIPELINE_DEFAULT),
+	_trackStagesReady(SCE_FALSE),
+	_dictPending(SCE_TRUE),
+	_isShapeTrack(SCE_TRUE),
+	_lostThres(SCE_FACE_SHAPE_SCORE_LOST_THRES_DEFAULT),
+	_roiMode(SCE_FALSE),
+	_trackNext(0),
+	_nextTrackId(1),
+	_newFaceCount(0),
+	_telemetryTime(0),
+	_lastFrameSeq(0)
+{
+	SceInt32 ret;
+
+	// Head angles: One Euro keeps them still at rest and responsive when turning.
+	// Mouth: spring, opens and closes smoothly without overshoot.
+	// Brows: One Euro, the landmark differences are small so speed matters more.
+	LRFilterParam filterParam[LR_FACE_CHANNEL_NUM];
+	LRFilter::GetDefaultParam(LR_FILTER_ONE_EURO, &filterParam[LR_FACE_CHANNEL_ANGLE_X]);
+	filterParam[LR_FACE_CHANNEL_ANGLE_Y] = filterParam[LR_FACE_CHANNEL_ANGLE_X];
+
+	LRFilter::GetDefaultParam(LR_FILTER_SPRING, &filterParam[LR_FACE_CHANNEL_MOUTH]);
+	filterParam[LR_FACE_CHANNEL_MOUTH].frequency = 30.0f;
+
+	LRFilter::GetDefaultParam(LR_FILTER_ONE_EURO, &filterParam[LR_FACE_CHANNEL_BROW_L]);
+	filterParam[LR_FACE_CHANNEL_BROW_L].minCutoff = 1.5f;
+	filterParam[LR_FACE_CHANNEL_BROW_L].beta = 20.0f;
+	filterParam[LR_FACE_CHANNEL_BROW_R] = filterParam[LR_FACE_CHANNEL_BROW_L];
+
+	// Eyes: a blink lasts about 100 ms, keep the cutoff high enough not to swallow it
+	LRFilter::GetDefaultParam(LR_FILTER_ONE_EURO, &filterParam[LR_FACE_CHANNEL_EYE_L_OPEN]);
+	filterParam[LR_FACE_CHANNEL_EYE_L_OPEN].minCutoff = 4.0f;
+	filterParam[LR_FACE_CHANNEL_EYE_L_OPEN].beta = 1.0f;
+	filterParam[LR_FACE_CHANNEL_EYE_R_OPEN] = filterParam[LR_FACE_CHANNEL_EYE_L_OPEN];
+
+	LRFilter::GetDefaultParam(LR_FILTER_ONE_EURO, &filterParam[LR_FACE_CHANNEL_GAZE_X]);
+	filterParam[LR_FACE_CHANNEL_GAZE_X].beta = 0.5f;
+	filterParam[LR_FACE_CHANNEL_GAZE_Y] = filterParam[LR_FACE_CHANNEL_GAZE_X];
+
+	for (int t = 0; t < LR_FACE_TRACK_MAX; t++) {
+		LRFaceTrack *track = &_track[t];
+
+		track->id = -1;
+		track->isTracking = SCE_FALSE;
+		track->updated = SCE_FALSE;
+		track->prevFrame = SCE_NULL;
+		track->roiX = 0;
+		track->roiY = 0;
+		track->localRetryCount = _localRetryNum;
+		track->lostFrames = 0;
+		track->filterTime = 0;
+		track->eyeStageCount = 0;
+		track->allPartsCount = 0;
+		track->allPartsValid = SCE_FALSE;
+		track->eyeValid = SCE_FALSE;
+		track->gazeX = 0.0f;
+		track->gazeY = 0.0f;
+		track->numAllParts = 0;
+
+		sceClibMemset(&track->shape, 0, sizeof(SceFaceShapeResult));
+		sceClibMemset(&track->rect, 0, sizeof(SceFaceDetectionResult));
+		sceClibMemset(&track->lostFace, 0, sizeof(SceFaceDetectionResult));
+		sceClibMemset(&track->frame, 0, sizeof(LRTrackingFrame));
+		sceClibMemset(&track->stats, 0, sizeof(LRFaceTrackStats));
+
+		for (int i = 0; i < LR_FACE_CHANNEL_NUM; i++)
+			track->filter.SetParam(i, &filterParam[i]);
+
+		sceClibMemset(track->neutral, 0, sizeof(track->neutral));
+		track->neutralCount = 0;
+
+		for (int i = 0; i < 2; i++) {
+			track->eyeOpen[i] = 1.0f;
+			track->eyeOpenRef[i] = 0.25f;
+		}
+	}
+
+	// What the last session learned replaces the defaults above
+	LoadProfile();
+	sceClibMemset(&_reacquireStats, 0, sizeof(LRReacquireStats));
+	sceClibMemset(&_calibStats, 0, sizeof(LRCalibrationStats));
+	sceClibMemset(&_startupStats, 0, sizeof(LRStartupStats));
+
+	sceKernelCreateLwMutex(&_faceMtx, "LRFace:FaceMtx", SCE_KERNEL_LW_MUTEX_ATTR_RECURSIVE, 0, NULL);
+	sceKernelCreateLwMutex(&_detectMtx, "LRFace:DetectMtx", SCE_KERNEL_LW_MUTEX_ATTR_RECURSIVE, 0, NULL);
+
+	_detectEvf = sceKernelCreateEventFlag("LRFace:DetectEvf", SCE_KERNEL_EVF_ATTR_MULTI, 0, SCE_NULL);
+	if (_detectEvf < 0)
+		SCE_DBG_LOG_ERROR("[LRFace] sceKernelCreateEventFlag() 0x%X\n", _detectEvf);
+
+	// Load face module
+	ret = sceSysmoduleLoadModule(SCE_SYSMODULE_FACE);
+	if (ret != SCE_OK)
+		SCE_DBG_LOG_ERROR("[LRFace] sceSysmoduleLoadModule(SCE_SYSMODULE_FACE) 0x%X\n", ret);
+
+	// Dictionaries come in on the loader's I/O thread, stages start as theirs are resident
+	for (int i = 0; i < LR_FACE_STAGE_NUM; i++) {
+		if (i != LR_FACE_STAGE_DETECT)
+			_arena.SetConflict(LR_FACE_STAGE_DETECT, i);
+	}
+
+	SceUInt32 dictMask = 0;
+	for (int i = 0; i < LR_FACE_STAGE_NUM; i++) {
+		if (_stageMask & LR_FACE_STAGE_BIT(i))
+			dictMask |= s_stageDictMask[i];
+	}
+	_dictLoader.Start("app0:sce_data/libface/", dictMask);
+
+	AllocWorkMemory();
+}
+
+LRFace::~LRFace()
+{
+	
+}
+
+SceVoid LRFace::AllocWorkMemory()
+{
+	LRCamera *cam = LRCamera::GetInstance();
+
+	cam->GetSize(&_camWidth, &_camHeight);
+
+	// In ROI mode detection runs on a QQVGA-sized pyramid level of the full frame,
+	// parts and shape run at full resolution on a crop around the face.
+	SceInt32 baseLevel = 0;
+	if (_roiMode) {
+		while (_camWidth >> (baseLevel + 1) >= 160)
+			baseLevel++;
+	}
+
+	// Every halving of the start magnification is one pyramid level libface does not have to resize itself
+	SceInt32 detectLevel = baseLevel;
+	SceFloat detectMag = _detectMagBegin;
+	while (detectMag <= 0.5f && (_camWidth >> (detectLevel + 1)) >= 80) {
+		detectMag *= 2.0f;
+		detectLevel++;
+	}
+
+	// One extra level is kept around for coarse searches
+	_pyramid.Init(_camWidth, _camHeight, detectLevel + 2);
+
+	const LRPyramidLevel *level = _pyramid.GetLevel(detectLevel);
+	_detectLevel = detectLevel;
+	_detectMag = detectMag;
+	_detectWidth = level->width;
+	_detectHeight = level->height;
+	_detectPitch = level->pitch;
+
+	if (_roiMode && baseLevel > 0) {
+		_trackWidth = _camWidth / 2;
+		_trackHeight = _camHeight / 2;
+	}
+	else {
+		_trackWidth = _camWidth;
+		_trackHeight = _camHeight;
+	}
+
+	for (int i = 0; i < LR_FACE_STAGE_NUM; i++) {
+		_workSize[i] = 0;
+		_workPtr[i] = SCE_NULL;
+		_arena.SetSize(i, 0);
+	}
+
+	AllocStageMemory();
+}
+
+SceInt32 LRFace::GetStageWorkSize(SceInt32 stage)
+{
+	switch (stage) {
+	case LR_FACE_STAGE_DETECT:
+		return sceFaceDetectionGetWorkingMemorySize(_detectWidth, _detectHeight, _detectPitch, _detectDictPtr);
+	case LR_FACE_STAGE_LOCAL:
+		return sceFaceDetectionGetWorkingMemorySize(_trackWidth, _trackHeight, _camWidth, _detectLocalDictPtr);
+	case LR_FACE_STAGE_PARTS:
+		return sceFacePartsGetWorkingMemorySize(_trackWidth, _trackHeight, _camWidth, _partsDictPtr);
+	case LR_FACE_STAGE_SHAPE:
+		return sceFaceShapeGetWorkingMemorySize(_trackWidth, _trackHeight, _camWidth, _shapeDictPtr, _trackWidth, _trackHeight, true);
+	case LR_FACE_STAGE_ALLPARTS:
+		return sceFaceAllPartsGetWorkingMemorySize(_trackWidth, _trackHeight, _camWidth, _allPartsDictPtr);
+	case LR_FACE_STAGE_ATTRIB:
+		return sceFaceAttributeGetWorkingMemorySize(_trackWidth, _trackHeight, _camWidth, _attribDictPtr);
+	}
+
+	return 0;
+}
+
+SceVoid LRFace::AllocStageMemory()
+{
+	sceKernelLockLwMutex(&_detectMtx, 1, NULL);
+
+	// SCE_NULL until resident, and for the dictionaries of disabled stages
+	_detectDictPtr = (SceUInt8 *)_dictLoader.Get(LR_DICT_DETECT);
+	_detectLocalDictPtr = (SceUInt8 *)_dictLoader.Get(LR_DICT_DETECT_LOCAL);
+	_partsDictPtr = (SceUInt8 *)_dictLoader.Get(LR_DICT_PARTS);
+	_partsCheckDictPtr = (SceUInt8 *)_dictLoader.Get(LR_DICT_PARTS_CHECK);
+	_shapeDictPtr = (SceFaceShapeModelDictPtr)_dictLoader.Get(LR_DICT_SHAPE);
+	_allPartsDictPtr = (SceUInt8 *)_dictLoader.Get(LR_DICT_ALLPARTS);
+	_shapeApDictPtr = (SceFaceShapeDictPtr)_dictLoader.Get(LR_DICT_ALLPARTS_SHAPE);
+	_attribDictPtr = (SceFaceAttribDictPtr)_dictLoader.Get(LR_DICT_ATTRIB);
+
+	// Each stage gets its working memory once all of its dictionaries are resident
+	SceBool grown = SCE_FALSE;
+	for (int i = 0; i < LR_FACE_STAGE_NUM; i++) {
+		if (!(_stageMask & LR_FACE_STAGE_BIT(i)) || _workSize[i] != 0)
+			continue;
+
+		SceBool resident = SCE_TRUE;
+		for (int d = 0; d < LR_DICT_NUM; d++) {
+			if ((s_stageDictMask[i] & (1 << d)) && _dictLoader.Get(d) == SCE_NULL)
+				resident = SCE_FALSE;
+		}
+		if (!resident)
+			continue;
+
+		SceInt32 size = GetStageWorkSize(i);
+		if (size <= 0) {
+			SCE_DBG_LOG_ERROR("[LRFace] stage %s working memory size 0x%X\n", s_stageName[i], size);
+			continue;
+		}
+
+		_workSize[i] = size;
+		_arena.SetSize(i, size);
+		grown = SCE_TRUE;
+	}
+
+	// No stage is running while both mutexes are held, so regions may move
+	if (grown) {
+		_arena.Plan();
+		if (!_arena.Reserve())
+			SCE_DBG_LOG_ERROR("[LRFace] LRArena::Reserve() failed.\n");
+
+		for (int i = 0; i < LR_FACE_STAGE_NUM; i++)
+			_workPtr[i] = _arena.Get(i);
+	}
+
+	sceKernelUnlockLwMutex(&_detectMtx, 1);
+
+	// Everything else is optional, a face is tracked with detection, parts and shape
+	_trackStagesReady = (_workPtr[LR_FACE_STAGE_DETECT] != SCE_NULL && _workPtr[LR_FACE_STAGE_PARTS] != SCE_NULL && _workPtr[LR_FACE_STAGE_SHAPE] != SCE_NULL);
+	if (_trackStagesReady && _startupStats.trackReadyTime == 0)
+		_startupStats.trackReadyTime = sceKernelGetProcessTimeWide();
+
+	const SceBool dictPending = _dictPending;
+	_dictPending = SCE_FALSE;
+	for (int i = 0; i < LR_DICT_NUM; i++) {
+		if (!_dictLoader.IsDone(i))
+			_dictPending = SCE_TRUE;
+	}
+
+	if (dictPending && !_dictPending)
+		PrintMemoryReport();
+}
+
+SceVoid LRFace::GetMemoryReport(LRStageMemoryReport *report)
+{
+	sceClibMemset(report, 0, sizeof(LRStageMemoryReport));
+
+	report->stageMask = _stageMask;
+
+	for (int i = 0; i < LR_FACE_STAGE_NUM; i++) {
+		for (int d = 0; d < LR_DICT_NUM; d++) {
+			if (s_stageDictMask[i] & (1 << d))
+				report->dictSize[i] += LRDictLoader::GetSize(d);
+		}
+
+		if (_workPtr[i] != SCE_NULL)
+			report->workSize[i] = _workSize[i];
+
+		if (_stageMask & LR_FACE_STAGE_BIT(i))
+			report->totalSize += report->dictSize[i];
+	}
+
+	report->arenaSize = _arena.GetCapacity();
+	report->savedSize = _arena.GetSeparateSize() - _arena.GetSize();
+	report->totalSize += report->arenaSize;
+}
+
+SceVoid LRFace::PrintMemoryReport()
+{
+	LRStageMemoryReport report;
+	GetMemoryReport(&report);
+
+	for (int i = 0; i < LR_FACE_STAGE_NUM; i++) {
+		sceClibPrintf("[LRFace] stage %-8s %s dict %7u B, work %7u B\n", s_stageName[i],
+			(report.stageMask & LR_FACE_STAGE_BIT(i)) ? "on " : "off", report.dictSize[i], report.workSize[i]);
+	}
+	sceClibPrintf("[LRFace] arena %u B, %u B saved by sharing\n", report.arenaSize, report.savedSize);
+	sceClibPrintf("[LRFace] tracker memory %u B\n", report.totalSize);
+}
+
+SceVoid LRFace::FreeWorkMemory()
+{
+	for (int i = 0; i < LR_FACE_STAGE_NUM; i++)
+		_workPtr[i] = SCE_NULL;
+	_arena.Free();
+	_pyramid.Term();
+}
+
+SceInt32 LRFace::SetCameraResolution(SceInt32 resolution)
+{
+	// The tracking thread only holds camera frames while it owns _faceMtx, the detection thread while it owns _detectMtx
+	sceKernelLockLwMutex(&_faceMtx, 1, NULL);
+	sceKernelLockLwMutex(&_detectMtx, 1, NULL);
+
+	FlushDetection();
+	ResetTracks();
+
+	SceInt32 ret = LRCamera::GetInstance()->SetResolution(resolution);
+
+	FreeWorkMemory();
+	AllocWorkMemory();
+
+	// Stage times scale with the resolution
+	_governor.ResetLoad();
+
+	// Scores from the old resolution do not compare, keep the level found before
+	if (_exposureSearch.IsActive()) {
+		_exposureSearch.Abort();
+		_calibStats.active = SCE_FALSE;
+		LRCamera::GetInstance()->SetEv(_evLevel);
+	}
+
+	sceKernelUnlockLwMutex(&_detectMtx, 1);
+	sceKernelUnlockLwMutex(&_faceMtx, 1);
+
+	return ret;
+}
+
+SceVoid LRFace::SetRoiMode(SceBool enable)
+{
+	sceKernelLockLwMutex(&_faceMtx, 1, NULL);
+	sceKernelLockLwMutex(&_detectMtx, 1, NULL);
+
+	if (_roiMode != enable) {
+		_roiMode = enable;
+
+		// Candidates in flight were found with the old crop size
+		FlushDetection();
+
+		ResetTracks();
+
+		FreeWorkMemory();
+		AllocWorkMemory();
+
+		_governor.ResetLoad();
+	}
+
+	sceKernelUnlockLwMutex(&_detectMtx, 1);
+	sceKernelUnlockLwMutex(&_faceMtx, 1);
+}
+
+SceBool LRFace::GetRoiMode()
+{
+	return _roiMode;
+}
+
+const LRPyramidLevel *LRFace::GetPyramidLevel(const LRFrame *frame, SceInt32 level)
+{
+	// Built lazily so that frames which only run shape tracking never pay for it
+	_pyramid.Build(frame->data, frame->pitch, frame->seq);
+
+	return _pyramid.GetLevel(level);
+}
+
+SceVoid LRFace::GetRoiOrigin(SceFloat centerX, SceFloat centerY, SceInt32 *roiX, SceInt32 *roiY)
+{
+	SceInt32 x = (SceInt32)(centerX * _camWidth) - _trackWidth / 2;
+	SceInt32 y = (SceInt32)(centerY * _camHeight) - _trackHeight / 2;
+
+	if (x < 0)
+		x = 0;
+	else if (x > _camWidth - _trackWidth)
+		x = _camWidth - _trackWidth;
+
+	if (y < 0)
+		y = 0;
+	else if (y > _camHeight - _trackHeight)
+		y = _camHeight - _trackHeight;
+
+	*roiX = x;
+	*roiY = y;
+}
+
+SceVoid LRFace::FrameRectToRoi(SceInt32 roiX, SceInt32 roiY, SceFaceDetectionResult *face)
+{
+	// libface results are normalized to the image they were computed on
+	face->faceX = (face->faceX * _camWidth - roiX) / _trackWidth;
+	face->faceY = (face->faceY * _camHeight - roiY) / _trackHeight;
+	face->faceW = face->faceW * _camWidth / _trackWidth;
+	face->faceH = face->faceH * _camHeight / _trackHeight;
+}
+
+SceVoid LRFace::MoveRoi(LRFaceTrack *track, SceInt32 roiX, SceInt32 roiY)
+{
+	SceFaceShapeResult *shape = &track->shape;
+
+	SceFloat dx = (SceFloat)(track->roiX - roiX) / _trackWidth;
+	SceFloat dy = (SceFloat)(track->roiY - roiY) / _trackHeight;
+
+	shape->rectCenterX += dx;
+	shape->rectCenterY += dy;
+
+	for (int i = 0; i < shape->pointNum; i++) {
+		shape->pointX[i] += dx;
+		shape->pointY[i] += dy;
+	}
+
+	track->roiX = roiX;
+	track->roiY = roiY;
+}
+
+SceVoid LRFace::UpdateFrameRect(LRFaceTrack *track)
+{
+	SceFaceDetectionResult face;
+	ShapeToRect(&track->shape, &face);
+
+	track->rect = face;
+	track->rect.faceX = (face.faceX * _trackWidth + track->roiX) / _camWidth;
+	track->rect.faceY = (face.faceY * _trackHeight + track->roiY) / _camHeight;
+	track->rect.faceW = face.faceW * _trackWidth / _camWidth;
+	track->rect.faceH = face.faceH * _trackHeight / _camHeight;
+}
+
+SceVoid LRFace::RoiShapeToFrame(const LRFaceTrack *track, const SceFaceShapeResult *src, SceFaceShapeResult *dst)
+{
+	const SceFloat sx = (SceFloat)_trackWidth / _camWidth;
+	const SceFloat sy = (SceFloat)_trackHeight / _camHeight;
+	const SceFloat ox = (SceFloat)track->roiX / _camWidth;
+	const SceFloat oy = (SceFloat)track->roiY / _camHeight;
+
+	sceClibMemcpy(dst, src, sizeof(SceFaceShapeResult));
+
+	dst->rectCenterX = src->rectCenterX * sx + ox;
+	dst->rectCenterY = src->rectCenterY * sy + oy;
+	dst->rectWidth = src->rectWidth * sx;
+	dst->rectHeight = src->rectHeight * sy;
+
+	for (int i = 0; i < src->pointNum; i++) {
+		dst->pointX[i] = src->pointX[i] * sx + ox;
+		dst->pointY[i] = src->pointY[i] * sy + oy;
+	}
+}
+
+SceInt32 LRFace::TrackThreadStart(SceSize args, ScePVoid argp)
+{
+	s_instance->TrackThread();
+
+	return 0;
+}
+
+SceInt32 LRFace::DetectThreadStart(SceSize args, ScePVoid argp)
+{
+	s_instance->DetectThread();
+
+	return 0;
+}
+
+SceInt32 LRFace::ProfileThreadStart(SceSize args, ScePVoid argp)
+{
+	s_instance->ProfileThread();
+
+	return 0;
+}
+
+SceVoid LRFace::ProfileThread()
+{
+	// The snapshot is taken every _profileSnapshotInterval, looking more often finds nothing new
+	while (1) {
+		sceKernelDelayThread(_profileSnapshotInterval);
+		SaveProfile();
+	}
+}
+
+SceVoid LRFace::DetectThread()
+{
+	SceInt32 ret;
+	SceInt32 numFace;
+
+	// Coarse scan: next smaller pyramid level, bigger steps, only faces at least twice the minimum size.
+	// The candidate is refined with a local search on the tracking thread, so SCE_FACE_DETECT_RESULT_NORMAL is enough.
+	SceFaceDetectionParam coarseParam;
+	sceFaceDetectionGetDefaultParam(&coarseParam);
+	coarseParam.resultPrecision = SCE_FACE_DETECT_RESULT_NORMAL;
+	coarseParam.searchType = SCE_FACE_DETECT_SEARCH_FACE_NUM_LIMIT;
+	coarseParam.magBegin = _detectMagBegin;
+	coarseParam.magStep = 0.707f;
+	coarseParam.magEnd = 0.0f;
+	coarseParam.xScanStep = 2;
+	coarseParam.yScanStep = 2;
+	coarseParam.thresholdScore = 0.5f;
+
+	// With SCE_FACE_DETECT_RESULT_PRECISE the candidates are handed to sceFacePartsEx() directly
+	// without a local search in between. Precision and steps are replaced per request by the governor tier.
+	SceFaceDetectionParam detectParam;
+	sceFaceDetectionGetDefaultParam(&detectParam);
+	detectParam.resultPrecision = SCE_FACE_DETECT_RESULT_PRECISE;
+	detectParam.searchType = SCE_FACE_DETECT_SEARCH_FACE_NUM_LIMIT;
+	detectParam.magBegin = _detectMagBegin;
+	detectParam.magStep = 0.841f;
+	detectParam.magEnd = 0.0f;
+	detectParam.xScanStep = 2;
+	detectParam.yScanStep = 2;
+	detectParam.thresholdScore = 0.5f;
+
+	LRCamera *cam = LRCamera::GetInstance();
+
+	// Handed to the tracking thread with the next result, along with the time of results it never took
+	SceUInt32 lockWait = 0;
+	SceUInt32 displacedCount = 0;
+	SceUInt32 displacedTime = 0;
+
+	while (1) {
+
+		SceUInt32 timeout = _frameWaitTimeout;
+		SceUInt32 bits = 0;
+		sceKernelWaitEventFlag(_detectEvf,
+			LR_FACE_EVF_DETECT_REQUEST | LR_FACE_EVF_CALIBRATE_START | LR_FACE_EVF_CALIBRATE_FRAME,
+			SCE_KERNEL_EVF_WAITMODE_OR | SCE_KERNEL_EVF_WAITMODE_CLEAR_PAT, &bits, &timeout);
+
+		// Pyramid and detection working memory are reallocated on resolution switches
+		SceUInt64 lockBegin = sceKernelGetProcessTimeWide();
+		sceKernelLockLwMutex(&_detectMtx, 1, NULL);
+		lockWait += (SceUInt32)(sceKernelGetProcessTimeWide() - lockBegin);
+
+		// A new request restarts a running search from the level in use
+		if (bits & LR_FACE_EVF_CALIBRATE_START) {
+			SceInt32 start = 0;
+			for (int i = 0; i < _evLevelNum; i++) {
+				if (_evLevelTable[i] == _evLevel)
+					start = i;
+			}
+
+			_exposureSearch.Start(_evLevelNum, start);
+			_calibBegin = sceKernelGetProcessTimeWide();
+			_calibStats.progress = 0;
+			_calibStats.measureCount = 0;
+			_calibStats.active = SCE_TRUE;
+
+			cam->SetEv(_evLevelTable[_exposureSearch.GetLevel()]);
+		}
+
+		LRDetectRequest calib;
+		if (_calibRequest.Take(&calib)) {
+			if (cam->IsFrameValid(calib.frame) && calib.frame->width == _camWidth)
+				CalibrateStep(calib.frame);
+			cam->Release(calib.frame);
+		}
+
+		LRDetectRequest request;
+		if (!_detectRequest.Take(&request)) {
+			sceKernelUnlockLwMutex(&_detectMtx, 1);
+			continue;
+		}
+
+		if (!cam->IsFrameValid(request.frame) || request.frame->width != _camWidth) {
+			cam->Release(request.frame);
+			sceKernelUnlockLwMutex(&_detectMtx, 1);
+			continue;
+		}
+
+		const LRGovernorTier *quality = LRGovernor::GetTierParam(request.quality);
+		detectParam.resultPrecision = quality->detectPrecise ? SCE_FACE_DETECT_RESULT_PRECISE : SCE_FACE_DETECT_RESULT_NORMAL;
+		detectParam.magStep = quality->detectMagStep;
+		detectParam.xScanStep = quality->detectScanStep;
+		detectParam.yScanStep = quality->detectScanStep;
+
+		LRDetectResult result;
+		sceClibMemset(&result, 0, sizeof(LRDetectResult));
+
+		// Escalate from the coarse to the precise scan on the same frame
+		for (SceInt32 tier = LR_FACE_TIER_COARSE; tier <= LR_FACE_TIER_PRECISE; tier++) {
+			SceInt32 level = _detectLevel;
+			SceFaceDetectionParam *param = &detectParam;
+
+			if (tier == LR_FACE_TIER_COARSE) {
+				if (_detectLevel + 1 >= _pyramid.GetLevelNum())
+					continue;
+				level = _detectLevel + 1;
+				param = &coarseParam;
+			}
+
+			SceUInt64 begin = sceKernelGetProcessTimeWide();
+
+			const LRPyramidLevel *detectImage = GetPyramidLevel(request.frame, level);
+
+			param->magBegin = _detectMag;
+
+			ret = sceFaceDetectionEx(
+				detectImage->data, detectImage->width, detectImage->height, detectImage->pitch,
+				_detectDictPtr,
+				param,
+				result.face, LR_FACE_DETECT_CANDIDATE_MAX,
+				&numFace,
+				_workPtr[LR_FACE_STAGE_DETECT], _workSize[LR_FACE_STAGE_DETECT]
+			);
+
+			if (ret != SCE_OK)
+				numFace = 0;
+
+			SceUInt32 time = (SceUInt32)(sceKernelGetProcessTimeWide() - begin);
+			AddReacquireAttempt(tier, numFace > 0, time);
+			result.time += time;
+
+			if (numFace > 0) {
+				result.numFace = numFace;
+				result.tier = tier;
+				result.precise = (tier == LR_FACE_TIER_PRECISE && quality->detectPrecise);
+				break;
+			}
+		}
+
+		// The tiers scan with other parameters and levels than the EV search, their scores
+		// do not compare with the calibrated one
+		result.evScore = -1.0f;
+		if (request.measureEv && result.numFace > 0)
+			result.evScore = MeasureEvScore(request.frame);
+
+		// Failed searches are reported as well, the tracker asks again with a newer frame
+		result.frame = request.frame;
+		result.lockWait = lockWait;
+		result.displacedCount = displacedCount;
+		result.displacedTime = displacedTime;
+		lockWait = 0;
+		displacedCount = 0;
+		displacedTime = 0;
+
+		LRDetectResult displaced;
+		if (_detectResult.Post(result, &displaced)) {
+			cam->Release(displaced.frame);
+
+			lockWait += displaced.lockWait;
+			displacedCount += displaced.displacedCount + 1;
+			displacedTime += displaced.displacedTime + displaced.time;
+		}
+
+		sceKernelUnlockLwMutex(&_detectMtx, 1);
+	}
+}
+
+SceVoid LRFace::AddReacquireAttempt(SceInt32 tier, SceBool hit, SceUInt32 time)
+{
+	_reacquireStats.attemptCount[tier]++;
+	if (hit)
+		_reacquireStats.hitCount[tier]++;
+	_reacquireStats.timeLast[tier] = time;
+	_reacquireStats.timeSum[tier] += time;
+}
+
+SceVoid LRFace::GetReacquireStats(LRReacquireStats *stats)
+{
+	sceClibMemcpy(stats, &_reacquireStats, sizeof(LRReacquireStats));
+}
+
+SceVoid LRFace::RequestDetection(const LRFrame *frame)
+{
+	LRCamera *cam = LRCamera::GetInstance();
+
+	// The detection thread always works on the newest frame, unread older requests are dropped
+	LRDetectRequest request;
+	request.frame = frame;
+	request.quality = _governor.GetTier();
+	request.measureEv = _profileCheck;
+	cam->Retain(frame);
+
+	LRDetectRequest displaced;
+	if (_detectRequest.Post(request, &displaced))
+		cam->Release(displaced.frame);
+
+	sceKernelSetEventFlag(_detectEvf, LR_FACE_EVF_DETECT_REQUEST);
+}
+
+SceVoid LRFace::GetStartupStats(LRStartupStats *stats)
+{
+	sceClibMemcpy(stats, &_startupStats, sizeof(LRStartupStats));
+	_dictLoader.GetStats(&stats->dict);
+}
+
+SceVoid LRFace::GetGovernorStats(LRGovernorStats *stats)
+{
+	_governor.GetStats(stats);
+}
+
+SceVoid LRFace::GetStats(LRTelemetryStats *stats)
+{
+	_telemetrySnapshot.Read(stats);
+}
+
+SceVoid LRFace::FlushDetection()
+{
+	LRCamera *cam = LRCamera::GetInstance();
+
+	// Caller owns _faceMtx and _detectMtx, so both mailbox ends are quiet
+	LRDetectRequest request;
+	while (_detectRequest.Take(&request))
+		cam->Release(request.frame);
+
+	LRDetectResult result;
+	while (_detectResult.Take(&result))
+		cam->Release(result.frame);
+
+	while (_calibRequest.Take(&request))
+		cam->Release(request.frame);
+}
+
+SceVoid LRFace::StartCalibration()
+{
+	sceKernelSetEventFlag(_detectEvf, LR_FACE_EVF_CALIBRATE_START);
+}
+
+SceVoid LRFace::GetCalibrationStats(LRCalibrationStats *stats)
+{
+	sceClibMemcpy(stats, &_calibStats, sizeof(LRCalibrationStats));
+	stats->evLevel = _evLevel;
+}
+
+SceVoid LRFace::LoadProfile()
+{
+	LRProfileFile::GetDefault(&_profile);
+
+	LRProfile profile;
+	SceInt32 ret = LRProfileFile::Load(s_profilePath, &profile);
+	if (ret != SCE_OK) {
+		// No profile yet is the normal first start
+		if (ret != LR_PROFILE_ERROR_IO)
+			SCE_DBG_LOG_ERROR("[LRFace] LRProfileFile::Load() %d, starting from defaults\n", ret);
+		return;
+	}
+
+	_profile = profile;
+
+	// The level goes straight to sceCameraSetEV(). A level not in the table or a score that is
+	// not a positive number, NaN fails the comparison, drops the EV and leaves it to a calibration.
+	if (profile.flags & LR_PROFILE_HAS_EV) {
+		SceBool evValid = SCE_FALSE;
+		for (int i = 0; i < _evLevelNum; i++) {
+			if (_evLevelTable[i] == profile.evLevel)
+				evValid = SCE_TRUE;
+		}
+
+		if (evValid && profile.evScore > 0.0f && !isinf(profile.evScore)) {
+			_evLevel = profile.evLevel;
+			_evScore = profile.evScore;
+			_profileCheck = SCE_TRUE;
+		}
+		else {
+			SCE_DBG_LOG_ERROR("[LRFace] profile EV %d with score %f rejected\n", profile.evLevel, profile.evScore);
+			_profile.flags &= ~LR_PROFILE_HAS_EV;
+		}
+	}
+
+	if (profile.flags & LR_PROFILE_HAS_FILTER) {
+		for (int t = 0; t < LR_FACE_TRACK_MAX; t++) {
+			for (int i = 0; i < LR_FACE_CHANNEL_NUM; i++)
+				_track[t].filter.SetParam(i, &profile.filter[i]);
+		}
+	}
+
+	// The profile is the user of slot 0, other slots learn from scratch
+	if (profile.flags & LR_PROFILE_HAS_NEUTRAL) {
+		LRFaceTrack *track = &_track[0];
+
+		sceClibMemcpy(track->neutral, profile.neutral, sizeof(track->neutral));
+		track->neutralCount = profile.neutralCount;
+		track->eyeOpenRef[0] = profile.eyeOpenRef[0];
+		track->eyeOpenRef[1] = profile.eyeOpenRef[1];
+	}
+
+	PublishEvSetting();
+
+	_profileSavedEv = _evLevel;
+	_profileSavedScore = _evScore;
+}
+
+SceVoid LRFace::UpdateProfile()
+{
+	const LRFaceTrack *track = &_track[0];
+
+	if (track->isTracking) {
+		_profile.faceX = track->rect.faceX;
+		_profile.faceY = track->rect.faceY;
+		_profile.faceW = track->rect.faceW;
+		_profile.faceH = track->rect.faceH;
+		_profile.flags |= LR_PROFILE_HAS_FACE;
+	}
+
+	if (track->neutralCount > 0) {
+		sceClibMemcpy(_profile.neutral, track->neutral, sizeof(_profile.neutral));
+		_profile.neutralCount = track->neutralCount;
+		_profile.flags |= LR_PROFILE_HAS_NEUTRAL;
+	}
+
+	_profile.eyeOpenRef[0] = track->eyeOpenRef[0];
+	_profile.eyeOpenRef[1] = track->eyeOpenRef[1];
+
+	for (int i = 0; i < LR_FILTER_CHANNEL_MAX; i++)
+		track->filter.GetParam(i, &_profile.filter[i]);
+	_profile.flags |= LR_PROFILE_HAS_FILTER;
+
+	_profileSnapshot.Write(_profile);
+}
+
+SceVoid LRFace::SaveProfile()
+{
+	LRProfile profile;
+	SceUInt32 version = _profileSnapshot.Read(&profile);
+	if (version == 0)
+		return;
+
+	// The EV is owned by the detection thread and saved as soon as it changed
+	LREvSetting ev;
+	_evSetting.Read(&ev);
+	const SceInt32 evLevel = ev.level;
+	const SceFloat evScore = ev.score;
+	const SceBool evChanged = (evLevel != _profileSavedEv || evScore != _profileSavedScore);
+
+	SceUInt64 now = sceKernelGetProcessTimeWide();
+	if (!evChanged && (version == _profileSavedVersion || now - _profileSaveTime < _profileSaveInterval))
+		return;
+
+	profile.evLevel = evLevel;
+	profile.evScore = evScore;
+	if (evScore > 0.0f)
+		profile.flags |= LR_PROFILE_HAS_EV;
+
+	SceInt32 ret = LRProfileFile::Save(s_profilePath, &profile);
+	if (ret != SCE_OK)
+		SCE_DBG_LOG_ERROR("[LRFace] LRProfileFile::Save() %d\n", ret);
+
+	_profileSavedVersion = version;
+	_profileSaveTime = now;
+	_profileSavedEv = evLevel;
+	_profileSavedScore = evScore;
+}
+
+SceVoid LRFace::PublishEvSetting()
+{
+	LREvSetting ev;
+	ev.level = _evLevel;
+	ev.score = _evScore;
+	_evSetting.Write(ev);
+}
+
+SceFloat LRFace::GetMeanLuma(const LRFrame *frame)
+{
+	// Every 4th pixel of every 4th row is plenty to see the exposure change
+	SceUInt32 sum = 0;
+	SceUInt32 count = 0;
+
+	for (SceInt32 y = 0; y < frame->height; y += 4) {
+		const unsigned char *row = frame->data + y * frame->pitch;
+		for (SceInt32 x = 0; x < frame->width; x += 4) {
+			sum += row[x];
+			count++;
+		}
+	}
+
+	return count > 0 ? (SceFloat)sum / count : 0.0f;
+}
+
+SceVoid LRFace::CalibrateStep(const LRFrame *frame)
+{
+	if (!_exposureSearch.IsActive())
+		return;
+
+	// Nothing to measure until the image stopped changing after the last SetEv()
+	if (!_exposureSearch.AddLuma(GetMeanLuma(frame)))
+		return;
+
+	SceFloat score = MeasureEvScore(frame);
+	SceInt32 level = _exposureSearch.GetLevel();
+
+	if (_exposureSearch.AddScore(score)) {
+		sceClibPrintf("EV_Level:Score = %d:%f\n", _evLevelTable[level], score);
+
+		if (_exposureSearch.IsActive())
+			LRCamera::GetInstance()->SetEv(_evLevelTable[_exposureSearch.GetLevel()]);
+		else
+			FinishCalibration();
+	}
+
+	_calibStats.measureCount = _exposureSearch.GetMeasureCount();
+	_calibStats.progress = _exposureSearch.GetProgress();
+}
+
+SceFloat LRFace::MeasureEvScore(const LRFrame *frame)
+{
+	SceFaceDetectionResult face;
+	SceInt32 numFace = 0;
+	const LRPyramidLevel *detectImage = GetPyramidLevel(frame, _detectLevel);
+
+	SceInt32 ret = sceFaceDetection(
+		detectImage->data, detectImage->width, detectImage->height, detectImage->pitch,
+		_detectDictPtr,
+		_detectMag, 0.841f, 0.0f, 2, 2, 0.80f, SCE_FACE_DETECT_RESULT_NORMAL,
+		&face, 1,
+		&numFace,
+		_workPtr[LR_FACE_STAGE_DETECT], _workSize[LR_FACE_STAGE_DETECT]
+	);
+
+	return (ret == SCE_OK && numFace > 0) ? face.score : 0.0f;
+}
+
+SceVoid LRFace::FinishCalibration()
+{
+	SceFloat maxScore;
+	SceInt32 maxLevelNum = _exposureSearch.GetBest(&maxScore);
+
+	if (maxLevelNum == -1) {
+		sceClibPrintf("Calibration Error\n");
+	}
+	else {
+		sceClibPrintf("max_level:max_score = %d:%f\n", _evLevelTable[maxLevelNum], maxScore);
+		_evLevel = _evLevelTable[maxLevelNum];
+		_evScore = maxScore;
+		PublishEvSetting();
+	}
+
+	LRCamera::GetInstance()->SetEv(_evLevel);
+
+	_calibStats.score = maxScore;
+	_calibStats.time = (SceUInt32)(sceKernelGetProcessTimeWide() - _calibBegin);
+	_calibStats.active = SCE_FALSE;
+}
+
+SceBool LRFace::DetectLocal(const unsigned char *trackBuffer, const SceFaceDetectionResult *reference, SceFaceDetectionResult *face)
+{
+	// Left out of the pipeline, detection and re-detection do without refinement
+	if (_workPtr[LR_FACE_STAGE_LOCAL] == SCE_NULL)
+		return SCE_FALSE;
+
+	SceInt32 numFace = 0;
+	const SceInt32 scanStep = LRGovernor::GetTierParam(_governor.GetTier())->localScanStep;
+
+	SceUInt64 begin = sceKernelGetProcessTimeWide();
+
+	SceInt32 ret = sceFaceDetectionLocal(
+		trackBuffer, _trackWidth, _trackHeight, _camWidth,
+		_detectLocalDictPtr,
+		0.841f, _localExpand, _localExpand, scanStep, scanStep, 0.50f,
+		face, 1, reference, 1,
+		&numFace,
+		_workPtr[LR_FACE_STAGE_LOCAL], _workSize[LR_FACE_STAGE_LOCAL]
+	);
+
+	_telemetry.AddStage(LR_TELEMETRY_STAGE_LOCAL, (SceUInt32)(sceKernelGetProcessTimeWide() - begin));
+
+	return ret == SCE_OK && numFace > 0;
+}
+
+SceBool LRFace::FitShape(LRFaceTrack *track, const unsigned char *trackBuffer, SceFaceDetectionResult *face)
+{
+	const SceInt32 scanStep = LRGovernor::GetTierParam(_governor.GetTier())->partsScanStep;
+
+	SceUInt64 begin = sceKernelGetProcessTimeWide();
+
+	SceInt32 ret = sceFacePartsEx(
+		trackBuffer, _trackWidth, _trackHeight, _camWidth,
+		_partsDictPtr,
+		_partsCheckDictPtr,
+		scanStep, scanStep,
+		face,
+		_parts, SCE_FACE_PARTS_NUM_MAX,
+		&_numParts,
+		_workPtr[LR_FACE_STAGE_PARTS], _workSize[LR_FACE_STAGE_PARTS]
+	);
+
+	SceUInt64 end = sceKernelGetProcessTimeWide();
+	_telemetry.AddStage(LR_TELEMETRY_STAGE_PARTS, (SceUInt32)(end - begin));
+
+	if (!_isShapeTrack || ret != SCE_OK)
+		return SCE_FALSE;
+
+	begin = end;
+
+	ret = sceFaceShapeFit(
+		trackBuffer, _trackWidth, _trackHeight, _camWidth,
+		_shapeDictPtr,
+		&track->shape, SCE_FACE_SHAPE_SCORE_LOST_THRES_MIN,
+		face, _parts, _numParts,
+		_workPtr[LR_FACE_STAGE_SHAPE], _workSize[LR_FACE_STAGE_SHAPE]
+	);
+
+	_telemetry.AddStage(LR_TELEMETRY_STAGE_FIT, (SceUInt32)(sceKernelGetProcessTimeWide() - begin));
+
+	return ret == SCE_OK;
+}
+
+SceBool LRFace::TrackShape(LRFaceTrack *track, const LRFrame *frame)
+{
+	// Keep the crop centered on the face. Previous and current frame are cropped identically.
+	if (_trackWidth != _camWidth || _trackHeight != _camHeight) {
+		SceInt32 roiX, roiY;
+		GetRoiOrigin(
+			(track->shape.rectCenterX * _trackWidth + track->roiX) / _camWidth,
+			(track->shape.rectCenterY * _trackHeight + track->roiY) / _camHeight,
+			&roiX, &roiY
+		);
+		MoveRoi(track, roiX, roiY);
+	}
+
+	// Where the local search starts if this frame loses the face
+	ShapeToRect(&track->shape, &track->lostFace);
+
+	const unsigned char *trackBuffer = frame->data + track->roiY * _camWidth + track->roiX;
+	const unsigned char *trackBufferPrevious = track->prevFrame->data + track->roiY * _camWidth + track->roiX;
+
+	SceUInt64 begin = sceKernelGetProcessTimeWide();
+
+	SceInt32 ret = sceFaceShapeTrack(
+		trackBuffer, trackBufferPrevious, _trackWidth, _trackHeight, _camWidth,
+		_shapeDictPtr,
+		&track->shape, _lostThres,
+		_workPtr[LR_FACE_STAGE_SHAPE], _workSize[LR_FACE_STAGE_SHAPE]
+	);
+
+	_telemetry.AddStage(LR_TELEMETRY_STAGE_TRACK, (SceUInt32)(sceKernelGetProcessTimeWide() - begin));
+
+	//s_score = s_shapeData.score;
+
+	if (ret != SCE_OK) {
+		// Start the recovery ladder with local searches around the last rect
+		track->localRetryCount = 0;
+		_telemetry.AddEvent(LR_TELEMETRY_EVENT_LOST);
+		return SCE_FALSE;
+	}
+
+	UpdateFrameRect(track);
+
+	return SCE_TRUE;
+}
+
+SceFloat LRFace::GetOverlap(const SceFaceDetectionResult *a, const SceFaceDetectionResult *b)
+{
+	const SceFloat x0 = a->faceX > b->faceX ? a->faceX : b->faceX;
+	const SceFloat y0 = a->faceY > b->faceY ? a->faceY : b->faceY;
+	const SceFloat x1 = (a->faceX + a->faceW) < (b->faceX + b->faceW) ? (a->faceX + a->faceW) : (b->faceX + b->faceW);
+	const SceFloat y1 = (a->faceY + a->faceH) < (b->faceY + b->faceH) ? (a->faceY + a->faceH) : (b->faceY + b->faceH);
+
+	if (x1 <= x0 || y1 <= y0)
+		return 0.0f;
+
+	const SceFloat inter = (x1 - x0) * (y1 - y0);
+	const SceFloat total = a->faceW * a->faceH + b->faceW * b->faceH - inter;
+
+	return total > 0.0f ? inter / total : 0.0f;
+}
+
+SceBool LRFace::AcquireFace(LRFaceTrack *track, const LRDetectResult *detect, SceFaceDetectionResult face, const LRFrame *frame)
+{
+	LRCamera *cam = LRCamera::GetInstance();
+
+	SceUInt64 begin = sceKernelGetProcessTimeWide();
+
+	// The slot keeps its ROI until the fit succeeded, its lost rect is relative to it
+	SceInt32 roiX, roiY;
+	GetRoiOrigin(face.faceX + face.faceW * 0.5f, face.faceY + face.faceH * 0.5f, &roiX, &roiY);
+	FrameRectToRoi(roiX, roiY, &face);
+	const unsigned char *trackBuffer = detect->frame->data + roiY * _camWidth + roiX;
+
+	// Coarse and normal precision rects are only roughly placed, refine them at full resolution
+	SceFaceDetectionResult *rect = &face;
+	SceFaceDetectionResult refined;
+	if (!detect->precise && DetectLocal(trackBuffer, rect, &refined))
+		rect = &refined;
+
+	SceBool fitted = FitShape(track, trackBuffer, rect);
+	if (fitted) {
+		track->roiX = roiX;
+		track->roiY = roiY;
+		track->isTracking = SCE_TRUE;
+		UpdateFrameRect(track);
+
+		cam->Retain(detect->frame);
+		cam->Release(track->prevFrame);
+		track->prevFrame = detect->frame;
+
+		// Catch up from the detected frame to the current one
+		if (track->prevFrame != frame)
+			track->isTracking = TrackShape(track, frame);
+
+		track->updated = track->isTracking;
+	}
+
+	_governor.AddStageTime(LR_GOVERNOR_STAGE_FIT, (SceUInt32)(sceKernelGetProcessTimeWide() - begin));
+
+	return fitted;
+}
+
+SceVoid LRFace::AssignCandidates(const LRDetectResult *detect, const LRFrame *frame)
+{
+	// Slot per candidate, -1 while unassigned and -2 for faces tracked already
+	SceInt32 slot[LR_FACE_DETECT_CANDIDATE_MAX];
+	SceBool claimed[LR_FACE_TRACK_MAX];
+	SceBool tracking = SCE_FALSE;
+
+	for (int t = 0; t < LR_FACE_TRACK_MAX; t++) {
+		claimed[t] = SCE_FALSE;
+		if (_track[t].isTracking)
+			tracking = SCE_TRUE;
+	}
+
+	for (int c = 0; c < detect->numFace; c++) {
+		slot[c] = -1;
+
+		for (int t = 0; t < LR_FACE_TRACK_MAX; t++) {
+			if (_track[t].isTracking && GetOverlap(&detect->face[c], &_track[t].rect) > _trackOverlapMax)
+				slot[c] = -2;
+		}
+	}
+
+	// Lost faces take back the candidate overlapping their last rect the most
+	for (int t = 0; t < LR_FACE_TRACK_MAX; t++) {
+		if (_track[t].id < 0 || _track[t].isTracking)
+			continue;
+
+		SceInt32 best = -1;
+		SceFloat bestOverlap = _identityOverlapMin;
+		for (int c = 0; c < detect->numFace; c++) {
+			if (slot[c] != -1)
+				continue;
+
+			SceFloat overlap = GetOverlap(&detect->face[c], &_track[t].rect);
+			if (overlap >= bestOverlap) {
+				best = c;
+				bestOverlap = overlap;
+			}
+		}
+
+		if (best >= 0) {
+			slot[best] = t;
+			claimed[t] = SCE_TRUE;
+		}
+	}
+
+	// The rest start new faces in free slots. With no face tracked at all, a candidate is most
+	// likely a lost face that moved too far to overlap, so it takes the nearest lost slot first.
+	for (int c = 0; c < detect->numFace; c++) {
+		if (slot[c] != -1)
+			continue;
+
+		const SceFaceDetectionResult *face = &detect->face[c];
+
+		if (!tracking) {
+			SceFloat bestDist = 0.0f;
+			for (int t = 0; t < LR_FACE_TRACK_MAX; t++) {
+				const SceFaceDetectionResult *rect = &_track[t].rect;
+				if (_track[t].id < 0 || claimed[t])
+					continue;
+
+				SceFloat dx = (face->faceX + face->faceW * 0.5f) - (rect->faceX + rect->faceW * 0.5f);
+				SceFloat dy = (face->faceY + face->faceH * 0.5f) - (rect->faceY + rect->faceH * 0.5f);
+				SceFloat dist = dx * dx + dy * dy;
+				if (slot[c] < 0 || dist < bestDist) {
+					slot[c] = t;
+					bestDist = dist;
+				}
+			}
+		}
+
+		for (int t = 0; t < LR_FACE_TRACK_MAX && slot[c] < 0; t++) {
+			if (_track[t].id < 0 && !claimed[t])
+				slot[c] = t;
+		}
+
+		if (slot[c] >= 0)
+			claimed[slot[c]] = SCE_TRUE;
+	}
+
+	// The first fit always runs, the others only while the frame budget has room. Candidates
+	// left over come back with a later detection.
+	SceInt32 fitNum = 0;
+	for (int c = 0; c < detect->numFace; c++) {
+		if (slot[c] < 0)
+			continue;
+
+		if (fitNum > 0 && !_governor.FitsFrame(LR_GOVERNOR_STAGE_FIT))
+			break;
+		fitNum++;
+
+		LRFaceTrack *track = &_track[slot[c]];
+		if (!AcquireFace(track, detect, detect->face[c], frame))
+			continue;
+
+		if (track->id < 0) {
+			// A new face, its filters start over from the first measurement
+			track->id = _nextTrackId++;
+			track->filterTime = 0;
+			_telemetry.AddEvent(LR_TELEMETRY_EVENT_NEW_FACE);
+		}
+		else {
+			track->stats.matchCount++;
+			_telemetry.AddEvent(LR_TELEMETRY_EVENT_REACQUIRE_DETECT);
+		}
+		track->lostFrames = 0;
+	}
+}
+
+SceVoid LRFace::DropDuplicates()
+{
+	for (int a = 0; a < LR_FACE_TRACK_MAX; a++) {
+		for (int b = a + 1; b < LR_FACE_TRACK_MAX; b++) {
+			LRFaceTrack *ta = &_track[a];
+			LRFaceTrack *tb = &_track[b];
+
+			if (!ta->isTracking || !tb->isTracking || GetOverlap(&ta->rect, &tb->rect) <= _trackOverlapMax)
+				continue;
+
+			ReleaseTrack(ta->id > tb->id ? ta : tb);
+		}
+	}
+}
+
+SceVoid LRFace::ReleaseTrack(LRFaceTrack *track)
+{
+	_telemetry.AddEvent(LR_TELEMETRY_EVENT_RELEASE);
+
+	LRCamera::GetInstance()->Release(track->prevFrame);
+	track->prevFrame = SCE_NULL;
+
+	track->id = -1;
+	track->isTracking = SCE_FALSE;
+	track->updated = SCE_FALSE;
+	track->localRetryCount = _localRetryNum;
+	track->lostFrames = 0;
+}
+
+SceVoid LRFace::ResetTracks()
+{
+	for (int t = 0; t < LR_FACE_TRACK_MAX; t++) {
+		LRFaceTrack *track = &_track[t];
+
+		LRCamera::GetInstance()->Release(track->prevFrame);
+		track->prevFrame = SCE_NULL;
+
+		track->isTracking = SCE_FALSE;
+		track->updated = SCE_FALSE;
+		track->localRetryCount = _localRetryNum;
+	}
+}
+
+SceVoid LRFace::TrackThread()
+{
+	SceInt32 camWidth;
+
+	LRCamera *cam = LRCamera::GetInstance();
+
+	while (1) {
+
+		// Woken by the camera capture thread as soon as a new frame is published
+		const LRFrame *camFrame = cam->WaitForFrame(_frameWaitTimeout);
+		if (camFrame == SCE_NULL)
+			continue;
+
+		SceUInt64 lockBegin = sceKernelGetProcessTimeWide();
+		sceKernelLockLwMutex(&_faceMtx, 1, NULL);
+		_telemetry.AddLockWait(LR_TELEMETRY_LOCK_FACE, (SceUInt32)(sceKernelGetProcessTimeWide() - lockBegin));
+
+		// Frames published while the last one was worked on were never seen
+		SceUInt32 skipped = (_lastFrameSeq != 0 && (SceInt32)(camFrame->seq - _lastFrameSeq) > 1) ? camFrame->seq - _lastFrameSeq - 1 : 0;
+		_lastFrameSeq = camFrame->seq;
+
+		// The resolution may have been switched while we were waiting for the lock
+		if (!cam->IsFrameValid(camFrame)) {
+			_telemetry.AddDrop();
+			cam->Release(camFrame);
+			sceKernelUnlockLwMutex(&_faceMtx, 1);
+			continue;
+		}
+
+		camWidth = camFrame->width;
+
+		// Stages come up as the loader delivers their dictionaries, frames are dropped until tracking can start
+		if (_dictPending)
+			AllocStageMemory();
+
+		// Frames from WaitForFrame() are always new, no need to compare frame numbers
+		if (camWidth == _camWidth && _trackStagesReady) {
+
+			_governor.BeginFrame(camFrame->captureTime);
+			_telemetry.AddFrame(camFrame->captureTime, skipped);
+
+			// TODO: Render camera image here
+
+			// Parts and shape work on the ROI crop of each face, addressed in place with the full frame pitch.
+			// Tracked faces take turns: the first one always runs, the others only while their usual time
+			// still fits the frame budget. A face that has to wait tracks on from its older frame and goes
+			// first on the next frame.
+			SceInt32 trackedNum = 0;
+			SceInt32 deferred = -1;
+
+			for (int n = 0; n < LR_FACE_TRACK_MAX; n++) {
+				const SceInt32 index = (_trackNext + n) % LR_FACE_TRACK_MAX;
+				LRFaceTrack *track = &_track[index];
+
+				track->updated = SCE_FALSE;
+
+				if (!track->isTracking || track->prevFrame == SCE_NULL) {
+					track->isTracking = SCE_FALSE;
+					continue;
+				}
+
+				if (trackedNum > 0 && !_governor.FitsFrame(LR_GOVERNOR_STAGE_TRACK)) {
+					track->stats.deferCount++;
+					if (deferred < 0)
+						deferred = index;
+					continue;
+				}
+				trackedNum++;
+
+				SceUInt64 begin = sceKernelGetProcessTimeWide();
+
+				track->isTracking = TrackShape(track, camFrame);
+				track->updated = track->isTracking;
+
+				SceUInt32 time = (SceUInt32)(sceKernelGetProcessTimeWide() - begin);
+				_governor.AddStageTime(LR_GOVERNOR_STAGE_TRACK, time);
+
+				track->stats.trackCount++;
+				track->stats.trackTime = time;
+				if (!track->isTracking)
+					track->stats.lostCount++;
+			}
+
+			_trackNext = deferred >= 0 ? deferred : (_trackNext + 1) % LR_FACE_TRACK_MAX;
+
+			// Tier 1: local search around the last known rect on this frame. Blinks and hands
+			// passing in front of the face usually recover here without missing a frame.
+			for (int t = 0; t < LR_FACE_TRACK_MAX; t++) {
+				LRFaceTrack *track = &_track[t];
+
+				if (track->id < 0 || track->isTracking || track->localRetryCount >= _localRetryNum)
+					continue;
+
+				track->localRetryCount++;
+
+				SceUInt64 begin = sceKernelGetProcessTimeWide();
+
+				SceFaceDetectionResult face;
+				const unsigned char *trackBuffer = camFrame->data + track->roiY * camWidth + track->roiX;
+				SceBool hit = DetectLocal(trackBuffer, &track->lostFace, &face);
+				if (hit)
+					track->isTracking = FitShape(track, trackBuffer, &face);
+
+				SceUInt32 time = (SceUInt32)(sceKernelGetProcessTimeWide() - begin);
+				AddReacquireAttempt(LR_FACE_TIER_LOCAL, track->isTracking, time);
+				_governor.AddStageTime(LR_GOVERNOR_STAGE_LOCAL, time);
+
+				if (track->isTracking) {
+					// Found again with the loaded EV, nothing to recalibrate
+					_profileCheck = SCE_FALSE;
+					_telemetry.AddEvent(LR_TELEMETRY_EVENT_REACQUIRE_LOCAL);
+
+					UpdateFrameRect(track);
+					track->updated = SCE_TRUE;
+				}
+			}
+
+			// Tier 2 and 3: candidates from the detection thread, found in an earlier frame.
+			// They go to lost faces by overlap and to free slots, faces tracked already are skipped.
+			LRDetectResult detect;
+			if (_detectResult.Take(&detect)) {
+				_governor.AddStageTime(LR_GOVERNOR_STAGE_DETECT, detect.time);
+				_telemetry.AddStage(LR_TELEMETRY_STAGE_DETECT, detect.time);
+				_telemetry.AddStageRuns(LR_TELEMETRY_STAGE_DETECT, detect.displacedCount, detect.displacedTime);
+				_telemetry.AddLockWait(LR_TELEMETRY_LOCK_DETECT, detect.lockWait);
+
+				// A loaded EV stands until live detection scores say otherwise, the first face is
+				// scored again the way the calibration measured _evScore
+				if (_profileCheck) {
+					if (detect.numFace > 0) {
+						if (detect.evScore < _evScore * _profileScoreRatio)
+							StartCalibration();
+						_profileCheck = SCE_FALSE;
+					}
+					else if (++_profileMissCount >= _profileMissNum) {
+						StartCalibration();
+						_profileCheck = SCE_FALSE;
+					}
+				}
+
+				if (detect.numFace > 0 && cam->IsFrameValid(detect.frame) && detect.frame->width == _camWidth)
+					AssignCandidates(&detect, camFrame);
+
+				cam->Release(detect.frame);
+			}
+
+			DropDuplicates();
+
+			// Faces gone for long free their slot, the others keep their identity for a match
+			SceBool anyTracking = SCE_FALSE;
+			SceBool anyLost = SCE_FALSE;
+			SceBool freeSlot = SCE_FALSE;
+
+			for (int t = 0; t < LR_FACE_TRACK_MAX; t++) {
+				LRFaceTrack *track = &_track[t];
+
+				if (track->isTracking)
+					track->lostFrames = 0;
+				else if (track->id >= 0 && ++track->lostFrames >= _trackReleaseFrames)
+					ReleaseTrack(track);
+
+				if (track->isTracking)
+					anyTracking = SCE_TRUE;
+				else if (track->id >= 0)
+					anyLost = SCE_TRUE;
+				else
+					freeSlot = SCE_TRUE;
+			}
+
+			const SceBool searching = anyLost || !anyTracking;
+
+			// Never wait for detection, the last fitted shapes stay in place meanwhile.
+			// With every bound face tracked, free slots only look for newcomers now and then.
+			if (searching) {
+				RequestDetection(camFrame);
+			}
+			else if (freeSlot && ++_newFaceCount >= _newFaceInterval) {
+				_newFaceCount = 0;
+				RequestDetection(camFrame);
+			}
+
+			// Keep this frame for the next sceFaceShapeTrack() of every face whose shape is on it,
+			// instead of copying it. A face that waited for its turn keeps its older frame.
+			for (int t = 0; t < LR_FACE_TRACK_MAX; t++) {
+				LRFaceTrack *track = &_track[t];
+
+				if (track->updated) {
+					cam->Retain(camFrame);
+					cam->Release(track->prevFrame);
+					track->prevFrame = camFrame;
+				}
+				else if (!track->isTracking) {
+					cam->Release(track->prevFrame);
+					track->prevFrame = SCE_NULL;
+				}
+			}
+
+			// TODO: End camera rendering here
+
+			for (int t = 0; t < LR_FACE_TRACK_MAX; t++) {
+				LRFaceTrack *track = &_track[t];
+				LRTrackingFrame *trackingFrame = &track->frame;
+
+				track->stats.id = track->id;
+				track->stats.isTracking = track->isTracking;
+
+				if (track->updated) { // Full tracking
+
+					RoiShapeToFrame(track, &track->shape, &trackingFrame->shape);
+
+					trackingFrame->score = track->shape.score;
+					trackingFrame->stamps.frame = camFrame->frame;
+					trackingFrame->stamps.sensor = cam->SensorToProcessTime(camFrame->timestamp);
+					trackingFrame->stamps.capture = camFrame->captureTime;
+					trackingFrame->stamps.track = sceKernelGetProcessTimeWide();
+
+					FilterChannels(track);
+
+					track->stats.score = track->shape.score;
+					_telemetry.AddScore(track->shape.score);
+
+					/*sceClibPrintf("face pitch: %f\n", track->shape.facePitch);
+					sceClibPrintf("face roll: %f\n", track->shape.faceRoll);
+					sceClibPrintf("face yaw: %f\n", track->shape.faceYaw);
+
+					sceClibPrintf("\nface rect widht: %f\n", track->shape.rectWidth);
+					sceClibPrintf("face rect height: %f\n", track->shape.rectHeight);
+
+					sceClibPrintf("\nface rect centerx: %f\n", track->shape.rectCenterX);
+					sceClibPrintf("face rect centery: %f\n", track->shape.rectCenterY);
+
+					sceClibPrintf("\npoint num: %d\n", track->shape.pointNum);*/
+
+					// TODO: draw wireframe here
+					//drawShape(rgbaBuffer, rgbaWidth, rgbaHeight, rgbaPitch * 4, &s_shapeData);
+				}
+				else if (track->isTracking || !trackingFrame->isTracking) {
+					// Waiting for its turn, or lost and published as such: readers keep the last result
+					continue;
+				}
+				else {
+					// Nothing new reaches the model, keep stale values out of the latency histograms
+					trackingFrame->stamps.capture = 0;
+				}
+
+				// The last fitted shape stays published while the face is lost
+				trackingFrame->isTracking = track->isTracking;
+				trackingFrame->isEyeTracking = track->isTracking && track->eyeValid;
+				trackingFrame->version = track->published.GetVersion() + 1;
+				track->published.Write(*trackingFrame);
+			}
+
+			if (anyTracking && _startupStats.firstTrackTime == 0)
+				_startupStats.firstTrackTime = sceKernelGetProcessTimeWide();
+
+			// Eyes only after the poses are out, so that they never hold up the model update
+			for (int t = 0; t < LR_FACE_TRACK_MAX; t++) {
+				LRFaceTrack *track = &_track[t];
+
+				if (track->updated) {
+					if (++track->eyeStageCount >= LRGovernor::GetTierParam(_governor.GetTier())->eyeStageInterval) {
+						track->eyeStageCount = 0;
+
+						SceUInt64 begin = sceKernelGetProcessTimeWide();
+
+						UpdateEyes(track, camFrame);
+
+						SceUInt32 time = (SceUInt32)(sceKernelGetProcessTimeWide() - begin);
+						_governor.AddStageTime(LR_GOVERNOR_STAGE_EYES, time);
+						_telemetry.AddStage(LR_TELEMETRY_STAGE_EYES, time);
+					}
+				}
+				else if (!track->isTracking) {
+					track->eyeValid = SCE_FALSE;
+					track->allPartsValid = SCE_FALSE;
+					track->allPartsCount = 0;
+				}
+			}
+
+			// Detection time only matters while a face is searched for
+			_governor.EndFrame(searching);
+
+			if (camFrame->captureTime - _profileSnapshotTime >= _profileSnapshotInterval) {
+				_profileSnapshotTime = camFrame->captureTime;
+				UpdateProfile();
+			}
+
+			if (camFrame->captureTime - _telemetryTime >= _telemetryInterval) {
+				_telemetryTime = camFrame->captureTime;
+
+				LRTelemetryStats telemetryStats;
+				_telemetry.GetStats(&telemetryStats);
+				_telemetrySnapshot.Write(telemetryStats);
+			}
+
+			// The EV search looks at every frame while tracking goes on
+			if (_calibStats.active) {
+				LRDetectRequest calib;
+				calib.frame = camFrame;
+				calib.quality = 0;
+				calib.measureEv = SCE_FALSE;
+				cam->Retain(camFrame);
+
+				LRDetectRequest displaced;
+				if (_calibRequest.Post(calib, &displaced))
+					cam->Release(displaced.frame);
+
+				sceKernelSetEventFlag(_detectEvf, LR_FACE_EVF_CALIBRATE_FRAME);
+			}
+		}
+		else {
+			_telemetry.AddDrop();
+		}
+
+		cam->Release(camFrame);
+		sceKernelUnlockLwMutex(&_faceMtx, 1);
+	}
+}
+
+SceBool LRFace::GetTrackingState()
+{
+	LRTrackingFrame frame;
+	_track[0].published.Read(&frame);
+
+	return frame.isTracking;
+}
+
+SceVoid LRFace::GetTrackingFrame(LRTrackingFrame *frame)
+{
+	_track[0].published.Read(frame);
+}
+
+SceVoid LRFace::GetTrackingFrame(SceInt32 track, LRTrackingFrame *frame)
+{
+	_track[track].published.Read(frame);
+}
+
+SceVoid LRFace::GetTrackStats(SceInt32 track, LRFaceTrackStats *stats)
+{
+	sceClibMemcpy(stats, &_track[track].stats, sizeof(LRFaceTrackStats));
+}
+
+SceVoid LRFace::ComputeChannels(LRFaceTrack *track)
+{
+	LRTrackingFrame *frame = &track->frame;
+	const SceFaceShapeResult *shape = &frame->shape;
+	SceFloat *channel = frame->rawChannel;
+
+	sceClibMemset(channel, 0, sizeof(SceFloat) * LR_FILTER_CHANNEL_MAX);
+
+	// Mouth and brows relative to the eye distance, so that they do not change with the distance to the camera
+	if (_features.Compute(shape->pointX, shape->pointY, (SceFloat)_camWidth / _camHeight, &track->featureResult)) {
+		sceClibMemcpy(frame->feature, track->featureResult.value, sizeof(frame->feature));
+
+		// Relaxed face: a slow average over roughly frontal frames, slot 0 keeps it in the profile
+		if (fabsf(shape->faceYaw) < _neutralPoseMax && fabsf(shape->facePitch) < _neutralPoseMax) {
+			if (track->neutralCount < _neutralFrames)
+				track->neutralCount++;
+
+			const SceFloat alpha = 1.0f / track->neutralCount;
+			for (int i = 0; i < LR_FEATURE_NUM; i++) {
+				if (!isnan(frame->feature[i]))
+					track->neutral[i] += (frame->feature[i] - track->neutral[i]) * alpha;
+			}
+		}
+	}
+	else {
+		sceClibMemset(frame->feature, 0, sizeof(frame->feature));
+	}
+
+	channel[LR_FACE_CHANNEL_ANGLE_X] = shape->faceYaw * 2.0f;
+	channel[LR_FACE_CHANNEL_ANGLE_Y] = shape->facePitch * -2.5f;
+	channel[LR_FACE_CHANNEL_MOUTH] = frame->feature[LR_FEATURE_MOUTH_OPEN] * _mouthGain;
+	// Brows move around the user's own neutral, the mouth is left absolute since talking biases its average
+	channel[LR_FACE_CHANNEL_BROW_L] = (frame->feature[LR_FEATURE_BROW_L] - track->neutral[LR_FEATURE_BROW_L]) * _browGain;
+	channel[LR_FACE_CHANNEL_BROW_R] = (frame->feature[LR_FEATURE_BROW_R] - track->neutral[LR_FEATURE_BROW_R]) * _browGain;
+
+	// From the last run of the eye stage, which trails the pose by a few frames
+	if (track->eyeValid) {
+		channel[LR_FACE_CHANNEL_EYE_L_OPEN] = track->eyeOpen[0];
+		channel[LR_FACE_CHANNEL_EYE_R_OPEN] = track->eyeOpen[1];
+		channel[LR_FACE_CHANNEL_GAZE_X] = track->gazeX * _gazeGain;
+		channel[LR_FACE_CHANNEL_GAZE_Y] = track->gazeY * _gazeGain;
+	}
+	else {
+		channel[LR_FACE_CHANNEL_EYE_L_OPEN] = 1.0f;
+		channel[LR_FACE_CHANNEL_EYE_R_OPEN] = 1.0f;
+	}
+
+	// A NaN would stick in the filter state
+	for (int i = 0; i < LR_FACE_CHANNEL_NUM; i++) {
+		if (isnan(channel[i]))
+			channel[i] = 0.0f;
+	}
+}
+
+SceVoid LRFace::FilterChannels(LRFaceTrack *track)
+{
+	LRTrackingFrame *frame = &track->frame;
+
+	ComputeChannels(track);
+
+	// Camera timestamps are free of scheduling jitter, fall back to publish time without one
+	SceUInt64 time = frame->stamps.sensor != 0 ? frame->stamps.sensor : frame->stamps.capture;
+
+	if (!track->filter.IsPrimed() || time <= track->filterTime || time - track->filterTime > _filterResetTime) {
+		track->filter.Reset(frame->rawChannel);
+		sceClibMemcpy(frame->channel, frame->rawChannel, sizeof(frame->channel));
+	}
+	else {
+		track->filter.Update(frame->rawChannel, (SceFloat)(time - track->filterTime) * 0.000001f, frame->channel);
+	}
+
+	track->filter.GetVelocity(frame->velocity);
+	frame->sampleTime = time;
+
+	track->filterTime = time;
+}
+
+SceVoid LRFace::SetFilterParam(SceInt32 channel, const LRFilterParam *param)
+{
+	sceKernelLockLwMutex(&_faceMtx, 1, NULL);
+	for (int t = 0; t < LR_FACE_TRACK_MAX; t++)
+		_track[t].filter.SetParam(channel, param);
+	sceKernelUnlockLwMutex(&_faceMtx, 1);
+}
+
+SceVoid LRFace::GetFilterParam(SceInt32 channel, LRFilterParam *param)
+{
+	sceKernelLockLwMutex(&_faceMtx, 1, NULL);
+	_track[0].filter.GetParam(channel, param);
+	sceKernelUnlockLwMutex(&_faceMtx, 1);
+}
+
+SceVoid LRFace::GetBasicTrackingAngles(const LRTrackingFrame *frame, SceFloat *x, SceFloat *y)
+{
+	*x = frame->channel[LR_FACE_CHANNEL_ANGLE_X];
+	*y = frame->channel[LR_FACE_CHANNEL_ANGLE_Y];
+}
+
+SceVoid LRFace::GetMouth(const LRTrackingFrame *frame, SceFloat *p1)
+{
+	*p1 = frame->channel[LR_FACE_CHANNEL_MOUTH];
+}
+
+SceVoid LRFace::GetResultStamps(const LRTrackingFrame *frame, LRLatencyStamps *stamps)
+{
+	sceClibMemcpy(stamps, &frame->stamps, sizeof(LRLatencyStamps));
+	stamps->model = 0;
+	stamps->submit = 0;
+}
+
+SceVoid LRFace::GetBrows(const LRTrackingFrame *frame, SceFloat *l, SceFloat *r)
+{
+	*l = frame->channel[LR_FACE_CHANNEL_BROW_L];
+	*r = frame->channel[LR_FACE_CHANNEL_BROW_R];
+}
+
+SceVoid LRFace::GetEyes(const LRTrackingFrame *frame, SceFloat *l, SceFloat *r)
+{
+	*l = frame->channel[LR_FACE_CHANNEL_EYE_L_OPEN];
+	*r = frame->channel[LR_FACE_CHANNEL_EYE_R_OPEN];
+}
+
+SceVoid LRFace::GetGaze(const LRTrackingFrame *frame, SceFloat *x, SceFloat *y)
+{
+	*x = frame->channel[LR_FACE_CHANNEL_GAZE_X];
+	*y = frame->channel[LR_FACE_CHANNEL_GAZE_Y];
+}
+
+SceVoid LRFace::ShapeToRect(const SceFaceShapeResult *shape, SceFaceDetectionResult *face)
+{
+	sceClibMemset(face, 0, sizeof(SceFaceDetectionResult));
+	face->faceX = shape->rectCenterX - shape->rectWidth * 0.5f;
+	face->faceY = shape->rectCenterY - shape->rectHeight * 0.5f;
+	face->faceW = shape->rectWidth;
+	face->faceH = shape->rectHeight;
+	face->score = shape->score;
+}
+
+SceBool LRFace::FindPupil(const LRFrame *frame, SceInt32 x0, SceInt32 y0, SceInt32 x1, SceInt32 y1, SceFloat threshold, SceFloat *pupilX, SceFloat *pupilY, SceFloat *dark)
+{
+	const SceInt32 area = (x1 - x0) * (y1 - y0);
+	if (area <= 0)
+		return SCE_FALSE;
+
+	SceUInt32 min = 255;
+	SceUInt32 sum = 0;
+
+	for (SceInt32 y = y0; y < y1; y++) {
+		const unsigned char *row = frame->data + y * frame->pitch;
+		for (SceInt32 x = x0; x < x1; x++) {
+			if (row[x] < min)
+				min = row[x];
+			sum += row[x];
+		}
+	}
+
+	const SceUInt32 mean = sum / area;
+	if (mean < min + 4)
+		return SCE_FALSE;
+
+	const SceUInt32 limit = min + (SceUInt32)((mean - min) * threshold);
+	SceUInt32 count = 0;
+	SceUInt32 sumX = 0;
+	SceUInt32 sumY = 0;
+
+	for (SceInt32 y = y0; y < y1; y++) {
+		const unsigned char *row = frame->data + y * frame->pitch;
+		for (SceInt32 x = x0; x < x1; x++) {
+			if (row[x] <= limit) {
+				count++;
+				sumX += x;
+				sumY += y;
+			}
+		}
+	}
+
+	*pupilX = (SceFloat)sumX / count + 0.5f;
+	*pupilY = (SceFloat)sumY / count + 0.5f;
+	*dark = (SceFloat)count / area;
+
+	return SCE_TRUE;
+}
+
+SceVoid LRFace::UpdateEyes(LRFaceTrack *track, const LRFrame *frame)
+{
+	const SceFaceShapeResult *shape = &track->frame.shape;
+
+	const SceInt32 allPartsInterval = LRGovernor::GetTierParam(_governor.GetTier())->allPartsInterval;
+
+	// Without the allparts dictionaries the pupil search works from the shape landmarks alone
+	if (allPartsInterval == 0 || _workPtr[LR_FACE_STAGE_ALLPARTS] == SCE_NULL) {
+		track->allPartsValid = SCE_FALSE;
+	}
+	else if (track->allPartsCount <= 0) {
+		track->allPartsCount = allPartsInterval;
+
+		SceFaceDetectionResult face;
+		ShapeToRect(&track->shape, &face);
+
+		SceInt32 ret = sceFaceAllParts(
+			frame->data + track->roiY * _camWidth + track->roiX, _trackWidth, _trackHeight, _camWidth,
+			_allPartsDictPtr,
+			_shapeApDictPtr,
+			1, 1,
+			&face,
+			track->allParts, SCE_FACE_ALLPARTS_NUM_MAX,
+			&track->numAllParts,
+			_workPtr[LR_FACE_STAGE_ALLPARTS], _workSize[LR_FACE_STAGE_ALLPARTS]
+		);
+
+		track->allPartsValid = (ret == SCE_OK && track->numAllParts > 0);
+	}
+	track->allPartsCount--;
+
+	SceFloat gazeX = 0.0f;
+	SceFloat gazeY = 0.0f;
+	SceInt32 gazeNum = 0;
+
+	for (int e = 0; e < 2; e++) {
+		const int first = (e == 0) ? 8 : 0;
+
+		SceFloat minX = (SceFloat)_camWidth, maxX = 0.0f;
+		SceFloat minY = (SceFloat)_camHeight, maxY = 0.0f;
+		SceFloat centerX = 0.0f, centerY = 0.0f;
+
+		for (int i = first; i < first + 8; i++) {
+			SceFloat px = shape->pointX[i] * _camWidth;
+			SceFloat py = shape->pointY[i] * _camHeight;
+
+			minX = px < minX ? px : minX;
+			maxX = px > maxX ? px : maxX;
+			minY = py < minY ? py : minY;
+			maxY = py > maxY ? py : maxY;
+			centerX += px * 0.125f;
+			centerY += py * 0.125f;
+		}
+
+		const SceFloat width = maxX - minX;
+		if (width < 4.0f) {
+			track->eyeValid = SCE_FALSE;
+			return;
+		}
+
+		// Part points next to the eye widen the box, the 8 contour points tend to sit inside the iris edge.
+		// Only positions are used, so this does not depend on the order of the parts.
+		if (track->allPartsValid) {
+			const SceFloat margin = width * 0.25f;
+
+			for (int i = 0; i < track->numAllParts; i++) {
+				SceFloat px = track->allParts[i].partsX * _trackWidth + track->roiX;
+				SceFloat py = track->allParts[i].partsY * _trackHeight + track->roiY;
+
+				if (px < minX - margin || px > maxX + margin || py < minY - margin || py > maxY + margin)
+					continue;
+
+				minX = px < minX ? px : minX;
+				maxX = px > maxX ? px : maxX;
+				minY = py < minY ? py : minY;
+				maxY = py > maxY ? py : maxY;
+			}
+		}
+
+		// Keep some height when the lids are nearly closed
+		SceFloat halfHeight = (maxY - minY) * 0.5f;
+		if (halfHeight < width * 0.2f)
+			halfHeight = width * 0.2f;
+		const SceFloat midY = (minY + maxY) * 0.5f;
+
+		SceInt32 x0 = (SceInt32)minX;
+		SceInt32 x1 = (SceInt32)maxX + 1;
+		SceInt32 y0 = (SceInt32)(midY - halfHeight);
+		SceInt32 y1 = (SceInt32)(midY + halfHeight) + 1;
+		x0 = x0 < 0 ? 0 : x0;
+		y0 = y0 < 0 ? 0 : y0;
+		x1 = x1 > _camWidth ? _camWidth : x1;
+		y1 = y1 > _camHeight ? _camHeight : y1;
+
+		SceFloat pupilX, pupilY, dark;
+		if (!FindPupil(frame, x0, y0, x1, y1, _pupilThreshold, &pupilX, &pupilY, &dark)) {
+			track->eyeValid = SCE_FALSE;
+			return;
+		}
+
+		// Lid gap relative to how wide this user's eye usually opens. The reference follows
+		// wider eyes quickly and narrower ones slowly, so that blinks do not pull it down.
+		SceFloat *openRef = &track->eyeOpenRef[e];
+		SceFloat open = track->featureResult.value[e == 0 ? LR_FEATURE_EYE_L_OPEN : LR_FEATURE_EYE_R_OPEN];
+		if (open > *openRef)
+			*openRef += (open - *openRef) * 0.05f;
+		else
+			*openRef += (open - *openRef) * 0.001f;
+
+		SceFloat openness = *openRef > 0.0f ? open / *openRef : 1.0f;
+		if (dark < _pupilMinDark)
+			openness = 0.0f;
+		if (openness < 0.0f)
+			openness = 0.0f;
+		else if (openness > 1.2f)
+			openness = 1.2f;
+
+		track->eyeOpen[e] = openness;
+
+		// The pupil of a closed eye is just the darkest lash
+		if (openness > 0.3f) {
+			gazeX += (pupilX - centerX) / (width * 0.5f);
+			gazeY += (pupilY - centerY) / (width * 0.5f);
+			gazeNum++;
+		}
+	}
+
+	if (gazeNum > 0) {
+		track->gazeX = gazeX / gazeNum;
+		track->gazeY = gazeY / gazeNum;
+	}
+
+	track->eyeValid = SCE_TRUE;
+}
+
+int idx = 0;
+
+SceVoid LRFace::DrawShape(const LRTrackingFrame *frame)
+{
+	const SceFaceShapeResult *shape = &frame->shape;
+
+	if (frame->isTracking) {
+		for (int i = 0; i < shape->pointNum; i++) {
+
+			SceFloat sx = (int)(160 * shape->pointX[i]);
+			SceFloat dx = (int)(160 * shape->pointX[_shapeConnectTo[shape->modelID][i]]);
+			SceFloat sy = (int)(120 * shape->pointY[i]);
+			SceFloat dy = (int)(120 * shape->pointY[_shapeConnectTo[shape->modelID][i]]);
+
+			//if (i == idx)
+			vita2d_draw_line(sx, sy, dx, dy, RGBA8(255, 0, 0, 255));
+		}
+	}
+
+	char val[1];
+
+	if (sceTargetTransportTryRecv(val, sizeof(val)) == sizeof(val)) {
+		if (val[0] == ',') {
+			idx++;
+			sceClibPrintf("idx: %d\n", idx);
+		}
+		else if (val[0] == 'S') {
+			idx--;
+			sceClibPrintf("idx: %d\n", idx);
+		}
+	}
+}
+
+SceVoid LRFace::StartTracking()
+{
+	// Warm start: the calibrated exposure, and the local search looks where the face was last seen
+	LRCamera::GetInstance()->SetEv(_evLevel);
+
+	// Slot 0 starts out bound to the face of the profile, as if it had just been lost there
+	if (_profile.flags & LR_PROFILE_HAS_FACE) {
+		LRFaceTrack *track = &_track[0];
+
+		SceFaceDetectionResult face;
+		sceClibMemset(&face, 0, sizeof(SceFaceDetectionResult));
+		face.faceX = _profile.faceX;
+		face.faceY = _profile.faceY;
+		face.faceW = _profile.faceW;
+		face.faceH = _profile.faceH;
+		track->rect = face;
+
+		GetRoiOrigin(face.faceX + face.faceW * 0.5f, face.faceY + face.faceH * 0.5f, &track->roiX, &track->roiY);
+		FrameRectToRoi(track->roiX, track->roiY, &face);
+
+		track->id = _nextTrackId++;
+		track->lostFace = face;
+		track->localRetryCount = 0;
+	}
+
+	SceUID updateThread = sceKernelCreateThread("LRFace:UpdateThread", TrackThreadStart, 64, 0x100000, 0, SCE_KERNEL_CPU_MASK_USER_1, NULL);
+	sceKernelStartThread(updateThread, 0, NULL);
+
+	// Global detection runs next to the camera capture thread, which spends most of its time blocked in sceCameraRead()
+	SceUID detectThread = sceKernelCreateThread("LRFace:DetectThread", DetectThreadStart, 70, 0x100000, 0, SCE_KERNEL_CPU_MASK_USER_2, NULL);
+	sceKernelStartThread(detectThread, 0, NULL);
+
+	// Below the tracking thread on its core, a slow memory card only delays the next save
+	SceUID profileThread = sceKernelCreateThread("LRFace:ProfileThread", ProfileThreadStart, 120, 0x4000, 0, SCE_KERNEL_CPU_MASK_USER_1, NULL);
+	sceKernelStartThread(profileThread, 0, NULL);
+}
@@ -1,120 +1,563 @@
-#pragma once
-
-#include <kernel.h>
-#include <camera.h>
-#include <libface.h>
-#include <scetypes.h>
-
-class LRFace
-{
-public:
-
-	static LRFace *GetInstance();
-
-	static SceVoid ReleaseInstance();
-
-	SceVoid StartTracking();
-
-	SceBool Calibrate(SceUInt32 *progress);
-
-	SceVoid DrawShape();
-
-	SceBool GetTrackingState();
-
-	SceVoid GetBasicTrackingAngles(SceFloat *x, SceFloat *y);
-
-	SceVoid GetMouth(SceFloat *p1);
-
-	SceVoid GetBrows(SceFloat *l, SceFloat *r);
-
-private:
-
-	const SceInt32 _waitFrameNum = 30;
-	const SceInt32 _evLevelNum = 17;
-
-	SceUInt8 *_detectDictPtr;
-	SceUInt8 *_detectLocalDictPtr;
-	SceUInt8 *_partsDictPtr;
-	SceUInt8 *_allPartsDictPtr;
-	SceFaceAttribDictPtr _attribDictPtr;
-	SceUInt8 *_partsCheckDictPtr;
-	SceFaceShapeModelDictPtr _shapeDictPtr;
-	SceFaceShapeDictPtr _shapeApDictPtr;
-
-	SceInt32 _workSize;
-	ScePVoid _workPtr;
-
-	SceInt32 _workSizeLocal;
-	ScePVoid _workPtrLocal;
-
-	SceInt32 _workSizeParts;
-	ScePVoid _workPtrParts;
-
-	SceInt32 _workSizeAllParts;
-	ScePVoid _workPtrAllParts;
-
-	SceInt32 _workAttribSize;
-	ScePVoid _workAttribPtr;
-
-	SceInt32 _workSizeShape;
-	ScePVoid _workPtrShape;
-
-	SceUInt8 *_iBufferPrevious;
-
-	SceUInt64 _prevFrame;
-
-	SceBool _isTracking;
-	SceBool _isShapeTrack;
-
-	SceFaceShapeResult _shapeData;
-
-	SceFloat _lostThres;
-
-	SceInt32 _evCalibrationNum;
-	SceInt32 _waitFrameCount;
-	
-	SceFloat _evScore[17];
-	SceInt32 _evLevel;
-
-	SceInt32 _numParts;
-	SceFacePartsResult _parts[SCE_FACE_PARTS_NUM_MAX];
-
-	SceInt32 _numAllParts;
-	SceFacePartsResult _allParts[SCE_FACE_ALLPARTS_NUM_MAX];
-
-	const SceInt32 _evLevelTable[17] = {
-		SCE_CAMERA_ATTRIBUTE_EV_MINUS_2,	// -20
-		SCE_CAMERA_ATTRIBUTE_EV_MINUS_1_7,	// -17
-		SCE_CAMERA_ATTRIBUTE_EV_MINUS_1_5,	// -15
-		SCE_CAMERA_ATTRIBUTE_EV_MINUS_1_3,	// -13
-		SCE_CAMERA_ATTRIBUTE_EV_MINUS_1,	// -10
-		SCE_CAMERA_ATTRIBUTE_EV_MINUS_0_7,	// - 7
-		SCE_CAMERA_ATTRIBUTE_EV_MINUS_0_5,	// - 5
-		SCE_CAMERA_ATTRIBUTE_EV_MINUS_0_3,	// - 3
-		SCE_CAMERA_ATTRIBUTE_EV_0,			//   0
-		SCE_CAMERA_ATTRIBUTE_EV_PLUS_0_3,	//   3
-		SCE_CAMERA_ATTRIBUTE_EV_PLUS_0_5,	//   5
-		SCE_CAMERA_ATTRIBUTE_EV_PLUS_0_7,	//   7
-		SCE_CAMERA_ATTRIBUTE_EV_PLUS_1,		//  10
-		SCE_CAMERA_ATTRIBUTE_EV_PLUS_1_3,	//  13
-		SCE_CAMERA_ATTRIBUTE_EV_PLUS_1_5,	//  15
-		SCE_CAMERA_ATTRIBUTE_EV_PLUS_1_7,	//  17
-		SCE_CAMERA_ATTRIBUTE_EV_PLUS_2		//  20
-	};
-
-	const unsigned char _shapeConnectTo[SCE_FACE_SHAPE_MODEL_NUM_MAX][SCE_FACE_SHAPE_POINT_NUM_MAX] = {
-		//SCE_FACE_SHAPE_MODEL_ID_FRONTAL (0)
-		{1, 2, 3, 4, 5, 6, 7, 0, 9, 10, 11, 12, 13, 14, 15, 8, 17, 18, 19, 20, 20, 22, 23, 24, 25, 25, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 36, 38, 39, 40, 41, 42, 43, 44, 37, 45},
-	};
-
-	SceKernelLwMutexWork _faceMtx;
-
-	LRFace();
-
-	~LRFace();
-
-	static SceInt32 TrackThreadStart(SceSize args, ScePVoid argp);
-
-	SceVoid TrackThread();
-};
-
+#pragma once
+
+#include <kernel.h>
+#include <camera.h>
+#include <libface.h>
+#include <scetypes.h>
+
+#include "LRFrameRing.hpp"
+#include "LRPyramid.hpp"
+#include "LRLatency.hpp"
+#include "LRMailbox.hpp"
+#include "LRSeqlock.hpp"
+#include "LRFilter.hpp"
+#include "LRFeatures.hpp"
+#include "LRGovernor.hpp"
+#include "LRExposureSearch.hpp"
+#include "LRProfile.hpp"
+#include "LRDictLoader.hpp"
+#include "LRArena.hpp"
+#include "LRTelemetry.hpp"
+
+#define LR_FACE_EVF_DETECT_REQUEST		1
+#define LR_FACE_EVF_CALIBRATE_START		2
+#define LR_FACE_EVF_CALIBRATE_FRAME		4
+
+// Candidates returned by one global detection
+#define LR_FACE_DETECT_CANDIDATE_MAX	4
+
+// Faces tracked at the same time, slot 0 is the one the model follows
+#define LR_FACE_TRACK_MAX				2
+
+// Re-acquisition ladder, tried in this order after sceFaceShapeTrack() lost the face
+#define LR_FACE_TIER_LOCAL		0	// local search around the last rect, on the tracking thread
+#define LR_FACE_TIER_COARSE		1	// global scan of the next smaller pyramid level
+#define LR_FACE_TIER_PRECISE	2	// full global scan
+#define LR_FACE_TIER_NUM		3
+
+struct LRCalibrationStats
+{
+	SceBool active;
+	SceUInt32 progress;		// percent
+	SceUInt32 measureCount;	// EV levels measured by the current or last search
+	SceInt32 evLevel;		// SCE_CAMERA_ATTRIBUTE_EV_* in use
+	SceFloat score;			// detection score at evLevel, 0 if the last search found no face
+	SceUInt32 time;			// microseconds the last search took
+};
+
+// Pipeline stages. Only enabled stages get their dictionaries loaded and working memory allocated.
+#define LR_FACE_STAGE_DETECT	0	// global detection on the detection thread, and EV calibration
+#define LR_FACE_STAGE_LOCAL		1	// local search around the last rect, refines coarse rects
+#define LR_FACE_STAGE_PARTS		2	// parts search before the shape fit
+#define LR_FACE_STAGE_SHAPE		3	// shape fit and track
+#define LR_FACE_STAGE_ALLPARTS	4	// eye and brow contours for the eye stage
+#define LR_FACE_STAGE_ATTRIB	5	// attribute classification, no tracking feature uses it
+#define LR_FACE_STAGE_NUM		6
+
+#define LR_FACE_STAGE_BIT(stage)	(1 << (stage))
+
+// Detection, parts and shape are required, the others can be left out to save memory
+#define LR_FACE_PIPELINE_DEFAULT	(LR_FACE_STAGE_BIT(LR_FACE_STAGE_DETECT) | LR_FACE_STAGE_BIT(LR_FACE_STAGE_LOCAL) | \
+									LR_FACE_STAGE_BIT(LR_FACE_STAGE_PARTS) | LR_FACE_STAGE_BIT(LR_FACE_STAGE_SHAPE) | \
+									LR_FACE_STAGE_BIT(LR_FACE_STAGE_ALLPARTS))
+
+struct LRStageMemoryReport
+{
+	SceUInt32 stageMask;	// enabled stages
+	SceUInt32 dictSize[LR_FACE_STAGE_NUM];	// bytes, also for disabled stages
+	SceUInt32 workSize[LR_FACE_STAGE_NUM];	// bytes at the current resolution, 0 while not allocated
+	SceUInt32 arenaSize;	// working memory shared by stages that never run at the same time
+	SceUInt32 savedSize;	// compared to a buffer per stage
+	SceUInt32 totalSize;	// dictionaries and arena of the enabled stages
+};
+
+// Process times are microseconds since launch, 0 until it happened
+struct LRStartupStats
+{
+	LRDictStats dict;
+	SceUInt64 trackReadyTime;	// detection, parts and shape had their dictionaries and working memory
+	SceUInt64 firstTrackTime;	// first face tracked
+};
+
+struct LRReacquireStats
+{
+	SceUInt32 attemptCount[LR_FACE_TIER_NUM];
+	SceUInt32 hitCount[LR_FACE_TIER_NUM];	// candidate found, for the local tier shape fitted
+	SceUInt32 timeLast[LR_FACE_TIER_NUM];	// microseconds
+	SceUInt64 timeSum[LR_FACE_TIER_NUM];
+};
+
+// Output channels passed through LRFilter, in model units
+#define LR_FACE_CHANNEL_ANGLE_X		0
+#define LR_FACE_CHANNEL_ANGLE_Y		1
+#define LR_FACE_CHANNEL_MOUTH		2
+#define LR_FACE_CHANNEL_BROW_L		3
+#define LR_FACE_CHANNEL_BROW_R		4
+#define LR_FACE_CHANNEL_EYE_L_OPEN	5	// 0 closed, 1 open as wide as usual
+#define LR_FACE_CHANNEL_EYE_R_OPEN	6
+#define LR_FACE_CHANNEL_GAZE_X		7	// pupil offset from the eye center in half eye widths
+#define LR_FACE_CHANNEL_GAZE_Y		8
+#define LR_FACE_CHANNEL_NUM			9
+
+// Tracking result of one camera frame, published as a whole by the tracking thread
+struct LRTrackingFrame
+{
+	SceUInt32 version;			// increases by one per published result
+	SceBool isTracking;
+	SceBool isEyeTracking;	// eye channels come from tracking, not from defaults
+	SceFloat score;
+	SceFaceShapeResult shape;	// pose and landmarks normalized to the full camera frame
+	SceFloat feature[LR_FEATURE_NUM];	// size and roll independent features of the shape
+	SceFloat rawChannel[LR_FILTER_CHANNEL_MAX];	// channels as measured on this frame
+	SceFloat channel[LR_FILTER_CHANNEL_MAX];	// filtered channels
+	SceFloat velocity[LR_FILTER_CHANNEL_MAX];	// filtered channels per second
+	SceUInt64 sampleTime;	// process time the channels were measured at, for prediction
+	LRLatencyStamps stamps;		// frame number and timestamps, capture is 0 while the face is lost
+};
+
+// Per-face metrics of one track slot
+struct LRFaceTrackStats
+{
+	SceInt32 id;			// identity of the face in the slot, -1 while the slot is free
+	SceBool isTracking;
+	SceFloat score;			// shape score of the last tracked frame
+	SceUInt32 trackCount;	// shape tracks run
+	SceUInt32 deferCount;	// frames the shape track waited for another face's turn
+	SceUInt32 lostCount;
+	SceUInt32 matchCount;	// lost face found again and bound to its old identity
+	SceUInt32 trackTime;	// microseconds of the last shape track
+};
+
+// Tracker state of one face, owned by the tracking thread
+struct LRFaceTrack
+{
+	SceInt32 id;			// -1 while the slot is free
+	SceBool isTracking;
+	SceBool updated;		// shape moved onto the current frame
+
+	// Frame the shape was last fitted or tracked on, held by reference for sceFaceShapeTrack()
+	const LRFrame *prevFrame;
+
+	// ROI crop origin in full frame pixels
+	SceInt32 roiX;
+	SceInt32 roiY;
+
+	// Shape in ROI coordinates as used by libface
+	SceFaceShapeResult shape;
+
+	// Last tracked rect normalized to the full frame, identities are matched against it
+	SceFaceDetectionResult rect;
+
+	// Last tracked rect in ROI coordinates, the local search looks around it
+	SceFaceDetectionResult lostFace;
+	SceInt32 localRetryCount;
+	SceInt32 lostFrames;	// camera frames since the face was last tracked
+
+	// Result being assembled, and the last one handed out to readers
+	LRTrackingFrame frame;
+	LRSeqlock<LRTrackingFrame> published;
+
+	// Time of the last filtered frame in microseconds
+	LRFilter filter;
+	SceUInt64 filterTime;
+
+	LRFeatureResult featureResult;
+
+	// Features of the relaxed face, slot 0 keeps them in the profile
+	SceFloat neutral[LR_FEATURE_NUM];
+	SceUInt32 neutralCount;
+
+	// Eye stage state, index 0 is the left and 1 the right eye
+	SceInt32 eyeStageCount;
+	SceInt32 allPartsCount;
+	SceBool allPartsValid;
+	SceBool eyeValid;
+	SceFloat eyeOpen[2];
+	SceFloat eyeOpenRef[2];	// openness feature of a normally open eye, adapts to the user
+	SceFloat gazeX;
+	SceFloat gazeY;
+
+	SceInt32 numAllParts;
+	SceFacePartsResult allParts[SCE_FACE_ALLPARTS_NUM_MAX];
+
+	LRFaceTrackStats stats;
+};
+
+// Frame handed to the detection thread, held by reference
+struct LRDetectRequest
+{
+	const LRFrame *frame;
+	SceInt32 quality;	// governor tier at the time of the request
+	SceBool measureEv;	// a loaded EV is being checked, score a found face like the EV search does
+};
+
+// EV level with the score it was calibrated at, published as one value
+struct LREvSetting
+{
+	SceInt32 level;
+	SceFloat score;
+};
+
+// Candidate rects normalized to the full frame, and the frame they were found in
+struct LRDetectResult
+{
+	const LRFrame *frame;
+	SceInt32 tier;
+	SceBool precise;	// SCE_FACE_DETECT_RESULT_PRECISE rects, others need a local search
+	SceUInt32 time;		// microseconds spent on the request
+	SceUInt32 lockWait;	// microseconds the detection thread waited for its mutex since the last result
+	SceUInt32 displacedCount;	// requests whose results were replaced before the tracker took them
+	SceUInt32 displacedTime;	// microseconds spent on those
+	SceFloat evScore;	// score from MeasureEvScore() for measureEv requests with a face, negative otherwise
+	SceInt32 numFace;
+	SceFaceDetectionResult face[LR_FACE_DETECT_CANDIDATE_MAX];
+};
+
+class LRFace
+{
+public:
+
+	static LRFace *GetInstance();
+
+	static SceVoid ReleaseInstance();
+
+	SceVoid StartTracking();
+
+	// Searches the EV level with the best detection score on the detection thread, tracking goes on meanwhile
+	SceVoid StartCalibration();
+
+	SceVoid GetCalibrationStats(LRCalibrationStats *stats);
+
+	SceVoid DrawShape(const LRTrackingFrame *frame);
+
+	SceBool GetTrackingState();
+
+	// Consistent copy of the latest result, never waits for the tracking thread
+	SceVoid GetTrackingFrame(LRTrackingFrame *frame);
+
+	// Same for any track slot, a slot keeps its face across losses so that it stays on one model
+	SceVoid GetTrackingFrame(SceInt32 track, LRTrackingFrame *frame);
+
+	SceVoid GetTrackStats(SceInt32 track, LRFaceTrackStats *stats);
+
+	static SceVoid GetBasicTrackingAngles(const LRTrackingFrame *frame, SceFloat *x, SceFloat *y);
+
+	static SceVoid GetMouth(const LRTrackingFrame *frame, SceFloat *p1);
+
+	static SceVoid GetBrows(const LRTrackingFrame *frame, SceFloat *l, SceFloat *r);
+
+	static SceVoid GetEyes(const LRTrackingFrame *frame, SceFloat *l, SceFloat *r);
+
+	static SceVoid GetGaze(const LRTrackingFrame *frame, SceFloat *x, SceFloat *y);
+
+	// Timestamps of the frame the tracking values were computed from
+	static SceVoid GetResultStamps(const LRTrackingFrame *frame, LRLatencyStamps *stamps);
+
+	// Switches the camera capture resolution and resizes all libface working memory
+	SceInt32 SetCameraResolution(SceInt32 resolution);
+
+	// Detect on a downscaled full frame and fit the shape on a full resolution crop around the face
+	SceVoid SetRoiMode(SceBool enable);
+
+	SceBool GetRoiMode();
+
+	// Filter used for one LR_FACE_CHANNEL_*, takes effect with the next tracked frame
+	SceVoid SetFilterParam(SceInt32 channel, const LRFilterParam *param);
+
+	SceVoid GetFilterParam(SceInt32 channel, LRFilterParam *param);
+
+	// Attempts, hits and timings of every re-acquisition tier
+	SceVoid GetReacquireStats(LRReacquireStats *stats);
+
+	// Dictionary loading progress and when tracking could start
+	SceVoid GetStartupStats(LRStartupStats *stats);
+
+	// Dictionary and working memory of every pipeline stage
+	SceVoid GetMemoryReport(LRStageMemoryReport *report);
+
+	// Quality tier picked by the governor and the stage timings it is based on
+	SceVoid GetGovernorStats(LRGovernorStats *stats);
+
+	// Tracker counters and timing histograms, at most half a second old, never waits for the tracking thread
+	SceVoid GetStats(LRTelemetryStats *stats);
+
+private:
+
+	const SceInt32 _evLevelNum = 17;
+	const SceFloat _detectMagBegin = 0.5f;
+	const SceUInt32 _frameWaitTimeout = 100 * 1000;
+	// Frames the local search keeps trying after a loss, about a quarter second at 30 fps
+	const SceInt32 _localRetryNum = 8;
+	const SceFloat _localExpand = 1.5f;
+	// Interocular feature units to the frame-relative channel values used before, at a typical
+	// distance where the eyes are 0.2 frame heights apart
+	const SceFloat _mouthGain = 2.0f;
+	const SceFloat _browGain = 0.2f;
+	// Pupil search: luma below min + (mean - min) * ratio counts as pupil or iris
+	const SceFloat _pupilThreshold = 0.5f;
+	// Hardly any dark pixels between the lids means the eye is closed whatever the landmarks say
+	const SceFloat _pupilMinDark = 0.03f;
+	// Pupil offset in half eye widths rarely exceeds 0.3, scale it to the model's -1..1
+	const SceFloat _gazeGain = 3.0f;
+	// Filters restart from the measurement after a gap this long, in microseconds
+	const SceUInt64 _filterResetTime = 500 * 1000;
+	// Neutral features average the last frames with the head within this many radians of frontal
+	const SceUInt32 _neutralFrames = 300;
+	const SceFloat _neutralPoseMax = 0.2f;
+	// The profile is handed to the profile thread every second and written at most every minute,
+	// right away when the EV changed
+	const SceUInt64 _profileSnapshotInterval = 1000 * 1000;
+	const SceUInt64 _profileSaveInterval = 60 * 1000 * 1000;
+	// A loaded EV is recalibrated when detection misses this often before the first hit,
+	// or the first hit, measured again like the calibration did, scores below this share
+	// of the calibrated score
+	const SceInt32 _profileMissNum = 10;
+	const SceFloat _profileScoreRatio = 0.8f;
+	// Rect overlap (intersection over union): a candidate over a tracked face is that face, a lost
+	// face takes back the candidate overlapping its last rect the most
+	const SceFloat _trackOverlapMax = 0.3f;
+	const SceFloat _identityOverlapMin = 0.1f;
+	// A face lost this many frames frees its slot, about 3 seconds at 30 fps
+	const SceInt32 _trackReleaseFrames = 90;
+	// With every bound face tracked, free slots look for newcomers every this many frames
+	const SceInt32 _newFaceInterval = 15;
+	// Telemetry is handed to readers this often, in microseconds
+	const SceUInt64 _telemetryInterval = 500 * 1000;
+
+	// Dictionary pointers are picked up from the loader as they become resident
+	SceUInt32 _stageMask;
+	LRDictLoader _dictLoader;
+	SceBool _trackStagesReady;
+	SceBool _dictPending;
+	LRStartupStats _startupStats;
+
+	SceUInt8 *_detectDictPtr;
+	SceUInt8 *_detectLocalDictPtr;
+	SceUInt8 *_partsDictPtr;
+	SceUInt8 *_allPartsDictPtr;
+	SceFaceAttribDictPtr _attribDictPtr;
+	SceUInt8 *_partsCheckDictPtr;
+	SceFaceShapeModelDictPtr _shapeDictPtr;
+	SceFaceShapeDictPtr _shapeApDictPtr;
+
+	// Per LR_FACE_STAGE_*, SCE_NULL for disabled stages and while the dictionaries are loading.
+	// Regions of _arena: tracking-thread stages run one after another and share addresses,
+	// detection runs on its own thread and gets a region of its own.
+	LRArena _arena;
+	SceInt32 _workSize[LR_FACE_STAGE_NUM];
+	ScePVoid _workPtr[LR_FACE_STAGE_NUM];
+
+	SceInt32 _camWidth;
+	SceInt32 _camHeight;
+
+	SceBool _roiMode;
+
+	// Luma pyramid built at most once per camera frame, level 0 is the frame itself.
+	// Detection scans _detectLevel starting at _detectMag instead of downscaling the frame on its own.
+	LRPyramid _pyramid;
+	SceInt32 _detectLevel;
+	SceFloat _detectMag;
+	SceInt32 _detectWidth;
+	SceInt32 _detectHeight;
+	SceInt32 _detectPitch;
+
+	// Global detection runs on its own thread. The tracker posts the newest frame while the face
+	// is lost and picks up candidates without ever waiting for a detection to finish.
+	LRMailbox<LRDetectRequest> _detectRequest;
+	LRMailbox<LRDetectResult> _detectResult;
+	SceUID _detectEvf;
+
+	LRReacquireStats _reacquireStats;
+
+	// Scan steps, precision and stage rates follow the time the stages take
+	LRGovernor _governor;
+
+	// Recorded by the tracking thread, detection timings arrive with the results.
+	// Readers get the copy in _telemetrySnapshot.
+	LRTelemetry _telemetry;
+	LRSeqlock<LRTelemetryStats> _telemetrySnapshot;
+	SceUInt64 _telemetryTime;
+	SceUInt32 _lastFrameSeq;	// ring sequence of the last frame taken, for skipped frames
+
+	// ROI crop size, every face has its own origin
+	SceInt32 _trackWidth;
+	SceInt32 _trackHeight;
+
+	SceBool _isShapeTrack;
+
+	// Faces in their slots. Shape tracks take turns starting at _trackNext when the frame
+	// budget does not fit all of them.
+	LRFaceTrack _track[LR_FACE_TRACK_MAX];
+	SceInt32 _trackNext;
+	SceInt32 _nextTrackId;
+	SceInt32 _newFaceCount;
+
+	LRFeatures _features;
+
+	SceFloat _lostThres;
+
+	// Calibration runs on the detection thread, the tracking thread passes it every frame
+	LRMailbox<LRDetectRequest> _calibRequest;
+	LRExposureSearch _exposureSearch;
+	LRCalibrationStats _calibStats;
+	SceUInt64 _calibBegin;
+	SceInt32 _evLevel;
+	SceFloat _evScore;	// calibrated detection score at _evLevel, 0 if never calibrated
+	// _evLevel and _evScore for the profile thread, so that it never saves a level with the
+	// score of another. Written by the detection thread.
+	LRSeqlock<LREvSetting> _evSetting;
+
+	// Profile fields owned by the tracking thread, the copy the profile thread saves from,
+	// and what it saved last
+	LRProfile _profile;
+	LRSeqlock<LRProfile> _profileSnapshot;
+	SceUInt64 _profileSnapshotTime;
+	SceUInt32 _profileSavedVersion;
+	SceUInt64 _profileSaveTime;
+	SceInt32 _profileSavedEv;
+	SceFloat _profileSavedScore;
+	// A loaded EV still has to prove itself against live detection scores
+	SceBool _profileCheck;
+	SceInt32 _profileMissCount;
+
+	SceInt32 _numParts;
+	SceFacePartsResult _parts[SCE_FACE_PARTS_NUM_MAX];
+
+	const SceInt32 _evLevelTable[17] = {
+		SCE_CAMERA_ATTRIBUTE_EV_MINUS_2,	// -20
+		SCE_CAMERA_ATTRIBUTE_EV_MINUS_1_7,	// -17
+		SCE_CAMERA_ATTRIBUTE_EV_MINUS_1_5,	// -15
+		SCE_CAMERA_ATTRIBUTE_EV_MINUS_1_3,	// -13
+		SCE_CAMERA_ATTRIBUTE_EV_MINUS_1,	// -10
+		SCE_CAMERA_ATTRIBUTE_EV_MINUS_0_7,	// - 7
+		SCE_CAMERA_ATTRIBUTE_EV_MINUS_0_5,	// - 5
+		SCE_CAMERA_ATTRIBUTE_EV_MINUS_0_3,	// - 3
+		SCE_CAMERA_ATTRIBUTE_EV_0,			//   0
+		SCE_CAMERA_ATTRIBUTE_EV_PLUS_0_3,	//   3
+		SCE_CAMERA_ATTRIBUTE_EV_PLUS_0_5,	//   5
+		SCE_CAMERA_ATTRIBUTE_EV_PLUS_0_7,	//   7
+		SCE_CAMERA_ATTRIBUTE_EV_PLUS_1,		//  10
+		SCE_CAMERA_ATTRIBUTE_EV_PLUS_1_3,	//  13
+		SCE_CAMERA_ATTRIBUTE_EV_PLUS_1_5,	//  15
+		SCE_CAMERA_ATTRIBUTE_EV_PLUS_1_7,	//  17
+		SCE_CAMERA_ATTRIBUTE_EV_PLUS_2		//  20
+	};
+
+	const unsigned char _shapeConnectTo[SCE_FACE_SHAPE_MODEL_NUM_MAX][SCE_FACE_SHAPE_POINT_NUM_MAX] = {
+		//SCE_FACE_SHAPE_MODEL_ID_FRONTAL (0)
+		{1, 2, 3, 4, 5, 6, 7, 0, 9, 10, 11, 12, 13, 14, 15, 8, 17, 18, 19, 20, 20, 22, 23, 24, 25, 25, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 36, 38, 39, 40, 41, 42, 43, 44, 37, 45},
+	};
+
+	SceKernelLwMutexWork _faceMtx;
+	// Guards the pyramid and detection working memory, always taken after _faceMtx
+	SceKernelLwMutexWork _detectMtx;
+
+	LRFace();
+
+	~LRFace();
+
+	static SceInt32 TrackThreadStart(SceSize args, ScePVoid argp);
+
+	SceVoid TrackThread();
+
+	static SceInt32 DetectThreadStart(SceSize args, ScePVoid argp);
+
+	SceVoid DetectThread();
+
+	static SceInt32 ProfileThreadStart(SceSize args, ScePVoid argp);
+
+	// Saves the profile snapshot, the only thread doing file I/O once tracking runs
+	SceVoid ProfileThread();
+
+	SceVoid RequestDetection(const LRFrame *frame);
+
+	// Releases every frame waiting in the detection mailboxes
+	SceVoid FlushDetection();
+
+	// One frame of the EV search, on the detection thread
+	SceVoid CalibrateStep(const LRFrame *frame);
+
+	// Detection score of the frame with the parameters and pyramid level of the EV search,
+	// so that it compares with _evScore. On the detection thread.
+	SceFloat MeasureEvScore(const LRFrame *frame);
+
+	SceVoid FinishCalibration();
+
+	SceVoid LoadProfile();
+
+	// Copies the tracking thread's profile fields to _profileSnapshot
+	SceVoid UpdateProfile();
+
+	// Writes the profile snapshot when it changed, blocks on file I/O
+	SceVoid SaveProfile();
+
+	// Copies _evLevel and _evScore to _evSetting, on the detection thread or before it started
+	SceVoid PublishEvSetting();
+
+	static SceFloat GetMeanLuma(const LRFrame *frame);
+
+	SceVoid AddReacquireAttempt(SceInt32 tier, SceBool hit, SceUInt32 time);
+
+	SceBool DetectLocal(const unsigned char *trackBuffer, const SceFaceDetectionResult *reference, SceFaceDetectionResult *face);
+
+	// sceFacePartsEx() and sceFaceShapeFit() on the ROI crop of a detected face
+	SceBool FitShape(LRFaceTrack *track, const unsigned char *trackBuffer, SceFaceDetectionResult *face);
+
+	// sceFaceShapeTrack() from the track's previous frame to frame
+	SceBool TrackShape(LRFaceTrack *track, const LRFrame *frame);
+
+	// Binds the candidates of a detection to lost faces by overlap, the rest to free slots
+	SceVoid AssignCandidates(const LRDetectResult *detect, const LRFrame *frame);
+
+	// Fits the shape on the detected frame and tracks it on to frame
+	SceBool AcquireFace(LRFaceTrack *track, const LRDetectResult *detect, SceFaceDetectionResult face, const LRFrame *frame);
+
+	// Frees the slot of the newer identity when two tracked shapes ended up on one face
+	SceVoid DropDuplicates();
+
+	SceVoid ReleaseTrack(LRFaceTrack *track);
+
+	// Drops the shapes of every face after their ROI or frame size changed, identities are kept
+	SceVoid ResetTracks();
+
+	// Intersection over union of two rects normalized to the same frame
+	static SceFloat GetOverlap(const SceFaceDetectionResult *a, const SceFaceDetectionResult *b);
+
+	SceVoid AllocWorkMemory();
+
+	// Working memory of every enabled stage that has none yet and whose dictionaries are resident
+	SceVoid AllocStageMemory();
+
+	SceInt32 GetStageWorkSize(SceInt32 stage);
+
+	SceVoid PrintMemoryReport();
+
+	SceVoid FreeWorkMemory();
+
+	const LRPyramidLevel *GetPyramidLevel(const LRFrame *frame, SceInt32 level);
+
+	SceVoid GetRoiOrigin(SceFloat centerX, SceFloat centerY, SceInt32 *roiX, SceInt32 *roiY);
+
+	SceVoid FrameRectToRoi(SceInt32 roiX, SceInt32 roiY, SceFaceDetectionResult *face);
+
+	SceVoid MoveRoi(LRFaceTrack *track, SceInt32 roiX, SceInt32 roiY);
+
+	SceVoid RoiShapeToFrame(const LRFaceTrack *track, const SceFaceShapeResult *src, SceFaceShapeResult *dst);
+
+	// Frame-normalized rect of the track's current shape
+	SceVoid UpdateFrameRect(LRFaceTrack *track);
+
+	// Features and unfiltered LR_FACE_CHANNEL_* values of the track's frame-normalized shape
+	SceVoid ComputeChannels(LRFaceTrack *track);
+
+	SceVoid FilterChannels(LRFaceTrack *track);
+
+	SceVoid ShapeToRect(const SceFaceShapeResult *shape, SceFaceDetectionResult *face);
+
+	// Auxiliary eye openness and gaze stage on the frame the track's shape was tracked in
+	SceVoid UpdateEyes(LRFaceTrack *track, const LRFrame *frame);
+
+	// Centroid of the dark pixels in a box and the share of them, false if the box is flat
+	static SceBool FindPupil(const LRFrame *frame, SceInt32 x0, SceInt32 y0, SceInt32 x1, SceInt32 y1, SceFloat threshold, SceFloat *pupilX, SceFloat *pupilY, SceFloat *dark);
+};
+
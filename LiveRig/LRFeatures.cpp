@@ -0,0 +1,199 @@
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define LR_FEATURES_NEON
+#endif
+
+#include "LRFeatures.hpp"
+
+LRFeatures::LRFeatures() :
+	_simd(true)
+{
+	memset(_weightX, 0, sizeof(_weightX));
+	memset(_weightY, 0, sizeof(_weightY));
+
+	// Same lip pair as the original mouth parameter
+	_weightY[LR_FEATURE_MOUTH_OPEN][43] = 1.0f;
+	_weightY[LR_FEATURE_MOUTH_OPEN][40] = -1.0f;
+
+	_weightX[LR_FEATURE_MOUTH_WIDTH][41] = 1.0f;
+	_weightX[LR_FEATURE_MOUTH_WIDTH][37] = -1.0f;
+
+	// y grows downwards, a raised brow gives a larger value
+	AddMean(_weightY[LR_FEATURE_BROW_L], 8, 15, 1.0f);
+	AddMean(_weightY[LR_FEATURE_BROW_L], 21, 25, -1.0f);
+	AddMean(_weightY[LR_FEATURE_BROW_R], 0, 7, 1.0f);
+	AddMean(_weightY[LR_FEATURE_BROW_R], 16, 20, -1.0f);
+
+	AddMean(_weightY[LR_FEATURE_EYE_L_OPEN], 9, 11, 1.0f);
+	AddMean(_weightY[LR_FEATURE_EYE_L_OPEN], 13, 15, -1.0f);
+	AddMean(_weightY[LR_FEATURE_EYE_R_OPEN], 5, 7, 1.0f);
+	AddMean(_weightY[LR_FEATURE_EYE_R_OPEN], 1, 3, -1.0f);
+
+	_weightX[LR_FEATURE_JAW_X][45] = 1.0f;
+	AddMean(_weightX[LR_FEATURE_JAW_X], 37, 44, -1.0f);
+	_weightY[LR_FEATURE_JAW_Y][45] = 1.0f;
+	AddMean(_weightY[LR_FEATURE_JAW_Y], 37, 44, -1.0f);
+
+	_weightX[ROW_EYE_L_WIDTH][12] = 1.0f;
+	_weightX[ROW_EYE_L_WIDTH][8] = -1.0f;
+	_weightX[ROW_EYE_R_WIDTH][4] = 1.0f;
+	_weightX[ROW_EYE_R_WIDTH][0] = -1.0f;
+}
+
+void LRFeatures::AddMean(float *row, int32_t first, int32_t last, float sign)
+{
+	const float w = sign / (float)(last - first + 1);
+
+	for (int32_t i = first; i <= last; i++)
+		row[i] += w;
+}
+
+void LRFeatures::SetSimd(bool enable)
+{
+	_simd = enable;
+}
+
+bool LRFeatures::Compute(const float *x, const float *y, float aspect, LRFeatureResult *result) const
+{
+	float rx = 0.0f, ry = 0.0f, lx = 0.0f, ly = 0.0f;
+
+	for (int32_t i = 0; i < 8; i++) {
+		rx += x[i];
+		ry += y[i];
+		lx += x[i + 8];
+		ly += y[i + 8];
+	}
+
+	rx *= 0.125f * aspect;
+	ry *= 0.125f;
+	lx *= 0.125f * aspect;
+	ly *= 0.125f;
+
+	const float dx = lx - rx;
+	const float dy = ly - ry;
+	const float scale = sqrtf(dx * dx + dy * dy);
+
+	if (!(scale > 0.0f)) {
+		memset(result, 0, sizeof(LRFeatureResult));
+		return false;
+	}
+
+	result->scale = scale;
+	result->roll = atan2f(dy, dx);
+	result->centerX = (rx + lx) * 0.5f / aspect;
+	result->centerY = (ry + ly) * 0.5f;
+
+	// Rotation by -roll and division by the scale in one matrix
+	const float c = dx / (scale * scale);
+	const float s = dy / (scale * scale);
+
+	float rows[ROW_NUM];
+
+	if (_simd) {
+		NormalizeSimd(x, y, aspect, c, s, result);
+		ApplySimd(result, rows);
+	}
+	else {
+		NormalizeScalar(x, y, aspect, c, s, result);
+		ApplyScalar(result, rows);
+	}
+
+	for (int32_t i = 0; i < LR_FEATURE_NUM; i++)
+		result->value[i] = rows[i];
+
+	// Openness relative to the eye width, a closed eye reads 0 at any distance
+	const float widthL = fabsf(rows[ROW_EYE_L_WIDTH]);
+	const float widthR = fabsf(rows[ROW_EYE_R_WIDTH]);
+	result->value[LR_FEATURE_EYE_L_OPEN] = widthL > 0.0f ? rows[LR_FEATURE_EYE_L_OPEN] / widthL : 0.0f;
+	result->value[LR_FEATURE_EYE_R_OPEN] = widthR > 0.0f ? rows[LR_FEATURE_EYE_R_OPEN] / widthR : 0.0f;
+
+	return true;
+}
+
+void LRFeatures::NormalizeScalar(const float *x, const float *y, float aspect, float c, float s, LRFeatureResult *result) const
+{
+	const float ox = result->centerX * aspect;
+	const float oy = result->centerY;
+
+	for (int32_t i = 0; i < LR_FEATURES_POINT_NUM; i++) {
+		const float px = x[i] * aspect - ox;
+		const float py = y[i] - oy;
+
+		result->x[i] = c * px + s * py;
+		result->y[i] = c * py - s * px;
+	}
+
+	for (int32_t i = LR_FEATURES_POINT_NUM; i < LR_FEATURES_POINT_PAD; i++) {
+		result->x[i] = 0.0f;
+		result->y[i] = 0.0f;
+	}
+}
+
+void LRFeatures::NormalizeSimd(const float *x, const float *y, float aspect, float c, float s, LRFeatureResult *result) const
+{
+#ifdef LR_FEATURES_NEON
+	// The caller's arrays are not padded, stage them so that every load is a full vector
+	memcpy(result->x, x, sizeof(float) * LR_FEATURES_POINT_NUM);
+	memcpy(result->y, y, sizeof(float) * LR_FEATURES_POINT_NUM);
+	for (int32_t i = LR_FEATURES_POINT_NUM; i < LR_FEATURES_POINT_PAD; i++) {
+		result->x[i] = 0.0f;
+		result->y[i] = 0.0f;
+	}
+
+	const float32x4_t vAspect = vdupq_n_f32(aspect);
+	const float32x4_t vOx = vdupq_n_f32(result->centerX * aspect);
+	const float32x4_t vOy = vdupq_n_f32(result->centerY);
+	const float32x4_t vC = vdupq_n_f32(c);
+	const float32x4_t vS = vdupq_n_f32(s);
+
+	for (int32_t i = 0; i < LR_FEATURES_POINT_PAD; i += 4) {
+		const float32x4_t px = vsubq_f32(vmulq_f32(vld1q_f32(result->x + i), vAspect), vOx);
+		const float32x4_t py = vsubq_f32(vld1q_f32(result->y + i), vOy);
+
+		vst1q_f32(result->x + i, vmlaq_f32(vmulq_f32(vC, px), vS, py));
+		vst1q_f32(result->y + i, vmlsq_f32(vmulq_f32(vC, py), vS, px));
+	}
+
+	for (int32_t i = LR_FEATURES_POINT_NUM; i < LR_FEATURES_POINT_PAD; i++) {
+		result->x[i] = 0.0f;
+		result->y[i] = 0.0f;
+	}
+#else
+	NormalizeScalar(x, y, aspect, c, s, result);
+#endif
+}
+
+void LRFeatures::ApplyScalar(LRFeatureResult *result, float *rows) const
+{
+	for (int32_t r = 0; r < ROW_NUM; r++) {
+		float acc = 0.0f;
+
+		for (int32_t i = 0; i < LR_FEATURES_POINT_PAD; i++)
+			acc += _weightX[r][i] * result->x[i] + _weightY[r][i] * result->y[i];
+
+		rows[r] = acc;
+	}
+}
+
+void LRFeatures::ApplySimd(LRFeatureResult *result, float *rows) const
+{
+#ifdef LR_FEATURES_NEON
+	for (int32_t r = 0; r < ROW_NUM; r++) {
+		float32x4_t acc = vdupq_n_f32(0.0f);
+
+		for (int32_t i = 0; i < LR_FEATURES_POINT_PAD; i += 4) {
+			acc = vmlaq_f32(acc, vld1q_f32(&_weightX[r][i]), vld1q_f32(result->x + i));
+			acc = vmlaq_f32(acc, vld1q_f32(&_weightY[r][i]), vld1q_f32(result->y + i));
+		}
+
+		float32x2_t sum = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+		rows[r] = vget_lane_f32(vpadd_f32(sum, sum), 0);
+	}
+#else
+	ApplyScalar(result, rows);
+#endif
+}
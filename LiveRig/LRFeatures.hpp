@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stdint.h>
+
+// Face features from the 46-point frontal shape model.
+//
+// Points are first moved into a face-relative frame: the origin is the midpoint between
+// the eye centers, x runs from the right to the left eye, and one unit is the interocular
+// distance. Features are then independent of face size, position and roll. All features
+// are linear in the normalized points except the eye openness, so they are computed as one
+// weighted sum per feature over the padded point arrays, four points per NEON instruction.
+//
+// Point layout: right eye 0-7 (corners 0, 4, top 1-3, bottom 5-7), left eye 8-15
+// (corners 8, 12, bottom 9-11, top 13-15), right brow 16-20, left brow 21-25, nose 26-36,
+// mouth 37-44 (corners 37, 41), 45 below the mouth.
+//
+// Only depends on the C library so that it can be benchmarked on the host.
+
+#define LR_FEATURES_POINT_NUM		46
+#define LR_FEATURES_POINT_PAD		48
+
+#define LR_FEATURE_MOUTH_OPEN		0	// lip gap
+#define LR_FEATURE_MOUTH_WIDTH		1	// corner to corner
+#define LR_FEATURE_BROW_L			2	// brow above the eye center
+#define LR_FEATURE_BROW_R			3
+#define LR_FEATURE_EYE_L_OPEN		4	// lid gap over eye width
+#define LR_FEATURE_EYE_R_OPEN		5
+#define LR_FEATURE_JAW_X			6	// point 45 relative to the mouth center
+#define LR_FEATURE_JAW_Y			7
+#define LR_FEATURE_NUM				8
+
+struct LRFeatureResult
+{
+	float value[LR_FEATURE_NUM];
+	float scale;	// interocular distance in input units, after aspect correction of x
+	float roll;		// radians, positive when the left eye is lower in the image
+	float centerX;	// midpoint between the eyes in input units
+	float centerY;
+
+	// Roll-compensated points in interocular units, padding points are 0
+	float x[LR_FEATURES_POINT_PAD];
+	float y[LR_FEATURES_POINT_PAD];
+};
+
+class LRFeatures
+{
+public:
+
+	LRFeatures();
+
+	void SetSimd(bool enable);
+
+	// x and y hold LR_FEATURES_POINT_NUM points. aspect is width / height of the image the
+	// points are normalized to, so that both axes use the same unit.
+	// Returns false if the eyes coincide and nothing could be normalized.
+	bool Compute(const float *x, const float *y, float aspect, LRFeatureResult *result) const;
+
+private:
+
+	// Linear rows: the features plus the two eye widths the openness is divided by
+	enum
+	{
+		ROW_EYE_L_WIDTH = LR_FEATURE_NUM,
+		ROW_EYE_R_WIDTH,
+		ROW_NUM
+	};
+
+	float _weightX[ROW_NUM][LR_FEATURES_POINT_PAD];
+	float _weightY[ROW_NUM][LR_FEATURES_POINT_PAD];
+	bool _simd;
+
+	void AddMean(float *row, int32_t first, int32_t last, float sign);
+
+	void NormalizeScalar(const float *x, const float *y, float aspect, float c, float s, LRFeatureResult *result) const;
+
+	void NormalizeSimd(const float *x, const float *y, float aspect, float c, float s, LRFeatureResult *result) const;
+
+	void ApplyScalar(LRFeatureResult *result, float *rows) const;
+
+	void ApplySimd(LRFeatureResult *result, float *rows) const;
+};
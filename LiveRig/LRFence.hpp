@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdint.h>
+
+// Monotonic GPU timeline. Every submitted scene signals the next serial when it
+// completes, serial 0 is never signalled and means "not in use".
+class LRFenceTimeline
+{
+public:
+
+	virtual ~LRFenceTimeline() {}
+
+	// Serial that will be signalled by the scene that is currently being recorded
+	virtual uint32_t GetPendingSerial() = 0;
+
+	virtual uint32_t GetCompletedSerial() = 0;
+
+	virtual void WaitSerial(uint32_t serial) = 0;
+
+	bool IsSerialComplete(uint32_t serial)
+	{
+		return serial == 0 || (int32_t)(GetCompletedSerial() - serial) >= 0;
+	}
+};
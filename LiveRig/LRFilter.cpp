@@ -0,0 +1,304 @@
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define LR_FILTER_NEON
+#endif
+
+#include "LRFilter.hpp"
+
+#define LR_FILTER_TWO_PI		6.2831853f
+// Initial velocity variance of the Kalman filter, relative to the measurement variance
+#define LR_FILTER_KALMAN_VELOCITY_INIT	100.0f
+
+#ifdef LR_FILTER_NEON
+namespace {
+	// Two Newton-Raphson steps on the estimate, close to a division for the ranges used here
+	float32x4_t Recip(float32x4_t d)
+	{
+		float32x4_t r = vrecpeq_f32(d);
+		r = vmulq_f32(vrecpsq_f32(d, r), r);
+		r = vmulq_f32(vrecpsq_f32(d, r), r);
+		return r;
+	}
+}
+#endif
+
+LRFilter::LRFilter() :
+	_simd(true),
+	_primed(false)
+{
+	LRFilterParam param;
+	GetDefaultParam(LR_FILTER_NONE, &param);
+
+	for (int32_t i = 0; i < LR_FILTER_CHANNEL_MAX; i++)
+		SetParam(i, &param);
+
+	float zero[LR_FILTER_CHANNEL_MAX];
+	memset(zero, 0, sizeof(zero));
+	Reset(zero);
+	_primed = false;
+}
+
+void LRFilter::GetDefaultParam(int32_t type, LRFilterParam *param)
+{
+	param->type = type;
+	param->minCutoff = 1.0f;
+	param->beta = 0.05f;
+	param->dCutoff = 1.0f;
+	param->processNoise = 1000.0f;
+	param->measureNoise = 0.25f;
+	param->frequency = 30.0f;
+}
+
+void LRFilter::SetParam(int32_t channel, const LRFilterParam *param)
+{
+	if (channel < 0 || channel >= LR_FILTER_CHANNEL_MAX)
+		return;
+
+	_type[channel] = (param->type >= 0 && param->type < LR_FILTER_TYPE_NUM) ? param->type : LR_FILTER_NONE;
+	_minCutoff[channel] = param->minCutoff;
+	_beta[channel] = param->beta;
+	_dCutoff[channel] = param->dCutoff;
+	_processNoise[channel] = param->processNoise;
+	_measureNoise[channel] = param->measureNoise;
+	_frequency[channel] = param->frequency;
+}
+
+void LRFilter::GetParam(int32_t channel, LRFilterParam *param) const
+{
+	if (channel < 0 || channel >= LR_FILTER_CHANNEL_MAX)
+		return;
+
+	param->type = _type[channel];
+	param->minCutoff = _minCutoff[channel];
+	param->beta = _beta[channel];
+	param->dCutoff = _dCutoff[channel];
+	param->processNoise = _processNoise[channel];
+	param->measureNoise = _measureNoise[channel];
+	param->frequency = _frequency[channel];
+}
+
+void LRFilter::SetSimd(bool enable)
+{
+	_simd = enable;
+}
+
+bool LRFilter::IsPrimed() const
+{
+	return _primed;
+}
+
+void LRFilter::Reset(const float *values)
+{
+	for (int32_t i = 0; i < LR_FILTER_CHANNEL_MAX; i++) {
+		_euroX[i] = values[i];
+		_euroDx[i] = 0.0f;
+		_euroPrev[i] = values[i];
+
+		_kfX[i] = values[i];
+		_kfV[i] = 0.0f;
+		_kfP00[i] = _measureNoise[i];
+		_kfP01[i] = 0.0f;
+		_kfP11[i] = _measureNoise[i] * LR_FILTER_KALMAN_VELOCITY_INIT;
+
+		_springX[i] = values[i];
+		_springV[i] = 0.0f;
+	}
+
+	_primed = true;
+}
+
+void LRFilter::Update(const float *values, float dt, float *out)
+{
+	if (!_primed || dt <= 0.0f) {
+		if (!_primed)
+			Reset(values);
+		if (out != values)
+			memcpy(out, values, sizeof(float) * LR_FILTER_CHANNEL_MAX);
+		return;
+	}
+
+	if (_simd)
+		UpdateSimd(values, dt, out);
+	else
+		UpdateScalar(values, dt, out);
+}
+
+void LRFilter::GetVelocity(float *out) const
+{
+	for (int32_t i = 0; i < LR_FILTER_CHANNEL_MAX; i++) {
+		switch (_type[i]) {
+		case LR_FILTER_ONE_EURO:
+			out[i] = _euroDx[i];
+			break;
+		case LR_FILTER_SPRING:
+			out[i] = _springV[i];
+			break;
+		default:
+			out[i] = _kfV[i];
+			break;
+		}
+	}
+}
+
+void LRFilter::UpdateScalar(const float *values, float dt, float *out)
+{
+	const float invDt = 1.0f / dt;
+	const float dt2 = dt * dt;
+
+	for (int32_t i = 0; i < LR_FILTER_CHANNEL_MAX; i++) {
+		const float x = values[i];
+
+		// One Euro: smoothing factor of a first order low-pass is k / (k + 1), k = 2 pi cutoff dt
+		float k = LR_FILTER_TWO_PI * _dCutoff[i] * dt;
+		float dx = (x - _euroPrev[i]) * invDt;
+		_euroDx[i] += (dx - _euroDx[i]) * (k / (k + 1.0f));
+
+		k = LR_FILTER_TWO_PI * (_minCutoff[i] + _beta[i] * fabsf(_euroDx[i])) * dt;
+		_euroX[i] += (x - _euroX[i]) * (k / (k + 1.0f));
+		_euroPrev[i] = x;
+
+		// Kalman: predict with white noise acceleration, then correct with the measurement
+		const float q = _processNoise[i];
+		const float p00 = _kfP00[i] + dt * (2.0f * _kfP01[i] + dt * _kfP11[i]) + q * dt2 * dt2 * 0.25f;
+		const float p01 = _kfP01[i] + dt * _kfP11[i] + q * dt2 * dt * 0.5f;
+		const float p11 = _kfP11[i] + q * dt2;
+		const float predicted = _kfX[i] + _kfV[i] * dt;
+
+		const float invS = 1.0f / (p00 + _measureNoise[i]);
+		const float k0 = p00 * invS;
+		const float k1 = p01 * invS;
+		const float innovation = x - predicted;
+
+		_kfX[i] = predicted + k0 * innovation;
+		_kfV[i] += k1 * innovation;
+		_kfP00[i] = p00 - k0 * p00;
+		_kfP01[i] = p01 - k0 * p01;
+		_kfP11[i] = p11 - k1 * p01;
+
+		// Spring: closed form step of the critically damped oscillator, stable for any dt.
+		// exp(-h) is taken as 1 / (1 + h + h^2/2 + h^3/6 + h^4/24), which stays in (0, 1].
+		const float w = _frequency[i];
+		const float h = w * dt;
+		const float decay = 1.0f / (1.0f + h * (1.0f + h * (0.5f + h * (1.0f / 6.0f + h * (1.0f / 24.0f)))));
+		const float e = _springX[i] - x;
+		const float c = _springV[i] + w * e;
+
+		_springX[i] = x + (e + c * dt) * decay;
+		_springV[i] = (_springV[i] - w * c * dt) * decay;
+
+		switch (_type[i]) {
+		case LR_FILTER_ONE_EURO:
+			out[i] = _euroX[i];
+			break;
+		case LR_FILTER_KALMAN:
+			out[i] = _kfX[i];
+			break;
+		case LR_FILTER_SPRING:
+			out[i] = _springX[i];
+			break;
+		default:
+			out[i] = x;
+			break;
+		}
+	}
+}
+
+void LRFilter::UpdateSimd(const float *values, float dt, float *out)
+{
+#ifdef LR_FILTER_NEON
+	const float32x4_t vDt = vdupq_n_f32(dt);
+	const float32x4_t vInvDt = Recip(vDt);
+	const float32x4_t vDt2 = vdupq_n_f32(dt * dt);
+	const float32x4_t vOne = vdupq_n_f32(1.0f);
+	const float32x4_t vTwoPiDt = vdupq_n_f32(LR_FILTER_TWO_PI * dt);
+	const float32x4_t vHalf = vdupq_n_f32(0.5f);
+	const float32x4_t vSixth = vdupq_n_f32(1.0f / 6.0f);
+	const float32x4_t vTwentyFourth = vdupq_n_f32(1.0f / 24.0f);
+	const int32x4_t vEuro = vdupq_n_s32(LR_FILTER_ONE_EURO);
+	const int32x4_t vKalman = vdupq_n_s32(LR_FILTER_KALMAN);
+	const int32x4_t vSpring = vdupq_n_s32(LR_FILTER_SPRING);
+
+	for (int32_t i = 0; i < LR_FILTER_CHANNEL_MAX; i += 4) {
+		const float32x4_t x = vld1q_f32(values + i);
+
+		// One Euro
+		float32x4_t k = vmulq_f32(vTwoPiDt, vld1q_f32(_dCutoff + i));
+		float32x4_t dx = vmulq_f32(vsubq_f32(x, vld1q_f32(_euroPrev + i)), vInvDt);
+		float32x4_t edx = vld1q_f32(_euroDx + i);
+		edx = vmlaq_f32(edx, vsubq_f32(dx, edx), vmulq_f32(k, Recip(vaddq_f32(k, vOne))));
+
+		float32x4_t cutoff = vmlaq_f32(vld1q_f32(_minCutoff + i), vld1q_f32(_beta + i), vabsq_f32(edx));
+		k = vmulq_f32(vTwoPiDt, cutoff);
+		float32x4_t ex = vld1q_f32(_euroX + i);
+		ex = vmlaq_f32(ex, vsubq_f32(x, ex), vmulq_f32(k, Recip(vaddq_f32(k, vOne))));
+
+		vst1q_f32(_euroDx + i, edx);
+		vst1q_f32(_euroX + i, ex);
+		vst1q_f32(_euroPrev + i, x);
+
+		// Kalman
+		const float32x4_t q = vld1q_f32(_processNoise + i);
+		const float32x4_t qDt2 = vmulq_f32(q, vDt2);
+		float32x4_t p00 = vld1q_f32(_kfP00 + i);
+		float32x4_t p01 = vld1q_f32(_kfP01 + i);
+		float32x4_t p11 = vld1q_f32(_kfP11 + i);
+
+		p00 = vmlaq_f32(p00, vDt, vmlaq_f32(vaddq_f32(p01, p01), vDt, p11));
+		p00 = vmlaq_f32(p00, qDt2, vmulq_n_f32(vDt2, 0.25f));
+		p01 = vmlaq_f32(p01, vDt, p11);
+		p01 = vmlaq_f32(p01, qDt2, vmulq_n_f32(vDt, 0.5f));
+		p11 = vaddq_f32(p11, qDt2);
+
+		float32x4_t kfV = vld1q_f32(_kfV + i);
+		const float32x4_t predicted = vmlaq_f32(vld1q_f32(_kfX + i), kfV, vDt);
+
+		const float32x4_t invS = Recip(vaddq_f32(p00, vld1q_f32(_measureNoise + i)));
+		const float32x4_t k0 = vmulq_f32(p00, invS);
+		const float32x4_t k1 = vmulq_f32(p01, invS);
+		const float32x4_t innovation = vsubq_f32(x, predicted);
+
+		const float32x4_t kfX = vmlaq_f32(predicted, k0, innovation);
+		kfV = vmlaq_f32(kfV, k1, innovation);
+
+		vst1q_f32(_kfX + i, kfX);
+		vst1q_f32(_kfV + i, kfV);
+		vst1q_f32(_kfP00 + i, vmlsq_f32(p00, k0, p00));
+		vst1q_f32(_kfP01 + i, vmlsq_f32(p01, k0, p01));
+		vst1q_f32(_kfP11 + i, vmlsq_f32(p11, k1, p01));
+
+		// Spring
+		const float32x4_t w = vld1q_f32(_frequency + i);
+		const float32x4_t h = vmulq_f32(w, vDt);
+		float32x4_t poly = vmlaq_f32(vSixth, h, vTwentyFourth);
+		poly = vmlaq_f32(vHalf, h, poly);
+		poly = vmlaq_f32(vOne, h, poly);
+		poly = vmlaq_f32(vOne, h, poly);
+		const float32x4_t decay = Recip(poly);
+
+		float32x4_t sv = vld1q_f32(_springV + i);
+		const float32x4_t e = vsubq_f32(vld1q_f32(_springX + i), x);
+		const float32x4_t c = vmlaq_f32(sv, w, e);
+
+		const float32x4_t sx = vmlaq_f32(x, vmlaq_f32(e, c, vDt), decay);
+		sv = vmulq_f32(vmlsq_f32(sv, vmulq_f32(w, c), vDt), decay);
+
+		vst1q_f32(_springV + i, sv);
+		vst1q_f32(_springX + i, sx);
+
+		// Pick the output of the configured filter, unfiltered for LR_FILTER_NONE
+		const int32x4_t type = vld1q_s32(_type + i);
+		float32x4_t result = x;
+		result = vbslq_f32(vceqq_s32(type, vEuro), ex, result);
+		result = vbslq_f32(vceqq_s32(type, vKalman), kfX, result);
+		result = vbslq_f32(vceqq_s32(type, vSpring), sx, result);
+
+		vst1q_f32(out + i, result);
+	}
+#else
+	UpdateScalar(values, dt, out);
+#endif
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stdint.h>
+
+// Temporal filters for the tracking output channels.
+//
+// Every channel runs one of the filters below with its own parameters. The state of all
+// channels is kept in structure-of-arrays form and every filter is stepped for all channels
+// in one pass, four channels per NEON instruction. The per-channel type only selects which
+// filter output is used, so switching the type of a channel does not need a reset.
+//
+// LR_FILTER_ONE_EURO	low-pass whose cutoff rises with speed: smooth at rest, little lag in motion
+// LR_FILTER_KALMAN		constant velocity Kalman filter
+// LR_FILTER_SPRING		critically damped spring pulled towards the measurement
+//
+// The NEON path matches the scalar one within float rounding, the reciprocals are refined
+// estimates instead of divisions. Only depends on the C library so that recorded channels
+// can be filtered and compared on the host.
+
+#define LR_FILTER_NONE			0
+#define LR_FILTER_ONE_EURO		1
+#define LR_FILTER_KALMAN		2
+#define LR_FILTER_SPRING		3
+#define LR_FILTER_TYPE_NUM		4
+
+#define LR_FILTER_CHANNEL_MAX	12
+
+struct LRFilterParam
+{
+	int32_t type;
+	float minCutoff;	// One Euro, cutoff at rest in Hz
+	float beta;			// One Euro, cutoff increase in Hz per unit/s of speed
+	float dCutoff;		// One Euro, cutoff of the speed estimate in Hz
+	float processNoise;	// Kalman, acceleration variance in (unit/s^2)^2
+	float measureNoise;	// Kalman, measurement variance in unit^2
+	float frequency;	// Spring, natural frequency in rad/s
+};
+
+class LRFilter
+{
+public:
+
+	LRFilter();
+
+	static void GetDefaultParam(int32_t type, LRFilterParam *param);
+
+	void SetParam(int32_t channel, const LRFilterParam *param);
+
+	void GetParam(int32_t channel, LRFilterParam *param) const;
+
+	void SetSimd(bool enable);
+
+	// Starts every channel at values[] with zero speed
+	void Reset(const float *values);
+
+	bool IsPrimed() const;
+
+	// Filters one measurement per channel taken dt seconds after the previous one.
+	// values and out hold LR_FILTER_CHANNEL_MAX entries and may be the same array.
+	void Update(const float *values, float dt, float *out);
+
+	// Rate of change per second of every channel as estimated by its filter, the Kalman
+	// estimate for LR_FILTER_NONE
+	void GetVelocity(float *out) const;
+
+private:
+
+	int32_t _type[LR_FILTER_CHANNEL_MAX];
+	float _minCutoff[LR_FILTER_CHANNEL_MAX];
+	float _beta[LR_FILTER_CHANNEL_MAX];
+	float _dCutoff[LR_FILTER_CHANNEL_MAX];
+	float _processNoise[LR_FILTER_CHANNEL_MAX];
+	float _measureNoise[LR_FILTER_CHANNEL_MAX];
+	float _frequency[LR_FILTER_CHANNEL_MAX];
+
+	// One Euro: filtered value, filtered speed, previous measurement
+	float _euroX[LR_FILTER_CHANNEL_MAX];
+	float _euroDx[LR_FILTER_CHANNEL_MAX];
+	float _euroPrev[LR_FILTER_CHANNEL_MAX];
+
+	// Kalman: position, velocity and the symmetric 2x2 covariance
+	float _kfX[LR_FILTER_CHANNEL_MAX];
+	float _kfV[LR_FILTER_CHANNEL_MAX];
+	float _kfP00[LR_FILTER_CHANNEL_MAX];
+	float _kfP01[LR_FILTER_CHANNEL_MAX];
+	float _kfP11[LR_FILTER_CHANNEL_MAX];
+
+	// Spring: position and velocity
+	float _springX[LR_FILTER_CHANNEL_MAX];
+	float _springV[LR_FILTER_CHANNEL_MAX];
+
+	bool _simd;
+	bool _primed;
+
+	void UpdateScalar(const float *values, float dt, float *out);
+
+	void UpdateSimd(const float *values, float dt, float *out);
+};
@@ -0,0 +1,241 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+#include "LRFence.hpp"
+
+// Single-producer, multi-consumer ring of luma frames.
+//
+// The producer fills the slot returned by BeginWrite() and publishes it with
+// EndWrite(). Consumers take a reference to the newest published slot with
+// AcquireLatest() and hand it back with Release(). A slot is recycled only when
+// it is neither the latest one nor referenced, so the producer never waits as long
+// as N >= 2 + frames held by consumers at once, and nothing is copied on the consumer side.
+//
+// Slots can also be sampled by the GPU. AcquireForGpu() stamps the latest slot with the
+// serial of the scene being recorded instead of taking a reference, and the producer
+// prefers slots whose last scene already completed, waiting for it only if it has to.
+//
+// Only depends on <atomic> so that it can be driven by a synthetic producer on the host.
+
+struct LRFrame
+{
+	unsigned char *data;
+	int32_t width;
+	int32_t height;
+	int32_t pitch;
+	uint64_t frame;		// camera frame number (qwFrame)
+	uint64_t timestamp;	// camera timestamp (qwTimestamp)
+	uint64_t captureTime;	// process time in microseconds when the frame was published
+	uint32_t seq;		// ring sequence number, increases by one per published frame
+};
+
+template <int N>
+class LRFrameRing
+{
+public:
+
+	LRFrameRing() :
+		_latest(-1),
+		_timeline(NULL),
+		_writing(-1),
+		_next(0),
+		_seq(0),
+		_fenceWaitCount(0)
+	{
+		_resetSeq.store(0);
+
+		for (int i = 0; i < N; i++) {
+			_slots[i].data = NULL;
+			_slots[i].width = 0;
+			_slots[i].height = 0;
+			_slots[i].pitch = 0;
+			_slots[i].frame = 0;
+			_slots[i].timestamp = 0;
+			_slots[i].captureTime = 0;
+			_slots[i].seq = 0;
+			_refs[i].store(0);
+			_fence[i].store(0);
+		}
+	}
+
+	void SetTimeline(LRFenceTimeline *timeline)
+	{
+		_timeline = timeline;
+	}
+
+	// Not thread safe, must be called before the ring is shared or after everything is released.
+	void SetBuffer(int index, unsigned char *data, int32_t width, int32_t height, int32_t pitch)
+	{
+		_slots[index].data = data;
+		_slots[index].width = width;
+		_slots[index].height = height;
+		_slots[index].pitch = pitch;
+	}
+
+	void Reset()
+	{
+		for (int i = 0; i < N; i++)
+			_fence[i].store(0);
+
+		// Frames published before this point refer to buffers that may be gone
+		_resetSeq.store(_seq);
+
+		_latest.store(-1);
+		_writing = -1;
+		_next = 0;
+	}
+
+	// Producer side
+
+	LRFrame *BeginWrite()
+	{
+		int latest = _latest.load();
+		int candidate = -1;
+
+		for (int i = 0; i < N; i++) {
+			int idx = (_next + i) % N;
+			if (idx == latest || _refs[idx].load() != 0)
+				continue;
+
+			if (_timeline == NULL || _timeline->IsSerialComplete(_fence[idx].load())) {
+				candidate = idx;
+				break;
+			}
+
+			if (candidate < 0)
+				candidate = idx;
+		}
+
+		if (candidate < 0)
+			return NULL;
+
+		// Every free slot is still being sampled, wait for the oldest candidate
+		uint32_t fence = _fence[candidate].load();
+		if (_timeline != NULL && !_timeline->IsSerialComplete(fence)) {
+			_fenceWaitCount++;
+			_timeline->WaitSerial(fence);
+		}
+
+		_writing = candidate;
+		_next = (candidate + 1) % N;
+
+		return &_slots[candidate];
+	}
+
+	void EndWrite(uint64_t frame, uint64_t timestamp, uint64_t captureTime = 0)
+	{
+		if (_writing < 0)
+			return;
+
+		_slots[_writing].frame = frame;
+		_slots[_writing].timestamp = timestamp;
+		_slots[_writing].captureTime = captureTime;
+		_slots[_writing].seq = ++_seq;
+
+		_latest.store(_writing);
+		_writing = -1;
+	}
+
+	void CancelWrite()
+	{
+		_writing = -1;
+	}
+
+	// Latest published slot, only safe to read from the producer thread.
+	const LRFrame *PeekLatest() const
+	{
+		int idx = _latest.load();
+		if (idx < 0)
+			return NULL;
+
+		return &_slots[idx];
+	}
+
+	// Number of BeginWrite() calls that had to wait for the GPU
+	uint32_t GetFenceWaitCount() const
+	{
+		return _fenceWaitCount;
+	}
+
+	// Consumer side
+
+	const LRFrame *AcquireLatest()
+	{
+		while (1) {
+			int idx = _latest.load();
+			if (idx < 0)
+				return NULL;
+
+			_refs[idx].fetch_add(1);
+
+			// The producer may have recycled the slot between the load and the increment
+			if (_latest.load() == idx)
+				return &_slots[idx];
+
+			_refs[idx].fetch_sub(1);
+		}
+	}
+
+	// Takes an additional reference on a frame the caller already holds.
+	void Retain(const LRFrame *frame)
+	{
+		if (frame != NULL)
+			_refs[frame - _slots].fetch_add(1);
+	}
+
+	void Release(const LRFrame *frame)
+	{
+		if (frame != NULL)
+			_refs[frame - _slots].fetch_sub(1);
+	}
+
+	uint32_t GetRefCount(int index) const
+	{
+		return _refs[index].load();
+	}
+
+	// False for frames that were published before the last Reset()
+	bool IsValid(const LRFrame *frame) const
+	{
+		return (int32_t)(frame->seq - _resetSeq.load()) > 0;
+	}
+
+	int GetIndex(const LRFrame *frame) const
+	{
+		return (int)(frame - _slots);
+	}
+
+	// Latest slot for a scene that is being recorded, must be called from the render thread
+	const LRFrame *AcquireForGpu()
+	{
+		while (1) {
+			int idx = _latest.load();
+			if (idx < 0 || _timeline == NULL)
+				return idx < 0 ? NULL : &_slots[idx];
+
+			_fence[idx].store(_timeline->GetPendingSerial());
+
+			// If the producer moved on, the stale stamp only costs it a redundant wait
+			if (_latest.load() == idx)
+				return &_slots[idx];
+		}
+	}
+
+private:
+
+	LRFrame _slots[N];
+	std::atomic<uint32_t> _refs[N];
+	std::atomic<uint32_t> _fence[N];
+	std::atomic<int> _latest;
+	std::atomic<uint32_t> _resetSeq;
+	LRFenceTimeline *_timeline;
+
+	// producer only
+	int _writing;
+	int _next;
+	uint32_t _seq;
+	uint32_t _fenceWaitCount;
+};
@@ -1,4 +1,5 @@
 #include <stdlib.h>
+#include <stdio.h>
 #include <kernel.h>
 #include <display.h>
 #include <gxm.h>
@@ -9,6 +10,8 @@
 #include "LRGXM.hpp"
 #include "LRUtil.hpp"
 
+#define LR_GXM_NOTIFICATION_SCENE	0
+
 namespace {
 	LRGXM *s_instance = SCE_NULL;
 }
@@ -33,8 +36,14 @@ SceVoid LRGXM::ReleaseInstance()
 	s_instance = SCE_NULL;
 }
 
-LRGXM::LRGXM()
+LRGXM::LRGXM() :
+	_sceneSerial(0)
 {
+	_sceneNotification.address = SCE_NULL;
+	_sceneNotification.value = 0;
+
+	sceKernelCreateLwMutex(&_latencyMtx, "LRGXM:LatencyMtx", 0, 0, NULL);
+
 	s_instance = this;
 }
 
@@ -365,6 +374,9 @@ SceInt32 LRGXM::Init(InitParams *params)
 
 	sceGxmSetViewportEnable(immContext, SCE_GXM_VIEWPORT_ENABLED);
 
+	_sceneNotification.address = sceGxmGetNotificationRegion() + LR_GXM_NOTIFICATION_SCENE;
+	*_sceneNotification.address = 0;
+
 	vita2d_init_param_external v2dParam;
 	sceClibMemset(&v2dParam, 0, sizeof(vita2d_init_param_external));
 	v2dParam.imm_context = immContext;
@@ -406,6 +418,13 @@ void LRGXM::DisplayCallback(const void *callbackData)
 	sceDisplaySetFrameBuf(&framebuf, SCE_DISPLAY_UPDATETIMING_NEXTVSYNC);
 
 	sceDisplayWaitVblankStart();
+
+	// The new frame starts scanning out now
+	SceUInt64 flip = sceKernelGetProcessTimeWide();
+
+	sceKernelLockLwMutex(&s_instance->_latencyMtx, 1, NULL);
+	s_instance->_latency.Record(&arg->stamps, flip);
+	sceKernelUnlockLwMutex(&s_instance->_latencyMtx, 1);
 }
 
 void *LRGXM::PatcherHostAlloc(void *user_data, uint32_t size)
@@ -436,7 +455,9 @@ SceVoid LRGXM::StartScene()
 
 SceVoid LRGXM::EndScene()
 {
-	sceGxmEndScene(immContext, NULL, NULL);
+	_sceneSerial++;
+	_sceneNotification.value = _sceneSerial;
+	sceGxmEndScene(immContext, NULL, &_sceneNotification);
 }
 
 SceVoid LRGXM::UpdateCommonDialog()
@@ -457,7 +478,7 @@ SceVoid LRGXM::UpdateCommonDialog()
 	sceCommonDialogUpdate(&updateParam);
 }
 
-SceVoid LRGXM::EndRendering()
+SceVoid LRGXM::EndRendering(const LRLatencyStamps *stamps)
 {
 	sceGxmPadHeartbeat(&displayColorSurface[_bufferIndex], displayBufferSync[_bufferIndex]);
 
@@ -465,6 +486,13 @@ SceVoid LRGXM::EndRendering()
 
 	DisplayCallbackArg displayData;
 	displayData.address = displayBufferData[_bufferIndex];
+	if (stamps != SCE_NULL) {
+		displayData.stamps = *stamps;
+		displayData.stamps.submit = sceKernelGetProcessTimeWide();
+	}
+	else {
+		sceClibMemset(&displayData.stamps, 0, sizeof(LRLatencyStamps));
+	}
 	sceGxmDisplayQueueAddEntry(
 		displayBufferSync[oldFb],
 		displayBufferSync[_bufferIndex],
@@ -473,6 +501,55 @@ SceVoid LRGXM::EndRendering()
 	_bufferIndex = (_bufferIndex + 1) % 2;
 }
 
+SceVoid LRGXM::GetLatencyHistogram(SceInt32 stage, LRHistogram *histogram)
+{
+	sceKernelLockLwMutex(&_latencyMtx, 1, NULL);
+	const LRHistogram *src = _latency.GetHistogram(stage);
+	if (src != SCE_NULL)
+		*histogram = *src;
+	sceKernelUnlockLwMutex(&_latencyMtx, 1);
+}
+
+SceInt32 LRGXM::DumpLatency(const char *path)
+{
+	FILE *fp = fopen(path, "w");
+	if (fp == NULL) {
+		SCE_DBG_LOG_ERROR("[LRGXM] failed to open %s for latency dump\n", path);
+		return -1;
+	}
+
+	sceKernelLockLwMutex(&_latencyMtx, 1, NULL);
+	_latency.Dump(fp);
+	sceKernelUnlockLwMutex(&_latencyMtx, 1);
+
+	fclose(fp);
+
+	return 0;
+}
+
+SceUInt64 LRGXM::GetDisplayDelay()
+{
+	sceKernelLockLwMutex(&_latencyMtx, 1, NULL);
+	const LRHistogram *render = _latency.GetHistogram(LR_LATENCY_STAGE_RENDER);
+	const LRHistogram *display = _latency.GetHistogram(LR_LATENCY_STAGE_DISPLAY);
+	SceUInt64 delay = render->GetPercentile(50.0f) + display->GetPercentile(50.0f);
+	SceBool measured = display->GetCount() > 0;
+	sceKernelUnlockLwMutex(&_latencyMtx, 1);
+
+	// One refresh until the first frame was displayed
+	if (!measured)
+		delay = 1000000 / 60;
+
+	return delay;
+}
+
+SceVoid LRGXM::ResetLatency()
+{
+	sceKernelLockLwMutex(&_latencyMtx, 1, NULL);
+	_latency.Reset();
+	sceKernelUnlockLwMutex(&_latencyMtx, 1);
+}
+
 SceInt32 LRGXM::GetDisplayIndex()
 {
 	return _bufferIndex;
@@ -481,4 +558,23 @@ SceInt32 LRGXM::GetDisplayIndex()
 SceVoid LRGXM::WaitRenderingDone()
 {
 	sceGxmFinish(immContext);
+}
+
+uint32_t LRGXM::GetPendingSerial()
+{
+	return _sceneSerial + 1;
+}
+
+uint32_t LRGXM::GetCompletedSerial()
+{
+	if (_sceneNotification.address == SCE_NULL)
+		return _sceneSerial;
+
+	return *_sceneNotification.address;
+}
+
+SceVoid LRGXM::WaitSerial(uint32_t serial)
+{
+	while (!IsSerialComplete(serial))
+		sceKernelDelayThread(200);
 }
\ No newline at end of file
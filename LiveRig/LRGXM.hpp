@@ -3,11 +3,14 @@
 #include <kernel.h>
 #include <gxm.h>
 
+#include "LRFence.hpp"
+#include "LRLatency.hpp"
+
 static const SceInt32 displayWidth = 960;
 static const SceInt32 displayHeight = 544;
 static const SceInt32 displayStride = 960;
 
-class LRGXM
+class LRGXM : public LRFenceTimeline
 {
 public:
 
@@ -39,7 +42,8 @@ public:
 
 	SceVoid StartScene();
 
-	SceVoid EndRendering();
+	// Queues the frame for display, stamps are carried to the flip and recorded in the latency histograms
+	SceVoid EndRendering(const LRLatencyStamps *stamps = SCE_NULL);
 
 	SceVoid UpdateCommonDialog();
 
@@ -49,11 +53,27 @@ public:
 
 	SceVoid WaitRenderingDone();
 
+	uint32_t GetPendingSerial();
+
+	uint32_t GetCompletedSerial();
+
+	SceVoid WaitSerial(uint32_t serial);
+
+	SceVoid GetLatencyHistogram(SceInt32 stage, LRHistogram *histogram);
+
+	SceInt32 DumpLatency(const char *path);
+
+	SceVoid ResetLatency();
+
+	// Typical time from the model update to the flip of the frame being built, in microseconds
+	SceUInt64 GetDisplayDelay();
+
 private:
 
 	struct DisplayCallbackArg
 	{
 		void* address;
+		LRLatencyStamps stamps;
 	};
 
 	SceGxmValidRegion _validRegion;
@@ -71,6 +91,14 @@ private:
 
 	uint32_t _bufferIndex;
 
+	// Signalled with the scene serial when fragment processing of a scene completes
+	SceGxmNotification _sceneNotification;
+	uint32_t _sceneSerial;
+
+	// Written from the display queue thread at every flip
+	LRLatency _latency;
+	SceKernelLwMutexWork _latencyMtx;
+
 	LRGXM();
 
 	~LRGXM();
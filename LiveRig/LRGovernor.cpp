@@ -0,0 +1,242 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "LRGovernor.hpp"
+
+// Tier 0 is what the tracker used before it had a governor
+static const LRGovernorTier s_tier[LR_GOVERNOR_TIER_NUM] =
+{
+	{ 2, 0.841f, true, 1, 1, 2, 4 },
+	{ 2, 0.841f, false, 1, 1, 2, 8 },
+	{ 3, 0.775f, false, 2, 1, 3, 0 },
+	{ 4, 0.707f, false, 2, 2, 4, 0 },
+};
+
+// Budgets as a share of the camera frame interval
+static const float s_frameBudget = 0.8f;
+static const float s_detectBudget = 4.0f;
+
+static const float s_frameAlpha = 0.1f;
+static const float s_detectAlpha = 0.3f;
+static const float s_stageAlpha = 0.1f;
+
+static const float s_downLoad = 1.0f;
+// Load the tier above is expected to have when stepping up
+static const float s_upLoad = 0.85f;
+
+// Relative tier cost before it was measured, and its limits
+static const float s_tierScaleDefault = 1.5f;
+static const float s_tierScaleMin = 1.05f;
+static const float s_tierScaleMax = 3.0f;
+
+// In camera frames. The hold lets the smoothed load settle on the new tier.
+static const int32_t s_holdFrames = 30;
+static const int32_t s_upWaitMin = 60;
+static const int32_t s_upWaitMax = 960;
+static const int32_t s_upStableFrames = 150;
+
+static const float s_intervalMin = 8000.0f;
+static const float s_intervalMax = 100000.0f;
+static const float s_intervalDefault = 33333.0f;
+
+LRGovernor::LRGovernor() :
+	_tier(0),
+	_fixedTier(-1),
+	_upWait(s_upWaitMin),
+	_sinceUp(s_upStableFrames),
+	_downCount(0),
+	_upCount(0)
+{
+	for (int32_t i = 0; i < LR_GOVERNOR_TIER_NUM; i++)
+		_tierScale[i] = s_tierScaleDefault;
+
+	ResetLoad();
+}
+
+const LRGovernorTier *LRGovernor::GetTierParam(int32_t tier)
+{
+	if (tier < 0)
+		tier = 0;
+	else if (tier >= LR_GOVERNOR_TIER_NUM)
+		tier = LR_GOVERNOR_TIER_NUM - 1;
+
+	return &s_tier[tier];
+}
+
+int32_t LRGovernor::GetTier() const
+{
+	return _tier;
+}
+
+void LRGovernor::SetFixedTier(int32_t tier)
+{
+	if (tier >= LR_GOVERNOR_TIER_NUM)
+		tier = LR_GOVERNOR_TIER_NUM - 1;
+
+	_fixedTier = tier;
+
+	if (tier >= 0)
+		_tier = tier;
+
+	ResetLoad();
+}
+
+void LRGovernor::ResetLoad()
+{
+	_prevFrameTime = 0;
+	_frameInterval = s_intervalDefault;
+	_frameTime = 0;
+
+	_frameLoad = 0.0f;
+	_detectLoad = 0.0f;
+	_load = 0.0f;
+
+	for (int32_t i = 0; i < LR_GOVERNOR_STAGE_NUM; i++) {
+		_stageTime[i] = 0.0f;
+		_stageValid[i] = false;
+	}
+
+	_holdFrames = s_holdFrames;
+	_headroomFrames = 0;
+	_switchFrom = -1;
+	_switchLoad = 0.0f;
+}
+
+void LRGovernor::BeginFrame(uint64_t time)
+{
+	if (_prevFrameTime != 0 && time > _prevFrameTime) {
+		float interval = (float)(time - _prevFrameTime);
+		if (interval < s_intervalMin)
+			interval = s_intervalMin;
+		else if (interval > s_intervalMax)
+			interval = s_intervalMax;
+
+		_frameInterval += (interval - _frameInterval) * s_frameAlpha;
+	}
+
+	_prevFrameTime = time;
+	_frameTime = 0;
+}
+
+void LRGovernor::AddStageTime(int32_t stage, uint32_t time)
+{
+	if (_stageValid[stage]) {
+		_stageTime[stage] += ((float)time - _stageTime[stage]) * s_stageAlpha;
+	}
+	else {
+		_stageTime[stage] = (float)time;
+		_stageValid[stage] = true;
+	}
+
+	// Detections run on their own thread and have their own budget
+	if (stage == LR_GOVERNOR_STAGE_DETECT) {
+		const float load = (float)time / (_frameInterval * s_detectBudget);
+		_detectLoad += (load - _detectLoad) * s_detectAlpha;
+	}
+	else {
+		_frameTime += time;
+	}
+}
+
+bool LRGovernor::FitsFrame(int32_t stage) const
+{
+	if (!_stageValid[stage])
+		return true;
+
+	return (float)_frameTime + _stageTime[stage] <= _frameInterval * s_frameBudget;
+}
+
+void LRGovernor::EndFrame(bool detecting)
+{
+	const float frameLoad = (float)_frameTime / (_frameInterval * s_frameBudget);
+	_frameLoad += (frameLoad - _frameLoad) * s_frameAlpha;
+
+	_load = _frameLoad;
+	if (detecting && _detectLoad > _load)
+		_load = _detectLoad;
+
+	if (_sinceUp < s_upStableFrames) {
+		// The tier above held long enough, the next attempt need not wait longer
+		if (++_sinceUp == s_upStableFrames)
+			_upWait = s_upWaitMin;
+	}
+
+	if (_fixedTier >= 0)
+		return;
+
+	if (_holdFrames > 0) {
+		_holdFrames--;
+		return;
+	}
+
+	// Settled on the new tier, compare with the load before the switch
+	if (_switchFrom >= 0) {
+		const int32_t upper = _switchFrom < _tier ? _switchFrom : _tier;
+		const float upperLoad = upper == _switchFrom ? _switchLoad : _load;
+		const float lowerLoad = upper == _switchFrom ? _load : _switchLoad;
+
+		if (lowerLoad > 0.0f) {
+			float scale = upperLoad / lowerLoad;
+			if (scale < s_tierScaleMin)
+				scale = s_tierScaleMin;
+			else if (scale > s_tierScaleMax)
+				scale = s_tierScaleMax;
+			_tierScale[upper] = scale;
+		}
+
+		_switchFrom = -1;
+	}
+
+	if (_load > s_downLoad) {
+		_headroomFrames = 0;
+
+		if (_tier < LR_GOVERNOR_TIER_NUM - 1) {
+			// Overloaded right after stepping up, back off for longer before trying again
+			if (_sinceUp < s_upStableFrames) {
+				_upWait *= 2;
+				if (_upWait > s_upWaitMax)
+					_upWait = s_upWaitMax;
+				_sinceUp = s_upStableFrames;
+			}
+
+			SetTier(_tier + 1);
+			_downCount++;
+		}
+	}
+	else if (_tier > 0 && _load * _tierScale[_tier - 1] < s_upLoad) {
+		if (++_headroomFrames >= _upWait) {
+			SetTier(_tier - 1);
+			_upCount++;
+			_sinceUp = 0;
+		}
+	}
+	else {
+		_headroomFrames = 0;
+	}
+}
+
+void LRGovernor::SetTier(int32_t tier)
+{
+	_switchFrom = _tier;
+	_switchLoad = _load;
+
+	_tier = tier;
+	_holdFrames = s_holdFrames;
+	_headroomFrames = 0;
+}
+
+void LRGovernor::GetStats(LRGovernorStats *stats) const
+{
+	memset(stats, 0, sizeof(LRGovernorStats));
+
+	stats->tier = _tier;
+	stats->load = _load;
+	stats->frameLoad = _frameLoad;
+	stats->detectLoad = _detectLoad;
+	stats->budget = (uint32_t)(_frameInterval * s_frameBudget);
+	stats->downCount = _downCount;
+	stats->upCount = _upCount;
+
+	for (int32_t i = 0; i < LR_GOVERNOR_STAGE_NUM; i++)
+		stats->stageTime[i] = (uint32_t)_stageTime[i];
+}
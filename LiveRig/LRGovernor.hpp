@@ -0,0 +1,112 @@
+#pragma once
+
+#include <stdint.h>
+
+// Picks the face tracking quality tier from the time the tracking stages take.
+//
+// The tracking thread reports the time of every stage it ran for a camera frame, the
+// detection thread's time arrives with its results. Both are compared against a budget
+// derived from the camera frame interval: one frame for the tracking thread, a few frames
+// for a detection. The load is smoothed so that single slow frames do not switch tiers.
+//
+// An overloaded tier steps down one tier at a time, with a pause after every switch for the
+// load to settle. The load before and after a switch gives the cost of one tier relative to
+// the next, and a tier steps back up after a longer stretch in which the tier above would
+// have fit. If the tier above overloads again right away, the wait before the next attempt
+// doubles.
+//
+// Only depends on the C library so that recorded stage times can be replayed on the host.
+
+#define LR_GOVERNOR_STAGE_TRACK		0	// shape tracking from the previous frame
+#define LR_GOVERNOR_STAGE_LOCAL		1	// local search around the last rect
+#define LR_GOVERNOR_STAGE_FIT		2	// parts and shape fit of a new face
+#define LR_GOVERNOR_STAGE_EYES		3	// eye openness and gaze
+#define LR_GOVERNOR_STAGE_DETECT	4	// one request on the detection thread
+#define LR_GOVERNOR_STAGE_NUM		5
+
+#define LR_GOVERNOR_TIER_NUM		4	// 0 is the best quality
+
+struct LRGovernorTier
+{
+	int32_t detectScanStep;		// full detection, pixels between scan positions
+	float detectMagStep;		// full detection, scale between pyramid steps
+	bool detectPrecise;			// precise rects, otherwise refined by a local search
+	int32_t localScanStep;		// local search
+	int32_t partsScanStep;		// parts search before the shape fit
+	int32_t eyeStageInterval;	// tracked frames per eye stage run
+	int32_t allPartsInterval;	// eye stage runs per all-parts search, 0 disables it
+};
+
+struct LRGovernorStats
+{
+	int32_t tier;
+	float load;							// smoothed share of the budget the governor acts on
+	float frameLoad;					// tracking thread
+	float detectLoad;					// detection thread
+	uint32_t budget;					// tracking thread budget per frame in microseconds
+	uint32_t stageTime[LR_GOVERNOR_STAGE_NUM];	// smoothed time per run in microseconds
+	uint32_t downCount;					// switches to a lower tier
+	uint32_t upCount;
+};
+
+class LRGovernor
+{
+public:
+
+	LRGovernor();
+
+	static const LRGovernorTier *GetTierParam(int32_t tier);
+
+	int32_t GetTier() const;
+
+	// Pins the tier and stops adapting, -1 adapts again
+	void SetFixedTier(int32_t tier);
+
+	// Starts the load measurement over, e.g. after a resolution switch. The tier is kept.
+	void ResetLoad();
+
+	// Start of the work on a camera frame captured at time (microseconds)
+	void BeginFrame(uint64_t time);
+
+	void AddStageTime(int32_t stage, uint32_t time);
+
+	// Another run of the stage at its smoothed time still fits the tracking thread budget of the
+	// current frame. True before the stage was ever timed.
+	bool FitsFrame(int32_t stage) const;
+
+	// End of the work on the frame. The detection load only counts while detecting,
+	// a slow detection does not matter while the face is tracked.
+	void EndFrame(bool detecting);
+
+	void GetStats(LRGovernorStats *stats) const;
+
+private:
+
+	int32_t _tier;
+	int32_t _fixedTier;
+
+	uint64_t _prevFrameTime;
+	float _frameInterval;		// microseconds
+	uint32_t _frameTime;		// tracking thread stages of the current frame
+
+	float _frameLoad;
+	float _detectLoad;
+	float _load;
+	float _stageTime[LR_GOVERNOR_STAGE_NUM];
+	bool _stageValid[LR_GOVERNOR_STAGE_NUM];
+
+	// Cost of every tier relative to the next lower one
+	float _tierScale[LR_GOVERNOR_TIER_NUM];
+	int32_t _switchFrom;		// tier before the last switch, -1 once its cost was measured
+	float _switchLoad;			// load before the last switch
+
+	int32_t _holdFrames;		// no switches until this runs out
+	int32_t _headroomFrames;	// frames in a row below the step up load
+	int32_t _upWait;			// frames of headroom needed to step up
+	int32_t _sinceUp;			// frames since the last step up
+
+	uint32_t _downCount;
+	uint32_t _upCount;
+
+	void SetTier(int32_t tier);
+};
@@ -0,0 +1,197 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "LRLatency.hpp"
+
+// Sensor timestamps further back than this are from another clock or a replayed recording
+#define LR_LATENCY_SENSOR_MAX		(1000 * 1000)
+
+LRHistogram::LRHistogram()
+{
+	Reset();
+}
+
+void LRHistogram::Reset()
+{
+	memset(_buckets, 0, sizeof(_buckets));
+	_count = 0;
+	_min = 0xFFFFFFFF;
+	_max = 0;
+	_sum = 0;
+}
+
+int32_t LRHistogram::GetBucketIndex(uint32_t value)
+{
+	if (value < 8)
+		return value;
+
+	int32_t exp = 31;
+	while ((value & (1u << exp)) == 0)
+		exp--;
+
+	int32_t index = (exp - 2) * 8 + ((value >> (exp - 3)) & 7);
+	if (index >= LR_HISTOGRAM_BUCKET_NUM)
+		index = LR_HISTOGRAM_BUCKET_NUM - 1;
+
+	return index;
+}
+
+uint32_t LRHistogram::GetBucketValue(int32_t index)
+{
+	if (index < 8)
+		return index;
+
+	int32_t exp = index / 8 + 2;
+	uint32_t low = (uint32_t)(8 + index % 8) << (exp - 3);
+
+	return low + ((1u << (exp - 3)) >> 1);
+}
+
+void LRHistogram::Add(uint32_t value)
+{
+	_buckets[GetBucketIndex(value)]++;
+	_count++;
+	_sum += value;
+
+	if (value < _min)
+		_min = value;
+	if (value > _max)
+		_max = value;
+}
+
+void LRHistogram::Merge(const LRHistogram *other)
+{
+	for (int32_t i = 0; i < LR_HISTOGRAM_BUCKET_NUM; i++)
+		_buckets[i] += other->_buckets[i];
+
+	_count += other->_count;
+	_sum += other->_sum;
+
+	if (other->_min < _min)
+		_min = other->_min;
+	if (other->_max > _max)
+		_max = other->_max;
+}
+
+uint32_t LRHistogram::GetCount() const
+{
+	return _count;
+}
+
+uint32_t LRHistogram::GetMin() const
+{
+	return _count > 0 ? _min : 0;
+}
+
+uint32_t LRHistogram::GetMax() const
+{
+	return _max;
+}
+
+uint32_t LRHistogram::GetMean() const
+{
+	return _count > 0 ? (uint32_t)(_sum / _count) : 0;
+}
+
+uint32_t LRHistogram::GetPercentile(float p) const
+{
+	if (_count == 0)
+		return 0;
+
+	uint32_t rank = (uint32_t)(p * 0.01f * _count + 0.5f);
+	if (rank < 1)
+		rank = 1;
+	else if (rank > _count)
+		rank = _count;
+
+	uint32_t acc = 0;
+	for (int32_t i = 0; i < LR_HISTOGRAM_BUCKET_NUM; i++) {
+		acc += _buckets[i];
+		if (acc >= rank) {
+			uint32_t value = GetBucketValue(i);
+			if (value < _min)
+				value = _min;
+			if (value > _max)
+				value = _max;
+			return value;
+		}
+	}
+
+	return _max;
+}
+
+LRLatency::LRLatency()
+{
+
+}
+
+void LRLatency::Reset()
+{
+	for (int32_t i = 0; i < LR_LATENCY_STAGE_NUM; i++)
+		_stages[i].Reset();
+}
+
+void LRLatency::AddStage(int32_t stage, uint64_t begin, uint64_t end)
+{
+	if (begin == 0 || end == 0 || end < begin)
+		return;
+
+	_stages[stage].Add((uint32_t)(end - begin));
+}
+
+void LRLatency::Record(const LRLatencyStamps *stamps, uint64_t flip)
+{
+	if (stamps->capture == 0)
+		return;
+
+	uint64_t sensor = stamps->sensor;
+	if (sensor > stamps->capture || stamps->capture - sensor > LR_LATENCY_SENSOR_MAX)
+		sensor = 0;
+
+	AddStage(LR_LATENCY_STAGE_CAMERA, sensor, stamps->capture);
+	AddStage(LR_LATENCY_STAGE_TRACK, stamps->capture, stamps->track);
+	AddStage(LR_LATENCY_STAGE_MODEL, stamps->track, stamps->model);
+	AddStage(LR_LATENCY_STAGE_RENDER, stamps->model, stamps->submit);
+	AddStage(LR_LATENCY_STAGE_DISPLAY, stamps->submit, flip);
+	AddStage(LR_LATENCY_STAGE_TOTAL, sensor != 0 ? sensor : stamps->capture, flip);
+}
+
+const LRHistogram *LRLatency::GetHistogram(int32_t stage) const
+{
+	if (stage < 0 || stage >= LR_LATENCY_STAGE_NUM)
+		return NULL;
+
+	return &_stages[stage];
+}
+
+void LRLatency::Dump(FILE *fp) const
+{
+	fprintf(fp, "%-8s %8s %8s %8s %8s %8s %8s\n", "stage", "count", "mean", "p50", "p95", "p99", "max");
+
+	for (int32_t i = 0; i < LR_LATENCY_STAGE_NUM; i++) {
+		const LRHistogram *h = &_stages[i];
+		fprintf(fp, "%-8s %8u %8u %8u %8u %8u %8u\n",
+			GetStageName(i),
+			h->GetCount(), h->GetMean(),
+			h->GetPercentile(50.0f), h->GetPercentile(95.0f), h->GetPercentile(99.0f),
+			h->GetMax());
+	}
+}
+
+const char *LRLatency::GetStageName(int32_t stage)
+{
+	static const char *s_names[LR_LATENCY_STAGE_NUM] = {
+		"camera",
+		"track",
+		"model",
+		"render",
+		"display",
+		"total"
+	};
+
+	if (stage < 0 || stage >= LR_LATENCY_STAGE_NUM)
+		return "unknown";
+
+	return s_names[stage];
+}
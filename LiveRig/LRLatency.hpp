@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+
+// Log-bucketed histogram of microsecond values. Every power of two is split into
+// 8 linear buckets, so reported percentiles are within ~6% of the recorded values.
+//
+// Only depends on stdio so that latency traces can be replayed and dumped on the host.
+
+#define LR_HISTOGRAM_BUCKET_NUM		176
+
+class LRHistogram
+{
+public:
+
+	LRHistogram();
+
+	void Reset();
+
+	void Add(uint32_t value);
+
+	// Adds every value recorded in other
+	void Merge(const LRHistogram *other);
+
+	uint32_t GetCount() const;
+
+	uint32_t GetMin() const;
+
+	uint32_t GetMax() const;
+
+	uint32_t GetMean() const;
+
+	// p in [0, 100], returns the center of the bucket holding the p-th percentile
+	uint32_t GetPercentile(float p) const;
+
+	static int32_t GetBucketIndex(uint32_t value);
+
+	static uint32_t GetBucketValue(int32_t index);
+
+private:
+
+	uint32_t _buckets[LR_HISTOGRAM_BUCKET_NUM];
+	uint32_t _count;
+	uint32_t _min;
+	uint32_t _max;
+	uint64_t _sum;
+};
+
+enum LRLatencyStage
+{
+	LR_LATENCY_STAGE_CAMERA,	// sensor timestamp -> frame published by the capture thread
+	LR_LATENCY_STAGE_TRACK,		// frame published -> tracking result
+	LR_LATENCY_STAGE_MODEL,		// tracking result -> model update
+	LR_LATENCY_STAGE_RENDER,	// model update -> display queue entry
+	LR_LATENCY_STAGE_DISPLAY,	// display queue entry -> flip
+	LR_LATENCY_STAGE_TOTAL,		// sensor timestamp (or publish if unknown) -> flip
+	LR_LATENCY_STAGE_NUM
+};
+
+// Process time in microseconds at which one tracking result passed each stage, 0 if unknown
+struct LRLatencyStamps
+{
+	uint64_t frame;		// camera frame number
+	uint64_t sensor;	// camera timestamp converted to process time
+	uint64_t capture;
+	uint64_t track;
+	uint64_t model;
+	uint64_t submit;
+};
+
+class LRLatency
+{
+public:
+
+	LRLatency();
+
+	void Reset();
+
+	// Adds one displayed frame, stages with missing or out of order stamps are skipped
+	void Record(const LRLatencyStamps *stamps, uint64_t flip);
+
+	const LRHistogram *GetHistogram(int32_t stage) const;
+
+	// Writes count, mean, p50/p95/p99 and max of every stage as text
+	void Dump(FILE *fp) const;
+
+	static const char *GetStageName(int32_t stage);
+
+private:
+
+	LRHistogram _stages[LR_LATENCY_STAGE_NUM];
+
+	void AddStage(int32_t stage, uint64_t begin, uint64_t end);
+};
@@ -0,0 +1,339 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define LR_LUMA_NORM_NEON
+#endif
+
+#include "LRLumaNorm.hpp"
+
+// Weight of the current frame in the smoothed percentiles
+#define LR_LUMA_NORM_ALPHA			0.125f
+// Narrowest range that is stretched, keeps flat frames from blowing up the noise
+#define LR_LUMA_NORM_MIN_RANGE		32.0f
+// Histogram bins are clipped at this multiple of the average bin count
+#define LR_LUMA_NORM_CLAHE_CLIP		3
+
+LRLumaNorm::LRLumaNorm() :
+	_width(0),
+	_height(0),
+	_mode(LR_LUMA_NORM_STRETCH),
+	_simd(true),
+	_primed(false),
+	_tileLut(NULL)
+{
+	memset(_hist, 0, sizeof(_hist));
+	memset(&_stats, 0, sizeof(LRLumaStats));
+}
+
+LRLumaNorm::~LRLumaNorm()
+{
+	Term();
+}
+
+int LRLumaNorm::Init(int32_t width, int32_t height)
+{
+	Term();
+
+	_tileLut = (unsigned char *)malloc(LR_LUMA_NORM_CLAHE_TILES * LR_LUMA_NORM_CLAHE_TILES * 256);
+	if (_tileLut == NULL)
+		return -1;
+
+	_width = width;
+	_height = height;
+
+	Reset();
+
+	return 0;
+}
+
+void LRLumaNorm::Term()
+{
+	free(_tileLut);
+	_tileLut = NULL;
+	_width = 0;
+	_height = 0;
+}
+
+void LRLumaNorm::Reset()
+{
+	_primed = false;
+	memset(&_stats, 0, sizeof(LRLumaStats));
+	_stats.high = 255.0f;
+	_stats.gain = 1.0f;
+}
+
+void LRLumaNorm::SetMode(int32_t mode)
+{
+	if (mode < 0 || mode >= LR_LUMA_NORM_MODE_NUM)
+		mode = LR_LUMA_NORM_OFF;
+
+	_mode = mode;
+	Reset();
+}
+
+int32_t LRLumaNorm::GetMode() const
+{
+	return _mode;
+}
+
+void LRLumaNorm::SetSimd(bool enable)
+{
+	_simd = enable;
+}
+
+const LRLumaStats *LRLumaNorm::GetStats() const
+{
+	return &_stats;
+}
+
+uint32_t LRLumaNorm::Process(const unsigned char *src, int32_t srcPitch, unsigned char *dst, int32_t dstPitch)
+{
+	if (_width == 0)
+		return 0;
+
+	switch (_mode) {
+	case LR_LUMA_NORM_STRETCH: {
+		UpdateStretch(src, srcPitch);
+
+		uint8_t low = (uint8_t)(_stats.low + 0.5f);
+		uint8_t gainQ5 = (uint8_t)(_stats.gain * 32.0f + 0.5f);
+
+		if (_simd)
+			StretchSimd(src, srcPitch, dst, dstPitch, _width, _height, low, gainQ5);
+		else
+			StretchScalar(src, srcPitch, dst, dstPitch, _width, _height, low, gainQ5);
+		break;
+	}
+	case LR_LUMA_NORM_CLAHE:
+		Clahe(src, srcPitch, dst, dstPitch);
+		break;
+	default:
+		if (src != dst) {
+			for (int32_t y = 0; y < _height; y++)
+				memcpy(dst + y * dstPitch, src + y * srcPitch, _width);
+		}
+		break;
+	}
+
+	_stats.frameCount++;
+
+	return src != dst ? (uint32_t)(_width * _height) : 0;
+}
+
+void LRLumaNorm::UpdateStretch(const unsigned char *src, int32_t srcPitch)
+{
+	Histogram(src, srcPitch, _width, _height, _hist);
+
+	uint32_t count = 0;
+	uint64_t sum = 0;
+	for (int32_t i = 0; i < 256; i++) {
+		count += _hist[i];
+		sum += (uint64_t)_hist[i] * i;
+	}
+
+	if (count == 0)
+		return;
+
+	const uint32_t lowCount = count / 100;
+	const uint32_t highCount = count - count / 100;
+	int32_t low = 0;
+	int32_t high = 255;
+	uint32_t acc = 0;
+
+	for (int32_t i = 0; i < 256; i++) {
+		acc += _hist[i];
+		if (acc > lowCount) {
+			low = i;
+			break;
+		}
+	}
+
+	acc = 0;
+	for (int32_t i = 0; i < 256; i++) {
+		acc += _hist[i];
+		if (acc >= highCount) {
+			high = i;
+			break;
+		}
+	}
+
+	if (!_primed) {
+		_stats.low = (float)low;
+		_stats.high = (float)high;
+		_primed = true;
+	}
+	else {
+		_stats.low += ((float)low - _stats.low) * LR_LUMA_NORM_ALPHA;
+		_stats.high += ((float)high - _stats.high) * LR_LUMA_NORM_ALPHA;
+	}
+
+	float range = _stats.high - _stats.low;
+	if (range < LR_LUMA_NORM_MIN_RANGE)
+		range = LR_LUMA_NORM_MIN_RANGE;
+
+	// Q5 gain has to fit in 8 bits
+	float gain = 255.0f / range;
+	if (gain > 255.0f / 32.0f)
+		gain = 255.0f / 32.0f;
+	else if (gain < 1.0f)
+		gain = 1.0f;
+
+	_stats.mean = (float)sum / (float)count;
+	_stats.gain = gain;
+}
+
+void LRLumaNorm::Clahe(const unsigned char *src, int32_t srcPitch, unsigned char *dst, int32_t dstPitch)
+{
+	const int32_t tiles = LR_LUMA_NORM_CLAHE_TILES;
+	const int32_t tileW = _width / tiles;
+	const int32_t tileH = _height / tiles;
+	uint64_t sum = 0;
+
+	// Clipped and equalized mapping per tile
+	for (int32_t ty = 0; ty < tiles; ty++) {
+		for (int32_t tx = 0; tx < tiles; tx++) {
+			const int32_t x0 = tx * tileW;
+			const int32_t y0 = ty * tileH;
+			const int32_t x1 = (tx == tiles - 1) ? _width : x0 + tileW;
+			const int32_t y1 = (ty == tiles - 1) ? _height : y0 + tileH;
+			const uint32_t area = (x1 - x0) * (y1 - y0);
+
+			memset(_hist, 0, sizeof(_hist));
+			for (int32_t y = y0; y < y1; y++) {
+				const unsigned char *row = src + y * srcPitch;
+				for (int32_t x = x0; x < x1; x++)
+					_hist[row[x]]++;
+			}
+
+			uint32_t clip = LR_LUMA_NORM_CLAHE_CLIP * area / 256;
+			if (clip < 1)
+				clip = 1;
+
+			uint32_t excess = 0;
+			for (int32_t i = 0; i < 256; i++) {
+				sum += (uint64_t)_hist[i] * i;
+				if (_hist[i] > clip) {
+					excess += _hist[i] - clip;
+					_hist[i] = clip;
+				}
+			}
+
+			const uint32_t spread = excess / 256;
+			const uint32_t rest = excess % 256;
+
+			unsigned char *lut = _tileLut + (ty * tiles + tx) * 256;
+			uint32_t cdf = 0;
+			for (int32_t i = 0; i < 256; i++) {
+				cdf += _hist[i] + spread + (i < (int32_t)rest ? 1 : 0);
+				lut[i] = (unsigned char)((cdf * 255 + area / 2) / area);
+			}
+		}
+	}
+
+	// Bilinear blend of the four nearest tile mappings, weights in Q7
+	for (int32_t y = 0; y < _height; y++) {
+		int32_t fy = ((2 * y + 1 - tileH) * 128) / (2 * tileH);
+		int32_t ty0 = fy >> 7;
+		int32_t wy = fy & 127;
+		if (fy < 0) {
+			ty0 = 0;
+			wy = 0;
+		}
+		int32_t ty1 = ty0 + 1;
+		if (ty0 >= tiles - 1) {
+			ty0 = tiles - 1;
+			ty1 = tiles - 1;
+			wy = 0;
+		}
+
+		const unsigned char *srcRow = src + y * srcPitch;
+		unsigned char *dstRow = dst + y * dstPitch;
+		const unsigned char *lutTop = _tileLut + ty0 * tiles * 256;
+		const unsigned char *lutBottom = _tileLut + ty1 * tiles * 256;
+
+		for (int32_t x = 0; x < _width; x++) {
+			int32_t fx = ((2 * x + 1 - tileW) * 128) / (2 * tileW);
+			int32_t tx0 = fx >> 7;
+			int32_t wx = fx & 127;
+			if (fx < 0) {
+				tx0 = 0;
+				wx = 0;
+			}
+			int32_t tx1 = tx0 + 1;
+			if (tx0 >= tiles - 1) {
+				tx0 = tiles - 1;
+				tx1 = tiles - 1;
+				wx = 0;
+			}
+
+			const uint32_t v = srcRow[x];
+			const uint32_t top = lutTop[tx0 * 256 + v] * (128 - wx) + lutTop[tx1 * 256 + v] * wx;
+			const uint32_t bottom = lutBottom[tx0 * 256 + v] * (128 - wx) + lutBottom[tx1 * 256 + v] * wx;
+
+			dstRow[x] = (unsigned char)((top * (128 - wy) + bottom * wy + 8192) >> 14);
+		}
+	}
+
+	_stats.mean = (float)sum / (float)(_width * _height);
+}
+
+void LRLumaNorm::Histogram(const unsigned char *src, int32_t pitch, int32_t width, int32_t height, uint32_t *hist)
+{
+	memset(hist, 0, sizeof(uint32_t) * 256);
+
+	for (int32_t y = 0; y < height; y += 2) {
+		const unsigned char *row = src + y * pitch;
+		for (int32_t x = 0; x < width; x += 2)
+			hist[row[x]]++;
+	}
+}
+
+void LRLumaNorm::StretchScalar(const unsigned char *src, int32_t srcPitch, unsigned char *dst, int32_t dstPitch, int32_t width, int32_t height, uint8_t low, uint8_t gainQ5)
+{
+	for (int32_t y = 0; y < height; y++) {
+		const unsigned char *in = src + y * srcPitch;
+		unsigned char *out = dst + y * dstPitch;
+
+		for (int32_t x = 0; x < width; x++) {
+			uint32_t d = in[x] > low ? in[x] - low : 0;
+			uint32_t v = (d * gainQ5 + 16) >> 5;
+			out[x] = (unsigned char)(v > 255 ? 255 : v);
+		}
+	}
+}
+
+void LRLumaNorm::StretchSimd(const unsigned char *src, int32_t srcPitch, unsigned char *dst, int32_t dstPitch, int32_t width, int32_t height, uint8_t low, uint8_t gainQ5)
+{
+#ifdef LR_LUMA_NORM_NEON
+	const int32_t vecWidth = width & ~15;
+	const uint8x16_t vLow = vdupq_n_u8(low);
+	const uint8x8_t vGain = vdup_n_u8(gainQ5);
+
+	for (int32_t y = 0; y < height; y++) {
+		const unsigned char *in = src + y * srcPitch;
+		unsigned char *out = dst + y * dstPitch;
+		int32_t x = 0;
+
+		for (; x < vecWidth; x += 16) {
+			uint8x16_t d = vqsubq_u8(vld1q_u8(in + x), vLow);
+
+			uint16x8_t lo = vmull_u8(vget_low_u8(d), vGain);
+			uint16x8_t hi = vmull_u8(vget_high_u8(d), vGain);
+
+			// Rounding shift with unsigned saturation matches the scalar clamp
+			vst1q_u8(out + x, vcombine_u8(vqrshrn_n_u16(lo, 5), vqrshrn_n_u16(hi, 5)));
+		}
+
+		for (; x < width; x++) {
+			uint32_t d = in[x] > low ? in[x] - low : 0;
+			uint32_t v = (d * gainQ5 + 16) >> 5;
+			out[x] = (unsigned char)(v > 255 ? 255 : v);
+		}
+	}
+#else
+	StretchScalar(src, srcPitch, dst, dstPitch, width, height, low, gainQ5);
+#endif
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdint.h>
+
+// Continuous luma normalization for the camera Y plane.
+//
+// LR_LUMA_NORM_STRETCH maps the 1st..99th percentile of the frame histogram to the
+// full range. The percentiles are smoothed over frames so that the gain follows changing
+// light without pumping. The stretch kernel has bit-exact scalar and NEON paths.
+//
+// LR_LUMA_NORM_CLAHE equalizes tiles of roughly face size with a clipped histogram
+// and interpolates between the tile mappings.
+//
+// Only depends on the C library so that it can be benchmarked on the host.
+
+#define LR_LUMA_NORM_OFF		0
+#define LR_LUMA_NORM_STRETCH	1
+#define LR_LUMA_NORM_CLAHE		2
+#define LR_LUMA_NORM_MODE_NUM	3
+
+#define LR_LUMA_NORM_CLAHE_TILES	4
+
+struct LRLumaStats
+{
+	float mean;
+	float low;		// smoothed 1st percentile
+	float high;		// smoothed 99th percentile
+	float gain;		// applied stretch gain
+	uint32_t frameCount;
+};
+
+class LRLumaNorm
+{
+public:
+
+	LRLumaNorm();
+
+	~LRLumaNorm();
+
+	int Init(int32_t width, int32_t height);
+
+	void Term();
+
+	// Forgets the smoothed statistics, the next frame is normalized from its own histogram
+	void Reset();
+
+	void SetMode(int32_t mode);
+
+	int32_t GetMode() const;
+
+	void SetSimd(bool enable);
+
+	// Writes the normalized src to dst, src and dst may be the same buffer.
+	// Returns the bytes that went from src to another buffer, 0 when normalized in place.
+	uint32_t Process(const unsigned char *src, int32_t srcPitch, unsigned char *dst, int32_t dstPitch);
+
+	const LRLumaStats *GetStats() const;
+
+	// Histogram of every second pixel of every second row
+	static void Histogram(const unsigned char *src, int32_t pitch, int32_t width, int32_t height, uint32_t *hist);
+
+	// dst = min(255, ((src -sat low) * gainQ5 + 16) >> 5)
+	static void StretchScalar(const unsigned char *src, int32_t srcPitch, unsigned char *dst, int32_t dstPitch, int32_t width, int32_t height, uint8_t low, uint8_t gainQ5);
+
+	// Same result as the scalar path, falls back to it when NEON is not available
+	static void StretchSimd(const unsigned char *src, int32_t srcPitch, unsigned char *dst, int32_t dstPitch, int32_t width, int32_t height, uint8_t low, uint8_t gainQ5);
+
+private:
+
+	int32_t _width;
+	int32_t _height;
+	int32_t _mode;
+	bool _simd;
+	bool _primed;
+
+	uint32_t _hist[256];
+	LRLumaStats _stats;
+
+	// CLAHE tile mappings, LR_LUMA_NORM_CLAHE_TILES^2 * 256 entries
+	unsigned char *_tileLut;
+
+	void UpdateStretch(const unsigned char *src, int32_t srcPitch);
+
+	void Clahe(const unsigned char *src, int32_t srcPitch, unsigned char *dst, int32_t dstPitch);
+};
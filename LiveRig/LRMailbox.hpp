@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+
+// Single-producer, single-consumer mailbox that only keeps the newest message.
+//
+// Three slots are rotated so that Post() and Take() never block each other: the producer
+// fills its own slot and swaps it with the shared middle slot, the consumer swaps the middle
+// slot with its own when it is marked as unread. A message that is overwritten before it was
+// taken is handed back to the producer, so that messages holding references can be released.
+//
+// Only depends on <atomic> so that it can be driven from host threads.
+
+#define LR_MAILBOX_INDEX_MASK	3
+#define LR_MAILBOX_UNREAD		4
+
+template <typename T>
+class LRMailbox
+{
+public:
+
+	LRMailbox() :
+		_back(0),
+		_front(2)
+	{
+		_middle.store(1);
+	}
+
+	// Producer side. Returns true and stores the message that was never taken in *displaced.
+	bool Post(const T &msg, T *displaced)
+	{
+		_slots[_back] = msg;
+
+		int prev = _middle.exchange(_back | LR_MAILBOX_UNREAD);
+		_back = prev & LR_MAILBOX_INDEX_MASK;
+
+		if (prev & LR_MAILBOX_UNREAD) {
+			*displaced = _slots[_back];
+			return true;
+		}
+
+		return false;
+	}
+
+	// Consumer side. Returns false if nothing was posted since the last call.
+	bool Take(T *msg)
+	{
+		// Only the consumer clears the unread mark, so it cannot go away before the exchange
+		if ((_middle.load() & LR_MAILBOX_UNREAD) == 0)
+			return false;
+
+		int prev = _middle.exchange(_front);
+		_front = prev & LR_MAILBOX_INDEX_MASK;
+		*msg = _slots[_front];
+
+		return true;
+	}
+
+	bool IsPending() const
+	{
+		return (_middle.load() & LR_MAILBOX_UNREAD) != 0;
+	}
+
+private:
+
+	T _slots[3];
+	std::atomic<int> _middle;
+	int _back;		// owned by the producer
+	int _front;		// owned by the consumer
+};
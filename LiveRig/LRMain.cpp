@@ -1,208 +1,389 @@
-#include <CubismFramework.hpp>
-#include <kernel.h>
-#include <ctrl.h>
-#include <libdbg.h>
-#include <message_dialog.h>
-#include <vita2d_sys.h>
-
-#pragma comment(lib, "libSceTargetTransport_stub.a")
-#include <target_transport.h>
-
-#include "LRGXM.hpp"
-#include "LRCamera.hpp"
-#include "LRFace.hpp"
-#include "LRInput.hpp"
-#include "LRCubismAllocator.hpp"
-#include "LRAppLevel.hpp"
-
-using namespace Csm;
-
-SCE_USER_MODULE_LIST("app0:module/libvita2d_sys.suprx");
-
-// User main thread parameters
-const char		sceUserMainThreadName[] = "simple_main_thr";
-int				sceUserMainThreadPriority = SCE_KERNEL_DEFAULT_PRIORITY_USER;
-unsigned int	sceUserMainThreadCpuAffinityMask = SCE_KERNEL_CPU_MASK_USER_0;
-unsigned int	sceUserMainThreadStackSize = SCE_KERNEL_STACK_SIZE_DEFAULT_USER_MAIN;
-
-// Libc parameters
-unsigned int	sceLibcHeapSize = 64 * 1024 * 1024;
-
-static LRCubismAllocator cubismAllocator;
-static Csm::CubismFramework::Option cubismOption;
-
-static vita2d_pvf *font;
-
-int showDialog(int mode, int type, bool infobar, bool dimmer, const char *str)
-{
-	SceMsgDialogParam				msgParam;
-	SceMsgDialogUserMessageParam	userMsgParam;
-	SceMsgDialogProgressBarParam	progBarParam;
-
-	SceCommonDialogInfobarParam	infobarParam;
-	SceCommonDialogColor		dimmerColor;
-
-	// initalize parameter of message dialog
-	sceMsgDialogParamInit(&msgParam);
-	msgParam.mode = mode;
-
-	// initalize message dialog
-	if (mode == SCE_MSG_DIALOG_MODE_USER_MSG) {
-		sceClibMemset(&userMsgParam, 0, sizeof(SceMsgDialogUserMessageParam));
-		msgParam.userMsgParam = &userMsgParam;
-		msgParam.userMsgParam->msg = (const SceChar8 *)str;
-		msgParam.userMsgParam->buttonType = type;
-	}
-	else if (mode == SCE_MSG_DIALOG_MODE_PROGRESS_BAR) {
-		sceClibMemset(&progBarParam, 0, sizeof(SceMsgDialogProgressBarParam));
-		msgParam.progBarParam = &progBarParam;
-		msgParam.progBarParam->barType = SCE_MSG_DIALOG_PROGRESSBAR_TYPE_PERCENTAGE;
-		msgParam.progBarParam->msg = (const SceChar8 *)str;
-	}
-
-	// initalize parameters for infobar
-	if (infobar) {
-		sceClibMemset(&infobarParam, 0, sizeof(infobarParam));
-		infobarParam.visibility = true;
-		infobarParam.color = 0;
-		infobarParam.transparency = 0;
-		msgParam.commonParam.infobarParam = &infobarParam;
-	}
-	else
-		msgParam.commonParam.infobarParam = NULL;
-
-	// initalize parameters for dimmer color
-	if (dimmer) {
-		dimmerColor.r = 0;
-		dimmerColor.g = 0;
-		dimmerColor.b = 0;
-		dimmerColor.a = 255;
-		msgParam.commonParam.dimmerColor = &dimmerColor;
-	}
-	else
-		msgParam.commonParam.dimmerColor = NULL;
-
-	msgParam.commonParam.bgColor = NULL;
-
-	sceMsgDialogTerm();
-
-	return sceMsgDialogInit(&msgParam);
-}
-
-int showMessageDialog(int type, bool infobar, bool dimmer, const char *str)
-{
-	return showDialog(SCE_MSG_DIALOG_MODE_USER_MSG, type, infobar, dimmer, str);
-}
-
-int showProgressDialog(bool infobar, bool dimmer, const char *str)
-{
-	return showDialog(SCE_MSG_DIALOG_MODE_PROGRESS_BAR, 0, infobar, dimmer, str);
-}
-
-int updateProgressDialog(SceUInt32 value)
-{
-	return sceMsgDialogProgressBarSetValue(SCE_MSG_DIALOG_PROGRESSBAR_TARGET_BAR_DEFAULT, value);
-}
-
-void initializeCubism()
-{
-	//setup cubism
-	cubismOption.LogFunction = (Live2D::Cubism::Core::csmLogFunction)sceClibPrintf;
-	cubismOption.LoggingLevel = CubismFramework::Option::LogLevel::LogLevel_Verbose;
-	CubismFramework::StartUp(&cubismAllocator, &cubismOption);
-
-	//Initialize cubism
-	CubismFramework::Initialize();
-
-	LRAppLevel::UpdateTime();
-}
-
-int main()
-{
-	sceKernelLoadStartModule("ur0:data/external/libTargetTransport.suprx", 0, NULL, 0, NULL, NULL);
-	sceTargetTransportConnect();
-
-	SceBool isCalibrating = SCE_FALSE;
-
-	sceDbgSetMinimumLogLevel(SCE_DBG_LOG_LEVEL_TRACE);
-
-	LRGXM *render = LRGXM::GetInstance();
-	LRInput *input = LRInput::GetInstance();
-
-	LRGXM::InitParams params;
-	sceClibMemset(&params, 0, sizeof(LRGXM::InitParams));
-
-	render->Init(&params);
-
-	vita2d_system_pvf_config configs[] = {
-		{SCE_PVF_LANGUAGE_LATIN, SCE_PVF_FAMILY_SANSERIF, SCE_PVF_STYLE_REGULAR, NULL},
-	};
-
-	font = vita2d_load_system_pvf(1, configs, 13, 13);
-
-	LRAppLevel *app = LRAppLevel::GetInstance();
-	app->Initialize();
-
-	initializeCubism();
-
-	app->LoadModel("app0:Resources/Hiyori/", "Hiyori");
-
-	LRCamera *cam = LRCamera::GetInstance();
-	LRFace *face = LRFace::GetInstance();
-
-	cam->Start(SCE_CAMERA_DEVICE_FRONT);
-	face->StartTracking();
-
-	SceFloat xAngle, yAngle, mouthPoint, browLY, browRY;
-
-	while (1) {
-
-		LRAppLevel::UpdateTime();
-
-		vita2d_pool_reset();
-		render->StartScene();
-		vita2d_clear_screen();
-		input->UpdateBegin();
-
-		if (input->CheckPressedState(SCE_CTRL_CROSS)) {
-			isCalibrating = SCE_TRUE;
-			showProgressDialog(false, false, "Camera calibration is in progress. Please hold still and don't move your PS Vita system unless there is no progress for a long time.");
-		}
-
-		if (isCalibrating) {
-			SceUInt32 progress = 0;
-			isCalibrating = !face->Calibrate(&progress);
-			updateProgressDialog(progress);
-			if (!isCalibrating) {
-				sceMsgDialogClose();
-			}
-		}
-
-		cam->DrawCamTex();
-		face->DrawShape();
-
-		if (face->GetTrackingState())
-			vita2d_pvf_draw_text(font, 20, 220, RGBA8(0, 255, 0, 255), 1.0f, "Tracking: OK");
-		else
-			vita2d_pvf_draw_text(font, 20, 220, RGBA8(255, 0, 0, 255), 1.0f, "Tracking: face lost");
-
-		face->GetBasicTrackingAngles(&xAngle, &yAngle);
-		face->GetMouth(&mouthPoint);
-		face->GetBrows(&browLY, &browRY);
-		vita2d_pvf_draw_textf(font, 20, 250, RGBA8(0, 0, 0, 255), 1.0f, "Mouth: %.4f", mouthPoint);
-		vita2d_pvf_draw_textf(font, 20, 280, RGBA8(0, 0, 0, 255), 1.0f, "Face x: %.4f", xAngle);
-		vita2d_pvf_draw_textf(font, 20, 310, RGBA8(0, 0, 0, 255), 1.0f, "Face y: %.4f", yAngle);
-		vita2d_pvf_draw_textf(font, 20, 340, RGBA8(0, 0, 0, 255), 1.0f, "Left brow: %.4f", browLY);
-		vita2d_pvf_draw_textf(font, 20, 370, RGBA8(0, 0, 0, 255), 1.0f, "Right brow: %.4f", browRY);
-
-		render->EndScene();
-
-		app->RenderModel(xAngle, yAngle, mouthPoint, browLY, browRY);
-
-		render->UpdateCommonDialog();
-		render->EndRendering();
-		input->UpdateEnd();
-	}
-
-	return 0;
+#include <CubismFramework.hpp>
+#include <kernel.h>
+#include <ctrl.h>
+#include <libdbg.h>
+#include <message_dialog.h>
+#include <vita2d_sys.h>
+
+#pragma comment(lib, "libSceTargetTransport_stub.a")
+#include <target_transport.h>
+
+#include "LRGXM.hpp"
+#include "LRCamera.hpp"
+#include "LRFace.hpp"
+#include "LRInput.hpp"
+#include "LRCubismAllocator.hpp"
+#include "LRAppLevel.hpp"
+#include "LRPredictor.hpp"
+#include "LRChannelTrace.hpp"
+
+using namespace Csm;
+
+SCE_USER_MODULE_LIST("app0:module/libvita2d_sys.suprx");
+
+// User main thread parameters
+const char		sceUserMainThreadName[] = "simple_main_thr";
+int				sceUserMainThreadPriority = SCE_KERNEL_DEFAULT_PRIORITY_USER;
+unsigned int	sceUserMainThreadCpuAffinityMask = SCE_KERNEL_CPU_MASK_USER_0;
+unsigned int	sceUserMainThreadStackSize = SCE_KERNEL_STACK_SIZE_DEFAULT_USER_MAIN;
+
+// Libc parameters
+unsigned int	sceLibcHeapSize = 64 * 1024 * 1024;
+
+static LRCubismAllocator cubismAllocator;
+static Csm::CubismFramework::Option cubismOption;
+
+static vita2d_pvf *font;
+
+// Unfiltered channels of the first face, dumped with the latency to tune the filters on the host
+static LRChannelTrace s_channelTrace;
+
+static const char *s_dataDir = "ux0:data/LiveRig";
+static const char *s_capturePath = "ux0:data/LiveRig/capture.lrcf";
+static const char *s_latencyPath = "ux0:data/LiveRig/latency.txt";
+static const char *s_channelPath = "ux0:data/LiveRig/channels.txt";
+static const char *s_lumaNormName[LR_LUMA_NORM_MODE_NUM] = { "off", "stretch", "CLAHE" };
+
+int showDialog(int mode, int type, bool infobar, bool dimmer, const char *str)
+{
+	SceMsgDialogParam				msgParam;
+	SceMsgDialogUserMessageParam	userMsgParam;
+	SceMsgDialogProgressBarParam	progBarParam;
+
+	SceCommonDialogInfobarParam	infobarParam;
+	SceCommonDialogColor		dimmerColor;
+
+	// initalize parameter of message dialog
+	sceMsgDialogParamInit(&msgParam);
+	msgParam.mode = mode;
+
+	// initalize message dialog
+	if (mode == SCE_MSG_DIALOG_MODE_USER_MSG) {
+		sceClibMemset(&userMsgParam, 0, sizeof(SceMsgDialogUserMessageParam));
+		msgParam.userMsgParam = &userMsgParam;
+		msgParam.userMsgParam->msg = (const SceChar8 *)str;
+		msgParam.userMsgParam->buttonType = type;
+	}
+	else if (mode == SCE_MSG_DIALOG_MODE_PROGRESS_BAR) {
+		sceClibMemset(&progBarParam, 0, sizeof(SceMsgDialogProgressBarParam));
+		msgParam.progBarParam = &progBarParam;
+		msgParam.progBarParam->barType = SCE_MSG_DIALOG_PROGRESSBAR_TYPE_PERCENTAGE;
+		msgParam.progBarParam->msg = (const SceChar8 *)str;
+	}
+
+	// initalize parameters for infobar
+	if (infobar) {
+		sceClibMemset(&infobarParam, 0, sizeof(infobarParam));
+		infobarParam.visibility = true;
+		infobarParam.color = 0;
+		infobarParam.transparency = 0;
+		msgParam.commonParam.infobarParam = &infobarParam;
+	}
+	else
+		msgParam.commonParam.infobarParam = NULL;
+
+	// initalize parameters for dimmer color
+	if (dimmer) {
+		dimmerColor.r = 0;
+		dimmerColor.g = 0;
+		dimmerColor.b = 0;
+		dimmerColor.a = 255;
+		msgParam.commonParam.dimmerColor = &dimmerColor;
+	}
+	else
+		msgParam.commonParam.dimmerColor = NULL;
+
+	msgParam.commonParam.bgColor = NULL;
+
+	sceMsgDialogTerm();
+
+	return sceMsgDialogInit(&msgParam);
+}
+
+int showMessageDialog(int type, bool infobar, bool dimmer, const char *str)
+{
+	return showDialog(SCE_MSG_DIALOG_MODE_USER_MSG, type, infobar, dimmer, str);
+}
+
+void initializeCubism()
+{
+	//setup cubism
+	cubismOption.LogFunction = (Live2D::Cubism::Core::csmLogFunction)sceClibPrintf;
+	cubismOption.LoggingLevel = CubismFramework::Option::LogLevel::LogLevel_Verbose;
+	CubismFramework::StartUp(&cubismAllocator, &cubismOption);
+
+	//Initialize cubism
+	CubismFramework::Initialize();
+
+	LRAppLevel::UpdateTime();
+}
+
+int DumpChannels(const char *path)
+{
+	FILE *fp = fopen(path, "w");
+	if (fp == NULL) {
+		SCE_DBG_LOG_ERROR("[LRMain] failed to open %s for channel dump\n", path);
+		return -1;
+	}
+
+	s_channelTrace.Write(fp);
+	fclose(fp);
+
+	return 0;
+}
+
+int main()
+{
+	sceKernelLoadStartModule("ur0:data/external/libTargetTransport.suprx", 0, NULL, 0, NULL, NULL);
+	sceTargetTransportConnect();
+
+
+	sceDbgSetMinimumLogLevel(SCE_DBG_LOG_LEVEL_TRACE);
+
+	sceIoMkdir(s_dataDir, 0777);
+
+	LRGXM *render = LRGXM::GetInstance();
+	LRInput *input = LRInput::GetInstance();
+
+	LRGXM::InitParams params;
+	sceClibMemset(&params, 0, sizeof(LRGXM::InitParams));
+
+	render->Init(&params);
+
+	vita2d_system_pvf_config configs[] = {
+		{SCE_PVF_LANGUAGE_LATIN, SCE_PVF_FAMILY_SANSERIF, SCE_PVF_STYLE_REGULAR, NULL},
+	};
+
+	font = vita2d_load_system_pvf(1, configs, 13, 13);
+
+	// The tracker's dictionaries load on an I/O thread while Cubism and the model come up
+	LRCamera *cam = LRCamera::GetInstance();
+	LRFace *face = LRFace::GetInstance();
+
+	LRAppLevel *app = LRAppLevel::GetInstance();
+	app->Initialize();
+
+	initializeCubism();
+
+	app->LoadModel("app0:Resources/Hiyori/", "Hiyori");
+
+	cam->Start(SCE_CAMERA_DEVICE_FRONT);
+	cam->StartCapture();
+	face->StartTracking();
+
+	LRModelInput modelInput;
+
+	// Tracking lags the display by several frames, the predictor moves it on to the flip
+	LRPredictor predictor;
+	SceUInt32 trackingVersion = 0;
+
+	while (1) {
+
+		LRAppLevel::UpdateTime();
+
+		vita2d_pool_reset();
+		render->StartScene();
+		vita2d_clear_screen();
+		input->UpdateBegin();
+
+		if (input->CheckPressedState(SCE_CTRL_CROSS))
+			face->StartCalibration();
+
+		if (input->CheckPressedState(SCE_CTRL_TRIANGLE)) {
+			switch (cam->GetResolution()) {
+			case SCE_CAMERA_RESOLUTION_QQVGA:
+				face->SetCameraResolution(SCE_CAMERA_RESOLUTION_QVGA);
+				break;
+			case SCE_CAMERA_RESOLUTION_QVGA:
+				face->SetCameraResolution(SCE_CAMERA_RESOLUTION_VGA);
+				break;
+			default:
+				face->SetCameraResolution(SCE_CAMERA_RESOLUTION_QQVGA);
+				break;
+			}
+		}
+
+		if (input->CheckPressedState(SCE_CTRL_SQUARE))
+			face->SetRoiMode(!face->GetRoiMode());
+
+		if (input->CheckPressedState(SCE_CTRL_CIRCLE))
+			cam->SetLumaNormMode((cam->GetLumaNormMode() + 1) % LR_LUMA_NORM_MODE_NUM);
+
+		if (input->CheckPressedState(SCE_CTRL_SELECT)) {
+			render->DumpLatency(s_latencyPath);
+			DumpChannels(s_channelPath);
+		}
+
+		if (input->CheckPressedState(SCE_CTRL_START)) {
+			LRPredictorParam predictorParam;
+			predictor.GetParam(&predictorParam);
+			predictorParam.enable = !predictorParam.enable;
+			predictor.SetParam(&predictorParam);
+			predictor.ResetStats();
+		}
+
+		if (input->CheckPressedState(SCE_CTRL_L)) {
+			if (cam->IsRecording())
+				cam->StopRecording();
+			else if (!cam->IsReplaying())
+				cam->StartRecording(s_capturePath);
+		}
+
+		if (input->CheckPressedState(SCE_CTRL_R)) {
+			if (cam->IsReplaying())
+				cam->StopReplay();
+			else if (!cam->IsRecording())
+				cam->StartReplay(s_capturePath, SCE_TRUE);
+		}
+
+		// One snapshot per displayed frame, so that pose, landmarks and timestamps all match
+		LRTrackingFrame trackingFrame;
+		face->GetTrackingFrame(&trackingFrame);
+
+		// Every new measurement scores the predictions made for the time before it
+		if (!trackingFrame.isTracking)
+			predictor.Flush();
+		else if (trackingFrame.version != trackingVersion) {
+			predictor.AddSample(trackingFrame.channel, trackingFrame.sampleTime);
+			s_channelTrace.Add(trackingFrame.rawChannel, trackingFrame.sampleTime);
+		}
+		trackingVersion = trackingFrame.version;
+
+		cam->DrawCamTex();
+		face->DrawShape(&trackingFrame);
+
+		// Faces in the other slots, only the first one drives the model
+		for (int i = 1; i < LR_FACE_TRACK_MAX; i++) {
+			LRTrackingFrame otherFrame;
+			face->GetTrackingFrame(i, &otherFrame);
+			face->DrawShape(&otherFrame);
+		}
+
+		if (trackingFrame.isTracking)
+			vita2d_pvf_draw_text(font, 20, 220, RGBA8(0, 255, 0, 255), 1.0f, "Tracking: OK");
+		else
+			vita2d_pvf_draw_text(font, 20, 220, RGBA8(255, 0, 0, 255), 1.0f, "Tracking: face lost");
+
+		if (cam->IsRecording())
+			vita2d_pvf_draw_text(font, 20, 190, RGBA8(255, 0, 0, 255), 1.0f, "REC");
+		else if (cam->IsReplaying())
+			vita2d_pvf_draw_text(font, 20, 190, RGBA8(0, 0, 255, 255), 1.0f, cam->IsReplayFinished() ? "Replay: finished" : "Replay");
+
+		if (trackingFrame.isTracking) {
+			SceUInt64 displayTime = sceKernelGetProcessTimeWide() + render->GetDisplayDelay();
+			predictor.Predict(trackingFrame.channel, trackingFrame.velocity, trackingFrame.sampleTime, displayTime, trackingFrame.channel);
+		}
+
+		LRFace::GetBasicTrackingAngles(&trackingFrame, &modelInput.xAngle, &modelInput.yAngle);
+		LRFace::GetMouth(&trackingFrame, &modelInput.mouth);
+		LRFace::GetBrows(&trackingFrame, &modelInput.browLY, &modelInput.browRY);
+		LRFace::GetEyes(&trackingFrame, &modelInput.eyeLOpen, &modelInput.eyeROpen);
+		LRFace::GetGaze(&trackingFrame, &modelInput.eyeBallX, &modelInput.eyeBallY);
+		modelInput.eyeTracked = trackingFrame.isEyeTracking;
+		LRFace::GetResultStamps(&trackingFrame, &modelInput.stamps);
+		vita2d_pvf_draw_textf(font, 20, 250, RGBA8(0, 0, 0, 255), 1.0f, "Mouth: %.4f", modelInput.mouth);
+		vita2d_pvf_draw_textf(font, 20, 280, RGBA8(0, 0, 0, 255), 1.0f, "Face x: %.4f", modelInput.xAngle);
+		vita2d_pvf_draw_textf(font, 20, 310, RGBA8(0, 0, 0, 255), 1.0f, "Face y: %.4f", modelInput.yAngle);
+		vita2d_pvf_draw_textf(font, 20, 340, RGBA8(0, 0, 0, 255), 1.0f, "Left brow: %.4f", modelInput.browLY);
+		vita2d_pvf_draw_textf(font, 20, 370, RGBA8(0, 0, 0, 255), 1.0f, "Right brow: %.4f", modelInput.browRY);
+		if (modelInput.eyeTracked)
+			vita2d_pvf_draw_textf(font, 520, 460, RGBA8(0, 0, 0, 255), 1.0f, "Eyes: %.2f %.2f, gaze %.2f %.2f", modelInput.eyeLOpen, modelInput.eyeROpen, modelInput.eyeBallX, modelInput.eyeBallY);
+		else
+			vita2d_pvf_draw_text(font, 520, 460, RGBA8(0, 0, 0, 255), 1.0f, "Eyes: blink");
+
+		for (int i = 0; i < LR_FACE_TRACK_MAX; i++) {
+			LRFaceTrackStats trackStats;
+			face->GetTrackStats(i, &trackStats);
+			if (trackStats.id < 0)
+				vita2d_pvf_draw_textf(font, 520, 310 + 30 * i, RGBA8(0, 0, 0, 255), 1.0f, "Face %d: free", i);
+			else
+				vita2d_pvf_draw_textf(font, 520, 310 + 30 * i, RGBA8(0, 0, 0, 255), 1.0f, "Face %d #%d%s: score %.2f, track %u wait %u lost %u match %u",
+					i, trackStats.id, trackStats.isTracking ? "" : " lost", trackStats.score,
+					trackStats.trackCount, trackStats.deferCount, trackStats.lostCount, trackStats.matchCount);
+		}
+
+		LRTelemetryStats trackerStats;
+		face->GetStats(&trackerStats);
+		vita2d_pvf_draw_textf(font, 20, 130, RGBA8(0, 0, 0, 255), 1.0f, "Track p50/p99 %.1f/%.1f ms, fit %.1f ms, score p10/p50 %.2f/%.2f",
+			trackerStats.stageHist[LR_TELEMETRY_STAGE_TRACK].GetPercentile(50.0f) / 1000.0f,
+			trackerStats.stageHist[LR_TELEMETRY_STAGE_TRACK].GetPercentile(99.0f) / 1000.0f,
+			trackerStats.stageHist[LR_TELEMETRY_STAGE_FIT].GetPercentile(50.0f) / 1000.0f,
+			trackerStats.scoreHist.GetPercentile(10.0f) / LR_TELEMETRY_SCORE_SCALE,
+			trackerStats.scoreHist.GetPercentile(50.0f) / LR_TELEMETRY_SCORE_SCALE);
+		vita2d_pvf_draw_textf(font, 520, 280, RGBA8(0, 0, 0, 255), 1.0f, "Tracked %u, skipped %u, dropped %u, lost %u, lock p99 %u us",
+			trackerStats.frameCount, trackerStats.frameSkipCount, trackerStats.frameDropCount,
+			trackerStats.eventCount[LR_TELEMETRY_EVENT_LOST], trackerStats.lockHist[LR_TELEMETRY_LOCK_FACE].GetPercentile(99.0f));
+
+		LRReacquireStats reacquireStats;
+		face->GetReacquireStats(&reacquireStats);
+		vita2d_pvf_draw_textf(font, 20, 160, RGBA8(0, 0, 0, 255), 1.0f, "Reacquire local %u/%u, coarse %u/%u, precise %u/%u (%.1f ms)",
+			reacquireStats.hitCount[LR_FACE_TIER_LOCAL], reacquireStats.attemptCount[LR_FACE_TIER_LOCAL],
+			reacquireStats.hitCount[LR_FACE_TIER_COARSE], reacquireStats.attemptCount[LR_FACE_TIER_COARSE],
+			reacquireStats.hitCount[LR_FACE_TIER_PRECISE], reacquireStats.attemptCount[LR_FACE_TIER_PRECISE],
+			reacquireStats.timeLast[LR_FACE_TIER_PRECISE] / 1000.0f);
+
+		LRCalibrationStats calibStats;
+		face->GetCalibrationStats(&calibStats);
+		if (calibStats.active)
+			vita2d_pvf_draw_textf(font, 520, 400, RGBA8(255, 0, 0, 255), 1.0f, "Calibrating EV: %u%% (%u levels)", calibStats.progress, calibStats.measureCount);
+		else if (calibStats.time != 0)
+			vita2d_pvf_draw_textf(font, 520, 400, RGBA8(0, 0, 0, 255), 1.0f, "EV %d: score %.2f, %u levels in %.1f s",
+				calibStats.evLevel, calibStats.score, calibStats.measureCount, calibStats.time / 1000000.0f);
+
+		LRStartupStats startupStats;
+		face->GetStartupStats(&startupStats);
+		if (startupStats.dict.doneCount < startupStats.dict.dictNum)
+			vita2d_pvf_draw_textf(font, 520, 520, RGBA8(255, 0, 0, 255), 1.0f, "Loading dictionaries: %u%% (%u/%u)", startupStats.dict.progress, startupStats.dict.doneCount, startupStats.dict.dictNum);
+		else
+			vita2d_pvf_draw_textf(font, 520, 520, RGBA8(0, 0, 0, 255), 1.0f, "Startup: tracking at %.0f ms, face at %.0f ms, %u dict errors",
+				startupStats.trackReadyTime / 1000.0f, startupStats.firstTrackTime / 1000.0f, startupStats.dict.failCount);
+
+		LRStageMemoryReport memoryReport;
+		face->GetMemoryReport(&memoryReport);
+		vita2d_pvf_draw_textf(font, 520, 370, RGBA8(0, 0, 0, 255), 1.0f, "Tracker memory: %.2f MB (%.2f MB shared)",
+			memoryReport.totalSize / (1024.0f * 1024.0f), memoryReport.savedSize / (1024.0f * 1024.0f));
+
+		LRGovernorStats governorStats;
+		face->GetGovernorStats(&governorStats);
+		vita2d_pvf_draw_textf(font, 520, 430, RGBA8(0, 0, 0, 255), 1.0f, "Quality tier %d (load %.2f, detect %.2f, budget %.1f ms)",
+			governorStats.tier, governorStats.frameLoad, governorStats.detectLoad, governorStats.budget / 1000.0f);
+
+		SceInt32 camWidth, camHeight;
+		cam->GetSize(&camWidth, &camHeight);
+		vita2d_pvf_draw_textf(font, 20, 400, RGBA8(0, 0, 0, 255), 1.0f, "Camera: %dx%d%s", camWidth, camHeight, face->GetRoiMode() ? " ROI" : "");
+
+		LRLumaStats lumaStats;
+		cam->GetLumaStats(&lumaStats);
+		vita2d_pvf_draw_textf(font, 20, 460, RGBA8(0, 0, 0, 255), 1.0f, "Luma: %s (mean %.0f, gain %.2f)", s_lumaNormName[cam->GetLumaNormMode()], lumaStats.mean, lumaStats.gain);
+
+		LRCaptureStats captureStats;
+		cam->GetCaptureStats(&captureStats);
+		vita2d_pvf_draw_textf(font, 20, 430, RGBA8(0, 0, 0, 255), 1.0f, "Capture wake: %u us (max %u us), copied %u B", captureStats.wakeLatencyLast, captureStats.wakeLatencyMax, captureStats.bytesCopiedLast);
+		vita2d_pvf_draw_textf(font, 20, 520, RGBA8(0, 0, 0, 255), 1.0f, "Frames: %.1f ms +-%.1f, skipped %u, dropped %u, dup %u",
+			captureStats.frameIntervalMean / 1000.0f, captureStats.frameJitter / 1000.0f,
+			captureStats.skippedFrameCount, captureStats.droppedFrameCount, captureStats.alreadyReadCount + captureStats.duplicateWakeCount);
+
+		LRHistogram latency;
+		render->GetLatencyHistogram(LR_LATENCY_STAGE_TOTAL, &latency);
+		vita2d_pvf_draw_textf(font, 20, 490, RGBA8(0, 0, 0, 255), 1.0f, "Latency p50/p95/p99: %.1f/%.1f/%.1f ms",
+			latency.GetPercentile(50.0f) / 1000.0f, latency.GetPercentile(95.0f) / 1000.0f, latency.GetPercentile(99.0f) / 1000.0f);
+
+		LRPredictorParam predictorParam;
+		LRPredictorStats predictorStats;
+		predictor.GetParam(&predictorParam);
+		predictor.GetStats(&predictorStats);
+		vita2d_pvf_draw_textf(font, 520, 490, RGBA8(0, 0, 0, 255), 1.0f, "Predict %s %.0f ms, x err %.2f (held %.2f)",
+			predictorParam.enable ? "on" : "off", predictorStats.horizonMean * 1000.0f,
+			predictorStats.predictedError[LR_FACE_CHANNEL_ANGLE_X], predictorStats.heldError[LR_FACE_CHANNEL_ANGLE_X]);
+
+		render->EndScene();
+
+		app->RenderModel(&modelInput);
+
+		render->UpdateCommonDialog();
+		render->EndRendering(&modelInput.stamps);
+		input->UpdateEnd();
+	}
+
+	return 0;
 }
\ No newline at end of file
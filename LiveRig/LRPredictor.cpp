@@ -0,0 +1,149 @@
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "LRPredictor.hpp"
+
+LRPredictor::LRPredictor()
+{
+	GetDefaultParam(&_param);
+
+	_prevTime = 0;
+	memset(_prevValues, 0, sizeof(_prevValues));
+
+	Flush();
+	ResetStats();
+}
+
+void LRPredictor::GetDefaultParam(LRPredictorParam *param)
+{
+	param->enable = true;
+	param->horizonMax = 0.1f;
+	param->damping = 0.05f;
+}
+
+void LRPredictor::SetParam(const LRPredictorParam *param)
+{
+	_param = *param;
+
+	if (_param.horizonMax < 0.0f)
+		_param.horizonMax = 0.0f;
+}
+
+void LRPredictor::GetParam(LRPredictorParam *param) const
+{
+	*param = _param;
+}
+
+void LRPredictor::Predict(const float *values, const float *velocity, uint64_t sampleTime, uint64_t targetTime, float *out)
+{
+	float horizon = 0.0f;
+	if (targetTime > sampleTime)
+		horizon = (float)(targetTime - sampleTime) * 0.000001f;
+	if (horizon > _param.horizonMax)
+		horizon = _param.horizonMax;
+
+	// Distance covered by a velocity decaying with the damping time constant
+	float reach = 0.0f;
+	if (_param.enable) {
+		if (_param.damping > 0.0f)
+			reach = _param.damping * (1.0f - expf(-horizon / _param.damping));
+		else
+			reach = horizon;
+	}
+
+	Pending *pending = NULL;
+	if (targetTime > _prevTime) {
+		if (_pendingNum == LR_PREDICTOR_PENDING_NUM) {
+			memmove(&_pending[0], &_pending[1], sizeof(Pending) * (LR_PREDICTOR_PENDING_NUM - 1));
+			_pendingNum--;
+		}
+		pending = &_pending[_pendingNum++];
+		pending->targetTime = targetTime;
+		pending->horizon = horizon;
+	}
+
+	for (int32_t i = 0; i < LR_FILTER_CHANNEL_MAX; i++) {
+		const float value = values[i];
+		const float predicted = value + velocity[i] * reach;
+
+		if (pending != NULL) {
+			pending->held[i] = value;
+			pending->predicted[i] = predicted;
+		}
+
+		out[i] = predicted;
+	}
+}
+
+void LRPredictor::AddSample(const float *values, uint64_t time)
+{
+	if (time == _prevTime)
+		return;
+
+	// The clock went back, a replay restarted
+	if (time < _prevTime)
+		Flush();
+
+	int32_t kept = 0;
+
+	for (int32_t n = 0; n < _pendingNum; n++) {
+		const Pending *pending = &_pending[n];
+
+		if (pending->targetTime > time) {
+			_pending[kept++] = *pending;
+			continue;
+		}
+
+		// Nothing to compare against if the target lies before the previous sample
+		if (_prevTime == 0 || pending->targetTime < _prevTime)
+			continue;
+
+		// Ground truth between the two samples that enclose the target
+		const float t = (float)(pending->targetTime - _prevTime) / (float)(time - _prevTime);
+
+		for (int32_t i = 0; i < LR_FILTER_CHANNEL_MAX; i++) {
+			const float truth = _prevValues[i] + (values[i] - _prevValues[i]) * t;
+			_predictedErrorSum[i] += fabsf(pending->predicted[i] - truth);
+			_heldErrorSum[i] += fabsf(pending->held[i] - truth);
+		}
+
+		_horizonSum += pending->horizon;
+		_count++;
+	}
+
+	_pendingNum = kept;
+
+	memcpy(_prevValues, values, sizeof(_prevValues));
+	_prevTime = time;
+}
+
+void LRPredictor::Flush()
+{
+	_pendingNum = 0;
+	_prevTime = 0;
+}
+
+void LRPredictor::GetStats(LRPredictorStats *stats) const
+{
+	memset(stats, 0, sizeof(LRPredictorStats));
+
+	stats->count = _count;
+	if (_count == 0)
+		return;
+
+	for (int32_t i = 0; i < LR_FILTER_CHANNEL_MAX; i++) {
+		stats->predictedError[i] = (float)(_predictedErrorSum[i] / _count);
+		stats->heldError[i] = (float)(_heldErrorSum[i] / _count);
+	}
+
+	stats->horizonMean = (float)(_horizonSum / _count);
+}
+
+void LRPredictor::ResetStats()
+{
+	_count = 0;
+	_horizonSum = 0.0;
+	memset(_predictedErrorSum, 0, sizeof(_predictedErrorSum));
+	memset(_heldErrorSum, 0, sizeof(_heldErrorSum));
+}
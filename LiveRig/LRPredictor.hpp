@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "LRFilter.hpp"
+
+// Extrapolates filtered tracking channels from the time their camera frame was exposed
+// to the time the frame being rendered reaches the display.
+//
+// Every channel moves on with its filter velocity, decaying with the damping time constant:
+// x(t + h) = x + v * damping * (1 - exp(-h / damping)). Short horizons are close to linear
+// extrapolation, long ones settle instead of running away. h is limited to horizonMax.
+//
+// Predictions are kept until a measured sample covers their target time, which gives the
+// error of the prediction and of simply holding the last value against the same ground truth.
+// Only depends on the C library so that replayed recordings can be scored on the host.
+
+#define LR_PREDICTOR_PENDING_NUM	16
+
+struct LRPredictorParam
+{
+	bool enable;
+	float horizonMax;	// seconds
+	float damping;		// seconds, time constant of the velocity decay
+};
+
+struct LRPredictorStats
+{
+	uint32_t count;									// scored predictions
+	float predictedError[LR_FILTER_CHANNEL_MAX];	// mean absolute error of the predicted values
+	float heldError[LR_FILTER_CHANNEL_MAX];			// same without prediction
+	float horizonMean;								// seconds
+};
+
+class LRPredictor
+{
+public:
+
+	LRPredictor();
+
+	static void GetDefaultParam(LRPredictorParam *param);
+
+	void SetParam(const LRPredictorParam *param);
+
+	void GetParam(LRPredictorParam *param) const;
+
+	// Times in microseconds on one clock. Writes the values expected at targetTime to out,
+	// out may be the same array as values.
+	void Predict(const float *values, const float *velocity, uint64_t sampleTime, uint64_t targetTime, float *out);
+
+	// Measured (filtered) values at time, scores every pending prediction it passed
+	void AddSample(const float *values, uint64_t time);
+
+	// Drops pending predictions, e.g. when the face was lost or a replay restarted
+	void Flush();
+
+	void GetStats(LRPredictorStats *stats) const;
+
+	void ResetStats();
+
+private:
+
+	struct Pending
+	{
+		uint64_t targetTime;
+		float horizon;
+		float predicted[LR_FILTER_CHANNEL_MAX];
+		float held[LR_FILTER_CHANNEL_MAX];
+	};
+
+	LRPredictorParam _param;
+
+	Pending _pending[LR_PREDICTOR_PENDING_NUM];
+	int32_t _pendingNum;
+
+	float _prevValues[LR_FILTER_CHANNEL_MAX];
+	uint64_t _prevTime;
+
+	uint32_t _count;
+	double _predictedErrorSum[LR_FILTER_CHANNEL_MAX];
+	double _heldErrorSum[LR_FILTER_CHANNEL_MAX];
+	double _horizonSum;
+};
@@ -0,0 +1,230 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "LRProfile.hpp"
+
+namespace {
+	void Put32(uint8_t **p, uint32_t v)
+	{
+		(*p)[0] = (uint8_t)v;
+		(*p)[1] = (uint8_t)(v >> 8);
+		(*p)[2] = (uint8_t)(v >> 16);
+		(*p)[3] = (uint8_t)(v >> 24);
+		*p += 4;
+	}
+
+	void PutFloat(uint8_t **p, float v)
+	{
+		uint32_t bits;
+		memcpy(&bits, &v, sizeof(bits));
+		Put32(p, bits);
+	}
+
+	uint32_t Get32(const uint8_t **p)
+	{
+		uint32_t v = (uint32_t)(*p)[0] | ((uint32_t)(*p)[1] << 8) | ((uint32_t)(*p)[2] << 16) | ((uint32_t)(*p)[3] << 24);
+		*p += 4;
+		return v;
+	}
+
+	float GetFloat(const uint8_t **p)
+	{
+		uint32_t bits = Get32(p);
+		float v;
+		memcpy(&v, &bits, sizeof(v));
+		return v;
+	}
+}
+
+void LRProfileFile::GetDefault(LRProfile *profile)
+{
+	memset(profile, 0, sizeof(LRProfile));
+
+	profile->eyeOpenRef[0] = 0.25f;
+	profile->eyeOpenRef[1] = 0.25f;
+
+	for (int32_t i = 0; i < LR_FILTER_CHANNEL_MAX; i++)
+		LRFilter::GetDefaultParam(LR_FILTER_NONE, &profile->filter[i]);
+}
+
+void LRProfileFile::Encode(const LRProfile *profile, uint8_t *buf)
+{
+	uint8_t *p = buf;
+
+	Put32(&p, profile->flags);
+	Put32(&p, (uint32_t)profile->evLevel);
+	PutFloat(&p, profile->evScore);
+
+	PutFloat(&p, profile->faceX);
+	PutFloat(&p, profile->faceY);
+	PutFloat(&p, profile->faceW);
+	PutFloat(&p, profile->faceH);
+
+	for (int32_t i = 0; i < LR_FEATURE_NUM; i++)
+		PutFloat(&p, profile->neutral[i]);
+	Put32(&p, profile->neutralCount);
+	PutFloat(&p, profile->eyeOpenRef[0]);
+	PutFloat(&p, profile->eyeOpenRef[1]);
+
+	for (int32_t i = 0; i < LR_FILTER_CHANNEL_MAX; i++) {
+		const LRFilterParam *f = &profile->filter[i];
+		Put32(&p, (uint32_t)f->type);
+		PutFloat(&p, f->minCutoff);
+		PutFloat(&p, f->beta);
+		PutFloat(&p, f->dCutoff);
+		PutFloat(&p, f->processNoise);
+		PutFloat(&p, f->measureNoise);
+		PutFloat(&p, f->frequency);
+	}
+}
+
+void LRProfileFile::Decode(const uint8_t *buf, LRProfile *profile)
+{
+	const uint8_t *p = buf;
+
+	profile->flags = Get32(&p);
+	profile->evLevel = (int32_t)Get32(&p);
+	profile->evScore = GetFloat(&p);
+
+	profile->faceX = GetFloat(&p);
+	profile->faceY = GetFloat(&p);
+	profile->faceW = GetFloat(&p);
+	profile->faceH = GetFloat(&p);
+
+	for (int32_t i = 0; i < LR_FEATURE_NUM; i++)
+		profile->neutral[i] = GetFloat(&p);
+	profile->neutralCount = Get32(&p);
+	profile->eyeOpenRef[0] = GetFloat(&p);
+	profile->eyeOpenRef[1] = GetFloat(&p);
+
+	for (int32_t i = 0; i < LR_FILTER_CHANNEL_MAX; i++) {
+		LRFilterParam *f = &profile->filter[i];
+		f->type = (int32_t)Get32(&p);
+		f->minCutoff = GetFloat(&p);
+		f->beta = GetFloat(&p);
+		f->dCutoff = GetFloat(&p);
+		f->processNoise = GetFloat(&p);
+		f->measureNoise = GetFloat(&p);
+		f->frequency = GetFloat(&p);
+	}
+}
+
+uint32_t LRProfileFile::Crc32(const uint8_t *buf, uint32_t size)
+{
+	// Bitwise, the payload is a few hundred bytes
+	uint32_t crc = 0xFFFFFFFF;
+
+	for (uint32_t i = 0; i < size; i++) {
+		crc ^= buf[i];
+		for (int32_t k = 0; k < 8; k++)
+			crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+	}
+
+	return ~crc;
+}
+
+int LRProfileFile::Save(const char *path, const LRProfile *profile)
+{
+	uint8_t buf[LR_PROFILE_HEADER_SIZE + LR_PROFILE_PAYLOAD_SIZE];
+
+	Encode(profile, buf + LR_PROFILE_HEADER_SIZE);
+
+	uint8_t *p = buf;
+	Put32(&p, LR_PROFILE_MAGIC);
+	Put32(&p, LR_PROFILE_VERSION);
+	Put32(&p, LR_PROFILE_PAYLOAD_SIZE);
+	Put32(&p, Crc32(buf + LR_PROFILE_HEADER_SIZE, LR_PROFILE_PAYLOAD_SIZE));
+
+	char tmpPath[256];
+	char bakPath[256];
+	snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path);
+	snprintf(bakPath, sizeof(bakPath), "%s.bak", path);
+
+	FILE *fp = fopen(tmpPath, "wb");
+	if (fp == NULL)
+		return LR_PROFILE_ERROR_IO;
+
+	const bool written = fwrite(buf, sizeof(buf), 1, fp) == 1;
+	if (fclose(fp) != 0 || !written) {
+		remove(tmpPath);
+		return LR_PROFILE_ERROR_IO;
+	}
+
+	// Not every file system lets rename() replace a file. The old profile is then moved
+	// aside first and only removed once the new one is in place.
+	if (rename(tmpPath, path) != 0) {
+		remove(bakPath);
+		if (rename(path, bakPath) != 0) {
+			remove(tmpPath);
+			return LR_PROFILE_ERROR_IO;
+		}
+
+		if (rename(tmpPath, path) != 0) {
+			rename(bakPath, path);
+			remove(tmpPath);
+			return LR_PROFILE_ERROR_IO;
+		}
+
+		remove(bakPath);
+	}
+
+	return 0;
+}
+
+int LRProfileFile::Load(const char *path, LRProfile *profile)
+{
+	int ret = Read(path, profile);
+	if (ret != LR_PROFILE_ERROR_IO)
+		return ret;
+
+	// Save() stopped between moving the old profile aside and putting the new one in place
+	char bakPath[256];
+	snprintf(bakPath, sizeof(bakPath), "%s.bak", path);
+
+	return Read(bakPath, profile);
+}
+
+int LRProfileFile::Read(const char *path, LRProfile *profile)
+{
+	FILE *fp = fopen(path, "rb");
+	if (fp == NULL)
+		return LR_PROFILE_ERROR_IO;
+
+	uint8_t header[LR_PROFILE_HEADER_SIZE];
+	if (fread(header, sizeof(header), 1, fp) != 1) {
+		fclose(fp);
+		return LR_PROFILE_ERROR_FORMAT;
+	}
+
+	const uint8_t *p = header;
+	const uint32_t magic = Get32(&p);
+	const uint32_t version = Get32(&p);
+	const uint32_t size = Get32(&p);
+	const uint32_t crc = Get32(&p);
+
+	if (magic != LR_PROFILE_MAGIC) {
+		fclose(fp);
+		return LR_PROFILE_ERROR_FORMAT;
+	}
+
+	if (version != LR_PROFILE_VERSION || size != LR_PROFILE_PAYLOAD_SIZE) {
+		fclose(fp);
+		return LR_PROFILE_ERROR_VERSION;
+	}
+
+	uint8_t buf[LR_PROFILE_PAYLOAD_SIZE];
+	if (fread(buf, sizeof(buf), 1, fp) != 1) {
+		fclose(fp);
+		return LR_PROFILE_ERROR_FORMAT;
+	}
+
+	fclose(fp);
+
+	if (Crc32(buf, sizeof(buf)) != crc)
+		return LR_PROFILE_ERROR_CHECKSUM;
+
+	Decode(buf, profile);
+
+	return 0;
+}
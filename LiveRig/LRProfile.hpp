@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "LRFilter.hpp"
+#include "LRFeatures.hpp"
+
+// Per-user tracker profile, kept between sessions so that tracking starts warm.
+//
+// file: "LRPF", version, payload size, CRC-32 of the payload (little endian uint32)
+// payload: the LRProfile fields in declaration order, little endian, no padding
+//
+// A file with another version is rejected as a whole, the caller starts from defaults.
+// Flags tell which parts were ever measured, the others hold defaults.
+//
+// Only depends on stdio so that profiles can be written and checked on the host.
+
+#define LR_PROFILE_MAGIC			0x4650524C	// "LRPF"
+#define LR_PROFILE_VERSION			1
+
+#define LR_PROFILE_HEADER_SIZE		16
+// flags, EV, face rect, neutral features and eyes, 7 fields per filter
+#define LR_PROFILE_PAYLOAD_SIZE		(4 * (10 + LR_FEATURE_NUM + LR_FILTER_CHANNEL_MAX * 7))
+
+#define LR_PROFILE_HAS_EV			0x1
+#define LR_PROFILE_HAS_FACE			0x2
+#define LR_PROFILE_HAS_NEUTRAL		0x4
+#define LR_PROFILE_HAS_FILTER		0x8
+
+#define LR_PROFILE_ERROR_IO			-1
+#define LR_PROFILE_ERROR_FORMAT		-2
+#define LR_PROFILE_ERROR_VERSION	-3
+#define LR_PROFILE_ERROR_CHECKSUM	-4
+
+struct LRProfile
+{
+	uint32_t flags;
+
+	// EV calibration
+	int32_t evLevel;
+	float evScore;		// detection score the calibration measured at evLevel
+
+	// Last tracked face rect, normalized to the frame
+	float faceX;
+	float faceY;
+	float faceW;
+	float faceH;
+
+	// Features of the relaxed face and the openness of a normally open eye
+	float neutral[LR_FEATURE_NUM];
+	uint32_t neutralCount;
+	float eyeOpenRef[2];
+
+	LRFilterParam filter[LR_FILTER_CHANNEL_MAX];
+};
+
+class LRProfileFile
+{
+public:
+
+	static void GetDefault(LRProfile *profile);
+
+	// Written to path.tmp first, so that a failed write leaves the old profile intact. Where
+	// rename() cannot replace path, the old profile stays as path.bak until the new one is in place.
+	static int Save(const char *path, const LRProfile *profile);
+
+	// Falls back to path.bak when path does not exist
+	static int Load(const char *path, LRProfile *profile);
+
+	// buf holds LR_PROFILE_PAYLOAD_SIZE bytes
+	static void Encode(const LRProfile *profile, uint8_t *buf);
+
+	static void Decode(const uint8_t *buf, LRProfile *profile);
+
+	static uint32_t Crc32(const uint8_t *buf, uint32_t size);
+
+private:
+
+	static int Read(const char *path, LRProfile *profile);
+};
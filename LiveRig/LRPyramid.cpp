@@ -0,0 +1,215 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define LR_PYRAMID_NEON
+#endif
+
+#include "LRPyramid.hpp"
+
+#define LR_PYRAMID_ALIGN	64
+#define LR_PYRAMID_PITCH	16
+
+namespace {
+	int32_t AlignUp(int32_t x, int32_t a)
+	{
+		return (x + a - 1) & ~(a - 1);
+	}
+
+	void *AllocAligned(size_t size)
+	{
+#ifdef _WIN32
+		return _aligned_malloc(size, LR_PYRAMID_ALIGN);
+#elif defined(__SNC__) || defined(__psp2__)
+		return memalign(LR_PYRAMID_ALIGN, size);
+#else
+		void *ptr = NULL;
+		if (posix_memalign(&ptr, LR_PYRAMID_ALIGN, size) != 0)
+			return NULL;
+		return ptr;
+#endif
+	}
+
+	void FreeAligned(void *ptr)
+	{
+#ifdef _WIN32
+		_aligned_free(ptr);
+#else
+		free(ptr);
+#endif
+	}
+}
+
+LRPyramid::LRPyramid() :
+	_memory(NULL),
+	_levelNum(0),
+	_simd(true),
+	_valid(false),
+	_id(0)
+{
+	memset(_levels, 0, sizeof(_levels));
+}
+
+LRPyramid::~LRPyramid()
+{
+	Term();
+}
+
+int LRPyramid::Init(int32_t width, int32_t height, int32_t levelNum)
+{
+	Term();
+
+	if (levelNum < 1 || levelNum > LR_PYRAMID_LEVEL_MAX)
+		return -1;
+
+	// Work out the layout first so that all levels share one allocation
+	size_t total = 0;
+	int32_t w = width;
+	int32_t h = height;
+
+	_levels[0].width = w;
+	_levels[0].height = h;
+	_levels[0].pitch = w;
+
+	for (int32_t i = 1; i < levelNum; i++) {
+		w /= 2;
+		h /= 2;
+		if (w < 8 || h < 8) {
+			levelNum = i;
+			break;
+		}
+
+		_levels[i].width = w;
+		_levels[i].height = h;
+		_levels[i].pitch = AlignUp(w, LR_PYRAMID_PITCH);
+		total += AlignUp(_levels[i].pitch * h, LR_PYRAMID_ALIGN);
+	}
+
+	if (total > 0) {
+		_memory = (unsigned char *)AllocAligned(total);
+		if (_memory == NULL)
+			return -1;
+	}
+
+	unsigned char *ptr = _memory;
+	for (int32_t i = 1; i < levelNum; i++) {
+		_levels[i].data = ptr;
+		ptr += AlignUp(_levels[i].pitch * _levels[i].height, LR_PYRAMID_ALIGN);
+	}
+
+	_levelNum = levelNum;
+	_valid = false;
+
+	return 0;
+}
+
+void LRPyramid::Term()
+{
+	if (_memory != NULL) {
+		FreeAligned(_memory);
+		_memory = NULL;
+	}
+
+	memset(_levels, 0, sizeof(_levels));
+	_levelNum = 0;
+	_valid = false;
+}
+
+void LRPyramid::Build(const unsigned char *src, int32_t pitch, uint32_t id)
+{
+	if (_levelNum == 0)
+		return;
+
+	if (_valid && _id == id && _levels[0].data == src)
+		return;
+
+	_levels[0].data = src;
+	_levels[0].pitch = pitch;
+
+	for (int32_t i = 1; i < _levelNum; i++) {
+		const LRPyramidLevel *prev = &_levels[i - 1];
+		LRPyramidLevel *cur = &_levels[i];
+
+		if (_simd)
+			Downsample2xSimd(prev->data, prev->pitch, (unsigned char *)cur->data, cur->pitch, cur->width, cur->height);
+		else
+			Downsample2xScalar(prev->data, prev->pitch, (unsigned char *)cur->data, cur->pitch, cur->width, cur->height);
+	}
+
+	_id = id;
+	_valid = true;
+}
+
+void LRPyramid::Invalidate()
+{
+	_valid = false;
+}
+
+const LRPyramidLevel *LRPyramid::GetLevel(int32_t level) const
+{
+	if (level < 0 || level >= _levelNum)
+		return NULL;
+
+	return &_levels[level];
+}
+
+int32_t LRPyramid::GetLevelNum() const
+{
+	return _levelNum;
+}
+
+void LRPyramid::SetSimd(bool enable)
+{
+	_simd = enable;
+	_valid = false;
+}
+
+void LRPyramid::Downsample2xScalar(const unsigned char *src, int32_t srcPitch, unsigned char *dst, int32_t dstPitch, int32_t dstWidth, int32_t dstHeight)
+{
+	for (int32_t y = 0; y < dstHeight; y++) {
+		const unsigned char *row0 = src + (y * 2) * srcPitch;
+		const unsigned char *row1 = row0 + srcPitch;
+		unsigned char *out = dst + y * dstPitch;
+
+		for (int32_t x = 0; x < dstWidth; x++) {
+			uint32_t sum = row0[x * 2] + row0[x * 2 + 1] + row1[x * 2] + row1[x * 2 + 1];
+			out[x] = (unsigned char)((sum + 2) >> 2);
+		}
+	}
+}
+
+void LRPyramid::Downsample2xSimd(const unsigned char *src, int32_t srcPitch, unsigned char *dst, int32_t dstPitch, int32_t dstWidth, int32_t dstHeight)
+{
+#ifdef LR_PYRAMID_NEON
+	const int32_t vecWidth = dstWidth & ~15;
+
+	for (int32_t y = 0; y < dstHeight; y++) {
+		const unsigned char *row0 = src + (y * 2) * srcPitch;
+		const unsigned char *row1 = row0 + srcPitch;
+		unsigned char *out = dst + y * dstPitch;
+		int32_t x = 0;
+
+		// 32 source pixels of two rows -> 16 output pixels
+		for (; x < vecWidth; x += 16) {
+			uint8x16_t a0 = vld1q_u8(row0 + x * 2);
+			uint8x16_t a1 = vld1q_u8(row0 + x * 2 + 16);
+			uint8x16_t b0 = vld1q_u8(row1 + x * 2);
+			uint8x16_t b1 = vld1q_u8(row1 + x * 2 + 16);
+
+			uint16x8_t s0 = vpadalq_u8(vpaddlq_u8(a0), b0);
+			uint16x8_t s1 = vpadalq_u8(vpaddlq_u8(a1), b1);
+
+			vst1q_u8(out + x, vcombine_u8(vrshrn_n_u16(s0, 2), vrshrn_n_u16(s1, 2)));
+		}
+
+		for (; x < dstWidth; x++) {
+			uint32_t sum = row0[x * 2] + row0[x * 2 + 1] + row1[x * 2] + row1[x * 2 + 1];
+			out[x] = (unsigned char)((sum + 2) >> 2);
+		}
+	}
+#else
+	Downsample2xScalar(src, srcPitch, dst, dstPitch, dstWidth, dstHeight);
+#endif
+}
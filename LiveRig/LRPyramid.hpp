@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdint.h>
+
+// Multi-scale luma pyramid. Level 0 references the source image, every further level
+// is a 2x2 box downsample of the previous one stored in 64-byte aligned memory with
+// a pitch padded to 16 bytes. The scalar and NEON paths produce identical output, so
+// they can be benchmarked and cross-checked against each other on the host.
+
+#define LR_PYRAMID_LEVEL_MAX	5
+
+struct LRPyramidLevel
+{
+	const unsigned char *data;
+	int32_t width;
+	int32_t height;
+	int32_t pitch;
+};
+
+class LRPyramid
+{
+public:
+
+	LRPyramid();
+
+	~LRPyramid();
+
+	int Init(int32_t width, int32_t height, int32_t levelNum);
+
+	void Term();
+
+	// Rebuilds all levels for the given source image unless it was already built for this id
+	void Build(const unsigned char *src, int32_t pitch, uint32_t id);
+
+	void Invalidate();
+
+	const LRPyramidLevel *GetLevel(int32_t level) const;
+
+	int32_t GetLevelNum() const;
+
+	void SetSimd(bool enable);
+
+	// (a + b + c + d + 2) / 4 for every 2x2 block of the source
+	static void Downsample2xScalar(const unsigned char *src, int32_t srcPitch, unsigned char *dst, int32_t dstPitch, int32_t dstWidth, int32_t dstHeight);
+
+	// Same result as the scalar path, falls back to it when NEON is not available
+	static void Downsample2xSimd(const unsigned char *src, int32_t srcPitch, unsigned char *dst, int32_t dstPitch, int32_t dstWidth, int32_t dstHeight);
+
+private:
+
+	LRPyramidLevel _levels[LR_PYRAMID_LEVEL_MAX];
+	unsigned char *_memory;
+	int32_t _levelNum;
+	bool _simd;
+	bool _valid;
+	uint32_t _id;
+};
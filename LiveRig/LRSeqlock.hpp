@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+
+// Single-writer sequence lock around a plain value.
+//
+// The writer never waits: it marks the value as being written by making the sequence odd,
+// copies the new value in and makes the sequence even again. Readers copy the value and
+// retry if the sequence was odd or changed meanwhile, so they always get a value from one
+// Write() and never block the writer. T has to be trivially copyable.
+//
+// Only depends on <atomic> so that both sides can be driven from host threads.
+
+template <typename T>
+class LRSeqlock
+{
+public:
+
+	LRSeqlock()
+	{
+		_seq.store(0);
+		memset(&_value, 0, sizeof(T));
+	}
+
+	// Writer side, must not be called from more than one thread at a time
+	void Write(const T &value)
+	{
+		uint32_t seq = _seq.load(std::memory_order_relaxed);
+
+		_seq.store(seq + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		memcpy(&_value, &value, sizeof(T));
+
+		_seq.store(seq + 2, std::memory_order_release);
+	}
+
+	// Returns the number of writes the copied value is the result of
+	uint32_t Read(T *value) const
+	{
+		uint32_t begin;
+		uint32_t end;
+
+		do {
+			begin = _seq.load(std::memory_order_acquire);
+
+			memcpy(value, &_value, sizeof(T));
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			end = _seq.load(std::memory_order_relaxed);
+		} while ((begin & 1) != 0 || begin != end);
+
+		return begin / 2;
+	}
+
+	uint32_t GetVersion() const
+	{
+		return _seq.load(std::memory_order_acquire) / 2;
+	}
+
+private:
+
+	std::atomic<uint32_t> _seq;
+	T _value;
+};
@@ -0,0 +1,140 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "LRTelemetry.hpp"
+
+LRTelemetry::LRTelemetry() :
+	_window(LR_TELEMETRY_WINDOW_DEFAULT)
+{
+	Reset();
+}
+
+void LRTelemetry::Reset()
+{
+	_windowBegin = 0;
+	_prevWindow = 0;
+	_lastTime = 0;
+	_current = 0;
+
+	_frameCount = 0;
+	_frameSkipCount = 0;
+	_frameDropCount = 0;
+
+	memset(_eventCount, 0, sizeof(_eventCount));
+	memset(_stageCount, 0, sizeof(_stageCount));
+	memset(_stageTime, 0, sizeof(_stageTime));
+	memset(_lockCount, 0, sizeof(_lockCount));
+	memset(_lockWait, 0, sizeof(_lockWait));
+
+	for (int32_t w = 0; w < 2; w++) {
+		for (int32_t i = 0; i < LR_TELEMETRY_STAGE_NUM; i++)
+			_stageHist[w][i].Reset();
+		for (int32_t i = 0; i < LR_TELEMETRY_LOCK_NUM; i++)
+			_lockHist[w][i].Reset();
+		_scoreHist[w].Reset();
+	}
+}
+
+void LRTelemetry::SetWindow(uint64_t window)
+{
+	_window = window;
+}
+
+void LRTelemetry::AddFrame(uint64_t time, uint32_t skipped)
+{
+	_frameCount++;
+	_frameSkipCount += skipped;
+
+	if (_windowBegin == 0 || time < _windowBegin) {
+		_windowBegin = time;
+	}
+	else if (time - _windowBegin >= _window) {
+		// The current window becomes the previous one, the oldest samples go
+		_prevWindow = time - _windowBegin;
+		_windowBegin = time;
+		_current ^= 1;
+
+		for (int32_t i = 0; i < LR_TELEMETRY_STAGE_NUM; i++)
+			_stageHist[_current][i].Reset();
+		for (int32_t i = 0; i < LR_TELEMETRY_LOCK_NUM; i++)
+			_lockHist[_current][i].Reset();
+		_scoreHist[_current].Reset();
+	}
+
+	_lastTime = time;
+}
+
+void LRTelemetry::AddDrop()
+{
+	_frameDropCount++;
+}
+
+void LRTelemetry::AddEvent(int32_t event)
+{
+	_eventCount[event]++;
+}
+
+void LRTelemetry::AddStage(int32_t stage, uint32_t time)
+{
+	_stageCount[stage]++;
+	_stageTime[stage] += time;
+	_stageHist[_current][stage].Add(time);
+}
+
+void LRTelemetry::AddStageRuns(int32_t stage, uint32_t count, uint64_t time)
+{
+	if (count == 0)
+		return;
+
+	_stageCount[stage] += count;
+	_stageTime[stage] += time;
+
+	const uint32_t mean = (uint32_t)(time / count);
+	for (uint32_t i = 0; i < count; i++)
+		_stageHist[_current][stage].Add(mean);
+}
+
+void LRTelemetry::AddLockWait(int32_t lock, uint32_t time)
+{
+	_lockCount[lock]++;
+	_lockWait[lock] += time;
+	_lockHist[_current][lock].Add(time);
+}
+
+void LRTelemetry::AddScore(float score)
+{
+	if (score < 0.0f)
+		score = 0.0f;
+
+	_scoreHist[_current].Add((uint32_t)(score * LR_TELEMETRY_SCORE_SCALE + 0.5f));
+}
+
+void LRTelemetry::GetStats(LRTelemetryStats *stats) const
+{
+	stats->frameCount = _frameCount;
+	stats->frameSkipCount = _frameSkipCount;
+	stats->frameDropCount = _frameDropCount;
+
+	memcpy(stats->eventCount, _eventCount, sizeof(_eventCount));
+	memcpy(stats->stageCount, _stageCount, sizeof(_stageCount));
+	memcpy(stats->stageTime, _stageTime, sizeof(_stageTime));
+	memcpy(stats->lockCount, _lockCount, sizeof(_lockCount));
+	memcpy(stats->lockWait, _lockWait, sizeof(_lockWait));
+
+	const int32_t prev = _current ^ 1;
+
+	stats->window = _prevWindow + (_windowBegin != 0 ? _lastTime - _windowBegin : 0);
+
+	for (int32_t i = 0; i < LR_TELEMETRY_STAGE_NUM; i++) {
+		stats->stageHist[i] = _stageHist[prev][i];
+		stats->stageHist[i].Merge(&_stageHist[_current][i]);
+	}
+
+	for (int32_t i = 0; i < LR_TELEMETRY_LOCK_NUM; i++) {
+		stats->lockHist[i] = _lockHist[prev][i];
+		stats->lockHist[i].Merge(&_lockHist[_current][i]);
+	}
+
+	stats->scoreHist = _scoreHist[prev];
+	stats->scoreHist.Merge(&_scoreHist[_current]);
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "LRLatency.hpp"
+
+// Tracker counters and timing histograms, cheap enough to stay on in release builds.
+//
+// Counters only ever increase. Histograms cover a rolling window: samples go into the current
+// window, which becomes the previous one after the window time and starts over empty. Stats
+// merge both, so they span between one and two window times of the most recent samples.
+//
+// One writer thread. Readers get a copy the writer publishes now and then, see LRFace::GetStats().
+//
+// Only depends on stdio through LRHistogram so that recorded runs can be replayed on the host.
+
+#define LR_TELEMETRY_STAGE_DETECT	0	// one global detection request on the detection thread
+#define LR_TELEMETRY_STAGE_LOCAL	1	// local search around a lost face
+#define LR_TELEMETRY_STAGE_PARTS	2	// parts search before a shape fit
+#define LR_TELEMETRY_STAGE_FIT		3	// shape fit
+#define LR_TELEMETRY_STAGE_TRACK	4	// shape track from the previous frame
+#define LR_TELEMETRY_STAGE_EYES		5	// eye openness and gaze
+#define LR_TELEMETRY_STAGE_NUM		6
+
+#define LR_TELEMETRY_EVENT_LOST				0	// shape track lost a face
+#define LR_TELEMETRY_EVENT_REACQUIRE_LOCAL	1	// lost face tracked again by the local search
+#define LR_TELEMETRY_EVENT_REACQUIRE_DETECT	2	// lost face tracked again from a global detection
+#define LR_TELEMETRY_EVENT_NEW_FACE			3	// face bound to a free slot
+#define LR_TELEMETRY_EVENT_RELEASE			4	// slot freed
+#define LR_TELEMETRY_EVENT_NUM				5
+
+#define LR_TELEMETRY_LOCK_FACE		0	// tracker state, by the tracking thread
+#define LR_TELEMETRY_LOCK_DETECT	1	// detection memory, by the detection thread
+#define LR_TELEMETRY_LOCK_NUM		2
+
+// Shape scores are kept in thousandths
+#define LR_TELEMETRY_SCORE_SCALE	1000.0f
+
+#define LR_TELEMETRY_WINDOW_DEFAULT	(10 * 1000 * 1000)
+
+struct LRTelemetryStats
+{
+	uint32_t frameCount;		// camera frames the pipeline ran on
+	uint32_t frameSkipCount;	// camera frames published while the tracker was busy, never seen
+	uint32_t frameDropCount;	// frames taken but not tracked, e.g. while the stages are loading
+	uint32_t eventCount[LR_TELEMETRY_EVENT_NUM];
+	uint32_t stageCount[LR_TELEMETRY_STAGE_NUM];	// runs
+	uint64_t stageTime[LR_TELEMETRY_STAGE_NUM];		// microseconds, all runs
+	uint32_t lockCount[LR_TELEMETRY_LOCK_NUM];
+	uint64_t lockWait[LR_TELEMETRY_LOCK_NUM];		// microseconds, all locks
+
+	uint64_t window;	// microseconds the histograms span
+	LRHistogram stageHist[LR_TELEMETRY_STAGE_NUM];	// microseconds per run
+	LRHistogram lockHist[LR_TELEMETRY_LOCK_NUM];	// microseconds waited per lock
+	LRHistogram scoreHist;	// shape score of every tracked frame, see LR_TELEMETRY_SCORE_SCALE
+};
+
+class LRTelemetry
+{
+public:
+
+	LRTelemetry();
+
+	void Reset();
+
+	// Microseconds after which the histograms start a new window
+	void SetWindow(uint64_t window);
+
+	// Frame the pipeline ran on, captured at time (microseconds). Rolls the window when due.
+	void AddFrame(uint64_t time, uint32_t skipped);
+
+	void AddDrop();
+
+	void AddEvent(int32_t event);
+
+	void AddStage(int32_t stage, uint32_t time);
+
+	// Runs only known by their total time, each goes into the histogram with the mean
+	void AddStageRuns(int32_t stage, uint32_t count, uint64_t time);
+
+	void AddLockWait(int32_t lock, uint32_t time);
+
+	void AddScore(float score);
+
+	void GetStats(LRTelemetryStats *stats) const;
+
+private:
+
+	uint64_t _window;
+	uint64_t _windowBegin;	// capture time the current window started at, 0 before the first frame
+	uint64_t _prevWindow;	// span of the previous window, 0 if there is none
+	uint64_t _lastTime;		// capture time of the last frame
+	int32_t _current;		// index of the current window
+
+	uint32_t _frameCount;
+	uint32_t _frameSkipCount;
+	uint32_t _frameDropCount;
+	uint32_t _eventCount[LR_TELEMETRY_EVENT_NUM];
+	uint32_t _stageCount[LR_TELEMETRY_STAGE_NUM];
+	uint64_t _stageTime[LR_TELEMETRY_STAGE_NUM];
+	uint32_t _lockCount[LR_TELEMETRY_LOCK_NUM];
+	uint64_t _lockWait[LR_TELEMETRY_LOCK_NUM];
+
+	// Previous and current window
+	LRHistogram _stageHist[2][LR_TELEMETRY_STAGE_NUM];
+	LRHistogram _lockHist[2][LR_TELEMETRY_LOCK_NUM];
+	LRHistogram _scoreHist[2];
+};
@@ -1,3 +1,3 @@
-#pragma once
-
+#pragma once
+
 #define ROUND_UP(x, a)	((((unsigned int)x)+((a)-1u))&(~((a)-1u)))
\ No newline at end of file
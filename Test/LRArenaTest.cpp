@@ -0,0 +1,255 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "LRTest.hpp"
+#include "../LiveRig/LRArena.hpp"
+
+// Checks the layouts LRArena::Plan() produces: conflicting stages never overlap, stages that
+// do not conflict share, and the plan is never larger than separate buffers. Covers the
+// conflict graph LRFace sets up and random ones.
+
+// Same as LR_FACE_STAGE_* in LRFace.hpp, which needs the SDK headers
+#define TEST_STAGE_DETECT		0
+#define TEST_STAGE_LOCAL		1
+#define TEST_STAGE_PARTS		2
+#define TEST_STAGE_SHAPE		3
+#define TEST_STAGE_ALLPARTS		4
+#define TEST_STAGE_ATTRIB		5
+#define TEST_STAGE_NUM			6
+
+#define TEST_RANDOM_NUM			5000
+
+namespace {
+	uint32_t Align(uint32_t size)
+	{
+		return (size + LR_ARENA_ALIGN - 1) & ~(uint32_t)(LR_ARENA_ALIGN - 1);
+	}
+
+	// Properties every plan must have, returns false on the first violation
+	bool CheckPlan(const LRArena *arena)
+	{
+		bool ok = true;
+		uint32_t largest = 0;
+
+		for (int32_t a = 0; a < LR_ARENA_STAGE_MAX; a++) {
+			const uint32_t sizeA = Align(arena->GetStageSize(a));
+			if (sizeA == 0)
+				continue;
+
+			const uint32_t offsetA = arena->GetOffset(a);
+			largest = sizeA > largest ? sizeA : largest;
+
+			ok = ok && offsetA % LR_ARENA_ALIGN == 0;
+			ok = ok && offsetA + sizeA <= arena->GetSize();
+
+			for (int32_t b = a + 1; b < LR_ARENA_STAGE_MAX; b++) {
+				const uint32_t sizeB = Align(arena->GetStageSize(b));
+				if (sizeB == 0 || !arena->IsConflict(a, b))
+					continue;
+
+				// [offset, offset + Align(size)) of both must not intersect
+				const uint32_t offsetB = arena->GetOffset(b);
+				ok = ok && (offsetA + sizeA <= offsetB || offsetB + sizeB <= offsetA);
+				ok = ok && arena->GetSize() >= sizeA + sizeB;
+			}
+		}
+
+		ok = ok && arena->GetSize() >= largest;
+		ok = ok && arena->GetSize() <= arena->GetSeparateSize();
+
+		return ok;
+	}
+
+	void TestShared()
+	{
+		LRArena arena;
+
+		// Nothing planned
+		LR_CHECK_EQ(arena.Plan(), 0);
+		LR_CHECK(arena.Get(0) == NULL);
+
+		// Without conflicts every stage starts at 0 and the largest sets the size
+		static const uint32_t sizes[] = { 1000, 64, 1, 70000, 4096 };
+		for (int32_t i = 0; i < 5; i++)
+			arena.SetSize(i, sizes[i]);
+
+		LR_CHECK_EQ(arena.Plan(), Align(70000));
+		for (int32_t i = 0; i < 5; i++)
+			LR_CHECK_EQ(arena.GetOffset(i), 0);
+		LR_CHECK_EQ(arena.GetSeparateSize(), Align(1000) + 64 + 64 + Align(70000) + 4096);
+		LR_CHECK(CheckPlan(&arena));
+
+		// A conflict only moves the stages involved
+		arena.SetConflict(2, 3);
+		LR_CHECK_EQ(arena.Plan(), Align(70000) + 64);
+		LR_CHECK_EQ(arena.GetOffset(3), 0);
+		LR_CHECK_EQ(arena.GetOffset(2), Align(70000));
+		LR_CHECK_EQ(arena.GetOffset(0), 0);
+		LR_CHECK(arena.IsConflict(3, 2));
+		LR_CHECK(!arena.IsConflict(0, 3));
+		LR_CHECK(CheckPlan(&arena));
+
+		// Every stage against every other is the sum of all
+		for (int32_t a = 0; a < 5; a++) {
+			for (int32_t b = a + 1; b < 5; b++)
+				arena.SetConflict(a, b);
+		}
+		LR_CHECK_EQ(arena.Plan(), arena.GetSeparateSize());
+		LR_CHECK(CheckPlan(&arena));
+
+		arena.Reset();
+		LR_CHECK_EQ(arena.Plan(), 0);
+		LR_CHECK(!arena.IsConflict(2, 3));
+	}
+
+	void CheckFacePlan(const uint32_t *sizes)
+	{
+		LRArena arena;
+
+		// As in LRFace: detection has its own thread, the tracking stages run one after another
+		for (int32_t i = 0; i < TEST_STAGE_NUM; i++) {
+			if (i != TEST_STAGE_DETECT)
+				arena.SetConflict(TEST_STAGE_DETECT, i);
+			arena.SetSize(i, sizes[i]);
+		}
+
+		uint32_t tracking = 0;
+		for (int32_t i = 0; i < TEST_STAGE_NUM; i++) {
+			if (i != TEST_STAGE_DETECT)
+				tracking = Align(sizes[i]) > tracking ? Align(sizes[i]) : tracking;
+		}
+
+		arena.Plan();
+		LR_CHECK(CheckPlan(&arena));
+
+		// Detection plus the largest tracking stage, the tracking stages all on the same spot
+		LR_CHECK_EQ(arena.GetSize(), Align(sizes[TEST_STAGE_DETECT]) + tracking);
+		uint32_t trackingOffset = 0xFFFFFFFF;
+		for (int32_t i = 0; i < TEST_STAGE_NUM; i++) {
+			if (i == TEST_STAGE_DETECT || sizes[i] == 0)
+				continue;
+			if (trackingOffset == 0xFFFFFFFF)
+				trackingOffset = arena.GetOffset(i);
+			LR_CHECK_EQ(arena.GetOffset(i), trackingOffset);
+		}
+
+		LR_CHECK(arena.Reserve());
+		LR_CHECK_EQ(arena.GetCapacity(), arena.GetSize());
+
+		// Disabled stages get no memory, the others aligned memory inside the region
+		for (int32_t i = 0; i < TEST_STAGE_NUM; i++) {
+			uint8_t *p = (uint8_t *)arena.Get(i);
+			if (sizes[i] == 0) {
+				LR_CHECK(p == NULL);
+				continue;
+			}
+
+			LR_CHECK(p != NULL);
+			LR_CHECK_EQ((uintptr_t)p % LR_ARENA_ALIGN, 0);
+			memset(p, i, sizes[i]);
+		}
+
+		// Detection runs while any tracking stage writes its whole region
+		const uint8_t *detect = (const uint8_t *)arena.Get(TEST_STAGE_DETECT);
+		bool intact = true;
+		for (uint32_t i = 0; i < sizes[TEST_STAGE_DETECT]; i++)
+			intact = intact && detect[i] == TEST_STAGE_DETECT;
+		LR_CHECK(intact);
+
+		printf("face stages: %u bytes instead of %u\n", arena.GetSize(), arena.GetSeparateSize());
+	}
+
+	void TestFaceStages()
+	{
+		// QVGA-like sizes with detection largest, with a tracking stage largest, and with the
+		// optional stages left out
+		static const uint32_t detectLargest[TEST_STAGE_NUM] = { 1200000, 310000, 220000, 520000, 410000, 90000 };
+		static const uint32_t shapeLargest[TEST_STAGE_NUM] = { 300000, 310000, 220000, 900001, 410000, 90000 };
+		static const uint32_t minimal[TEST_STAGE_NUM] = { 500000, 0, 220000, 520000, 0, 0 };
+
+		CheckFacePlan(detectLargest);
+		CheckFacePlan(shapeLargest);
+		CheckFacePlan(minimal);
+	}
+
+	void TestRandom()
+	{
+		uint32_t rand = 3;
+		uint32_t saved = 0;
+		uint32_t separate = 0;
+		int32_t failCount = 0;
+
+		for (int32_t n = 0; n < TEST_RANDOM_NUM; n++) {
+			LRArena arena;
+
+			const int32_t stageNum = 1 + LRTestRand(&rand) % LR_ARENA_STAGE_MAX;
+			for (int32_t i = 0; i < stageNum; i++) {
+				// Some left out, some tiny, some not a multiple of the alignment
+				uint32_t r = LRTestRand(&rand);
+				arena.SetSize(i, (r & 7) == 0 ? 0 : 1 + (r >> 3) % 100000);
+			}
+
+			const uint32_t density = LRTestRand(&rand) % 100;
+			for (int32_t a = 0; a < stageNum; a++) {
+				for (int32_t b = a + 1; b < stageNum; b++) {
+					if (LRTestRand(&rand) % 100 < density)
+						arena.SetConflict(a, b);
+				}
+			}
+
+			arena.Plan();
+			if (!CheckPlan(&arena))
+				failCount++;
+
+			saved += (arena.GetSeparateSize() - arena.GetSize()) / 1024;
+			separate += arena.GetSeparateSize() / 1024;
+		}
+
+		LR_CHECK_EQ(failCount, 0);
+		printf("random: %d plans, %u of %u KiB saved\n", TEST_RANDOM_NUM, saved, separate);
+	}
+
+	void TestReserve()
+	{
+		LRArena arena;
+		arena.SetSize(0, 1000);
+		arena.SetSize(1, 2000);
+		arena.SetConflict(0, 1);
+
+		// Nothing to hand out before the region exists
+		arena.Plan();
+		LR_CHECK(arena.Get(0) == NULL);
+		LR_CHECK(arena.Reserve());
+		LR_CHECK(arena.Get(0) != NULL);
+		const uint32_t capacity = arena.GetCapacity();
+
+		// A smaller plan keeps the region, a larger one grows it
+		arena.SetSize(1, 100);
+		arena.Plan();
+		LR_CHECK(arena.Reserve());
+		LR_CHECK_EQ(arena.GetCapacity(), capacity);
+
+		arena.SetSize(1, 100000);
+		arena.Plan();
+		LR_CHECK(arena.Get(1) == NULL);
+		LR_CHECK(arena.Reserve());
+		LR_CHECK(arena.GetCapacity() >= arena.GetSize());
+		LR_CHECK(arena.Get(1) != NULL);
+		LR_CHECK(CheckPlan(&arena));
+
+		arena.Free();
+		LR_CHECK(arena.Get(0) == NULL);
+		LR_CHECK_EQ(arena.GetCapacity(), 0);
+	}
+}
+
+int main()
+{
+	TestShared();
+	TestFaceStages();
+	TestRandom();
+	TestReserve();
+
+	return LR_TEST_RESULT();
+}
@@ -0,0 +1,249 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "LRTest.hpp"
+#include "../LiveRig/LRCaptureFile.hpp"
+
+// Records frames with LRCaptureWriter and replays them with LRCaptureReader in a temporary
+// directory: a round trip through padded rows, Peek(), the end of the file, a recording that
+// was cut short and files that are not recordings.
+
+#define TEST_WIDTH		40
+#define TEST_HEIGHT		30
+#define TEST_PITCH		48
+#define TEST_FRAME_NUM	5
+
+namespace {
+	char s_dir[64];
+	char s_path[96];
+
+	uint8_t Pixel(uint32_t n, int32_t x, int32_t y)
+	{
+		return (uint8_t)(n * 31 + x * 7 + y * 13);
+	}
+
+	void FillFrame(unsigned char *buf, uint32_t n)
+	{
+		for (int32_t y = 0; y < TEST_HEIGHT; y++) {
+			for (int32_t x = 0; x < TEST_PITCH; x++)
+				buf[y * TEST_PITCH + x] = x < TEST_WIDTH ? Pixel(n, x, y) : 0xEE;
+		}
+	}
+
+	bool CheckFrame(const unsigned char *buf, int32_t pitch, uint32_t n)
+	{
+		bool ok = true;
+		for (int32_t y = 0; y < TEST_HEIGHT; y++) {
+			for (int32_t x = 0; x < TEST_WIDTH; x++)
+				ok = ok && buf[y * pitch + x] == Pixel(n, x, y);
+		}
+
+		return ok;
+	}
+
+	uint64_t Timestamp(uint32_t n)
+	{
+		return 1000000000000ull + n * 16667;
+	}
+
+	void WriteRecording()
+	{
+		unsigned char frame[TEST_PITCH * TEST_HEIGHT];
+
+		LRCaptureWriter writer;
+		LR_CHECK(!writer.IsOpen());
+		LR_CHECK_EQ(writer.Write(1, 1, frame, TEST_PITCH), LR_CAPTURE_ERROR_IO);
+
+		LR_CHECK_EQ(writer.Open(s_path, TEST_WIDTH, TEST_HEIGHT), 0);
+		LR_CHECK(writer.IsOpen());
+
+		// Rows padded as in the frame ring, only the width is recorded
+		for (uint32_t n = 0; n < TEST_FRAME_NUM; n++) {
+			FillFrame(frame, n);
+			LR_CHECK_EQ(writer.Write(100 + n, Timestamp(n), frame, TEST_PITCH), 0);
+		}
+		LR_CHECK_EQ(writer.GetFrameCount(), TEST_FRAME_NUM);
+
+		writer.Close();
+		LR_CHECK(!writer.IsOpen());
+	}
+
+	long FileSize(const char *path)
+	{
+		FILE *fp = fopen(path, "rb");
+		if (fp == NULL)
+			return -1;
+
+		fseek(fp, 0, SEEK_END);
+		long size = ftell(fp);
+		fclose(fp);
+
+		return size;
+	}
+
+	void TestRoundTrip()
+	{
+		WriteRecording();
+		LR_CHECK_EQ(FileSize(s_path), sizeof(LRCaptureHeader) + TEST_FRAME_NUM * (16 + TEST_WIDTH * TEST_HEIGHT));
+
+		LRCaptureReader reader;
+		LR_CHECK_EQ(reader.Open(s_path), 0);
+		LR_CHECK_EQ(reader.GetWidth(), TEST_WIDTH);
+		LR_CHECK_EQ(reader.GetHeight(), TEST_HEIGHT);
+
+		unsigned char padded[TEST_PITCH * TEST_HEIGHT];
+		unsigned char packed[TEST_WIDTH * TEST_HEIGHT];
+		uint64_t frame;
+		uint64_t timestamp;
+
+		for (uint32_t n = 0; n < TEST_FRAME_NUM; n++) {
+			// Peek does not consume the record, twice in a row gives the same one
+			uint64_t peekFrame = 0;
+			uint64_t peekTimestamp = 0;
+			LR_CHECK_EQ(reader.Peek(&peekFrame, &peekTimestamp), 0);
+			LR_CHECK_EQ(reader.Peek(&peekFrame, &peekTimestamp), 0);
+			LR_CHECK_EQ(peekFrame, 100 + n);
+			LR_CHECK(peekTimestamp == Timestamp(n));
+
+			// Into a padded and a packed buffer alternately, the padding is left alone
+			if (n & 1) {
+				memset(packed, 0, sizeof(packed));
+				LR_CHECK_EQ(reader.Read(&frame, &timestamp, packed, TEST_WIDTH), 0);
+				LR_CHECK(CheckFrame(packed, TEST_WIDTH, n));
+			}
+			else {
+				memset(padded, 0x55, sizeof(padded));
+				LR_CHECK_EQ(reader.Read(&frame, &timestamp, padded, TEST_PITCH), 0);
+				LR_CHECK(CheckFrame(padded, TEST_PITCH, n));
+				LR_CHECK(padded[TEST_PITCH - 1] == 0x55);
+			}
+			LR_CHECK_EQ(frame, 100 + n);
+			LR_CHECK(timestamp == Timestamp(n));
+		}
+
+		// The end is reported by both, and again on every later call
+		LR_CHECK_EQ(reader.Peek(&frame, &timestamp), LR_CAPTURE_ERROR_EOF);
+		LR_CHECK_EQ(reader.Read(&frame, &timestamp, padded, TEST_PITCH), LR_CAPTURE_ERROR_EOF);
+		LR_CHECK_EQ(reader.Read(&frame, &timestamp, padded, TEST_PITCH), LR_CAPTURE_ERROR_EOF);
+
+		// Rewind starts over at the first record
+		LR_CHECK_EQ(reader.Rewind(), 0);
+		LR_CHECK_EQ(reader.Read(&frame, &timestamp, packed, TEST_WIDTH), 0);
+		LR_CHECK_EQ(frame, 100);
+		LR_CHECK(CheckFrame(packed, TEST_WIDTH, 0));
+
+		reader.Close();
+		LR_CHECK(!reader.IsOpen());
+		LR_CHECK_EQ(reader.Read(&frame, &timestamp, packed, TEST_WIDTH), LR_CAPTURE_ERROR_IO);
+	}
+
+	// Reads every record of a recording cut to size, returns the number read before the end
+	int32_t ReadTruncated(long size)
+	{
+		WriteRecording();
+		LR_CHECK_EQ(truncate(s_path, size), 0);
+
+		LRCaptureReader reader;
+		LR_CHECK_EQ(reader.Open(s_path), 0);
+
+		unsigned char padded[TEST_PITCH * TEST_HEIGHT];
+		uint64_t frame;
+		uint64_t timestamp;
+		int32_t count = 0;
+		int ret;
+
+		// Whole planes and row by row
+		while ((ret = reader.Read(&frame, &timestamp, padded, count & 1 ? TEST_PITCH : TEST_WIDTH)) == 0)
+			count++;
+
+		LR_CHECK_EQ(ret, LR_CAPTURE_ERROR_EOF);
+		LR_CHECK_EQ(reader.Read(&frame, &timestamp, padded, TEST_PITCH), LR_CAPTURE_ERROR_EOF);
+		LR_CHECK_EQ(reader.Read(&frame, &timestamp, padded, TEST_WIDTH), LR_CAPTURE_ERROR_EOF);
+
+		return count;
+	}
+
+	void TestTruncated()
+	{
+		const long header = sizeof(LRCaptureHeader);
+		const long record = 16 + TEST_WIDTH * TEST_HEIGHT;
+
+		// Cut in the payload, in the record header and on a record boundary
+		LR_CHECK_EQ(ReadTruncated(header + 3 * record + 16 + 100), 3);
+		LR_CHECK_EQ(ReadTruncated(header + 3 * record + 7), 3);
+		LR_CHECK_EQ(ReadTruncated(header + 3 * record), 3);
+		LR_CHECK_EQ(ReadTruncated(header + record - 1), 0);
+		LR_CHECK_EQ(ReadTruncated(header), 0);
+	}
+
+	void CheckOpen(const LRCaptureHeader *header, long size, int expected)
+	{
+		FILE *fp = fopen(s_path, "wb");
+		LR_CHECK(fp != NULL);
+		if (fp == NULL)
+			return;
+
+		fwrite(header, size, 1, fp);
+		fclose(fp);
+
+		LRCaptureReader reader;
+		LR_CHECK_EQ(reader.Open(s_path), expected);
+		LR_CHECK_EQ(reader.IsOpen(), expected == 0);
+	}
+
+	void TestFormat()
+	{
+		const LRCaptureHeader good = { LR_CAPTURE_MAGIC, LR_CAPTURE_VERSION, TEST_WIDTH, TEST_HEIGHT };
+		LRCaptureHeader header;
+
+		CheckOpen(&good, sizeof(good), 0);
+
+		header = good;
+		header.magic = 0x4643524D;
+		CheckOpen(&header, sizeof(header), LR_CAPTURE_ERROR_FORMAT);
+
+		header = good;
+		header.version = LR_CAPTURE_VERSION + 1;
+		CheckOpen(&header, sizeof(header), LR_CAPTURE_ERROR_FORMAT);
+
+		header = good;
+		header.width = 0;
+		CheckOpen(&header, sizeof(header), LR_CAPTURE_ERROR_FORMAT);
+
+		CheckOpen(&good, sizeof(good) - 1, LR_CAPTURE_ERROR_FORMAT);
+		CheckOpen(&good, 0, LR_CAPTURE_ERROR_FORMAT);
+
+		// Missing file and directory
+		remove(s_path);
+		LRCaptureReader reader;
+		LR_CHECK_EQ(reader.Open(s_path), LR_CAPTURE_ERROR_IO);
+
+		char badPath[128];
+		snprintf(badPath, sizeof(badPath), "%s/missing/capture.lrcf", s_dir);
+		LRCaptureWriter writer;
+		LR_CHECK_EQ(writer.Open(badPath, TEST_WIDTH, TEST_HEIGHT), LR_CAPTURE_ERROR_IO);
+		LR_CHECK(!writer.IsOpen());
+	}
+}
+
+int main()
+{
+	snprintf(s_dir, sizeof(s_dir), "/tmp/LRCaptureFileTestXXXXXX");
+	if (mkdtemp(s_dir) == NULL) {
+		printf("mkdtemp() failed\n");
+		return 1;
+	}
+	snprintf(s_path, sizeof(s_path), "%s/capture.lrcf", s_dir);
+
+	TestRoundTrip();
+	TestTruncated();
+	TestFormat();
+
+	remove(s_path);
+	rmdir(s_dir);
+
+	return LR_TEST_RESULT();
+}
@@ -0,0 +1,231 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "LRTest.hpp"
+#include "../LiveRig/LRExposureSearch.hpp"
+
+// Drives LRExposureSearch with a simulated camera: the mean luma moves towards the one of the
+// new level over a few frames after every change, and each level has a fixed detection score.
+// Checks the level found and the number of measurements on unimodal, flat, edge-peak and
+// no-face score curves over the 17 levels of the camera EV table.
+
+#define TEST_LEVEL_NUM		17
+// Frames after which a search counts as stuck
+#define TEST_FRAME_MAX		2000
+
+namespace {
+	struct Camera
+	{
+		float score[TEST_LEVEL_NUM];
+		float luma;
+		float flicker;	// luma added on odd frames and taken off on even ones
+	};
+
+	struct Run
+	{
+		int32_t best;
+		float bestScore;
+		uint32_t measureCount;
+		uint32_t frameCount;
+		bool finished;
+	};
+
+	float TargetLuma(int32_t level)
+	{
+		return 30.0f + level * 10.0f;
+	}
+
+	void Search(Camera *camera, int32_t start, Run *run)
+	{
+		LRExposureSearch search;
+		search.Start(TEST_LEVEL_NUM, start);
+
+		camera->luma = TargetLuma(start);
+		run->frameCount = 0;
+		run->finished = false;
+
+		uint32_t lastProgress = 0;
+		int32_t measured[TEST_LEVEL_NUM];
+		memset(measured, 0, sizeof(measured));
+
+		while (search.IsActive() && run->frameCount < TEST_FRAME_MAX) {
+			const int32_t level = search.GetLevel();
+			LR_CHECK(level >= 0 && level < TEST_LEVEL_NUM);
+
+			// Auto exposure converging on the new level
+			camera->luma += (TargetLuma(level) - camera->luma) * 0.5f;
+			run->frameCount++;
+			float flicker = (run->frameCount & 1) != 0 ? camera->flicker : -camera->flicker;
+
+			if (!search.AddLuma(camera->luma + flicker))
+				continue;
+
+			if (search.AddScore(camera->score[level])) {
+				measured[level]++;
+
+				uint32_t progress = search.GetProgress();
+				LR_CHECK(search.IsActive() ? progress < 100 : progress == 100);
+				lastProgress = progress;
+			}
+		}
+
+		run->finished = !search.IsActive();
+		run->measureCount = search.GetMeasureCount();
+		run->best = search.GetBest(&run->bestScore);
+		LR_CHECK_EQ(lastProgress, 100);
+
+		// No level is measured twice, and the camera is left at the best one
+		for (int32_t i = 0; i < TEST_LEVEL_NUM; i++)
+			LR_CHECK(measured[i] <= 1);
+		if (run->best >= 0)
+			LR_CHECK_EQ(search.GetLevel(), run->best);
+	}
+
+	void InitCamera(Camera *camera)
+	{
+		memset(camera, 0, sizeof(Camera));
+	}
+
+	// A single peak anywhere, including both ends of the table, found from any start
+	void TestUnimodal()
+	{
+		uint32_t minCount = 0xFFFFFFFF;
+		uint32_t maxCount = 0;
+		uint32_t maxFrames = 0;
+		uint32_t anyStartMax = 0;
+
+		for (int32_t peak = 0; peak < TEST_LEVEL_NUM; peak++) {
+			for (int32_t start = 0; start < TEST_LEVEL_NUM; start++) {
+				Camera camera;
+				InitCamera(&camera);
+				for (int32_t i = 0; i < TEST_LEVEL_NUM; i++)
+					camera.score[i] = 1.0f / (1.0f + 0.1f * (i - peak) * (i - peak));
+
+				Run run;
+				Search(&camera, start, &run);
+				LR_CHECK(run.finished);
+				LR_CHECK_EQ(run.best, peak);
+
+				// The claim in LRExposureSearch.hpp, from the usual start in the middle and from anywhere
+				anyStartMax = run.measureCount > anyStartMax ? run.measureCount : anyStartMax;
+				if (start == TEST_LEVEL_NUM / 2) {
+					minCount = run.measureCount < minCount ? run.measureCount : minCount;
+					maxCount = run.measureCount > maxCount ? run.measureCount : maxCount;
+					maxFrames = run.frameCount > maxFrames ? run.frameCount : maxFrames;
+				}
+			}
+		}
+
+		LR_CHECK(minCount >= 6);
+		LR_CHECK(maxCount <= 8);
+		LR_CHECK(anyStartMax <= 9);
+		printf("unimodal: %u to %u measurements from the middle, at most %u frames, at most %u from any start\n",
+			minCount, maxCount, maxFrames, anyStartMax);
+	}
+
+	// Every level equally good: the start is kept and only the pattern around it is measured
+	void TestFlat()
+	{
+		Camera camera;
+		InitCamera(&camera);
+		for (int32_t i = 0; i < TEST_LEVEL_NUM; i++)
+			camera.score[i] = 0.5f;
+
+		Run run;
+		Search(&camera, TEST_LEVEL_NUM / 2, &run);
+		LR_CHECK(run.finished);
+		LR_CHECK_EQ(run.best, TEST_LEVEL_NUM / 2);
+		LR_CHECK_EQ(run.measureCount, 7);
+	}
+
+	// Only a narrow range at either end of the table sees the face, the rest scores 0
+	void TestEdgePeak()
+	{
+		for (int32_t peak = 0; peak < TEST_LEVEL_NUM; peak += TEST_LEVEL_NUM - 1) {
+			Camera camera;
+			InitCamera(&camera);
+			camera.score[peak] = 0.9f;
+			camera.score[peak == 0 ? 1 : peak - 1] = 0.4f;
+
+			Run run;
+			Search(&camera, TEST_LEVEL_NUM / 2, &run);
+			LR_CHECK(run.finished);
+			LR_CHECK_EQ(run.best, peak);
+			LR_CHECK(run.measureCount < TEST_LEVEL_NUM);
+			printf("edge peak at %d: %u measurements\n", peak, run.measureCount);
+		}
+	}
+
+	// No face at any level: every level ends up measured, nothing is best
+	void TestNoFace()
+	{
+		Camera camera;
+		InitCamera(&camera);
+
+		Run run;
+		Search(&camera, TEST_LEVEL_NUM / 2, &run);
+		LR_CHECK(run.finished);
+		LR_CHECK_EQ(run.best, -1);
+		LR_CHECK_EQ(run.measureCount, TEST_LEVEL_NUM);
+	}
+
+	// A flickering image never settles: every level is taken after LR_EXPOSURE_SETTLE_MAX frames
+	void TestFlicker()
+	{
+		Camera camera;
+		InitCamera(&camera);
+		camera.flicker = 2.0f * LR_EXPOSURE_SETTLE_DELTA;
+		for (int32_t i = 0; i < TEST_LEVEL_NUM; i++)
+			camera.score[i] = 1.0f / (1.0f + 0.1f * (i - 5) * (i - 5));
+
+		Run run;
+		Search(&camera, TEST_LEVEL_NUM / 2, &run);
+		LR_CHECK(run.finished);
+		LR_CHECK_EQ(run.best, 5);
+		LR_CHECK(run.frameCount <= run.measureCount * (LR_EXPOSURE_SETTLE_MAX + LR_EXPOSURE_SAMPLE_NUM));
+	}
+
+	void TestSettle()
+	{
+		LRExposureSearch search;
+		search.Start(TEST_LEVEL_NUM, 3);
+
+		// Not before the level can have taken effect, then once stable
+		LR_CHECK(!search.AddLuma(50.0f));
+		LR_CHECK(!search.AddLuma(50.0f));
+		LR_CHECK(search.AddLuma(50.0f));
+
+		// A jump in the image restarts the samples of the level
+		LR_CHECK(!search.AddScore(0.5f));
+		LR_CHECK(!search.AddLuma(80.0f));
+		LR_CHECK(!search.AddLuma(80.5f));
+		LR_CHECK(search.AddLuma(80.0f));
+		LR_CHECK(!search.AddScore(0.7f));
+		LR_CHECK(search.AddLuma(80.0f));
+		LR_CHECK(search.AddScore(0.7f));
+		LR_CHECK_EQ(search.GetMeasureCount(), 1);
+
+		float score;
+		LR_CHECK_EQ(search.GetBest(&score), 3);
+		LR_CHECK_NEAR(score, 0.7f, 0.00001f);
+
+		search.Abort();
+		LR_CHECK(!search.IsActive());
+		LR_CHECK(!search.AddLuma(80.0f));
+		LR_CHECK(!search.AddScore(0.7f));
+	}
+}
+
+int main()
+{
+	TestSettle();
+	TestUnimodal();
+	TestFlat();
+	TestEdgePeak();
+	TestNoFace();
+	TestFlicker();
+
+	return LR_TEST_RESULT();
+}
@@ -0,0 +1,253 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "LRTest.hpp"
+#include "../LiveRig/LRFeatures.hpp"
+
+// Checks that LRFeatures gives the same features for a face at any roll, size, position and
+// image aspect, cross-checks the scalar and NEON paths on noisy shapes and times both. Without
+// NEON on the host the SIMD path falls back to the scalar one; run it on an ARM host to check
+// the NEON path.
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define TEST_NEON	"NEON"
+#else
+#define TEST_NEON	"scalar fallback, no NEON on this host"
+#endif
+
+#define TEST_RANDOM_NUM		10000
+#define TEST_BENCH_NUM		200000
+
+namespace {
+	struct Shape
+	{
+		float x[LR_FEATURES_POINT_NUM];
+		float y[LR_FEATURES_POINT_NUM];
+	};
+
+	void SetPoint(Shape *shape, int32_t i, float x, float y)
+	{
+		shape->x[i] = x;
+		shape->y[i] = y;
+	}
+
+	// Corners first, then three points on each lid. The mean is the center.
+	void SetEye(Shape *shape, int32_t first, float cx, bool upperFirst)
+	{
+		const float lid = upperFirst ? -1.0f : 1.0f;
+
+		SetPoint(shape, first, cx - 0.15f, 0.0f);
+		SetPoint(shape, first + 1, cx - 0.08f, 0.05f * lid);
+		SetPoint(shape, first + 2, cx, 0.06f * lid);
+		SetPoint(shape, first + 3, cx + 0.08f, 0.05f * lid);
+		SetPoint(shape, first + 4, cx + 0.15f, 0.0f);
+		SetPoint(shape, first + 5, cx + 0.08f, -0.05f * lid);
+		SetPoint(shape, first + 6, cx, -0.06f * lid);
+		SetPoint(shape, first + 7, cx - 0.08f, -0.05f * lid);
+	}
+
+	// A frontal face in the normalized frame: eyes at (-0.5, 0) and (0.5, 0), y down
+	void MakeFace(Shape *shape)
+	{
+		SetEye(shape, 0, -0.5f, true);
+		SetEye(shape, 8, 0.5f, false);
+
+		for (int32_t i = 0; i < 5; i++) {
+			SetPoint(shape, 16 + i, -0.7f + i * 0.1f, -0.3f + fabsf(i - 2.0f) * 0.03f);
+			SetPoint(shape, 21 + i, 0.3f + i * 0.1f, -0.25f + fabsf(i - 2.0f) * 0.03f);
+		}
+
+		for (int32_t i = 0; i < 11; i++)
+			SetPoint(shape, 26 + i, (i - 5) * 0.04f, 0.1f + i * 0.05f);
+
+		// Corners 37 and 41, upper lip 38-40, lower lip 42-44
+		SetPoint(shape, 37, -0.4f, 1.1f);
+		SetPoint(shape, 38, -0.2f, 1.02f);
+		SetPoint(shape, 39, 0.0f, 1.0f);
+		SetPoint(shape, 40, 0.2f, 1.02f);
+		SetPoint(shape, 41, 0.4f, 1.1f);
+		SetPoint(shape, 42, 0.2f, 1.25f);
+		SetPoint(shape, 43, 0.0f, 1.3f);
+		SetPoint(shape, 44, -0.2f, 1.25f);
+		SetPoint(shape, 45, 0.05f, 1.6f);
+	}
+
+	// Places the face in an image: rotated by roll, scaled, moved and squeezed by the aspect
+	void Transform(const Shape *face, float roll, float scale, float cx, float cy, float aspect, Shape *out)
+	{
+		const float c = cosf(roll) * scale;
+		const float s = sinf(roll) * scale;
+
+		for (int32_t i = 0; i < LR_FEATURES_POINT_NUM; i++) {
+			out->x[i] = (cx + c * face->x[i] - s * face->y[i]) / aspect;
+			out->y[i] = cy + s * face->x[i] + c * face->y[i];
+		}
+	}
+
+	void TestKnownValues()
+	{
+		Shape face;
+		MakeFace(&face);
+
+		LRFeatures features;
+		LRFeatureResult result;
+		LR_CHECK(features.Compute(face.x, face.y, 1.0f, &result));
+
+		LR_CHECK_NEAR(result.scale, 1.0f, 0.00001f);
+		LR_CHECK_NEAR(result.roll, 0.0f, 0.00001f);
+		LR_CHECK_NEAR(result.value[LR_FEATURE_MOUTH_OPEN], 0.28f, 0.00001f);
+		LR_CHECK_NEAR(result.value[LR_FEATURE_MOUTH_WIDTH], 0.8f, 0.00001f);
+		// Lid gap of the middle points over the corner distance
+		LR_CHECK_NEAR(result.value[LR_FEATURE_EYE_L_OPEN], (0.1f + 0.12f + 0.1f) / 3.0f / 0.3f, 0.00001f);
+		LR_CHECK_NEAR(result.value[LR_FEATURE_EYE_R_OPEN], (0.1f + 0.12f + 0.1f) / 3.0f / 0.3f, 0.00001f);
+		LR_CHECK_NEAR(result.value[LR_FEATURE_BROW_R], 0.3f - 0.036f, 0.00001f);
+		LR_CHECK_NEAR(result.value[LR_FEATURE_BROW_L], 0.25f - 0.036f, 0.00001f);
+
+		// Eyes on the same spot cannot be normalized
+		Shape flat;
+		memset(&flat, 0, sizeof(flat));
+		LR_CHECK(!features.Compute(flat.x, flat.y, 1.0f, &result));
+		LR_CHECK_EQ(result.scale, 0);
+	}
+
+	void TestInvariance()
+	{
+		static const float rolls[] = { 0.0f, 0.1f, -0.3f, 0.8f, -1.4f, 2.5f, -3.0f };
+		static const float scales[] = { 0.05f, 0.2f, 1.0f, 37.0f };
+		static const float aspects[] = { 1.0f, 4.0f / 3.0f, 16.0f / 9.0f };
+
+		Shape face;
+		MakeFace(&face);
+
+		LRFeatures features;
+		LRFeatureResult reference;
+		features.Compute(face.x, face.y, 1.0f, &reference);
+
+		for (int32_t simd = 0; simd < 2; simd++) {
+			features.SetSimd(simd != 0);
+			double maxError = 0.0;
+
+			for (size_t r = 0; r < sizeof(rolls) / sizeof(rolls[0]); r++) {
+				for (size_t s = 0; s < sizeof(scales) / sizeof(scales[0]); s++) {
+					for (size_t a = 0; a < sizeof(aspects) / sizeof(aspects[0]); a++) {
+						const float cx = 0.6f * aspects[a];
+						const float cy = 0.4f;
+
+						Shape image;
+						Transform(&face, rolls[r], scales[s], cx, cy, aspects[a], &image);
+
+						LRFeatureResult result;
+						LR_CHECK(features.Compute(image.x, image.y, aspects[a], &result));
+
+						// The pose comes out as it went in
+						LR_CHECK_NEAR(result.roll, rolls[r], 0.0001f);
+						LR_CHECK_NEAR(result.scale / scales[s], 1.0f, 0.0001f);
+						LR_CHECK_NEAR(result.centerX, cx / aspects[a], 0.0001f * scales[s]);
+						LR_CHECK_NEAR(result.centerY, cy, 0.0001f * scales[s]);
+
+						// The features and normalized points do not change
+						for (int32_t i = 0; i < LR_FEATURE_NUM; i++) {
+							double e = fabs((double)result.value[i] - reference.value[i]);
+							maxError = e > maxError ? e : maxError;
+						}
+						for (int32_t i = 0; i < LR_FEATURES_POINT_NUM; i++) {
+							double e = fabs((double)result.x[i] - face.x[i]) + fabs((double)result.y[i] - face.y[i]);
+							maxError = e > maxError ? e : maxError;
+						}
+						for (int32_t i = LR_FEATURES_POINT_NUM; i < LR_FEATURES_POINT_PAD; i++)
+							LR_CHECK(result.x[i] == 0.0f && result.y[i] == 0.0f);
+					}
+				}
+			}
+
+			LR_CHECK(maxError < 0.0001);
+			printf("invariance (%s): largest error %.2g\n", simd != 0 ? "simd" : "scalar", maxError);
+		}
+	}
+
+	void TestRandom()
+	{
+		Shape face;
+		MakeFace(&face);
+
+		LRFeatures scalar;
+		LRFeatures simd;
+		scalar.SetSimd(false);
+		simd.SetSimd(true);
+
+		uint32_t rand = 5;
+		double maxDiff = 0.0;
+
+		for (int32_t n = 0; n < TEST_RANDOM_NUM; n++) {
+			// Tracker noise on a face somewhere in a QVGA sized frame
+			Shape image;
+			Transform(&face, (LRTestRand(&rand) % 2000) * 0.001f - 1.0f, 0.05f + (LRTestRand(&rand) % 1000) * 0.0003f,
+				(LRTestRand(&rand) % 1000) * 0.001f, (LRTestRand(&rand) % 1000) * 0.001f, 1.0f, &image);
+			for (int32_t i = 0; i < LR_FEATURES_POINT_NUM; i++) {
+				image.x[i] += ((LRTestRand(&rand) % 1000) - 500.0f) * 0.000005f;
+				image.y[i] += ((LRTestRand(&rand) % 1000) - 500.0f) * 0.000005f;
+			}
+
+			LRFeatureResult a;
+			LRFeatureResult b;
+			LR_CHECK(scalar.Compute(image.x, image.y, 4.0f / 3.0f, &a));
+			LR_CHECK(simd.Compute(image.x, image.y, 4.0f / 3.0f, &b));
+
+			// The NEON sums run in another order, only rounding may differ
+			for (int32_t i = 0; i < LR_FEATURE_NUM; i++) {
+				double d = fabs((double)a.value[i] - b.value[i]) / (1.0 + fabs((double)a.value[i]));
+				maxDiff = d > maxDiff ? d : maxDiff;
+			}
+		}
+
+		LR_CHECK(maxDiff < 0.00001);
+		printf("random: %d shapes, largest scalar/simd difference %.2g (%s)\n", TEST_RANDOM_NUM, maxDiff, TEST_NEON);
+	}
+
+	double Bench(const LRFeatures *features, const Shape *shape)
+	{
+		LRFeatureResult result;
+		float sum = 0.0f;
+		uint64_t begin = LRTestTime();
+
+		for (int32_t i = 0; i < TEST_BENCH_NUM; i++) {
+			features->Compute(shape->x, shape->y, 4.0f / 3.0f, &result);
+			sum += result.value[i % LR_FEATURE_NUM];
+		}
+
+		double time = (double)(LRTestTime() - begin) * 1000.0 / TEST_BENCH_NUM;
+
+		// Keeps the loop from being optimized out
+		LR_CHECK(sum == sum);
+
+		return time;
+	}
+
+	void BenchFeatures()
+	{
+		Shape face;
+		Shape image;
+		MakeFace(&face);
+		Transform(&face, 0.2f, 0.15f, 0.5f, 0.5f, 4.0f / 3.0f, &image);
+
+		LRFeatures features;
+		features.SetSimd(false);
+		double scalar = Bench(&features, &image);
+		features.SetSimd(true);
+		double simd = Bench(&features, &image);
+
+		printf("compute: scalar %.1f ns, simd %.1f ns (%s)\n", scalar, simd, TEST_NEON);
+	}
+}
+
+int main()
+{
+	TestKnownValues();
+	TestInvariance();
+	TestRandom();
+	BenchFeatures();
+
+	return LR_TEST_RESULT();
+}
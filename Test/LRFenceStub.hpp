@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+
+#include "../LiveRig/LRFence.hpp"
+
+// Host stand-in for the GXM timeline in LRGXM: the render thread submits the scene it was
+// recording, another thread plays the GPU and completes the serials in submission order.
+class LRFenceStub : public LRFenceTimeline
+{
+public:
+
+	LRFenceStub() :
+		_pending(1),
+		_completed(0),
+		_waitCount(0)
+	{
+
+	}
+
+	uint32_t GetPendingSerial()
+	{
+		return _pending.load();
+	}
+
+	uint32_t GetCompletedSerial()
+	{
+		return _completed.load();
+	}
+
+	void WaitSerial(uint32_t serial)
+	{
+		_waitCount++;
+
+		while (!IsSerialComplete(serial))
+			std::this_thread::yield();
+	}
+
+	// Ends the scene being recorded, returns its serial
+	uint32_t Submit()
+	{
+		return _pending.fetch_add(1);
+	}
+
+	// GPU side, serials complete in order
+	void Complete(uint32_t serial)
+	{
+		_completed.store(serial);
+	}
+
+	uint32_t GetWaitCount() const
+	{
+		return _waitCount.load();
+	}
+
+private:
+
+	std::atomic<uint32_t> _pending;
+	std::atomic<uint32_t> _completed;
+	std::atomic<uint32_t> _waitCount;
+};
@@ -0,0 +1,235 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include "LRTest.hpp"
+#include "LRFenceStub.hpp"
+#include "../LiveRig/LRFrameRing.hpp"
+
+// Ordering between the camera producer and scenes sampling ring slots, with LRFenceStub
+// in place of the GPU: BeginWrite() must never hand out a slot a pending scene still samples.
+
+#define TEST_WIDTH			64
+#define TEST_HEIGHT			8
+#define TEST_SIZE			(TEST_WIDTH * TEST_HEIGHT)
+#define TEST_RING_SIZE		3
+#define TEST_FRAME_NUM		20000
+// Scenes submitted but not completed, like a double buffered display. With the latest slot
+// that can be every slot of the ring, so the producer has to wait now and then.
+#define TEST_SCENE_DEPTH	2
+
+typedef LRFrameRing<TEST_RING_SIZE> TestRing;
+
+namespace {
+	unsigned char s_buffer[TEST_RING_SIZE][TEST_SIZE];
+
+	struct Scene
+	{
+		const LRFrame *slot;
+		uint64_t frame;
+		uint32_t serial;
+	};
+
+	struct StressState
+	{
+		TestRing ring;
+		LRFenceStub timeline;
+		std::atomic<bool> producerDone;
+		std::atomic<bool> renderDone;
+
+		// Serial of the last scene that sampled each slot, written by the render thread
+		std::atomic<uint32_t> sampled[TEST_RING_SIZE];
+
+		std::mutex sceneMtx;
+		Scene scene[TEST_SCENE_DEPTH];
+		int32_t sceneHead;
+		int32_t sceneCount;
+
+		uint32_t sceneNum;
+		uint32_t reuseCount;
+	};
+
+	void Fill(LRFrame *slot, uint64_t frame)
+	{
+		memset(slot->data, (int)(frame & 0xFF), TEST_SIZE);
+		memcpy(slot->data, &frame, sizeof(frame));
+	}
+
+	// Frame number the contents were filled with, or 0 if they are torn
+	uint64_t ReadFrame(const LRFrame *slot)
+	{
+		uint64_t frame;
+		memcpy(&frame, slot->data, sizeof(frame));
+
+		for (int i = sizeof(frame); i < TEST_SIZE; i++) {
+			if (slot->data[i] != (unsigned char)(frame & 0xFF))
+				return 0;
+		}
+
+		return frame;
+	}
+
+	void TestStub()
+	{
+		LRFenceStub timeline;
+
+		LR_CHECK(timeline.IsSerialComplete(0));
+		LR_CHECK(!timeline.IsSerialComplete(1));
+
+		uint32_t serial = timeline.Submit();
+		LR_CHECK_EQ(serial, 1);
+		LR_CHECK_EQ(timeline.GetPendingSerial(), 2);
+
+		timeline.Complete(serial);
+		LR_CHECK(timeline.IsSerialComplete(1));
+		LR_CHECK(!timeline.IsSerialComplete(2));
+
+		// Comparisons survive the serial wrapping around
+		LR_CHECK(!timeline.IsSerialComplete(0x80000000));
+	}
+
+	void Producer(StressState *state)
+	{
+		for (uint64_t frame = 1; frame <= TEST_FRAME_NUM; frame++) {
+			LRFrame *slot = state->ring.BeginWrite();
+			LR_CHECK(slot != NULL);
+			if (slot == NULL)
+				continue;
+
+			int32_t index = state->ring.GetIndex(slot);
+			uint32_t sampled = state->sampled[index].load();
+			LR_CHECK(state->timeline.IsSerialComplete(sampled));
+			if (sampled != 0)
+				state->reuseCount++;
+
+			Fill(slot, frame);
+			state->ring.EndWrite(frame, frame * 33333);
+
+			if ((frame & 3) == 0)
+				std::this_thread::yield();
+		}
+
+		state->producerDone.store(true);
+	}
+
+	void Render(StressState *state)
+	{
+		while (!state->producerDone.load()) {
+			// Wait for a free scene, as the display queue would
+			while (1) {
+				{
+					std::lock_guard<std::mutex> lock(state->sceneMtx);
+					if (state->sceneCount < TEST_SCENE_DEPTH)
+						break;
+				}
+				std::this_thread::yield();
+			}
+
+			uint32_t serial = state->timeline.GetPendingSerial();
+			const LRFrame *slot = state->ring.AcquireForGpu();
+			uint64_t frame = 0;
+			if (slot != NULL) {
+				frame = ReadFrame(slot);
+				LR_CHECK(frame != 0 && frame == slot->frame);
+
+				state->sampled[state->ring.GetIndex(slot)].store(serial);
+			}
+
+			// Scenes without a frame still go through the queue, serials complete in order
+			{
+				std::lock_guard<std::mutex> lock(state->sceneMtx);
+				Scene *scene = &state->scene[(state->sceneHead + state->sceneCount) % TEST_SCENE_DEPTH];
+				scene->slot = slot;
+				scene->frame = frame;
+				scene->serial = serial;
+				state->sceneCount++;
+				if (slot != NULL)
+					state->sceneNum++;
+			}
+
+			LR_CHECK_EQ(state->timeline.Submit(), serial);
+
+			std::this_thread::yield();
+		}
+
+		state->renderDone.store(true);
+	}
+
+	void Gpu(StressState *state)
+	{
+		while (1) {
+			Scene scene;
+			bool queued;
+			{
+				std::lock_guard<std::mutex> lock(state->sceneMtx);
+				queued = state->sceneCount > 0;
+				if (queued)
+					scene = state->scene[state->sceneHead];
+			}
+
+			if (!queued) {
+				if (state->renderDone.load())
+					break;
+				std::this_thread::yield();
+				continue;
+			}
+
+			// Sampling takes a while, the frame must not change under the scene
+			for (int i = 0; i < 2; i++)
+				std::this_thread::yield();
+			if (scene.slot != NULL)
+				LR_CHECK_EQ(ReadFrame(scene.slot), scene.frame);
+
+			state->timeline.Complete(scene.serial);
+
+			std::lock_guard<std::mutex> lock(state->sceneMtx);
+			state->sceneHead = (state->sceneHead + 1) % TEST_SCENE_DEPTH;
+			state->sceneCount--;
+		}
+	}
+
+	void TestOrdering()
+	{
+		StressState *state = new StressState();
+		state->producerDone.store(false);
+		state->renderDone.store(false);
+		state->sceneHead = 0;
+		state->sceneCount = 0;
+		state->sceneNum = 0;
+		state->reuseCount = 0;
+
+		for (int i = 0; i < TEST_RING_SIZE; i++) {
+			state->ring.SetBuffer(i, s_buffer[i], TEST_WIDTH, TEST_HEIGHT, TEST_WIDTH);
+			state->sampled[i].store(0);
+		}
+		state->ring.SetTimeline(&state->timeline);
+
+		uint64_t begin = LRTestTime();
+
+		std::thread gpu(Gpu, state);
+		std::thread render(Render, state);
+		Producer(state);
+		render.join();
+		gpu.join();
+
+		LR_CHECK(state->sceneNum > 0);
+		LR_CHECK(state->reuseCount > 0);
+		LR_CHECK_EQ(state->ring.GetFenceWaitCount(), state->timeline.GetWaitCount());
+
+		printf("ordering: %u frames, %u scenes, %u sampled slots reused, %u fence waits in %.1f ms\n",
+			TEST_FRAME_NUM, state->sceneNum, state->reuseCount, state->ring.GetFenceWaitCount(), (LRTestTime() - begin) / 1000.0f);
+
+		delete state;
+	}
+}
+
+int main()
+{
+	TestStub();
+	TestOrdering();
+
+	return LR_TEST_RESULT();
+}
@@ -0,0 +1,328 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "LRTest.hpp"
+#include "../LiveRig/LRFilter.hpp"
+#include "../LiveRig/LRChannelTrace.hpp"
+
+// Runs recorded tracking channels through every LRFilter type and reports how much jitter each
+// removes and how much latency it adds, for the scalar and the SIMD path. Select on the device
+// dumps the channels to ux0:data/LiveRig/channels.txt, pass that file to measure on real data:
+//
+//   LRFilterTest channels.txt
+//
+// Without a file a synthetic trace with head turns, mouth movement, blinks and measurement
+// noise is used and the results are checked. Without NEON on the host the SIMD path falls back
+// to the scalar one; run it on an ARM host to compare the NEON path.
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define TEST_NEON	"NEON"
+#else
+#define TEST_NEON	"scalar fallback, no NEON on this host"
+#endif
+
+// Same as LRFace: a longer gap between samples restarts the filter
+#define TEST_RESET_TIME		(500 * 1000)
+// Lag searched when aligning the output to the input, in 1 ms steps
+#define TEST_LAG_MAX		250
+#define TEST_SYNTH_NUM		1800
+#define TEST_BENCH_NUM		200
+
+namespace {
+	const char *s_typeName[LR_FILTER_TYPE_NUM] = { "none", "one euro", "kalman", "spring" };
+
+	struct Result
+	{
+		float *out;			// filtered samples, count * LR_FILTER_CHANNEL_MAX
+		double jitter;		// filtered / unfiltered jitter, averaged over the moving channels
+		double lag;			// ms, averaged over the moving channels
+		double updateTime;	// ns per Update()
+	};
+
+	float Noise(uint32_t *rand)
+	{
+		// Sum of uniforms, close enough to a unit gaussian
+		float sum = 0.0f;
+		for (int32_t i = 0; i < 4; i++)
+			sum += (LRTestRand(rand) & 0xFFFF) / 65535.0f;
+
+		return (sum - 2.0f) * 1.732f;
+	}
+
+	// 30 fps with scheduling jitter, a dropped frame now and then and the face lost for a second
+	void MakeTrace(LRChannelTrace *trace)
+	{
+		uint32_t rand = 17;
+		uint64_t time = 1000000;
+
+		for (int32_t i = 0; i < TEST_SYNTH_NUM; i++) {
+			time += 33333 + (LRTestRand(&rand) % 4000) - 2000;
+			if (i % 97 == 96)
+				time += 33333;
+			if (i == TEST_SYNTH_NUM / 2)
+				time += 1000000;
+
+			const float t = time * 0.000001f;
+			float values[LR_FILTER_CHANNEL_MAX];
+			memset(values, 0, sizeof(values));
+
+			values[0] = 20.0f * sinf(t * 1.9f) + 8.0f * sinf(t * 4.4f) + Noise(&rand);
+			values[1] = 10.0f * sinf(t * 1.3f + 1.0f) + Noise(&rand) * 0.8f;
+			values[2] = (sinf(t * 12.0f) > 0.3f ? 0.8f : 0.1f) + Noise(&rand) * 0.03f;
+			values[3] = 0.3f * sinf(t * 0.7f) + Noise(&rand) * 0.05f;
+			values[4] = values[3] + Noise(&rand) * 0.05f;
+			values[5] = (i % 120) < 3 ? 0.0f : 1.0f - fabsf(Noise(&rand)) * 0.02f;
+			values[6] = values[5];
+			values[7] = 0.5f * sinf(t * 0.9f) + Noise(&rand) * 0.1f;
+			values[8] = 0.3f * sinf(t * 0.5f) + Noise(&rand) * 0.1f;
+
+			trace->Add(values, time);
+		}
+	}
+
+	void Filter(const LRChannelTrace *trace, int32_t type, bool simd, float *out)
+	{
+		LRFilter filter;
+		LRFilterParam param;
+		LRFilter::GetDefaultParam(type, &param);
+		for (int32_t c = 0; c < LR_FILTER_CHANNEL_MAX; c++)
+			filter.SetParam(c, &param);
+		filter.SetSimd(simd);
+
+		uint64_t last = 0;
+		for (uint32_t i = 0; i < trace->GetCount(); i++) {
+			const LRChannelSample *sample = trace->GetSample(i);
+			float *o = out + i * LR_FILTER_CHANNEL_MAX;
+
+			if (!filter.IsPrimed() || sample->time - last > TEST_RESET_TIME) {
+				filter.Reset(sample->value);
+				memcpy(o, sample->value, sizeof(sample->value));
+			}
+			else {
+				filter.Update(sample->value, (sample->time - last) * 0.000001f, o);
+			}
+
+			last = sample->time;
+		}
+	}
+
+	// RMS of the second difference, what shows as shaking on the model
+	double Jitter(const LRChannelTrace *trace, const float *values, int32_t channel)
+	{
+		double sum = 0.0;
+		uint32_t count = 0;
+
+		for (uint32_t i = 2; i < trace->GetCount(); i++) {
+			double d = values[i * LR_FILTER_CHANNEL_MAX + channel] - 2.0 * values[(i - 1) * LR_FILTER_CHANNEL_MAX + channel] +
+				values[(i - 2) * LR_FILTER_CHANNEL_MAX + channel];
+			sum += d * d;
+			count++;
+		}
+
+		return count != 0 ? sqrt(sum / count) : 0.0;
+	}
+
+	// Input value at time by linear interpolation, false before the first sample
+	bool Sample(const LRChannelTrace *trace, uint32_t *index, double time, int32_t channel, double *value)
+	{
+		while (*index > 0 && trace->GetSample(*index)->time > time)
+			(*index)--;
+		while (*index + 1 < trace->GetCount() && trace->GetSample(*index + 1)->time <= time)
+			(*index)++;
+
+		const LRChannelSample *a = trace->GetSample(*index);
+		if (a->time > time || *index + 1 >= trace->GetCount())
+			return false;
+
+		const LRChannelSample *b = trace->GetSample(*index + 1);
+		double f = (time - a->time) / (double)(b->time - a->time);
+		*value = a->value[channel] + (b->value[channel] - a->value[channel]) * f;
+
+		return true;
+	}
+
+	// The delay of the input that best matches the output
+	int32_t Lag(const LRChannelTrace *trace, const float *out, int32_t channel)
+	{
+		double best = -1.0;
+		int32_t bestLag = 0;
+
+		for (int32_t lag = 0; lag <= TEST_LAG_MAX; lag++) {
+			double sum = 0.0;
+			uint32_t index = 0;
+
+			for (uint32_t i = 0; i < trace->GetCount(); i++) {
+				double value;
+				if (!Sample(trace, &index, trace->GetSample(i)->time - lag * 1000.0, channel, &value))
+					continue;
+
+				double d = out[i * LR_FILTER_CHANNEL_MAX + channel] - value;
+				sum += d * d;
+			}
+
+			if (best < 0.0 || sum < best) {
+				best = sum;
+				bestLag = lag;
+			}
+		}
+
+		return bestLag;
+	}
+
+	void Measure(const LRChannelTrace *trace, int32_t type, bool simd, Result *result)
+	{
+		float *in = (float *)malloc(trace->GetCount() * sizeof(float) * LR_FILTER_CHANNEL_MAX);
+		for (uint32_t i = 0; i < trace->GetCount(); i++)
+			memcpy(in + i * LR_FILTER_CHANNEL_MAX, trace->GetSample(i)->value, sizeof(float) * LR_FILTER_CHANNEL_MAX);
+
+		uint64_t begin = LRTestTime();
+		for (uint32_t i = 0; i < TEST_BENCH_NUM; i++)
+			Filter(trace, type, simd, result->out);
+		result->updateTime = (double)(LRTestTime() - begin) * 1000.0 / ((double)TEST_BENCH_NUM * trace->GetCount());
+
+		result->jitter = 0.0;
+		result->lag = 0.0;
+		int32_t moving = 0;
+		for (int32_t c = 0; c < LR_FILTER_CHANNEL_MAX; c++) {
+			double raw = Jitter(trace, in, c);
+			if (raw == 0.0)
+				continue;
+
+			result->jitter += Jitter(trace, result->out, c) / raw;
+			result->lag += Lag(trace, result->out, c);
+			moving++;
+		}
+
+		if (moving != 0) {
+			result->jitter /= moving;
+			result->lag /= moving;
+		}
+
+		free(in);
+	}
+
+	// Largest difference between two runs relative to the value
+	double MaxDiff(const float *a, const float *b, uint32_t count)
+	{
+		double max = 0.0;
+
+		for (uint32_t i = 0; i < count * LR_FILTER_CHANNEL_MAX; i++) {
+			double d = fabs((double)a[i] - b[i]) / (1.0 + fabs((double)a[i]));
+			max = d > max ? d : max;
+		}
+
+		return max;
+	}
+
+	void TestTraceFile(const LRChannelTrace *trace)
+	{
+		FILE *fp = tmpfile();
+		LR_CHECK(fp != NULL);
+		if (fp == NULL)
+			return;
+
+		trace->Write(fp);
+		rewind(fp);
+
+		LRChannelTrace *read = new LRChannelTrace();
+		LR_CHECK_EQ(read->Read(fp), trace->GetCount());
+		fclose(fp);
+
+		bool same = true;
+		for (uint32_t i = 0; i < trace->GetCount(); i++) {
+			const LRChannelSample *a = trace->GetSample(i);
+			const LRChannelSample *b = read->GetSample(i);
+			same = same && a->time == b->time;
+			for (int32_t c = 0; c < LR_FILTER_CHANNEL_MAX; c++)
+				same = same && fabsf(a->value[c] - b->value[c]) <= 0.00001f * (1.0f + fabsf(a->value[c]));
+		}
+		LR_CHECK(same);
+
+		// Old samples are ignored, the oldest falls out of a full trace
+		float values[LR_FILTER_CHANNEL_MAX];
+		memset(values, 0, sizeof(values));
+		uint64_t last = read->GetSample(read->GetCount() - 1)->time;
+		read->Add(values, last);
+		LR_CHECK_EQ(read->GetCount(), trace->GetCount());
+		for (uint32_t i = 0; i < LR_CHANNEL_TRACE_SIZE; i++)
+			read->Add(values, last + i + 1);
+		LR_CHECK_EQ(read->GetCount(), LR_CHANNEL_TRACE_SIZE);
+		LR_CHECK_EQ(read->GetSample(0)->time, last + 1);
+
+		delete read;
+	}
+
+	void Run(const LRChannelTrace *trace, bool check)
+	{
+		const uint32_t count = trace->GetCount();
+		const uint64_t duration = trace->GetSample(count - 1)->time - trace->GetSample(0)->time;
+
+		printf("%u samples over %.1f s (%s)\n", count, duration * 0.000001f, TEST_NEON);
+		printf("%-10s %8s %8s %10s %10s %10s\n", "filter", "jitter", "lag ms", "scalar ns", "simd ns", "max diff");
+
+		for (int32_t type = 0; type < LR_FILTER_TYPE_NUM; type++) {
+			Result scalar;
+			Result simd;
+			scalar.out = (float *)malloc(count * sizeof(float) * LR_FILTER_CHANNEL_MAX);
+			simd.out = (float *)malloc(count * sizeof(float) * LR_FILTER_CHANNEL_MAX);
+
+			Measure(trace, type, false, &scalar);
+			Measure(trace, type, true, &simd);
+			double diff = MaxDiff(scalar.out, simd.out, count);
+
+			printf("%-10s %8.3f %8.1f %10.1f %10.1f %10.2g\n", s_typeName[type], scalar.jitter, scalar.lag,
+				scalar.updateTime, simd.updateTime, diff);
+
+			// Refined reciprocal estimates instead of divisions
+			LR_CHECK(diff < 0.0001);
+			LR_CHECK_NEAR(simd.lag, scalar.lag, 1.0);
+
+			if (check) {
+				if (type == LR_FILTER_NONE) {
+					LR_CHECK_NEAR(scalar.jitter, 1.0, 0.000001);
+					LR_CHECK_EQ(scalar.lag, 0);
+				}
+				else {
+					// Smoother than the measurements while staying well under a few frames behind
+					LR_CHECK(scalar.jitter < 0.7);
+					LR_CHECK(scalar.lag < 100.0);
+				}
+			}
+
+			free(scalar.out);
+			free(simd.out);
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	LRChannelTrace *trace = new LRChannelTrace();
+
+	if (argc > 1) {
+		FILE *fp = fopen(argv[1], "r");
+		if (fp == NULL) {
+			printf("failed to open %s\n", argv[1]);
+			return 1;
+		}
+
+		trace->Read(fp);
+		fclose(fp);
+
+		LR_CHECK(trace->GetCount() > 2);
+		if (trace->GetCount() > 2)
+			Run(trace, false);
+	}
+	else {
+		MakeTrace(trace);
+		TestTraceFile(trace);
+		Run(trace, true);
+	}
+
+	delete trace;
+
+	return LR_TEST_RESULT();
+}
@@ -0,0 +1,343 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+
+#include "LRTest.hpp"
+#include "../LiveRig/LRFrameRing.hpp"
+
+// Synthetic producer and consumers around LRFrameRing: refcounts, Reset()/IsValid() and the
+// fence serials the producer honours before recycling a slot.
+
+#define TEST_WIDTH			64
+#define TEST_HEIGHT			8
+#define TEST_SIZE			(TEST_WIDTH * TEST_HEIGHT)
+#define TEST_CONSUMER_NUM	3
+// Latest slot plus one held by every consumer, the producer must never run out
+#define TEST_RING_SIZE		(2 + TEST_CONSUMER_NUM)
+#define TEST_FRAME_NUM		200000
+#define TEST_RESET_INTERVAL	5000
+
+typedef LRFrameRing<TEST_RING_SIZE> TestRing;
+
+namespace {
+	unsigned char s_buffer[TEST_RING_SIZE][TEST_SIZE];
+
+	// Completes serials only when told to, WaitSerial() completes right away and is counted
+	class ManualTimeline : public LRFenceTimeline
+	{
+	public:
+
+		uint32_t pending;
+		uint32_t completed;
+		uint32_t waitCount;
+
+		ManualTimeline() : pending(1), completed(0), waitCount(0)
+		{
+
+		}
+
+		uint32_t GetPendingSerial()
+		{
+			return pending;
+		}
+
+		uint32_t GetCompletedSerial()
+		{
+			return completed;
+		}
+
+		void WaitSerial(uint32_t serial)
+		{
+			waitCount++;
+			if ((int32_t)(serial - completed) > 0)
+				completed = serial;
+		}
+	};
+
+	void SetBuffers(TestRing *ring)
+	{
+		for (int i = 0; i < TEST_RING_SIZE; i++)
+			ring->SetBuffer(i, s_buffer[i], TEST_WIDTH, TEST_HEIGHT, TEST_WIDTH);
+	}
+
+	// Frame number in the first bytes, the rest filled with its low byte
+	void Fill(LRFrame *slot, uint64_t frame)
+	{
+		memset(slot->data, (int)(frame & 0xFF), TEST_SIZE);
+		memcpy(slot->data, &frame, sizeof(frame));
+	}
+
+	bool IsIntact(const LRFrame *slot)
+	{
+		uint64_t frame;
+		memcpy(&frame, slot->data, sizeof(frame));
+		if (frame != slot->frame)
+			return false;
+
+		for (int i = sizeof(frame); i < TEST_SIZE; i++) {
+			if (slot->data[i] != (unsigned char)(frame & 0xFF))
+				return false;
+		}
+
+		return true;
+	}
+
+	void Publish(TestRing *ring, uint64_t frame)
+	{
+		LRFrame *slot = ring->BeginWrite();
+		LR_CHECK(slot != NULL);
+		if (slot == NULL)
+			return;
+
+		Fill(slot, frame);
+		ring->EndWrite(frame, frame * 33333);
+	}
+
+	void TestRefCounts()
+	{
+		TestRing ring;
+		SetBuffers(&ring);
+
+		LR_CHECK(ring.AcquireLatest() == NULL);
+		LR_CHECK(ring.PeekLatest() == NULL);
+
+		Publish(&ring, 1);
+		const LRFrame *held = ring.AcquireLatest();
+		LR_CHECK(held != NULL && held->frame == 1 && held->seq == 1);
+		LR_CHECK_EQ(ring.GetRefCount(ring.GetIndex(held)), 1);
+
+		ring.Retain(held);
+		LR_CHECK_EQ(ring.GetRefCount(ring.GetIndex(held)), 2);
+
+		// Neither the held slot nor the latest one may be handed out
+		for (int i = 0; i < TEST_RING_SIZE * 3; i++) {
+			LRFrame *slot = ring.BeginWrite();
+			LR_CHECK(slot != NULL && slot != held);
+			if (slot == NULL)
+				break;
+
+			const LRFrame *latest = ring.PeekLatest();
+			LR_CHECK(slot != latest);
+
+			Fill(slot, i + 2);
+			ring.EndWrite(i + 2, 0);
+		}
+
+		LR_CHECK(IsIntact(held) && held->frame == 1);
+
+		ring.Release(held);
+		ring.Release(held);
+		for (int i = 0; i < TEST_RING_SIZE; i++)
+			LR_CHECK_EQ(ring.GetRefCount(i), 0);
+
+		// Every consumer holding a different frame still leaves the producer a slot
+		const LRFrame *frames[TEST_RING_SIZE - 2];
+		for (int i = 0; i < TEST_RING_SIZE - 2; i++) {
+			Publish(&ring, 100 + i);
+			frames[i] = ring.AcquireLatest();
+		}
+		LRFrame *slot = ring.BeginWrite();
+		LR_CHECK(slot != NULL);
+		ring.CancelWrite();
+
+		// One more and it has to give up instead of overwriting
+		Publish(&ring, 200);
+		const LRFrame *extra = ring.AcquireLatest();
+		Publish(&ring, 201);
+		LR_CHECK(ring.BeginWrite() == NULL);
+
+		ring.Release(extra);
+		for (int i = 0; i < TEST_RING_SIZE - 2; i++)
+			ring.Release(frames[i]);
+	}
+
+	void TestReset()
+	{
+		TestRing ring;
+		SetBuffers(&ring);
+
+		Publish(&ring, 1);
+		Publish(&ring, 2);
+		const LRFrame *held = ring.AcquireLatest();
+		LR_CHECK(held != NULL && ring.IsValid(held));
+
+		ring.Reset();
+		LR_CHECK(!ring.IsValid(held));
+		LR_CHECK(ring.PeekLatest() == NULL);
+		LR_CHECK(ring.AcquireLatest() == NULL);
+
+		// Sequence numbers keep counting so that old and new frames never compare equal
+		Publish(&ring, 3);
+		const LRFrame *fresh = ring.AcquireLatest();
+		LR_CHECK(fresh != NULL && ring.IsValid(fresh));
+		LR_CHECK(fresh != NULL && fresh->seq == 3);
+		LR_CHECK(fresh != held);
+
+		ring.Release(fresh);
+		ring.Release(held);
+	}
+
+	void TestFenceSerials()
+	{
+		TestRing ring;
+		ManualTimeline timeline;
+		SetBuffers(&ring);
+		ring.SetTimeline(&timeline);
+
+		// Every frame is sampled by a scene of its own and none completes, slots that were
+		// never sampled are still around until the last one
+		for (int i = 0; i < TEST_RING_SIZE; i++) {
+			Publish(&ring, i + 1);
+			const LRFrame *gpu = ring.AcquireForGpu();
+			LR_CHECK(gpu != NULL && ring.GetIndex(gpu) == i);
+			timeline.pending++;
+		}
+		LR_CHECK_EQ(timeline.waitCount, 0);
+		LR_CHECK_EQ(ring.GetFenceWaitCount(), 0);
+
+		// Only sampled slots are left, the producer waits for the first candidate's scene
+		LRFrame *slot = ring.BeginWrite();
+		LR_CHECK(slot != NULL && ring.GetIndex(slot) == 0);
+		LR_CHECK_EQ(timeline.waitCount, 1);
+		LR_CHECK_EQ(ring.GetFenceWaitCount(), 1);
+		LR_CHECK(timeline.IsSerialComplete(1));
+		LR_CHECK(!timeline.IsSerialComplete(2));
+		ring.CancelWrite();
+
+		// Slot 1 comes next in order but its scene is pending, the completed slot 0 is preferred
+		slot = ring.BeginWrite();
+		LR_CHECK(slot != NULL && ring.GetIndex(slot) == 0);
+		LR_CHECK_EQ(timeline.waitCount, 1);
+		ring.CancelWrite();
+
+		// Once every scene completed nothing is waited for
+		timeline.completed = timeline.pending - 1;
+		for (int i = 0; i < TEST_RING_SIZE * 2; i++)
+			Publish(&ring, 100 + i);
+		LR_CHECK_EQ(ring.GetFenceWaitCount(), 1);
+	}
+
+	struct StressState
+	{
+		TestRing ring;
+		std::atomic<bool> done;
+		std::atomic<uint32_t> resetSeq;
+		uint32_t stallCount;
+		uint32_t resetCount;
+		uint32_t acquireCount[TEST_CONSUMER_NUM];
+	};
+
+	void Producer(StressState *state)
+	{
+		uint32_t published = 0;
+
+		for (uint64_t frame = 1; frame <= TEST_FRAME_NUM; frame++) {
+			LRFrame *slot = state->ring.BeginWrite();
+			if (slot == NULL) {
+				state->stallCount++;
+				std::this_thread::yield();
+				continue;
+			}
+
+			Fill(slot, frame);
+			state->ring.EndWrite(frame, frame * 33333);
+			published++;
+
+			// Let the consumers in between frames even on a single core
+			if ((frame & 3) == 0)
+				std::this_thread::yield();
+
+			if (frame % TEST_RESET_INTERVAL == 0) {
+				state->ring.Reset();
+				state->resetSeq.store(published);
+				state->resetCount++;
+			}
+		}
+
+		state->done.store(true);
+	}
+
+	void Consumer(StressState *state, int index)
+	{
+		uint32_t rand = 1234 + index;
+		uint32_t lastSeq = 0;
+
+		while (!state->done.load()) {
+			uint32_t resetSeq = state->resetSeq.load();
+
+			const LRFrame *frame = state->ring.AcquireLatest();
+			if (frame == NULL) {
+				std::this_thread::yield();
+				continue;
+			}
+
+			state->acquireCount[index]++;
+
+			uint64_t seen = frame->frame;
+			LR_CHECK(IsIntact(frame));
+			LR_CHECK(frame->seq >= lastSeq);
+			LR_CHECK(!state->ring.IsValid(frame) || frame->seq > resetSeq);
+			LR_CHECK(state->ring.GetRefCount(state->ring.GetIndex(frame)) > 0);
+			lastSeq = frame->seq;
+
+			bool retained = (LRTestRand(&rand) & 3) == 0;
+			if (retained)
+				state->ring.Retain(frame);
+
+			// Hold it while the producer keeps going, the slot must not be recycled meanwhile
+			for (uint32_t spin = LRTestRand(&rand) & 7; spin > 0; spin--)
+				std::this_thread::yield();
+
+			LR_CHECK(IsIntact(frame) && frame->frame == seen);
+
+			if (retained)
+				state->ring.Release(frame);
+			state->ring.Release(frame);
+		}
+	}
+
+	void TestStress()
+	{
+		StressState *state = new StressState();
+		SetBuffers(&state->ring);
+		state->done.store(false);
+		state->resetSeq.store(0);
+		state->stallCount = 0;
+		state->resetCount = 0;
+
+		std::thread consumers[TEST_CONSUMER_NUM];
+		for (int i = 0; i < TEST_CONSUMER_NUM; i++) {
+			state->acquireCount[i] = 0;
+			consumers[i] = std::thread(Consumer, state, i);
+		}
+
+		uint64_t begin = LRTestTime();
+		Producer(state);
+
+		for (int i = 0; i < TEST_CONSUMER_NUM; i++)
+			consumers[i].join();
+
+		// N >= 2 + frames held at once, so the producer never had to give up a frame
+		LR_CHECK_EQ(state->stallCount, 0);
+		LR_CHECK_EQ(state->resetCount, TEST_FRAME_NUM / TEST_RESET_INTERVAL);
+		for (int i = 0; i < TEST_RING_SIZE; i++)
+			LR_CHECK_EQ(state->ring.GetRefCount(i), 0);
+
+		printf("stress: %u frames in %.1f ms, acquired %u/%u/%u\n", TEST_FRAME_NUM, (LRTestTime() - begin) / 1000.0f,
+			state->acquireCount[0], state->acquireCount[1], state->acquireCount[2]);
+
+		delete state;
+	}
+}
+
+int main()
+{
+	TestRefCounts();
+	TestReset();
+	TestFenceSerials();
+	TestStress();
+
+	return LR_TEST_RESULT();
+}
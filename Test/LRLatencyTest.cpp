@@ -0,0 +1,225 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+
+#include "LRTest.hpp"
+#include "../LiveRig/LRLatency.hpp"
+
+// Replays stage timestamps through LRLatency: attribution to stages, stamps that are missing,
+// out of order or from another clock, the reported percentiles against the exact ones and the
+// text dump.
+
+#define TEST_TRACE_NUM		20000
+
+namespace {
+	// Same rank as LRHistogram::GetPercentile(), on the exact values
+	uint32_t ExactPercentile(std::vector<uint32_t> values, float p)
+	{
+		std::sort(values.begin(), values.end());
+
+		uint32_t rank = (uint32_t)(p * 0.01f * values.size() + 0.5f);
+		if (rank < 1)
+			rank = 1;
+		else if (rank > values.size())
+			rank = (uint32_t)values.size();
+
+		return values[rank - 1];
+	}
+
+	void TestBuckets()
+	{
+		// Exact below 8, every other value within half a bucket: 1/16 of the value
+		for (uint32_t v = 0; v < 8; v++)
+			LR_CHECK_EQ(LRHistogram::GetBucketValue(LRHistogram::GetBucketIndex(v)), v);
+
+		int32_t lastIndex = 0;
+		bool monotonic = true;
+		bool bounded = true;
+		for (uint32_t v = 8; v < (1u << 24); v += 1 + v / 97) {
+			int32_t index = LRHistogram::GetBucketIndex(v);
+			uint32_t center = LRHistogram::GetBucketValue(index);
+			uint32_t error = center > v ? center - v : v - center;
+
+			monotonic = monotonic && index >= lastIndex;
+			bounded = bounded && error * 16 <= v;
+			lastIndex = index;
+		}
+		LR_CHECK(monotonic);
+		LR_CHECK(bounded);
+		LR_CHECK_EQ(lastIndex, LR_HISTOGRAM_BUCKET_NUM - 1);
+
+		// Values past the last bucket are clamped into it
+		LR_CHECK_EQ(LRHistogram::GetBucketIndex(0xFFFFFFFF), LR_HISTOGRAM_BUCKET_NUM - 1);
+	}
+
+	void TestAttribution()
+	{
+		LRLatency latency;
+		LRLatencyStamps stamps;
+
+		// Every stage known and in order
+		stamps.frame = 1;
+		stamps.sensor = 1000000;
+		stamps.capture = stamps.sensor + 5000;
+		stamps.track = stamps.capture + 12000;
+		stamps.model = stamps.track + 300;
+		stamps.submit = stamps.model + 4000;
+		latency.Record(&stamps, stamps.submit + 16000);
+
+		static const uint32_t expected[LR_LATENCY_STAGE_NUM] = { 5000, 12000, 300, 4000, 16000, 37300 };
+		for (int32_t i = 0; i < LR_LATENCY_STAGE_NUM; i++) {
+			const LRHistogram *h = latency.GetHistogram(i);
+			LR_CHECK_EQ(h->GetCount(), 1);
+			LR_CHECK_EQ(h->GetPercentile(50.0f), expected[i]);
+			LR_CHECK_EQ(h->GetMean(), expected[i]);
+		}
+
+		// No tracking result: both stages touching it are skipped, the rest still count
+		latency.Reset();
+		LRLatencyStamps missing = stamps;
+		missing.track = 0;
+		latency.Record(&missing, missing.submit + 16000);
+		LR_CHECK_EQ(latency.GetHistogram(LR_LATENCY_STAGE_CAMERA)->GetCount(), 1);
+		LR_CHECK_EQ(latency.GetHistogram(LR_LATENCY_STAGE_TRACK)->GetCount(), 0);
+		LR_CHECK_EQ(latency.GetHistogram(LR_LATENCY_STAGE_MODEL)->GetCount(), 0);
+		LR_CHECK_EQ(latency.GetHistogram(LR_LATENCY_STAGE_RENDER)->GetCount(), 1);
+		LR_CHECK_EQ(latency.GetHistogram(LR_LATENCY_STAGE_TOTAL)->GetCount(), 1);
+
+		// A model update stamped before the result it used is skipped, not wrapped around
+		latency.Reset();
+		LRLatencyStamps reversed = stamps;
+		reversed.model = reversed.track - 100;
+		latency.Record(&reversed, reversed.submit + 16000);
+		LR_CHECK_EQ(latency.GetHistogram(LR_LATENCY_STAGE_MODEL)->GetCount(), 0);
+		LR_CHECK_EQ(latency.GetHistogram(LR_LATENCY_STAGE_TRACK)->GetCount(), 1);
+		LR_CHECK(latency.GetHistogram(LR_LATENCY_STAGE_RENDER)->GetMax() < 0x80000000);
+
+		// Sensor stamps after the capture or more than a second before it are from another
+		// clock: the camera stage is skipped and the total starts at the capture
+		static const uint64_t badSensor[] = { stamps.capture + 1, stamps.capture - 2000000, 0 };
+		for (size_t i = 0; i < sizeof(badSensor) / sizeof(badSensor[0]); i++) {
+			latency.Reset();
+			LRLatencyStamps clock = stamps;
+			clock.sensor = badSensor[i];
+			latency.Record(&clock, clock.submit + 16000);
+			LR_CHECK_EQ(latency.GetHistogram(LR_LATENCY_STAGE_CAMERA)->GetCount(), 0);
+			LR_CHECK_EQ(latency.GetHistogram(LR_LATENCY_STAGE_TOTAL)->GetPercentile(50.0f), 32300);
+		}
+
+		// Without a capture stamp nothing can be attributed
+		latency.Reset();
+		LRLatencyStamps none = stamps;
+		none.capture = 0;
+		latency.Record(&none, none.submit + 16000);
+		for (int32_t i = 0; i < LR_LATENCY_STAGE_NUM; i++)
+			LR_CHECK_EQ(latency.GetHistogram(i)->GetCount(), 0);
+
+		// Flip before the submit: only the display stage is skipped
+		latency.Reset();
+		latency.Record(&stamps, stamps.submit - 1);
+		LR_CHECK_EQ(latency.GetHistogram(LR_LATENCY_STAGE_DISPLAY)->GetCount(), 0);
+		LR_CHECK_EQ(latency.GetHistogram(LR_LATENCY_STAGE_RENDER)->GetCount(), 1);
+	}
+
+	void TestTrace()
+	{
+		LRLatency latency;
+		std::vector<uint32_t> exact[LR_LATENCY_STAGE_NUM];
+		uint32_t rand = 99;
+		uint32_t skipped = 0;
+		uint64_t now = 5000000;
+
+		for (uint32_t i = 0; i < TEST_TRACE_NUM; i++) {
+			// Mostly steady with a long tail, like a tracker that sometimes re-detects
+			uint32_t delta[LR_LATENCY_STAGE_TOTAL];
+			delta[LR_LATENCY_STAGE_CAMERA] = 4000 + LRTestRand(&rand) % 2000;
+			delta[LR_LATENCY_STAGE_TRACK] = 8000 + LRTestRand(&rand) % 4000 + ((LRTestRand(&rand) % 20) == 0 ? 30000 : 0);
+			delta[LR_LATENCY_STAGE_MODEL] = 100 + LRTestRand(&rand) % 400;
+			delta[LR_LATENCY_STAGE_RENDER] = 2000 + LRTestRand(&rand) % 3000;
+			delta[LR_LATENCY_STAGE_DISPLAY] = LRTestRand(&rand) % 16667;
+
+			LRLatencyStamps stamps;
+			stamps.frame = i;
+			stamps.sensor = now;
+			stamps.capture = stamps.sensor + delta[LR_LATENCY_STAGE_CAMERA];
+			stamps.track = stamps.capture + delta[LR_LATENCY_STAGE_TRACK];
+			stamps.model = stamps.track + delta[LR_LATENCY_STAGE_MODEL];
+			stamps.submit = stamps.model + delta[LR_LATENCY_STAGE_RENDER];
+			uint64_t flip = stamps.submit + delta[LR_LATENCY_STAGE_DISPLAY];
+
+			// Every 50th frame is shown again without a new tracking result
+			if (i % 50 == 49) {
+				stamps.track = 0;
+				skipped++;
+			}
+
+			latency.Record(&stamps, flip);
+
+			uint32_t total = 0;
+			for (int32_t s = 0; s < LR_LATENCY_STAGE_TOTAL; s++) {
+				total += delta[s];
+				if (stamps.track == 0 && (s == LR_LATENCY_STAGE_TRACK || s == LR_LATENCY_STAGE_MODEL))
+					continue;
+				exact[s].push_back(delta[s]);
+			}
+			exact[LR_LATENCY_STAGE_TOTAL].push_back(total);
+
+			now += 16667;
+		}
+
+		static const float percentiles[] = { 50.0f, 95.0f, 99.0f };
+		for (int32_t s = 0; s < LR_LATENCY_STAGE_NUM; s++) {
+			const LRHistogram *h = latency.GetHistogram(s);
+			LR_CHECK_EQ(h->GetCount(), exact[s].size());
+
+			for (size_t p = 0; p < sizeof(percentiles) / sizeof(percentiles[0]); p++) {
+				uint32_t reported = h->GetPercentile(percentiles[p]);
+				uint32_t truth = ExactPercentile(exact[s], percentiles[p]);
+				LR_CHECK_NEAR(reported, truth, truth / 16.0 + 1.0);
+			}
+		}
+		LR_CHECK_EQ(latency.GetHistogram(LR_LATENCY_STAGE_TRACK)->GetCount(), TEST_TRACE_NUM - skipped);
+
+		// The dump has a row per stage with the same numbers
+		FILE *fp = tmpfile();
+		LR_CHECK(fp != NULL);
+		if (fp == NULL)
+			return;
+
+		latency.Dump(fp);
+		rewind(fp);
+
+		char line[256];
+		LR_CHECK(fgets(line, sizeof(line), fp) != NULL && strncmp(line, "stage", 5) == 0);
+		for (int32_t s = 0; s < LR_LATENCY_STAGE_NUM; s++) {
+			char name[16];
+			uint32_t count, mean, p50, p95, p99, max;
+			LR_CHECK(fgets(line, sizeof(line), fp) != NULL);
+			LR_CHECK_EQ(sscanf(line, "%15s %u %u %u %u %u %u", name, &count, &mean, &p50, &p95, &p99, &max), 7);
+			LR_CHECK(strcmp(name, LRLatency::GetStageName(s)) == 0);
+
+			const LRHistogram *h = latency.GetHistogram(s);
+			LR_CHECK_EQ(count, h->GetCount());
+			LR_CHECK_EQ(p95, h->GetPercentile(95.0f));
+			LR_CHECK_EQ(max, h->GetMax());
+		}
+		fclose(fp);
+
+		printf("trace: %u frames, track p50/p95/p99 %u/%u/%u us\n", TEST_TRACE_NUM,
+			latency.GetHistogram(LR_LATENCY_STAGE_TRACK)->GetPercentile(50.0f),
+			latency.GetHistogram(LR_LATENCY_STAGE_TRACK)->GetPercentile(95.0f),
+			latency.GetHistogram(LR_LATENCY_STAGE_TRACK)->GetPercentile(99.0f));
+	}
+}
+
+int main()
+{
+	TestBuckets();
+	TestAttribution();
+	TestTrace();
+
+	return LR_TEST_RESULT();
+}
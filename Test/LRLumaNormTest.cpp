@@ -0,0 +1,229 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "LRTest.hpp"
+#include "../LiveRig/LRLumaNorm.hpp"
+
+// Cross-checks the scalar and NEON stretch kernels of LRLumaNorm and times stretch and CLAHE.
+// CLAHE has a scalar path only, its per-pixel table lookups do not vectorize, so it is checked
+// for its properties instead. Without NEON on the host the SIMD entry point falls back to the
+// scalar path; run it on an ARM host to check the NEON path.
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define TEST_NEON	"NEON"
+#else
+#define TEST_NEON	"scalar fallback, no NEON on this host"
+#endif
+
+#define TEST_GUARD			0xA5
+#define TEST_BENCH_NUM		200
+
+namespace {
+	void FillScene(unsigned char *data, int32_t width, int32_t height, int32_t pitch, uint32_t seed)
+	{
+		uint32_t rand = seed;
+
+		// Dim gradient with noise, the kind of frame normalization is for
+		for (int32_t y = 0; y < height; y++) {
+			for (int32_t x = 0; x < width; x++) {
+				int32_t v = 40 + (x * 60) / width + (y * 20) / height + (int32_t)(LRTestRand(&rand) % 16);
+				data[y * pitch + x] = (unsigned char)v;
+			}
+		}
+	}
+
+	uint8_t Stretch(uint8_t v, uint8_t low, uint8_t gainQ5)
+	{
+		uint32_t d = v > low ? v - low : 0;
+		uint32_t out = (d * gainQ5 + 16) / 32;
+
+		return (uint8_t)(out > 255 ? 255 : out);
+	}
+
+	void TestStretch()
+	{
+		// Every input value, a 16-wide vector part and an odd tail, padded pitch
+		const int32_t width = 256 + 7;
+		const int32_t pitch = width + 9;
+		unsigned char src[pitch * 2];
+		unsigned char scalar[pitch * 2];
+		unsigned char simd[pitch * 2];
+		int32_t diffCount = 0;
+
+		for (int32_t i = 0; i < pitch * 2; i++)
+			src[i] = (unsigned char)(i * 7);
+
+		// Every offset and every Q5 gain UpdateStretch() can produce
+		for (int32_t low = 0; low < 256; low++) {
+			for (int32_t gain = 32; gain < 256; gain++) {
+				memset(scalar, TEST_GUARD, sizeof(scalar));
+				memset(simd, TEST_GUARD, sizeof(simd));
+
+				LRLumaNorm::StretchScalar(src, pitch, scalar, pitch, width, 2, (uint8_t)low, (uint8_t)gain);
+				LRLumaNorm::StretchSimd(src, pitch, simd, pitch, width, 2, (uint8_t)low, (uint8_t)gain);
+
+				if (memcmp(scalar, simd, sizeof(scalar)) != 0)
+					diffCount++;
+
+				for (int32_t y = 0; y < 2; y++) {
+					for (int32_t x = 0; x < pitch; x++) {
+						uint8_t expected = x < width ? Stretch(src[y * pitch + x], (uint8_t)low, (uint8_t)gain) : TEST_GUARD;
+						if (scalar[y * pitch + x] != expected) {
+							LR_CHECK_EQ(scalar[y * pitch + x], expected);
+							low = 256;
+							gain = 256;
+							y = 2;
+							break;
+						}
+					}
+				}
+			}
+		}
+
+		LR_CHECK_EQ(diffCount, 0);
+		printf("stretch: every offset and gain bit-exact (%s)\n", TEST_NEON);
+	}
+
+	void TestProcess(int32_t mode, int32_t width, int32_t height)
+	{
+		const int32_t pitch = width + 16;
+		unsigned char *src = (unsigned char *)malloc(pitch * height);
+		unsigned char *scalar = (unsigned char *)malloc(pitch * height);
+		unsigned char *simd = (unsigned char *)malloc(pitch * height);
+		unsigned char *inPlace = (unsigned char *)malloc(pitch * height);
+
+		LRLumaNorm a;
+		LRLumaNorm b;
+		LRLumaNorm c;
+		a.Init(width, height);
+		b.Init(width, height);
+		c.Init(width, height);
+		a.SetMode(mode);
+		b.SetMode(mode);
+		c.SetMode(mode);
+		a.SetSimd(false);
+		b.SetSimd(true);
+
+		// A few frames so that the smoothed percentiles move
+		for (uint32_t frame = 0; frame < 8; frame++) {
+			FillScene(src, width, height, pitch, frame + 1);
+			memcpy(inPlace, src, pitch * height);
+
+			LR_CHECK_EQ(a.Process(src, pitch, scalar, pitch), width * height);
+			LR_CHECK_EQ(b.Process(src, pitch, simd, pitch), width * height);
+			LR_CHECK_EQ(c.Process(inPlace, pitch, inPlace, pitch), 0);
+
+			for (int32_t y = 0; y < height; y++) {
+				LR_CHECK(memcmp(scalar + y * pitch, simd + y * pitch, width) == 0);
+				LR_CHECK(memcmp(scalar + y * pitch, inPlace + y * pitch, width) == 0);
+			}
+		}
+
+		// The dim input must come out with more contrast
+		uint32_t minIn = 255, maxIn = 0, minOut = 255, maxOut = 0;
+		for (int32_t y = 0; y < height; y++) {
+			for (int32_t x = 0; x < width; x++) {
+				uint32_t in = src[y * pitch + x];
+				uint32_t out = scalar[y * pitch + x];
+				minIn = in < minIn ? in : minIn;
+				maxIn = in > maxIn ? in : maxIn;
+				minOut = out < minOut ? out : minOut;
+				maxOut = out > maxOut ? out : maxOut;
+			}
+		}
+		LR_CHECK(maxOut - minOut > maxIn - minIn);
+		LR_CHECK_EQ(a.GetStats()->frameCount, 8);
+
+		free(src);
+		free(scalar);
+		free(simd);
+		free(inPlace);
+	}
+
+	void TestClahe()
+	{
+		const int32_t width = 160;
+		const int32_t height = 120;
+		unsigned char src[width * height];
+		unsigned char dst[width * height];
+
+		LRLumaNorm norm;
+		norm.Init(width, height);
+		norm.SetMode(LR_LUMA_NORM_CLAHE);
+
+		// A flat frame stays flat, there is nothing to equalize between tiles
+		memset(src, 90, sizeof(src));
+		norm.Process(src, width, dst, width);
+		bool flat = true;
+		for (int32_t i = 1; i < width * height; i++)
+			flat = flat && dst[i] == dst[0];
+		LR_CHECK(flat);
+		LR_CHECK_NEAR(norm.GetStats()->mean, 90.0f, 0.01f);
+
+		// Within a tile the mapping never reverses the order of two values
+		for (int32_t y = 0; y < height; y++) {
+			for (int32_t x = 0; x < width; x++)
+				src[y * width + x] = (unsigned char)((x + y * 3) & 0xFF);
+		}
+		norm.Process(src, width, dst, width);
+
+		const int32_t tileW = width / LR_LUMA_NORM_CLAHE_TILES;
+		bool monotonic = true;
+		for (int32_t y = 0; y < height; y++) {
+			for (int32_t x = 1; x < tileW / 2; x++) {
+				if (src[y * width + x] > src[y * width + x - 1] && dst[y * width + x] < dst[y * width + x - 1])
+					monotonic = false;
+			}
+		}
+		LR_CHECK(monotonic);
+	}
+
+	double Bench(LRLumaNorm *norm, unsigned char *src, unsigned char *dst, int32_t pitch)
+	{
+		uint64_t begin = LRTestTime();
+
+		for (uint32_t i = 0; i < TEST_BENCH_NUM; i++)
+			norm->Process(src, pitch, dst, pitch);
+
+		return (double)(LRTestTime() - begin) / TEST_BENCH_NUM;
+	}
+
+	void BenchModes(int32_t width, int32_t height)
+	{
+		unsigned char *src = (unsigned char *)malloc(width * height);
+		unsigned char *dst = (unsigned char *)malloc(width * height);
+		FillScene(src, width, height, width, 5);
+
+		LRLumaNorm norm;
+		norm.Init(width, height);
+
+		norm.SetMode(LR_LUMA_NORM_STRETCH);
+		norm.SetSimd(false);
+		double stretchScalar = Bench(&norm, src, dst, width);
+		norm.SetSimd(true);
+		double stretchSimd = Bench(&norm, src, dst, width);
+
+		norm.SetMode(LR_LUMA_NORM_CLAHE);
+		double clahe = Bench(&norm, src, dst, width);
+
+		printf("%dx%d: stretch scalar %.1f us, simd %.1f us (%s), clahe %.1f us\n",
+			width, height, stretchScalar, stretchSimd, TEST_NEON, clahe);
+
+		free(src);
+		free(dst);
+	}
+}
+
+int main()
+{
+	TestStretch();
+	TestProcess(LR_LUMA_NORM_STRETCH, 161, 121);
+	TestProcess(LR_LUMA_NORM_CLAHE, 161, 121);
+	TestClahe();
+	BenchModes(320, 240);
+	BenchModes(640, 480);
+
+	return LR_TEST_RESULT();
+}
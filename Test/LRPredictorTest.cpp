@@ -0,0 +1,220 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "LRTest.hpp"
+#include "../LiveRig/LRPredictor.hpp"
+
+// Feeds LRPredictor known trajectories the way LRMain does: a measured sample at the camera
+// rate, a prediction to the display time at the display rate, and checks the extrapolation
+// and the error statistics against the true values.
+
+#define TEST_SAMPLE_INTERVAL	33333	// 30 fps tracking
+#define TEST_DISPLAY_INTERVAL	16667	// 60 fps display
+#define TEST_DISPLAY_DELAY		50000
+
+namespace {
+	void Fill(float *values, float value)
+	{
+		for (int32_t i = 0; i < LR_FILTER_CHANNEL_MAX; i++)
+			values[i] = value * (i + 1);
+	}
+
+	void TestExtrapolation()
+	{
+		LRPredictor predictor;
+		LRPredictorParam param;
+		float values[LR_FILTER_CHANNEL_MAX];
+		float velocity[LR_FILTER_CHANNEL_MAX];
+		float out[LR_FILTER_CHANNEL_MAX];
+
+		Fill(values, 1.0f);
+		Fill(velocity, 2.0f);
+
+		// Without damping the velocity is simply carried on
+		predictor.GetParam(&param);
+		param.damping = 0.0f;
+		predictor.SetParam(&param);
+		predictor.Predict(values, velocity, 1000000, 1040000, out);
+		for (int32_t i = 0; i < LR_FILTER_CHANNEL_MAX; i++)
+			LR_CHECK_NEAR(out[i], (i + 1) * (1.0f + 2.0f * 0.04f), 0.00001f);
+
+		// Damped, the reach is damping * (1 - exp(-h / damping)) and never beyond damping
+		param.damping = 0.05f;
+		predictor.SetParam(&param);
+		predictor.Predict(values, velocity, 1000000, 1040000, out);
+		LR_CHECK_NEAR(out[0], 1.0f + 2.0f * 0.05f * (1.0f - expf(-0.04f / 0.05f)), 0.00001f);
+
+		// The horizon stops at horizonMax, a target in the past does not go backwards
+		predictor.Predict(values, velocity, 1000000, 9000000, out);
+		LR_CHECK_NEAR(out[0], 1.0f + 2.0f * 0.05f * (1.0f - expf(-param.horizonMax / 0.05f)), 0.00001f);
+		predictor.Predict(values, velocity, 1000000, 500000, out);
+		LR_CHECK_NEAR(out[0], 1.0f, 0.00001f);
+
+		// Disabled holds the values, out may alias them
+		param.enable = false;
+		predictor.SetParam(&param);
+		predictor.Predict(values, velocity, 1000000, 1040000, values);
+		LR_CHECK_NEAR(values[0], 1.0f, 0.00001f);
+		LR_CHECK_NEAR(values[LR_FILTER_CHANNEL_MAX - 1], (float)LR_FILTER_CHANNEL_MAX, 0.00001f);
+
+		param.horizonMax = -1.0f;
+		predictor.SetParam(&param);
+		predictor.GetParam(&param);
+		LR_CHECK_EQ(param.horizonMax, 0);
+	}
+
+	// Runs one second of a trajectory given by position and velocity at any time
+	void Run(LRPredictor *predictor, float (*position)(double), float (*speed)(double), LRPredictorStats *stats)
+	{
+		float values[LR_FILTER_CHANNEL_MAX];
+		float velocity[LR_FILTER_CHANNEL_MAX];
+		float out[LR_FILTER_CHANNEL_MAX];
+
+		const uint64_t begin = 5000000;
+		uint64_t sampleTime = 0;
+
+		predictor->ResetStats();
+
+		for (uint64_t now = begin; now < begin + 1000000; now += TEST_DISPLAY_INTERVAL) {
+			// The newest measurement available at this display frame
+			uint64_t latest = begin + (now - begin) / TEST_SAMPLE_INTERVAL * TEST_SAMPLE_INTERVAL;
+			if (latest != sampleTime) {
+				sampleTime = latest;
+				Fill(values, position(sampleTime * 0.000001));
+				predictor->AddSample(values, sampleTime);
+			}
+
+			Fill(values, position(sampleTime * 0.000001));
+			Fill(velocity, speed(sampleTime * 0.000001));
+			predictor->Predict(values, velocity, sampleTime, now + TEST_DISPLAY_DELAY, out);
+		}
+
+		predictor->GetStats(stats);
+	}
+
+	float LinearPosition(double t)
+	{
+		return (float)(0.5 * t);
+	}
+
+	float LinearSpeed(double)
+	{
+		return 0.5f;
+	}
+
+	float StillPosition(double)
+	{
+		return 0.25f;
+	}
+
+	float StillSpeed(double)
+	{
+		return 0.0f;
+	}
+
+	void TestStats()
+	{
+		LRPredictor predictor;
+		LRPredictorParam param;
+		LRPredictorStats stats;
+
+		predictor.GetParam(&param);
+		param.damping = 0.0f;
+		predictor.SetParam(&param);
+
+		// Constant speed without damping is predicted exactly, holding is off by speed * horizon
+		Run(&predictor, LinearPosition, LinearSpeed, &stats);
+		LR_CHECK(stats.count > 40);
+		LR_CHECK(stats.horizonMean > TEST_DISPLAY_DELAY * 0.000001f);
+		LR_CHECK(stats.horizonMean < (TEST_DISPLAY_DELAY + TEST_SAMPLE_INTERVAL) * 0.000001f);
+		for (int32_t i = 0; i < LR_FILTER_CHANNEL_MAX; i++) {
+			LR_CHECK(stats.predictedError[i] < 0.0001f * (i + 1));
+			LR_CHECK_NEAR(stats.heldError[i], 0.5f * stats.horizonMean * (i + 1), 0.0001f * (i + 1));
+		}
+		printf("linear: %u predictions, horizon %.1f ms, error %.5f predicted, %.5f held\n",
+			stats.count, stats.horizonMean * 1000.0f, stats.predictedError[0], stats.heldError[0]);
+
+		// Damping settles short of the true position but still beats holding
+		param.damping = 0.05f;
+		predictor.SetParam(&param);
+		Run(&predictor, LinearPosition, LinearSpeed, &stats);
+		LR_CHECK(stats.count > 40);
+		LR_CHECK(stats.predictedError[0] > 0.0001f);
+		LR_CHECK(stats.predictedError[0] < stats.heldError[0]);
+
+		// Nothing to gain on a still face, and nothing lost
+		Run(&predictor, StillPosition, StillSpeed, &stats);
+		LR_CHECK(stats.count > 40);
+		LR_CHECK_NEAR(stats.predictedError[0], 0.0f, 0.00001f);
+		LR_CHECK_NEAR(stats.heldError[0], 0.0f, 0.00001f);
+
+		// Disabled, the prediction is the held value
+		param.enable = false;
+		predictor.SetParam(&param);
+		Run(&predictor, LinearPosition, LinearSpeed, &stats);
+		LR_CHECK(stats.count > 40);
+		LR_CHECK_NEAR(stats.predictedError[0], stats.heldError[0], 0.00001f);
+	}
+
+	void TestPending()
+	{
+		LRPredictor predictor;
+		LRPredictorStats stats;
+		float values[LR_FILTER_CHANNEL_MAX];
+		float velocity[LR_FILTER_CHANNEL_MAX];
+		float out[LR_FILTER_CHANNEL_MAX];
+
+		Fill(values, 0.0f);
+		Fill(velocity, 1.0f);
+
+		// Scored only once a later sample covers the target time
+		predictor.AddSample(values, 1000000);
+		predictor.Predict(values, velocity, 1000000, 1050000, out);
+		predictor.AddSample(values, 1033333);
+		predictor.GetStats(&stats);
+		LR_CHECK_EQ(stats.count, 0);
+		predictor.AddSample(values, 1066666);
+		predictor.GetStats(&stats);
+		LR_CHECK_EQ(stats.count, 1);
+
+		// The same sample twice scores nothing twice
+		predictor.AddSample(values, 1066666);
+		predictor.GetStats(&stats);
+		LR_CHECK_EQ(stats.count, 1);
+
+		// Only the newest LR_PREDICTOR_PENDING_NUM predictions are kept
+		predictor.ResetStats();
+		for (int32_t i = 0; i < LR_PREDICTOR_PENDING_NUM + 4; i++)
+			predictor.Predict(values, velocity, 1066666, 1070000 + i * 1000, out);
+		predictor.AddSample(values, 2000000);
+		predictor.GetStats(&stats);
+		LR_CHECK_EQ(stats.count, LR_PREDICTOR_PENDING_NUM);
+
+		// A clock going back, as on a restarted replay, drops what was pending
+		predictor.ResetStats();
+		predictor.Predict(values, velocity, 2000000, 2050000, out);
+		predictor.AddSample(values, 1000000);
+		predictor.AddSample(values, 3000000);
+		predictor.GetStats(&stats);
+		LR_CHECK_EQ(stats.count, 0);
+
+		// So does a lost face
+		predictor.Predict(values, velocity, 3000000, 3050000, out);
+		predictor.Flush();
+		predictor.AddSample(values, 3100000);
+		predictor.AddSample(values, 3200000);
+		predictor.GetStats(&stats);
+		LR_CHECK_EQ(stats.count, 0);
+	}
+}
+
+int main()
+{
+	TestExtrapolation();
+	TestStats();
+	TestPending();
+
+	return LR_TEST_RESULT();
+}
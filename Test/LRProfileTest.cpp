@@ -0,0 +1,245 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "LRTest.hpp"
+#include "../LiveRig/LRProfile.hpp"
+
+// Writes and reads LRProfileFile files in a temporary directory: a round trip, and files that
+// are damaged, from another version, cut short or left behind by an interrupted save.
+
+namespace {
+	char s_dir[64];
+	char s_path[96];
+	char s_bakPath[sizeof(s_path) + 4];
+	char s_tmpPath[sizeof(s_path) + 4];
+
+	void MakeProfile(LRProfile *profile)
+	{
+		LRProfileFile::GetDefault(profile);
+
+		profile->flags = LR_PROFILE_HAS_EV | LR_PROFILE_HAS_FACE | LR_PROFILE_HAS_NEUTRAL | LR_PROFILE_HAS_FILTER;
+		profile->evLevel = -7;
+		profile->evScore = 0.93f;
+		profile->faceX = 0.25f;
+		profile->faceY = 0.125f;
+		profile->faceW = 0.375f;
+		profile->faceH = 0.5f;
+		for (int32_t i = 0; i < LR_FEATURE_NUM; i++)
+			profile->neutral[i] = 0.1f * i - 0.3f;
+		profile->neutralCount = 300;
+		profile->eyeOpenRef[0] = 0.31f;
+		profile->eyeOpenRef[1] = 0.29f;
+		for (int32_t i = 0; i < LR_FILTER_CHANNEL_MAX; i++) {
+			LRFilter::GetDefaultParam(i % LR_FILTER_TYPE_NUM, &profile->filter[i]);
+			profile->filter[i].minCutoff = 1.0f + i;
+			profile->filter[i].frequency = 20.0f + i;
+		}
+	}
+
+	bool FileExists(const char *path)
+	{
+		return access(path, F_OK) == 0;
+	}
+
+	long ReadFile(const char *path, uint8_t *buf, long size)
+	{
+		FILE *fp = fopen(path, "rb");
+		if (fp == NULL)
+			return -1;
+
+		long read = (long)fread(buf, 1, size, fp);
+		fclose(fp);
+
+		return read;
+	}
+
+	void WriteFile(const char *path, const uint8_t *buf, long size)
+	{
+		FILE *fp = fopen(path, "wb");
+		LR_CHECK(fp != NULL);
+		if (fp == NULL)
+			return;
+
+		LR_CHECK_EQ(fwrite(buf, 1, size, fp), size);
+		fclose(fp);
+	}
+
+	void TestEncoding()
+	{
+		// The check value of the standard CRC-32
+		LR_CHECK_EQ(LRProfileFile::Crc32((const uint8_t *)"123456789", 9), 0xCBF43926u);
+
+		LRProfile profile;
+		MakeProfile(&profile);
+
+		// Exactly LR_PROFILE_PAYLOAD_SIZE bytes, and back to the same fields
+		uint8_t buf[LR_PROFILE_PAYLOAD_SIZE + 16];
+		memset(buf, 0xA5, sizeof(buf));
+		LRProfileFile::Encode(&profile, buf);
+		bool guard = true;
+		for (size_t i = LR_PROFILE_PAYLOAD_SIZE; i < sizeof(buf); i++)
+			guard = guard && buf[i] == 0xA5;
+		LR_CHECK(guard);
+
+		LRProfile decoded;
+		memset(&decoded, 0, sizeof(decoded));
+		LRProfileFile::Decode(buf, &decoded);
+		LR_CHECK(memcmp(&profile, &decoded, sizeof(LRProfile)) == 0);
+
+		// Little endian whatever the host
+		LR_CHECK_EQ(buf[0], profile.flags);
+		LR_CHECK_EQ(buf[4], 0xF9);
+		LR_CHECK_EQ(buf[7], 0xFF);
+	}
+
+	void TestRoundTrip()
+	{
+		LRProfile profile;
+		MakeProfile(&profile);
+
+		LR_CHECK_EQ(LRProfileFile::Save(s_path, &profile), 0);
+		LR_CHECK(!FileExists(s_tmpPath));
+		LR_CHECK(!FileExists(s_bakPath));
+
+		LRProfile loaded;
+		memset(&loaded, 0, sizeof(loaded));
+		LR_CHECK_EQ(LRProfileFile::Load(s_path, &loaded), 0);
+		LR_CHECK(memcmp(&profile, &loaded, sizeof(LRProfile)) == 0);
+
+		// Saving again replaces the file
+		profile.evLevel = 13;
+		LR_CHECK_EQ(LRProfileFile::Save(s_path, &profile), 0);
+		LR_CHECK_EQ(LRProfileFile::Load(s_path, &loaded), 0);
+		LR_CHECK_EQ(loaded.evLevel, 13);
+
+		uint8_t file[LR_PROFILE_HEADER_SIZE + LR_PROFILE_PAYLOAD_SIZE + 1];
+		LR_CHECK_EQ(ReadFile(s_path, file, sizeof(file)), LR_PROFILE_HEADER_SIZE + LR_PROFILE_PAYLOAD_SIZE);
+		LR_CHECK(memcmp(file, "LRPF", 4) == 0);
+	}
+
+	// Loads a copy of the saved file changed by the caller, the profile must stay untouched
+	void CheckDamaged(const uint8_t *file, long size, int expected)
+	{
+		WriteFile(s_path, file, size);
+
+		LRProfile loaded;
+		memset(&loaded, 0x5A, sizeof(loaded));
+		LR_CHECK_EQ(LRProfileFile::Load(s_path, &loaded), expected);
+
+		const uint8_t *bytes = (const uint8_t *)&loaded;
+		bool untouched = true;
+		for (size_t i = 0; i < sizeof(loaded); i++)
+			untouched = untouched && bytes[i] == 0x5A;
+		LR_CHECK(untouched);
+	}
+
+	void TestDamaged()
+	{
+		LRProfile profile;
+		MakeProfile(&profile);
+		LR_CHECK_EQ(LRProfileFile::Save(s_path, &profile), 0);
+
+		const long size = LR_PROFILE_HEADER_SIZE + LR_PROFILE_PAYLOAD_SIZE;
+		uint8_t good[LR_PROFILE_HEADER_SIZE + LR_PROFILE_PAYLOAD_SIZE];
+		uint8_t file[LR_PROFILE_HEADER_SIZE + LR_PROFILE_PAYLOAD_SIZE];
+		LR_CHECK_EQ(ReadFile(s_path, good, size), size);
+
+		// One flipped bit anywhere in the payload
+		for (long i = LR_PROFILE_HEADER_SIZE; i < size; i += 37) {
+			memcpy(file, good, size);
+			file[i] ^= 0x10;
+			CheckDamaged(file, size, LR_PROFILE_ERROR_CHECKSUM);
+		}
+
+		// Stored checksum itself damaged
+		memcpy(file, good, size);
+		file[12] ^= 0x01;
+		CheckDamaged(file, size, LR_PROFILE_ERROR_CHECKSUM);
+
+		// Another version or payload size is rejected before the checksum is looked at
+		memcpy(file, good, size);
+		file[4] = LR_PROFILE_VERSION + 1;
+		CheckDamaged(file, size, LR_PROFILE_ERROR_VERSION);
+
+		memcpy(file, good, size);
+		file[8] += 4;
+		CheckDamaged(file, size, LR_PROFILE_ERROR_VERSION);
+
+		memcpy(file, good, size);
+		file[0] = 'X';
+		CheckDamaged(file, size, LR_PROFILE_ERROR_FORMAT);
+
+		// Cut short in the header and in the payload, and empty
+		CheckDamaged(good, LR_PROFILE_HEADER_SIZE - 1, LR_PROFILE_ERROR_FORMAT);
+		CheckDamaged(good, LR_PROFILE_HEADER_SIZE, LR_PROFILE_ERROR_FORMAT);
+		CheckDamaged(good, size - 1, LR_PROFILE_ERROR_FORMAT);
+		CheckDamaged(good, 0, LR_PROFILE_ERROR_FORMAT);
+
+		remove(s_path);
+	}
+
+	void TestInterrupted()
+	{
+		LRProfile profile;
+		LRProfile loaded;
+		MakeProfile(&profile);
+
+		// No profile at all is the first start
+		remove(s_path);
+		remove(s_bakPath);
+		LR_CHECK_EQ(LRProfileFile::Load(s_path, &loaded), LR_PROFILE_ERROR_IO);
+
+		// Stopped after moving the old profile aside: the backup is read
+		LR_CHECK_EQ(LRProfileFile::Save(s_path, &profile), 0);
+		LR_CHECK_EQ(rename(s_path, s_bakPath), 0);
+		memset(&loaded, 0, sizeof(loaded));
+		LR_CHECK_EQ(LRProfileFile::Load(s_path, &loaded), 0);
+		LR_CHECK(memcmp(&profile, &loaded, sizeof(LRProfile)) == 0);
+
+		// The profile wins over a backup left behind
+		profile.evLevel = 3;
+		LR_CHECK_EQ(LRProfileFile::Save(s_path, &profile), 0);
+		LR_CHECK_EQ(LRProfileFile::Load(s_path, &loaded), 0);
+		LR_CHECK_EQ(loaded.evLevel, 3);
+
+		// A damaged profile is reported, not silently replaced by the backup
+		uint8_t file[LR_PROFILE_HEADER_SIZE + LR_PROFILE_PAYLOAD_SIZE];
+		ReadFile(s_path, file, sizeof(file));
+		file[LR_PROFILE_HEADER_SIZE] ^= 0x01;
+		WriteFile(s_path, file, sizeof(file));
+		LR_CHECK_EQ(LRProfileFile::Load(s_path, &loaded), LR_PROFILE_ERROR_CHECKSUM);
+
+		// A write that cannot even start leaves everything as it was
+		char badPath[128];
+		snprintf(badPath, sizeof(badPath), "%s/missing/profile.lrpf", s_dir);
+		LR_CHECK_EQ(LRProfileFile::Save(badPath, &profile), LR_PROFILE_ERROR_IO);
+
+		remove(s_path);
+		remove(s_bakPath);
+		remove(s_tmpPath);
+	}
+}
+
+int main()
+{
+	snprintf(s_dir, sizeof(s_dir), "/tmp/LRProfileTestXXXXXX");
+	if (mkdtemp(s_dir) == NULL) {
+		printf("mkdtemp() failed\n");
+		return 1;
+	}
+	snprintf(s_path, sizeof(s_path), "%s/profile.lrpf", s_dir);
+	snprintf(s_bakPath, sizeof(s_bakPath), "%s.bak", s_path);
+	snprintf(s_tmpPath, sizeof(s_tmpPath), "%s.tmp", s_path);
+
+	TestEncoding();
+	TestRoundTrip();
+	TestDamaged();
+	TestInterrupted();
+
+	rmdir(s_dir);
+
+	return LR_TEST_RESULT();
+}
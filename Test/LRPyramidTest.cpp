@@ -0,0 +1,181 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "LRTest.hpp"
+#include "../LiveRig/LRPyramid.hpp"
+
+// Cross-checks the scalar and NEON downsample paths of LRPyramid and times both. Without NEON
+// on the host the SIMD entry point falls back to the scalar path and only the reference checks
+// and the scalar timing mean anything; run it on an ARM host to check the NEON path.
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define TEST_NEON	"NEON"
+#else
+#define TEST_NEON	"scalar fallback, no NEON on this host"
+#endif
+
+#define TEST_GUARD			0xA5
+#define TEST_BENCH_WIDTH	640
+#define TEST_BENCH_HEIGHT	480
+#define TEST_BENCH_NUM		500
+
+namespace {
+	void FillRandom(unsigned char *data, int32_t size, uint32_t seed)
+	{
+		uint32_t rand = seed;
+
+		for (int32_t i = 0; i < size; i++) {
+			// Runs of the extremes catch overflow and rounding in the 16-bit sums
+			uint32_t r = LRTestRand(&rand);
+			if ((r & 0x300) == 0)
+				data[i] = 255;
+			else if ((r & 0x300) == 0x100)
+				data[i] = 0;
+			else
+				data[i] = (unsigned char)r;
+		}
+	}
+
+	// The definition, independent of both paths
+	unsigned char Reference(const unsigned char *src, int32_t pitch, int32_t x, int32_t y)
+	{
+		const unsigned char *p = src + y * 2 * pitch + x * 2;
+
+		return (unsigned char)((p[0] + p[1] + p[pitch] + p[pitch + 1] + 2) / 4);
+	}
+
+	void TestDownsample()
+	{
+		// Odd and vector multiple widths, tight and padded pitches
+		static const int32_t widths[] = { 16, 17, 31, 32, 33, 47, 63, 64, 65, 95, 127, 161, 320, 641 };
+		static const int32_t pads[] = { 0, 1, 3, 13, 16, 64 };
+		int32_t checkCount = 0;
+
+		for (size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); w++) {
+			for (size_t p = 0; p < sizeof(pads) / sizeof(pads[0]); p++) {
+				const int32_t srcWidth = widths[w];
+				const int32_t srcHeight = 2 * 7 + 1;
+				const int32_t srcPitch = srcWidth + pads[p];
+				const int32_t dstWidth = srcWidth / 2;
+				const int32_t dstHeight = srcHeight / 2;
+				const int32_t dstPitch = dstWidth + pads[p];
+				const int32_t dstSize = dstPitch * dstHeight;
+
+				unsigned char *src = (unsigned char *)malloc(srcPitch * srcHeight);
+				unsigned char *scalar = (unsigned char *)malloc(dstSize);
+				unsigned char *simd = (unsigned char *)malloc(dstSize);
+
+				FillRandom(src, srcPitch * srcHeight, (uint32_t)(w * 31 + p));
+				memset(scalar, TEST_GUARD, dstSize);
+				memset(simd, TEST_GUARD, dstSize);
+
+				LRPyramid::Downsample2xScalar(src, srcPitch, scalar, dstPitch, dstWidth, dstHeight);
+				LRPyramid::Downsample2xSimd(src, srcPitch, simd, dstPitch, dstWidth, dstHeight);
+
+				// Bit-exact, padding included: neither path may write past the width
+				bool same = memcmp(scalar, simd, dstSize) == 0;
+				LR_CHECK(same);
+				if (!same)
+					printf("  width %d pitch %d differs\n", srcWidth, srcPitch);
+
+				for (int32_t y = 0; y < dstHeight; y++) {
+					for (int32_t x = 0; x < dstPitch; x++) {
+						unsigned char expected = x < dstWidth ? Reference(src, srcPitch, x, y) : TEST_GUARD;
+						if (scalar[y * dstPitch + x] != expected) {
+							LR_CHECK_EQ(scalar[y * dstPitch + x], expected);
+							y = dstHeight;
+							break;
+						}
+					}
+				}
+
+				free(src);
+				free(scalar);
+				free(simd);
+				checkCount++;
+			}
+		}
+
+		printf("downsample: %d layouts bit-exact (%s)\n", checkCount, TEST_NEON);
+	}
+
+	void TestPyramid()
+	{
+		// An odd source whose levels end up with odd widths and padded pitches
+		const int32_t width = 322;
+		const int32_t height = 242;
+		unsigned char *src = (unsigned char *)malloc(width * height);
+		FillRandom(src, width * height, 7);
+
+		LRPyramid scalar;
+		LRPyramid simd;
+		LR_CHECK_EQ(scalar.Init(width, height, LR_PYRAMID_LEVEL_MAX), 0);
+		LR_CHECK_EQ(simd.Init(width, height, LR_PYRAMID_LEVEL_MAX), 0);
+		scalar.SetSimd(false);
+		simd.SetSimd(true);
+
+		scalar.Build(src, width, 1);
+		simd.Build(src, width, 1);
+
+		LR_CHECK_EQ(scalar.GetLevelNum(), simd.GetLevelNum());
+		for (int32_t i = 1; i < scalar.GetLevelNum(); i++) {
+			const LRPyramidLevel *a = scalar.GetLevel(i);
+			const LRPyramidLevel *b = simd.GetLevel(i);
+
+			LR_CHECK_EQ(a->width, width >> i);
+			LR_CHECK_EQ(a->pitch % 16, 0);
+			LR_CHECK_EQ((uintptr_t)a->data % 64, 0);
+			for (int32_t y = 0; y < a->height; y++)
+				LR_CHECK(memcmp(a->data + y * a->pitch, b->data + y * b->pitch, a->width) == 0);
+		}
+
+		// Same id and source: nothing is rebuilt, a new id rebuilds
+		memset(src, 0, width * height);
+		simd.Build(src, width, 1);
+		LR_CHECK(simd.GetLevel(1)->data[0] == scalar.GetLevel(1)->data[0]);
+		simd.Build(src, width, 2);
+		LR_CHECK_EQ(simd.GetLevel(1)->data[0], 0);
+
+		free(src);
+	}
+
+	double Bench(LRPyramid *pyramid, const unsigned char *src, int32_t pitch)
+	{
+		uint64_t begin = LRTestTime();
+
+		for (uint32_t i = 0; i < TEST_BENCH_NUM; i++)
+			pyramid->Build(src, pitch, i + 1);
+
+		return (double)(LRTestTime() - begin) / TEST_BENCH_NUM;
+	}
+
+	void BenchPyramid()
+	{
+		unsigned char *src = (unsigned char *)malloc(TEST_BENCH_WIDTH * TEST_BENCH_HEIGHT);
+		FillRandom(src, TEST_BENCH_WIDTH * TEST_BENCH_HEIGHT, 3);
+
+		LRPyramid pyramid;
+		pyramid.Init(TEST_BENCH_WIDTH, TEST_BENCH_HEIGHT, 4);
+
+		pyramid.SetSimd(false);
+		double scalar = Bench(&pyramid, src, TEST_BENCH_WIDTH);
+		pyramid.SetSimd(true);
+		double simd = Bench(&pyramid, src, TEST_BENCH_WIDTH);
+
+		printf("build %dx%d, 4 levels: scalar %.1f us, simd %.1f us (%s)\n",
+			TEST_BENCH_WIDTH, TEST_BENCH_HEIGHT, scalar, simd, TEST_NEON);
+
+		free(src);
+	}
+}
+
+int main()
+{
+	TestDownsample();
+	TestPyramid();
+	BenchPyramid();
+
+	return LR_TEST_RESULT();
+}
@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+
+#include "LRTest.hpp"
+#include "../LiveRig/LRSeqlock.hpp"
+
+// One writer against several readers of an LRSeqlock. Every word of a snapshot is derived
+// from the write it belongs to, so a read that mixes two writes shows up as a torn snapshot.
+
+#define TEST_READER_NUM		3
+// Neither side yields, so that on a single core they are preempted at arbitrary points
+// and copies are regularly interrupted half way
+#define TEST_DURATION		(500 * 1000)
+#define TEST_WORD_NUM		1024
+
+namespace {
+	struct Snapshot
+	{
+		uint32_t version;
+		uint32_t word[TEST_WORD_NUM];
+	};
+
+	void Make(Snapshot *snapshot, uint32_t version)
+	{
+		snapshot->version = version;
+		for (uint32_t i = 0; i < TEST_WORD_NUM; i++)
+			snapshot->word[i] = version * 2654435761u + i;
+	}
+
+	// Before the first write the value is all zero
+	bool IsConsistent(const Snapshot *snapshot)
+	{
+		for (uint32_t i = 0; i < TEST_WORD_NUM; i++) {
+			uint32_t expected = snapshot->version != 0 ? snapshot->version * 2654435761u + i : 0;
+			if (snapshot->word[i] != expected)
+				return false;
+		}
+
+		return true;
+	}
+
+	void TestSingleThread()
+	{
+		LRSeqlock<Snapshot> *lock = new LRSeqlock<Snapshot>();
+		Snapshot *snapshot = new Snapshot();
+
+		// Nothing written yet reads as zero
+		LR_CHECK_EQ(lock->GetVersion(), 0);
+		LR_CHECK_EQ(lock->Read(snapshot), 0);
+		LR_CHECK_EQ(snapshot->version, 0);
+
+		for (uint32_t v = 1; v <= 3; v++) {
+			Make(snapshot, v);
+			lock->Write(*snapshot);
+		}
+
+		memset(snapshot, 0, sizeof(Snapshot));
+		LR_CHECK_EQ(lock->Read(snapshot), 3);
+		LR_CHECK_EQ(lock->GetVersion(), 3);
+		LR_CHECK(snapshot->version == 3 && IsConsistent(snapshot));
+
+		delete snapshot;
+		delete lock;
+	}
+
+	struct StressState
+	{
+		LRSeqlock<Snapshot> lock;
+		std::atomic<bool> done;
+		uint32_t writeCount;
+		uint32_t readCount[TEST_READER_NUM];
+	};
+
+	void Writer(StressState *state)
+	{
+		Snapshot *snapshot = new Snapshot();
+		uint64_t end = LRTestTime() + TEST_DURATION;
+
+		while (LRTestTime() < end) {
+			Make(snapshot, state->writeCount + 1);
+			state->lock.Write(*snapshot);
+			state->writeCount++;
+		}
+
+		state->done.store(true);
+		delete snapshot;
+	}
+
+	void Reader(StressState *state, int index)
+	{
+		Snapshot *snapshot = new Snapshot();
+		uint32_t last = 0;
+		uint32_t torn = 0;
+
+		while (!state->done.load()) {
+			uint32_t version = state->lock.Read(snapshot);
+
+			// The returned write count is the one the snapshot came from, and never goes back
+			if (!IsConsistent(snapshot) || snapshot->version != version)
+				torn++;
+			LR_CHECK(version >= last);
+			last = version;
+
+			state->readCount[index]++;
+		}
+
+		LR_CHECK_EQ(torn, 0);
+		delete snapshot;
+	}
+
+	void TestStress()
+	{
+		StressState *state = new StressState();
+		state->done.store(false);
+		state->writeCount = 0;
+
+		std::thread readers[TEST_READER_NUM];
+		for (int i = 0; i < TEST_READER_NUM; i++) {
+			state->readCount[i] = 0;
+			readers[i] = std::thread(Reader, state, i);
+		}
+
+		uint64_t begin = LRTestTime();
+		Writer(state);
+
+		for (int i = 0; i < TEST_READER_NUM; i++)
+			readers[i].join();
+
+		Snapshot *snapshot = new Snapshot();
+		LR_CHECK(state->writeCount > 0);
+		LR_CHECK_EQ(state->lock.Read(snapshot), state->writeCount);
+		LR_CHECK(IsConsistent(snapshot));
+
+		printf("stress: %u writes of %u bytes in %.1f ms, reads %u/%u/%u\n", state->writeCount, (uint32_t)sizeof(Snapshot),
+			(LRTestTime() - begin) / 1000.0f, state->readCount[0], state->readCount[1], state->readCount[2]);
+
+		delete snapshot;
+		delete state;
+	}
+}
+
+int main()
+{
+	TestSingleThread();
+	TestStress();
+
+	return LR_TEST_RESULT();
+}
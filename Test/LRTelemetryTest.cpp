@@ -0,0 +1,192 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "LRTest.hpp"
+#include "../LiveRig/LRTelemetry.hpp"
+
+// Drives LRTelemetry the way the tracking thread does: counters that never go back, histogram
+// windows that roll over with the capture time, also when it jumps back on a replay, stats that
+// merge the previous and the current window, and the span they report.
+
+#define TEST_WINDOW		1000000
+#define TEST_BEGIN		5000000
+
+namespace {
+	bool CountersNotBelow(const LRTelemetryStats *a, const LRTelemetryStats *b)
+	{
+		bool ok = a->frameCount >= b->frameCount && a->frameSkipCount >= b->frameSkipCount &&
+			a->frameDropCount >= b->frameDropCount;
+
+		for (int32_t i = 0; i < LR_TELEMETRY_EVENT_NUM; i++)
+			ok = ok && a->eventCount[i] >= b->eventCount[i];
+		for (int32_t i = 0; i < LR_TELEMETRY_STAGE_NUM; i++)
+			ok = ok && a->stageCount[i] >= b->stageCount[i] && a->stageTime[i] >= b->stageTime[i];
+		for (int32_t i = 0; i < LR_TELEMETRY_LOCK_NUM; i++)
+			ok = ok && a->lockCount[i] >= b->lockCount[i] && a->lockWait[i] >= b->lockWait[i];
+
+		return ok;
+	}
+
+	void TestCounters()
+	{
+		LRTelemetry telemetry;
+		telemetry.SetWindow(TEST_WINDOW);
+
+		LRTelemetryStats prev;
+		LRTelemetryStats stats;
+		telemetry.GetStats(&prev);
+		LR_CHECK_EQ(prev.frameCount, 0);
+		LR_CHECK_EQ(prev.window, 0);
+
+		// Ten windows of 30 fps, with the clock going back once halfway as on a replay restart
+		uint32_t rand = 7;
+		uint64_t time = TEST_BEGIN;
+		bool monotonic = true;
+		uint64_t stageTime = 0;
+
+		for (int32_t n = 0; n < 300; n++) {
+			time = n == 150 ? TEST_BEGIN : time + 33333;
+
+			telemetry.AddFrame(time, n % 10 == 0 ? 2 : 0);
+			if (n % 7 == 0)
+				telemetry.AddDrop();
+			telemetry.AddEvent(n % LR_TELEMETRY_EVENT_NUM);
+
+			uint32_t t = 100 + LRTestRand(&rand) % 5000;
+			telemetry.AddStage(LR_TELEMETRY_STAGE_TRACK, t);
+			stageTime += t;
+			telemetry.AddLockWait(LR_TELEMETRY_LOCK_FACE, n % 3);
+			telemetry.AddScore(0.8f);
+
+			telemetry.GetStats(&stats);
+			monotonic = monotonic && CountersNotBelow(&stats, &prev);
+			prev = stats;
+		}
+
+		// Window roll-overs only affect the histograms
+		LR_CHECK(monotonic);
+		LR_CHECK_EQ(stats.frameCount, 300);
+		LR_CHECK_EQ(stats.frameSkipCount, 60);
+		LR_CHECK_EQ(stats.frameDropCount, 43);
+		for (int32_t i = 0; i < LR_TELEMETRY_EVENT_NUM; i++)
+			LR_CHECK_EQ(stats.eventCount[i], 60);
+		LR_CHECK_EQ(stats.stageCount[LR_TELEMETRY_STAGE_TRACK], 300);
+		LR_CHECK(stats.stageTime[LR_TELEMETRY_STAGE_TRACK] == stageTime);
+		LR_CHECK_EQ(stats.stageCount[LR_TELEMETRY_STAGE_DETECT], 0);
+		LR_CHECK_EQ(stats.lockCount[LR_TELEMETRY_LOCK_FACE], 300);
+		LR_CHECK_EQ(stats.lockWait[LR_TELEMETRY_LOCK_FACE], 300);
+		LR_CHECK(stats.stageHist[LR_TELEMETRY_STAGE_TRACK].GetCount() < 300);
+
+		telemetry.Reset();
+		telemetry.GetStats(&stats);
+		LR_CHECK_EQ(stats.frameCount, 0);
+		LR_CHECK_EQ(stats.stageTime[LR_TELEMETRY_STAGE_TRACK], 0);
+		LR_CHECK_EQ(stats.stageHist[LR_TELEMETRY_STAGE_TRACK].GetCount(), 0);
+		LR_CHECK_EQ(stats.window, 0);
+	}
+
+	void TestWindow()
+	{
+		LRTelemetry telemetry;
+		telemetry.SetWindow(TEST_WINDOW);
+		LRTelemetryStats stats;
+
+		// First window, nothing before it
+		telemetry.AddFrame(TEST_BEGIN, 0);
+		telemetry.AddStage(LR_TELEMETRY_STAGE_FIT, 100);
+		telemetry.AddScore(0.25f);
+		telemetry.AddFrame(TEST_BEGIN + 400000, 0);
+		telemetry.GetStats(&stats);
+		LR_CHECK_EQ(stats.window, 400000);
+		LR_CHECK_EQ(stats.stageHist[LR_TELEMETRY_STAGE_FIT].GetCount(), 1);
+
+		// Due: the first window becomes the previous one and both are merged
+		telemetry.AddFrame(TEST_BEGIN + TEST_WINDOW, 0);
+		telemetry.AddStage(LR_TELEMETRY_STAGE_FIT, 300);
+		telemetry.AddScore(0.75f);
+		telemetry.GetStats(&stats);
+		LR_CHECK_EQ(stats.window, TEST_WINDOW);
+		LR_CHECK_EQ(stats.stageHist[LR_TELEMETRY_STAGE_FIT].GetCount(), 2);
+		LR_CHECK_EQ(stats.stageHist[LR_TELEMETRY_STAGE_FIT].GetMin(), 100);
+		LR_CHECK_EQ(stats.stageHist[LR_TELEMETRY_STAGE_FIT].GetMax(), 300);
+		LR_CHECK_EQ(stats.stageHist[LR_TELEMETRY_STAGE_FIT].GetMean(), 200);
+		LR_CHECK_EQ(stats.scoreHist.GetCount(), 2);
+		LR_CHECK_EQ(stats.scoreHist.GetMin(), 250);
+		LR_CHECK_EQ(stats.scoreHist.GetMax(), 750);
+
+		telemetry.AddFrame(TEST_BEGIN + TEST_WINDOW + 600000, 0);
+		telemetry.GetStats(&stats);
+		LR_CHECK_EQ(stats.window, TEST_WINDOW + 600000);
+
+		// A late roll-over spans the time since the last one, the oldest samples go
+		telemetry.AddFrame(TEST_BEGIN + 2 * TEST_WINDOW + 200000, 0);
+		telemetry.AddStage(LR_TELEMETRY_STAGE_FIT, 500);
+		telemetry.GetStats(&stats);
+		LR_CHECK_EQ(stats.window, TEST_WINDOW + 200000);
+		LR_CHECK_EQ(stats.stageHist[LR_TELEMETRY_STAGE_FIT].GetCount(), 2);
+		LR_CHECK_EQ(stats.stageHist[LR_TELEMETRY_STAGE_FIT].GetMin(), 300);
+		LR_CHECK_EQ(stats.scoreHist.GetCount(), 1);
+
+		// The clock going back restarts the current window there without dropping samples
+		telemetry.AddFrame(TEST_BEGIN, 0);
+		telemetry.AddStage(LR_TELEMETRY_STAGE_FIT, 700);
+		telemetry.GetStats(&stats);
+		LR_CHECK_EQ(stats.window, TEST_WINDOW + 200000);
+		LR_CHECK_EQ(stats.stageHist[LR_TELEMETRY_STAGE_FIT].GetCount(), 3);
+
+		telemetry.AddFrame(TEST_BEGIN + TEST_WINDOW - 1, 0);
+		telemetry.GetStats(&stats);
+		LR_CHECK_EQ(stats.window, TEST_WINDOW + 200000 + TEST_WINDOW - 1);
+		LR_CHECK_EQ(stats.stageHist[LR_TELEMETRY_STAGE_FIT].GetCount(), 3);
+
+		// And rolls over one window after it
+		telemetry.AddFrame(TEST_BEGIN + TEST_WINDOW, 0);
+		telemetry.GetStats(&stats);
+		LR_CHECK_EQ(stats.window, TEST_WINDOW);
+		LR_CHECK_EQ(stats.stageHist[LR_TELEMETRY_STAGE_FIT].GetCount(), 2);
+		LR_CHECK_EQ(stats.stageHist[LR_TELEMETRY_STAGE_FIT].GetMin(), 500);
+		LR_CHECK_EQ(stats.stageHist[LR_TELEMETRY_STAGE_FIT].GetMax(), 700);
+
+		// Two roll-overs without samples in between leave nothing
+		telemetry.AddFrame(TEST_BEGIN + 2 * TEST_WINDOW, 0);
+		telemetry.AddFrame(TEST_BEGIN + 3 * TEST_WINDOW, 0);
+		telemetry.GetStats(&stats);
+		LR_CHECK_EQ(stats.stageHist[LR_TELEMETRY_STAGE_FIT].GetCount(), 0);
+		LR_CHECK_EQ(stats.stageCount[LR_TELEMETRY_STAGE_FIT], 4);
+	}
+
+	void TestStageRuns()
+	{
+		LRTelemetry telemetry;
+		LRTelemetryStats stats;
+
+		// Detection results the tracker never took are counted with their total time
+		telemetry.AddFrame(TEST_BEGIN, 0);
+		telemetry.AddStage(LR_TELEMETRY_STAGE_DETECT, 4000);
+		telemetry.AddStageRuns(LR_TELEMETRY_STAGE_DETECT, 3, 15000);
+		telemetry.AddStageRuns(LR_TELEMETRY_STAGE_DETECT, 0, 0);
+		telemetry.GetStats(&stats);
+
+		LR_CHECK_EQ(stats.stageCount[LR_TELEMETRY_STAGE_DETECT], 4);
+		LR_CHECK_EQ(stats.stageTime[LR_TELEMETRY_STAGE_DETECT], 19000);
+		LR_CHECK_EQ(stats.stageHist[LR_TELEMETRY_STAGE_DETECT].GetCount(), 4);
+		LR_CHECK_EQ(stats.stageHist[LR_TELEMETRY_STAGE_DETECT].GetMin(), 4000);
+		LR_CHECK_EQ(stats.stageHist[LR_TELEMETRY_STAGE_DETECT].GetMax(), 5000);
+
+		// Scores below 0 are kept as 0
+		telemetry.AddScore(-0.5f);
+		telemetry.GetStats(&stats);
+		LR_CHECK_EQ(stats.scoreHist.GetCount(), 1);
+		LR_CHECK_EQ(stats.scoreHist.GetMax(), 0);
+	}
+}
+
+int main()
+{
+	TestCounters();
+	TestWindow();
+	TestStageRuns();
+
+	return LR_TEST_RESULT();
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include <atomic>
+
+// Checks shared by the host tests. Every test is its own executable, a failed check is reported
+// and counted, from any thread, but does not stop the test, main() returns LR_TEST_RESULT().
+
+static std::atomic<int> s_testFailCount(0);
+
+#define LR_CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			s_testFailCount++; \
+		} \
+	} while (0)
+
+#define LR_CHECK_EQ(a, b) \
+	do { \
+		long long _a = (long long)(a); \
+		long long _b = (long long)(b); \
+		if (_a != _b) { \
+			printf("%s:%d: check failed: %s == %s (%lld, %lld)\n", __FILE__, __LINE__, #a, #b, _a, _b); \
+			s_testFailCount++; \
+		} \
+	} while (0)
+
+#define LR_CHECK_NEAR(a, b, eps) \
+	do { \
+		double _a = (double)(a); \
+		double _b = (double)(b); \
+		if (!(_a - _b <= (eps) && _b - _a <= (eps))) { \
+			printf("%s:%d: check failed: %s ~ %s (%f, %f)\n", __FILE__, __LINE__, #a, #b, _a, _b); \
+			s_testFailCount++; \
+		} \
+	} while (0)
+
+#define LR_TEST_RESULT() \
+	(printf("%s: %d failed checks\n", __FILE__, s_testFailCount.load()), s_testFailCount.load() == 0 ? 0 : 1)
+
+// Monotonic microseconds, the host stand-in for sceKernelGetProcessTimeWide()
+static inline uint64_t LRTestTime()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Deterministic generator so that failures can be reproduced
+static inline uint32_t LRTestRand(uint32_t *state)
+{
+	*state = *state * 1664525u + 1013904223u;
+
+	return *state >> 8;
+}